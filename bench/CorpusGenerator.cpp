@@ -0,0 +1,449 @@
+#include "CorpusGenerator.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// How each shape draws its functions
+struct ShapeProfile {
+    uint32_t minStatements , maxStatements; // top level of a function body
+    uint32_t minBlock , maxBlock;           // statements in a nested block
+    int exprDepth;                          // binary operators nested below a statement
+    int blockDepth;                         // control statements nested in a function
+    uint32_t controlPercent;                // if / while / for , while under blockDepth
+    uint32_t matchPercent;
+    uint32_t minArms , maxArms;
+    uint32_t maxParams;
+    uint32_t deepPercent;                   // statements whose expression is a deep chain
+    uint32_t minDeep , maxDeep;             // parentheses in such a chain
+    size_t functionBytes;                   // soft cap on one function's text
+};
+
+constexpr ShapeProfile PROFILES[] = {
+    // MIXED
+    {3 , 20 , 1 , 5 , 3 , 3 , 15 , 6 , 3 , 12 , 3 , 2 , 8 , 24 , 16 * 1024},
+    // DEEP
+    {2 , 5 , 1 , 3 , 2 , 24 , 60 , 5 , 2 , 6 , 3 , 50 , 30 , 200 , 64 * 1024},
+    // LONG
+    {300 , 2000 , 1 , 4 , 3 , 2 , 12 , 4 , 3 , 10 , 3 , 0 , 0 , 0 , 256 * 1024},
+    // SMALL
+    {1 , 3 , 1 , 2 , 2 , 1 , 10 , 3 , 2 , 5 , 2 , 0 , 0 , 0 , 1024},
+    // MATCH
+    {3 , 10 , 1 , 3 , 2 , 3 , 10 , 60 , 4 , 64 , 3 , 0 , 0 , 0 , 64 * 1024},
+};
+
+// Locals (let and var , `let _` included) live at once before new
+// declarations stop , the compiler allows 255 frame slots
+constexpr size_t MAX_LIVE = 64;
+// Earlier functions a call picks from , keeps callees close like real code
+constexpr uint32_t CALL_WINDOW = 64;
+// Running a corpus stays cheap at any nesting : the trip counts of the loops
+// around a statement multiply to at most MAX_TRIPS , and one call of a
+// function runs at most MAX_COST statements , its callees' included
+constexpr uint64_t MAX_TRIPS = 64;
+constexpr uint64_t MAX_COST = 1 << 16;
+
+const char* const WORDS[] = {
+    "count" , "total" , "value" , "index" , "acc" , "step" , "limit" , "left" ,
+    "right" , "sum" , "key" , "width" , "offset" , "delta" , "score" , "depth"
+};
+constexpr uint32_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+const char* const VERBS[] = {
+    "parse" , "scan" , "update" , "compute" , "check" , "merge" , "apply" , "reduce" ,
+    "visit" , "emit" , "load" , "store" , "split" , "build" , "rank" , "walk"
+};
+constexpr uint32_t VERB_COUNT = sizeof(VERBS) / sizeof(VERBS[0]);
+
+const char* const ARITHMETIC[] = {" + " , " - " , " * " , " / " , " % "};
+const char* const COMPARISON[] = {" < " , " <= " , " > " , " >= " , " == " , " != "};
+const char* const LOGICAL[] = {" && " , " || "};
+
+uint64_t splitmix(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+std::string functionName(size_t index) {
+    return std::string(VERBS[index % VERB_COUNT]) + "_" + std::to_string(index);
+}
+
+} // namespace
+
+const char* shapeName(CorpusShape shape) {
+    switch(shape) {
+        case CorpusShape::MIXED : return "mixed";
+        case CorpusShape::DEEP : return "deep";
+        case CorpusShape::LONG : return "long";
+        case CorpusShape::SMALL : return "small";
+        case CorpusShape::MATCH : return "match";
+    }
+    return "?";
+}
+
+bool parseShape(std::string_view text , CorpusShape& shape) {
+    for(CorpusShape s : {CorpusShape::MIXED , CorpusShape::DEEP , CorpusShape::LONG , CorpusShape::SMALL , CorpusShape::MATCH}) {
+        if(text == shapeName(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSize(std::string_view text , size_t& bytes) {
+    size_t digits = 0;
+    uint64_t value = 0;
+    while(digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+        value = value * 10 + static_cast<uint64_t>(text[digits] - '0');
+        if(value > (uint64_t(1) << 40)) return false;
+        digits++;
+    }
+    if(digits == 0) return false;
+    std::string_view unit = text.substr(digits);
+    if(unit == "" || unit == "B") bytes = value;
+    else if(unit == "KB" || unit == "K") bytes = value << 10;
+    else if(unit == "MB" || unit == "M") bytes = value << 20;
+    else if(unit == "GB" || unit == "G") bytes = value << 30;
+    else return false;
+    return bytes > 0;
+}
+
+CorpusGenerator::CorpusGenerator(CorpusShape shape , uint64_t seed)
+    : shape(shape) , limit(0) , indent(0) , nextName(0) , trips(1) , cost(0) {
+    uint64_t x = seed;
+    state[0] = splitmix(x);
+    state[1] = splitmix(x);
+}
+
+uint64_t CorpusGenerator::next() {
+    uint64_t s1 = state[0];
+    const uint64_t s0 = state[1];
+    state[0] = s0;
+    s1 ^= s1 << 23;
+    state[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+    return state[1] + s0;
+}
+
+void CorpusGenerator::newline() {
+    out += '\n';
+    out.append(static_cast<size_t>(indent) * 4 , ' ');
+}
+
+std::string CorpusGenerator::freshName(const char* prefix) {
+    return std::string(prefix) + std::to_string(nextName++ % 1000);
+}
+
+void CorpusGenerator::generate(std::string& text , size_t bytes) {
+    size_t start = text.size();
+    while(text.size() - start < bytes) {
+        function(bytes - (text.size() - start));
+        text += out;
+    }
+    mainFunction();
+    text += out;
+}
+
+void CorpusGenerator::write(std::ostream& stream , size_t bytes) {
+    size_t written = 0;
+    while(written < bytes) {
+        function(bytes - written);
+        stream.write(out.data() , static_cast<std::streamsize>(out.size()));
+        written += out.size();
+    }
+    mainFunction();
+    stream.write(out.data() , static_cast<std::streamsize>(out.size()));
+}
+
+void CorpusGenerator::function(size_t budget) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    out.clear();
+    locals.clear();
+    indent = 0;
+    nextName = 0;
+    trips = 1;
+    cost = 0;
+    limit = std::min(budget , p.functionBytes);
+
+    uint32_t params = below(p.maxParams + 1);
+    out += "fn " + functionName(arities.size()) + "(";
+    for(uint32_t i = 0; i < params; i++) {
+        locals.push_back(Local{std::string(WORDS[(i + arities.size()) % WORD_COUNT]) + "_in" , false});
+        if(i > 0) out += " , ";
+        out += locals.back().name;
+    }
+    out += ") {";
+
+    indent = 1;
+    uint32_t statements = between(p.minStatements , p.maxStatements);
+    for(uint32_t i = 0; i < statements && out.size() < limit; i++) {
+        newline();
+        statement(0);
+    }
+    newline();
+    out += "return ";
+    expression(0);
+    out += ";\n}\n\n";
+    indent = 0;
+    arities.push_back(static_cast<uint8_t>(params));
+    costs.push_back(cost);
+}
+
+void CorpusGenerator::mainFunction() {
+    out = "fn main() {";
+    indent = 1;
+    locals.clear();
+    size_t first = arities.size() > 4 ? arities.size() - 4 : 0;
+    for(size_t f = first; f < arities.size(); f++) {
+        newline();
+        out += "let _ = print(" + functionName(f) + "(";
+        for(uint8_t a = 0; a < arities[f]; a++) {
+            if(a > 0) out += " , ";
+            out += std::to_string(between(1 , 9));
+        }
+        out += "));";
+    }
+    newline();
+    out += "return 0;\n}\n";
+    indent = 0;
+}
+
+void CorpusGenerator::block(int depth , std::string_view tail) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    size_t mark = locals.size();
+    indent++;
+    uint32_t statements = between(p.minBlock , p.maxBlock);
+    for(uint32_t i = 0; i < statements && out.size() < limit; i++) {
+        newline();
+        statement(depth);
+    }
+    if(!tail.empty()) {
+        newline();
+        out += tail;
+    }
+    indent--;
+    locals.resize(mark);
+    newline();
+}
+
+void CorpusGenerator::statement(int depth) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    cost += trips;
+    if(depth < p.blockDepth) {
+        if(chance(p.matchPercent)) return matchStatement(depth);
+        if(chance(p.controlPercent)) {
+            switch(below(3)) {
+                case 0 : return ifStatement(depth);
+                case 1 : return whileStatement(depth);
+                default : return forStatement(depth);
+            }
+        }
+    }
+
+    const Local* target = nullptr;
+    uint32_t roll = below(100);
+    bool full = locals.size() >= MAX_LIVE;
+    if(roll >= 45 || full) {
+        // A random mutable local , looking at 8 from a random start (all of
+        // them once the frame is full)
+        size_t start = locals.empty() ? 0 : below(static_cast<uint32_t>(locals.size()));
+        size_t scan = full ? locals.size() : std::min<size_t>(8 , locals.size());
+        for(size_t i = 0; i < scan && !target; i++) {
+            const Local& l = locals[(start + i) % locals.size()];
+            if(l.mutable_) target = &l;
+        }
+    }
+    if(target) {
+        out += target->name + " = ";
+        expression(0);
+        out += ";";
+        return;
+    }
+    if(full) roll = 30; // nothing to assign to , one `var` over the soft limit gives the next ones a target
+
+    Local local;
+    if(roll < 25) {
+        local = Local{freshName(WORDS[below(WORD_COUNT)]) , false};
+        out += "let " + local.name + " = ";
+    } else if(roll < 37) {
+        local = Local{freshName(WORDS[below(WORD_COUNT)]) , true};
+        out += "var " + local.name + " = ";
+    } else {
+        // Strings only reach print , so the arithmetic never mixes types
+        local = Local{"_" , false};
+        out += "let _ = print(";
+        if(roll < 50) out += "\"" + std::string(WORDS[below(WORD_COUNT)]) + " =\" , ";
+    }
+    if(chance(p.deepPercent)) deepExpression(between(p.minDeep , p.maxDeep));
+    else expression(0);
+    out += local.name == "_" ? ");" : ";";
+    locals.push_back(std::move(local)); // bound after its initializer , as the resolver does
+}
+
+void CorpusGenerator::ifStatement(int depth) {
+    out += "if (";
+    expression(1);
+    out += COMPARISON[below(6)];
+    expression(1);
+    out += ") {";
+    block(depth + 1);
+    out += "}";
+    while(chance(25)) {
+        out += " else if (";
+        leaf(1);
+        out += COMPARISON[below(6)];
+        expression(1);
+        out += ") {";
+        block(depth + 1);
+        out += "}";
+    }
+    if(chance(50)) {
+        out += " else {";
+        block(depth + 1);
+        out += "}";
+    }
+}
+
+void CorpusGenerator::whileStatement(int depth) {
+    // The counter is never picked for assignment , only the tail bumps it
+    std::string counter = freshName("n");
+    out += "var " + counter + " = 0;";
+    locals.push_back(Local{counter , false});
+    newline();
+    uint32_t count = tripCount();
+    out += "while (" + counter + " < " + std::to_string(count) + ") {";
+    trips *= count;
+    block(depth + 1 , counter + " = " + counter + " + 1;");
+    trips /= count;
+    out += "}";
+}
+
+// 1 to 8 , less once the loops around have used up MAX_TRIPS
+uint32_t CorpusGenerator::tripCount() {
+    return between(1 , static_cast<uint32_t>(std::min<uint64_t>(8 , std::max<uint64_t>(1 , MAX_TRIPS / trips))));
+}
+
+void CorpusGenerator::forStatement(int depth) {
+    std::string iterator = freshName("i");
+    uint32_t count = tripCount();
+    out += "for " + iterator + " in " + std::to_string(count) + " {";
+    size_t mark = locals.size();
+    locals.push_back(Local{iterator , false});
+    trips *= count;
+    block(depth + 1);
+    trips /= count;
+    locals.resize(mark);
+    out += "}";
+}
+
+void CorpusGenerator::matchStatement(int depth) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    out += "match ";
+    leaf(1);
+    out += " {";
+    indent++;
+
+    uint32_t arms = between(p.minArms , p.maxArms);
+    uint32_t kind = below(4); // dense ints , sparse ints , strings , floats
+    uint32_t base = below(100);
+    for(uint32_t k = 0; k < arms && (k < p.minArms || out.size() < limit); k++) {
+        newline();
+        switch(kind) {
+            case 0 : out += std::to_string(base + k); break;
+            case 1 : out += std::to_string(base + k * 7919 + (k % 3) * 100003); break;
+            case 2 : out += "\"" + std::string(WORDS[k % WORD_COUNT]) + "_" + std::to_string(k) + "\""; break;
+            default : out += std::to_string(base + k) + "." + std::to_string(1 + below(9)); break;
+        }
+        out += " => ";
+        if(chance(50)) {
+            out += "{";
+            block(depth + 1);
+            out += "}";
+        } else {
+            // Single simple statement (a while would be two) , the comma
+            // keeps the next pattern apart
+            size_t mark = locals.size();
+            statement(p.blockDepth);
+            locals.resize(mark);
+            out += " ,";
+        }
+    }
+    if(chance(70)) {
+        newline();
+        out += "_ => return ";
+        expression(1);
+        out += ";";
+    }
+    indent--;
+    newline();
+    out += "}";
+}
+
+void CorpusGenerator::expression(int depth) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    if(depth >= p.exprDepth || chance(30)) return leaf(depth);
+
+    bool grouped = chance(20);
+    if(grouped) out += "(";
+    expression(depth + 1);
+    uint32_t roll = below(100);
+    if(roll < 60) {
+        uint32_t op = below(5);
+        out += ARITHMETIC[op];
+        if(op >= 3) out += std::to_string(between(1 , 16)); // never divide by zero
+        else expression(depth + 1);
+    } else {
+        out += roll < 90 ? COMPARISON[below(6)] : LOGICAL[below(2)];
+        expression(depth + 1);
+    }
+    if(grouped) out += ")";
+}
+
+void CorpusGenerator::deepExpression(uint32_t levels) {
+    // Left leaning so nesting grows the parser's recursion , not the
+    // registers the compiler needs to evaluate it
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    out.append(levels , '(');
+    leaf(p.exprDepth);
+    for(uint32_t i = 0; i < levels; i++) {
+        uint32_t op = below(5);
+        out += ARITHMETIC[op];
+        if(op >= 3) out += std::to_string(between(1 , 16));
+        else leaf(p.exprDepth);
+        out += ")";
+    }
+}
+
+void CorpusGenerator::leaf(int depth) {
+    const ShapeProfile& p = PROFILES[static_cast<size_t>(shape)];
+    uint32_t roll = below(100);
+    if(roll < 8 && depth < p.exprDepth && !arities.empty()) return call(depth);
+    if(roll < 55 && !locals.empty()) {
+        const Local& l = locals[below(static_cast<uint32_t>(locals.size()))];
+        if(l.name != "_") {
+            out += l.name;
+            return;
+        }
+    }
+    if(roll < 85) out += std::to_string(below(1000));
+    else out += std::to_string(below(100)) + "." + std::to_string(below(100));
+}
+
+void CorpusGenerator::call(int depth) {
+    uint32_t window = std::min<uint32_t>(CALL_WINDOW , static_cast<uint32_t>(arities.size()));
+    size_t callee = arities.size() - 1 - below(window);
+    if(cost + costs[callee] * trips > MAX_COST) {
+        // Too much work from here , a literal instead
+        out += std::to_string(below(1000));
+        return;
+    }
+    cost += costs[callee] * trips;
+    out += functionName(callee) + "(";
+    for(uint8_t a = 0; a < arities[callee]; a++) {
+        if(a > 0) out += " , ";
+        expression(depth + 1);
+    }
+    out += ")";
+}
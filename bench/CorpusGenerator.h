@@ -0,0 +1,85 @@
+#ifndef CORPUS_GENERATOR_H
+#define CORPUS_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ---- Seeded generator of synthetic Stryx programs ----
+// Output is a sequence of whole functions followed by a `main` , so every
+// corpus lexes , parses and compiles : variables are declared before use ,
+// reassigned ones are `var` , calls only go to earlier functions with the
+// right argument count and running it is cheap : loop trip counts multiply
+// to at most 64 along any nesting path and a call runs at most 64K
+// statements , its callees' included. The random stream is a
+// splitmix-seeded xorshift128+ reduced by modulo , not the std
+// distributions , so a (shape , seed , size) triple produces the same bytes
+// with every compiler and standard library.
+enum class CorpusShape : uint8_t {
+    MIXED,  // a blend of the ones below , closest to hand-written code
+    DEEP,   // expressions and blocks nested tens to hundreds of levels
+    LONG,   // hundreds to thousands of statements per function
+    SMALL,  // many one to three statement functions
+    MATCH   // most statements are `match` with 4 to 64 literal arms
+};
+
+const char* shapeName(CorpusShape shape);
+bool parseShape(std::string_view text , CorpusShape& shape);
+// "4096" , "64KB" , "16MB" , "1GB" (powers of 1024) , false on anything else
+bool parseSize(std::string_view text , size_t& bytes);
+
+class CorpusGenerator {
+    private :
+        struct Local {
+            std::string name;
+            bool mutable_;
+        };
+
+        CorpusShape shape;
+        uint64_t state[2];
+        std::vector<uint8_t> arities; // of every function emitted so far
+        std::vector<uint64_t> costs;  // statements one call of each runs , at most
+        std::vector<Local> locals;    // in scope at the current point
+        std::string out;              // text of the function being built
+        size_t limit;                 // statements stop once `out` is this long
+        int indent;
+        uint32_t nextName;
+        uint64_t trips; // product of the trip counts of the loops around the current point
+        uint64_t cost;  // statements one call of the function being built runs , at most
+
+        uint64_t next();
+        uint32_t below(uint32_t n) { return static_cast<uint32_t>(next() % n); }
+        uint32_t between(uint32_t low , uint32_t high) { return low + below(high - low + 1); }
+        bool chance(uint32_t percent) { return below(100) < percent; }
+
+        void newline();
+        std::string freshName(const char* prefix);
+        void function(size_t budget);
+        void block(int depth , std::string_view tail = std::string_view());
+        void statement(int depth);
+        void ifStatement(int depth);
+        void whileStatement(int depth);
+        void forStatement(int depth);
+        uint32_t tripCount();
+        void matchStatement(int depth);
+        void expression(int depth);
+        void deepExpression(uint32_t levels);
+        void leaf(int depth);
+        void call(int depth);
+        void mainFunction();
+
+    public :
+        CorpusGenerator(CorpusShape shape , uint64_t seed);
+
+        // Append functions to `text` until it has grown by at least `bytes` ,
+        // then a `main` calling the last of them. Sizes from 1KB to 1GB.
+        void generate(std::string& text , size_t bytes);
+        // Same bytes as generate() , written through in function-sized
+        // chunks so a corpus larger than memory can go straight to a file
+        void write(std::ostream& stream , size_t bytes);
+};
+
+#endif // CORPUS_GENERATOR_H
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "AstCache.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Cold start through the Lexer and Parser against a warm .stxc load of the same file
+int main(int argc , char* argv[]) {
+    if(argc < 2) {
+        std::cerr<<"Usage : ./cache_bench <filename.styx> [iterations] [cache dir]"<<std::endl;
+        return 1;
+    }
+    SourceBuffer source;
+    if(!source.open(argv[1])) {
+        std::cerr<<"Error : Could not open file "<<argv[1]<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+    AstCache cache(argc > 3 ? argv[3] : ".stryx-cache");
+
+    double parseTime = 0 , storeTime = 0 , loadTime = 0;
+    size_t functions = 0;
+    for(int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(source.view());
+        Parser parser(lexer);
+        Program parsed = parser.parseProgram();
+        parseTime += seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        if(!cache.store(source.view() , parsed)) {
+            std::cerr<<"Error : could not write "<<cache.pathFor(AstCache::hashSource(source.view()))<<std::endl;
+            return 1;
+        }
+        storeTime += seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        Program loaded;
+        if(!cache.load(source.view() , loaded)) {
+            std::cerr<<"Error : cache entry did not load back"<<std::endl;
+            return 1;
+        }
+        loadTime += seconds(start);
+        functions = loaded.functions.size();
+    }
+
+    double mb = source.size() / (1024.0 * 1024.0);
+    std::cout<<"source    : "<<mb<<" MB , "<<functions<<" functions\n";
+    std::cout<<"lex+parse : "<<parseTime / iterations * 1000<<" ms ("<<mb * iterations / parseTime<<" MB/s)\n";
+    std::cout<<"store     : "<<storeTime / iterations * 1000<<" ms\n";
+    std::cout<<"load      : "<<loadTime / iterations * 1000<<" ms ("<<parseTime / loadTime<<"x faster than parsing)\n";
+    return 0;
+}
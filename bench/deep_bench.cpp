@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include "Lexer.h"
+#include "Parser.h"
+
+// Pathologically deep sources : nested parentheses , a long `else if` chain ,
+// nested blocks and a long left-associative `+` chain , each parsed and then
+// printed into a stream that drops its output. Every shape is run at growing
+// depths ; a build whose parser or print() recurses per level overflows the
+// native stack somewhere along the way , so run each shape in its own process
+// when comparing against one : ./deep_bench parens 1000000
+
+// Counts what print() writes , keeps none of it
+class NullBuffer : public std::streambuf {
+    public :
+        size_t bytes = 0;
+
+    protected :
+        int overflow(int c) override {
+            bytes++;
+            return c;
+        }
+        std::streamsize xsputn(const char* , std::streamsize n) override {
+            bytes += static_cast<size_t>(n);
+            return n;
+        }
+};
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string parens(size_t depth) {
+    return "fn main() {\n    let x = " + std::string(depth , '(') + "1" + std::string(depth , ')') + ";\n}\n";
+}
+
+static std::string elseIf(size_t depth) {
+    std::string text = "fn main(x) {\n    if (x == 0) {\n        return 0;\n    }";
+    for(size_t i = 1; i < depth; i++) {
+        std::string n = std::to_string(i);
+        text += " else if (x == " + n + ") {\n        return " + n + ";\n    }";
+    }
+    return text + " else {\n        return 1;\n    }\n}\n";
+}
+
+static std::string blocks(size_t depth) {
+    std::string text = "fn main(x) {\n";
+    for(size_t i = 0; i < depth; i++) text += i % 2 ? "while (x) {\n" : "if (x) {\n";
+    text += "x = x - 1;\n";
+    for(size_t i = 0; i < depth; i++) text += "}\n";
+    return text + "}\n";
+}
+
+static std::string chain(size_t depth) {
+    std::string text = "fn main(x) {\n    return x";
+    for(size_t i = 0; i < depth; i++) text += " + x";
+    return text + ";\n}\n";
+}
+
+struct Shape {
+    const char* name;
+    std::string (*generate)(size_t depth);
+};
+
+static const Shape SHAPES[] = {
+    {"parens" , parens} , {"elseif" , elseIf} , {"blocks" , blocks} , {"chain" , chain}
+};
+
+static void run(const Shape& shape , size_t depth) {
+    std::string source = shape.generate(depth);
+    TokenStream tokens = Lexer(source).tokenize();
+
+    auto start = std::chrono::steady_clock::now();
+    Program program = Parser(tokens , 0 , tokens.size()).parseProgram();
+    double parseTime = seconds(start);
+    if(!program.errors.empty()) {
+        std::cerr<<"Error : "<<shape.name<<" at depth "<<depth<<" : "<<program.errors.front().toString()<<std::endl;
+        return;
+    }
+
+    NullBuffer sink;
+    std::streambuf* saved = std::cout.rdbuf(&sink);
+    start = std::chrono::steady_clock::now();
+    for(const FunctionDecl* fn : program.functions) fn->print();
+    double printTime = seconds(start);
+    std::cout.rdbuf(saved);
+
+    std::cout<<shape.name<<std::string(8 - std::strlen(shape.name) , ' ')<<"depth "<<depth<<" : "<<source.size() / 1024
+             <<" KB , parse "<<parseTime * 1000<<" ms , print "<<printTime * 1000<<" ms ("<<sink.bytes / 1024<<" KB)"
+             <<std::endl;
+}
+
+int main(int argc , char* argv[]) {
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    size_t maxDepth = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    bool found = false;
+    for(const Shape& shape : SHAPES) {
+        if(only && std::strcmp(only , "all") != 0 && std::strcmp(only , shape.name) != 0) continue;
+        found = true;
+        for(size_t depth = 1000; depth <= maxDepth; depth *= 10) run(shape , depth);
+    }
+    if(!found) {
+        std::cerr<<"Usage : ./deep_bench [parens|elseif|blocks|chain|all] [max depth]"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Incremental.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Types one digit into a random number literal per edit , the keystroke case
+// editor tooling re-checks , and compares against lexing and parsing from scratch
+int main(int argc , char* argv[]) {
+    if(argc < 2) {
+        std::cerr<<"Usage : ./edit_bench <filename.styx> [edits]"<<std::endl;
+        return 1;
+    }
+    SourceBuffer source;
+    if(!source.open(argv[1])) {
+        std::cerr<<"Error : Could not open file "<<argv[1]<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    int edits = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+    auto start = std::chrono::steady_clock::now();
+    IncrementalDocument doc{std::string(source.view())};
+    double initialTime = seconds(start);
+
+    std::mt19937 rng(1);
+    double editTime = 0;
+    size_t relexed = 0 , reparsed = 0 , full = 0;
+    for(int i = 0; i < edits; i++) {
+        const std::string& text = doc.source();
+        size_t pos = rng() % text.size();
+        while(pos < text.size() && (text[pos] < '0' || text[pos] > '9')) pos++;
+        if(pos == text.size()) continue;
+
+        start = std::chrono::steady_clock::now();
+        IncrementalDocument::EditStats stats;
+        if(!doc.apply(TextEdit{pos , 0 , "7"} , stats)) {
+            std::cerr<<"Error : edit at "<<pos<<" rejected\n";
+            return 1;
+        }
+        editTime += seconds(start);
+        relexed += stats.tokensRelexed;
+        reparsed += stats.functionsReparsed;
+        full += stats.fullReparse;
+    }
+
+    start = std::chrono::steady_clock::now();
+    TokenStream tokens = Lexer(doc.source()).tokenize();
+    Program program = Parser(tokens , 0 , tokens.size()).parseProgram();
+    double scratchTime = seconds(start);
+
+    std::cout<<"source    : "<<doc.source().size() / (1024.0 * 1024.0)<<" MB , "<<doc.tokenStream().size()<<" tokens\n";
+    std::cout<<"initial   : "<<initialTime * 1000<<" ms\n";
+    std::cout<<"scratch   : "<<scratchTime * 1000<<" ms per re-check\n";
+    std::cout<<"edit      : "<<editTime / edits * 1e6<<" us per edit ("<<relexed / double(edits)<<" tokens re-lexed , "
+             <<reparsed / double(edits)<<" functions re-parsed , "<<full<<" full re-parses)\n";
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include "AstSerializer.h"
+#include "CorpusGenerator.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+// AST export throughput : a generated corpus is parsed once , then written in
+// every format into a stream that drops its output and into a file , and
+// streamed function by function the way the driver's --format does it.
+// Build with bench/CorpusGenerator.cpp next to this file.
+
+// Counts what is written , keeps none of it
+class NullBuffer : public std::streambuf {
+    public :
+        size_t bytes = 0;
+
+    protected :
+        int overflow(int c) override {
+            bytes++;
+            return c;
+        }
+        std::streamsize xsputn(const char* , std::streamsize n) override {
+            bytes += static_cast<size_t>(n);
+            return n;
+        }
+};
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const char* formatName(AstFormat format) {
+    switch(format) {
+        case AstFormat::TEXT: return "text";
+        case AstFormat::JSON: return "json";
+        case AstFormat::SEXPR: return "sexpr";
+    }
+    return "?";
+}
+
+static void report(const char* what , AstFormat format , double time , size_t bytes) {
+    double mb = bytes / (1024.0 * 1024.0);
+    std::cout<<what<<std::string(8 - std::strlen(what) , ' ')<<formatName(format)<<std::string(6 - std::strlen(formatName(format)) , ' ')
+             <<": "<<time * 1000<<" ms , "<<mb<<" MB out ("<<mb / time<<" MB/s)\n";
+}
+
+int main(int argc , char* argv[]) {
+    size_t bytes = 16 << 20;
+    CorpusShape shape = CorpusShape::MIXED;
+    if((argc > 1 && !parseSize(argv[1] , bytes)) || (argc > 2 && !parseShape(argv[2] , shape))) {
+        std::cerr<<"Usage : ./export_bench [size , e.g. 16MB] [mixed|deep|long|small|match]"<<std::endl;
+        return 1;
+    }
+
+    std::string source;
+    CorpusGenerator(shape , 1).generate(source , bytes);
+    TokenStream tokens = Lexer(source).tokenize();
+    Program program = Parser(tokens , 0 , tokens.size()).parseProgram();
+    std::cout<<"source  : "<<source.size() / (1024.0 * 1024.0)<<" MB "<<shapeName(shape)<<" , "
+             <<program.functions.size()<<" functions\n";
+
+    std::string path = "/tmp/stryx-export-bench-" + std::to_string(getpid());
+    for(AstFormat format : {AstFormat::TEXT , AstFormat::JSON , AstFormat::SEXPR}) {
+        // Parsed up front , writing only
+        NullBuffer null;
+        std::ostream nullStream(&null);
+        auto start = std::chrono::steady_clock::now();
+        AstSerializer(nullStream , format).program(program);
+        report("null" , format , seconds(start) , null.bytes);
+
+        std::ofstream file(path , std::ios::binary);
+        start = std::chrono::steady_clock::now();
+        AstSerializer(file , format).program(program);
+        file.close();
+        report("file" , format , seconds(start) , null.bytes);
+
+        // Parse and write one function at a time , each in its own arena
+        NullBuffer streamed;
+        std::ostream streamedStream(&streamed);
+        start = std::chrono::steady_clock::now();
+        {
+            Parser parser(tokens , 0 , tokens.size());
+            AstSerializer serializer(streamedStream , format);
+            serializer.beginProgram();
+            for(;;) {
+                AstArena arena;
+                FunctionDecl* fn = nullptr;
+                if(!parser.parseNextFunction(arena , fn)) break;
+                if(fn) serializer.function(fn);
+            }
+            serializer.endProgram(parser.errors());
+        }
+        report("stream" , format , seconds(start) , streamed.bytes);
+    }
+    std::remove(path.c_str());
+    return 0;
+}
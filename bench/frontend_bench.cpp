@@ -0,0 +1,294 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+#include "CorpusGenerator.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+
+// Front-end suite over generated corpora : Lexer::tokenize , Parser::parseProgram
+// from a prebuilt stream and dropping the Program , each timed on its own.
+// Build with bench/CorpusGenerator.cpp next to this file.
+//
+// Every heap allocation in the process goes through the operators below , the
+// counts taken inside a timed region are reported per KB of source.
+
+static size_t allocations = 0;
+static size_t frees = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size , std::align_val_t align) {
+    allocations++;
+    size_t a = static_cast<size_t>(align);
+    if(void* p = std::aligned_alloc(a , (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+static void release(void* p) {
+    if(p) frees++;
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p , size_t) noexcept { release(p); }
+void operator delete(void* p , std::align_val_t) noexcept { release(p); }
+void operator delete(void* p , size_t , std::align_val_t) noexcept { release(p); }
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t countNodes(const Expression* expr) {
+    switch(expr->kind) {
+        case AstKind::UNARY : return 1 + countNodes(static_cast<const UnaryExpr*>(expr)->operand);
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            return 1 + countNodes(bin->left) + countNodes(bin->right);
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(expr);
+            size_t n = 1 + countNodes(call->callee);
+            for(const Expression* arg : call->arguments) n += countNodes(arg);
+            return n;
+        }
+        default : return 1;
+    }
+}
+
+static size_t countNodes(const AstList<Statement*>& body);
+
+static size_t countNodes(const Statement* stmt) {
+    switch(stmt->kind) {
+        case AstKind::LET : return 1 + countNodes(static_cast<const LetStatement*>(stmt)->value);
+        case AstKind::VAR : return 1 + countNodes(static_cast<const VarStatement*>(stmt)->value);
+        case AstKind::ASSIGN : return 1 + countNodes(static_cast<const AssignStatement*>(stmt)->value);
+        case AstKind::RETURN : return 1 + countNodes(static_cast<const ReturnStatement*>(stmt)->value);
+        case AstKind::IF : {
+            auto s = static_cast<const IfStatement*>(stmt);
+            return 1 + countNodes(s->condition) + countNodes(s->thenBranch) + countNodes(s->elseBranch);
+        }
+        case AstKind::WHILE : {
+            auto s = static_cast<const WhileStatement*>(stmt);
+            return 1 + countNodes(s->condition) + countNodes(s->body);
+        }
+        case AstKind::FOR : {
+            auto s = static_cast<const ForStatement*>(stmt);
+            return 1 + countNodes(s->iterable) + countNodes(s->body);
+        }
+        case AstKind::MATCH : {
+            auto s = static_cast<const MatchStatement*>(stmt);
+            size_t n = 1 + countNodes(s->expr);
+            for(const MatchArm& arm : s->arms) n += countNodes(arm.pattern) + countNodes(arm.body);
+            return n;
+        }
+        default : return 1;
+    }
+}
+
+static size_t countNodes(const AstList<Statement*>& body) {
+    size_t n = 0;
+    for(const Statement* stmt : body) n += countNodes(stmt);
+    return n;
+}
+
+struct Result {
+    std::string bench;
+    double total = 0;           // seconds over all iterations
+    double best = 1e30;
+    size_t allocations = 0;     // over all iterations
+    size_t frees = 0;
+};
+
+struct Corpus {
+    std::string name;
+    std::string_view source;
+    size_t tokens = 0;
+    size_t nodes = 0;
+};
+
+static void report(const Corpus& corpus , const Result& r , int iterations) {
+    double mean = r.total / iterations;
+    double mb = corpus.source.size() / (1024.0 * 1024.0);
+    double kb = corpus.source.size() / 1024.0;
+    std::cout<<"  "<<r.bench<<std::string(10 - r.bench.size() , ' ')<<": "<<mean * 1000<<" ms , "
+             <<mb / mean<<" MB/s , "<<corpus.tokens / mean / 1e6<<" M tokens/s , "<<corpus.nodes / mean / 1e6<<" M nodes/s , "
+             <<r.allocations / iterations / kb<<" allocs/KB , "<<r.frees / iterations / kb<<" frees/KB\n";
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for(char c : text) {
+        if(c == '"' || c == '\\') out += '\\';
+        if(static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out + "\"";
+}
+
+static void writeJson(std::ostream& json , const std::string& label , const Corpus& corpus , uint64_t seed ,
+                      const Result& r , int iterations) {
+    double mean = r.total / iterations;
+    double kb = corpus.source.size() / 1024.0;
+    json.precision(9);
+    json<<"{\"label\":"<<jsonString(label)<<",\"time\":"<<std::time(nullptr)<<",\"bench\":\""<<r.bench<<"\",\"corpus\":"<<jsonString(corpus.name)
+        <<",\"seed\":"<<seed<<",\"bytes\":"<<corpus.source.size()<<",\"tokens\":"<<corpus.tokens<<",\"nodes\":"<<corpus.nodes
+        <<",\"iterations\":"<<iterations<<",\"mean_s\":"<<mean<<",\"best_s\":"<<r.best
+        <<",\"mb_per_s\":"<<corpus.source.size() / (1024.0 * 1024.0) / mean<<",\"tokens_per_s\":"<<corpus.tokens / mean
+        <<",\"nodes_per_s\":"<<corpus.nodes / mean<<",\"allocs_per_kb\":"<<r.allocations / iterations / kb
+        <<",\"frees_per_kb\":"<<r.frees / iterations / kb<<"}\n";
+}
+
+static void usage() {
+    std::cerr<<"Usage : ./frontend_bench [--shape mixed|deep|long|small|match|all] [--size 16MB] [--seed N]\n"
+             <<"                         [--iterations N] [--json results.jsonl] [--label name]\n"
+             <<"                         [--file source.styx] [--write corpus.styx]"<<std::endl;
+}
+
+// Runs the three benchmarks over one corpus and prints / records them
+static void run(Corpus& corpus , int iterations , uint64_t seed , std::ofstream* json , const std::string& label) {
+    Result lex{"tokenize"} , parse{"parse"} , teardown{"teardown"};
+    for(int i = 0; i < iterations; i++) {
+        // ---- Lexer::tokenize ----
+        size_t allocs = allocations , freed = frees;
+        auto start = std::chrono::steady_clock::now();
+        TokenStream tokens = Lexer(corpus.source).tokenize();
+        double t = seconds(start);
+        lex.allocations += allocations - allocs;
+        lex.frees += frees - freed;
+        lex.total += t;
+        lex.best = std::min(lex.best , t);
+        corpus.tokens = tokens.size();
+
+        // ---- Parser::parseProgram over the stream , the copy into the parser is not timed ----
+        Parser parser(std::move(tokens));
+        std::optional<Program> program;
+        allocs = allocations , freed = frees;
+        start = std::chrono::steady_clock::now();
+        program.emplace(parser.parseProgram());
+        t = seconds(start);
+        parse.allocations += allocations - allocs;
+        parse.frees += frees - freed;
+        parse.total += t;
+        parse.best = std::min(parse.best , t);
+        if(i == 0) {
+            corpus.nodes = 0;
+            for(const FunctionDecl* fn : program->functions) corpus.nodes += 1 + countNodes(fn->body);
+        }
+
+        // ---- Dropping the Program ----
+        allocs = allocations , freed = frees;
+        start = std::chrono::steady_clock::now();
+        program.reset();
+        t = seconds(start);
+        teardown.allocations += allocations - allocs;
+        teardown.frees += frees - freed;
+        teardown.total += t;
+        teardown.best = std::min(teardown.best , t);
+    }
+
+    std::cout<<corpus.name<<" : "<<corpus.source.size() / (1024.0 * 1024.0)<<" MB , "<<corpus.tokens<<" tokens , "
+             <<corpus.nodes<<" nodes\n";
+    for(const Result* r : {&lex , &parse , &teardown}) {
+        report(corpus , *r , iterations);
+        if(json) writeJson(*json , label , corpus , seed , *r , iterations);
+    }
+}
+
+int main(int argc , char* argv[]) {
+    std::vector<CorpusShape> shapes = {CorpusShape::MIXED};
+    size_t size = 16 << 20;
+    uint64_t seed = 1;
+    int iterations = 5;
+    std::string jsonPath , label , filePath , writePath;
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if(arg == "--shape") {
+            shapes.clear();
+            CorpusShape shape;
+            if(value == "all") shapes = {CorpusShape::MIXED , CorpusShape::DEEP , CorpusShape::LONG , CorpusShape::SMALL , CorpusShape::MATCH};
+            else if(parseShape(value , shape)) shapes.push_back(shape);
+            else {
+                usage();
+                return 1;
+            }
+        } else if(arg == "--size") {
+            if(!parseSize(value , size)) {
+                std::cerr<<"Error : bad size "<<value<<" , expected e.g. 4096 , 64KB , 16MB , 1GB"<<std::endl;
+                return 1;
+            }
+        } else if(arg == "--seed") seed = std::stoull(value);
+        else if(arg == "--iterations") iterations = std::max(1 , std::stoi(value));
+        else if(arg == "--json") jsonPath = value;
+        else if(arg == "--label") label = value;
+        else if(arg == "--file") filePath = value;
+        else if(arg == "--write") writePath = value;
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    // Streams the corpus to a file for the other benches and the driver , nothing is timed
+    if(!writePath.empty()) {
+        if(shapes.size() != 1) {
+            std::cerr<<"Error : --write takes a single shape"<<std::endl;
+            return 1;
+        }
+        std::ofstream file(writePath , std::ios::binary);
+        if(!file) {
+            std::cerr<<"Error : Could not open file "<<writePath<<" : "<<std::strerror(errno)<<std::endl;
+            return 1;
+        }
+        CorpusGenerator(shapes[0] , seed).write(file , size);
+        return file ? 0 : 1;
+    }
+
+    std::ofstream json;
+    if(!jsonPath.empty()) {
+        json.open(jsonPath , std::ios::app); // one object per line , runs accumulate
+        if(!json) {
+            std::cerr<<"Error : Could not open file "<<jsonPath<<" : "<<std::strerror(errno)<<std::endl;
+            return 1;
+        }
+    }
+    std::ofstream* jsonOut = json.is_open() ? &json : nullptr;
+
+    if(!filePath.empty()) {
+        SourceBuffer source;
+        if(!source.open(filePath)) {
+            std::cerr<<"Error : Could not open file "<<filePath<<" : "<<std::strerror(errno)<<std::endl;
+            return 1;
+        }
+        Corpus corpus{filePath , source.view()};
+        run(corpus , iterations , seed , jsonOut , label);
+        return 0;
+    }
+
+    for(CorpusShape shape : shapes) {
+        std::string text;
+        text.reserve(size + 4096);
+        auto start = std::chrono::steady_clock::now();
+        CorpusGenerator(shape , seed).generate(text , size);
+        std::cout<<"generated "<<shapeName(shape)<<" in "<<seconds(start) * 1000<<" ms\n";
+        Corpus corpus{shapeName(shape) , text};
+        run(corpus , iterations , seed , jsonOut , label);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "VM.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+// Each string shape the heap treats differently , in tight loops
+static const Workload WORKLOADS[] = {
+    // Short results stay inline in their values
+    {"small" ,
+     "fn main() {\n"
+     "    var hits = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < 1000000) {\n"
+     "        let t = \"ab\" + \"cd\";\n"
+     "        let u = t + t + \"!\";\n"
+     "        if (u == \"abcdabcd!\") { hits = hits + 1; }\n"
+     "        i = i + 1;\n"
+     "    }\n"
+     "    return hits;\n"
+     "}\n"},
+    // A call builds a heap string out of temporaries and returns it : its
+    // region goes on return , the result moves down into the caller's
+    {"bits" ,
+     "fn bits(n) {\n"
+     "    var s = \"#\";\n"
+     "    var k = 0;\n"
+     "    while (k < 20) {\n"
+     "        if (n % 2 == 1) { s = s + \"1\"; } else { s = s + \"0\"; }\n"
+     "        n = n / 2;\n"
+     "        k = k + 1;\n"
+     "    }\n"
+     "    return s;\n"
+     "}\n"
+     "fn main() {\n"
+     "    var hits = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < 100000) {\n"
+     "        if (bits(i) < \"#1\") { hits = hits + 1; }\n"
+     "        i = i + 1;\n"
+     "    }\n"
+     "    return hits;\n"
+     "}\n"},
+    // One frame that never returns , its temporaries fill the nursery and
+    // minor collections promote the few still held
+    {"frame" ,
+     "fn main() {\n"
+     "    var hits = 0;\n"
+     "    var held = \"held-across-the-whole-loop\";\n"
+     "    var i = 0;\n"
+     "    while (i < 1000000) {\n"
+     "        let t = \"a-temporary-string-\" + \"that-dies-at-once\";\n"
+     "        if (t < held) { hits = hits + 1; }\n"
+     "        if (i % 100000 == 0) { held = held + \"+\"; }\n"
+     "        i = i + 1;\n"
+     "    }\n"
+     "    return hits;\n"
+     "}\n"},
+    // Strings too large for the nursery start out old , major collections free them
+    {"large" ,
+     "fn main() {\n"
+     "    var big = \"0123456789abcdef\";\n"
+     "    var j = 0;\n"
+     "    while (j < 16) { big = big + big; j = j + 1; }\n"
+     "    var hits = 0;\n"
+     "    var r = 0;\n"
+     "    while (r < 400) { let x = big + big; if (x > big) { hits = hits + 1; } r = r + 1; }\n"
+     "    return hits;\n"
+     "}\n"},
+};
+
+int main(int argc , char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 3;
+    for(const Workload& w : WORKLOADS) {
+        Lexer lexer(w.source);
+        Parser parser(lexer);
+        Program program = parser.parseProgram();
+        std::vector<CompileError> errors;
+        Module module = compileProgram(program , errors);
+        if(!errors.empty()) {
+            std::cerr<<errors.front().toString()<<std::endl;
+            return 1;
+        }
+        uint32_t entry = static_cast<uint32_t>(module.find(symbols().intern("main")));
+
+        // A VM per workload , so the counters are its own
+        VM vm;
+        Value result = vm.run(module , entry);
+        if(!vm.error().empty()) {
+            std::cerr<<"Runtime Error : "<<vm.error()<<std::endl;
+            return 1;
+        }
+        double time = 0;
+        for(int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            vm.run(module , entry);
+            time += seconds(start);
+        }
+        time /= iterations;
+
+        const HeapStats& heap = vm.heapStats();
+        std::cout<<w.name<<std::string(8 - std::string(w.name).size() , ' ')<<": ";
+        printValue(std::cout , result);
+        std::cout<<" , "<<time * 1000<<" ms , "<<heap.smallStrings<<" small , "<<heap.allocations<<" allocated ("
+                 <<heap.pretenured<<" old) , "<<heap.regionsDropped<<" regions dropped , "<<heap.escapes<<" escapes , "
+                 <<heap.minorCollections<<" minor / "<<heap.majorCollections<<" major collections , "
+                 <<heap.collectNanos / 1e6<<" ms collecting\n";
+    }
+    return 0;
+}
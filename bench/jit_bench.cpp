@@ -0,0 +1,116 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "Compiler.h"
+#include "Jit.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "VM.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+// Kernels live outside main() , the JIT only enters at calls
+static const Workload WORKLOADS[] = {
+    {"fib" ,
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "fn main() { return fib(30); }\n"},
+    {"while" ,
+     "fn sum(n) {\n"
+     "    var sum = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < n) { sum = sum + i % 7; i = i + 1; }\n"
+     "    return sum;\n"
+     "}\n"
+     "fn main() { return sum(20000000); }\n"},
+    {"nested" ,
+     "fn grid(w , h) {\n"
+     "    var acc = 0;\n"
+     "    var y = 0;\n"
+     "    while (y < h) {\n"
+     "        var x = 0;\n"
+     "        while (x < w) { acc = acc + (x ^ y) * (x < y); x = x + 1; }\n"
+     "        y = y + 1;\n"
+     "    }\n"
+     "    return acc;\n"
+     "}\n"
+     "fn main() { return grid(3000 , 3000); }\n"},
+    {"float" ,
+     "fn f(x) { return 4.0 / (1.0 + x * x); }\n"
+     "fn integrate(n) {\n"
+     "    var acc = 0.0;\n"
+     "    var i = 0;\n"
+     "    let h = 1.0 / n;\n"
+     "    while (i < n) { acc = acc + f((i + 0.5) * h); i = i + 1; }\n"
+     "    return acc * h;\n"
+     "}\n"
+     "fn main() { return integrate(5000000); }\n"},
+    {"calls" ,
+     "fn gcd(a , b) { if (b == 0) { return a; } return gcd(b , a % b); }\n"
+     "fn main() {\n"
+     "    var total = 0;\n"
+     "    var i = 1;\n"
+     "    while (i < 300000) { total = total + gcd(i * 7919 , 104729); i = i + 1; }\n"
+     "    return total;\n"
+     "}\n"},
+};
+
+int main(int argc , char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 3;
+    VM vm;
+    for(const Workload& w : WORKLOADS) {
+        Lexer lexer(w.source);
+        Parser parser(lexer);
+        Program program = parser.parseProgram();
+        std::vector<CompileError> errors;
+        Module module = compileProgram(program , errors);
+        if(!errors.empty()) {
+            std::cerr<<errors.front().toString()<<std::endl;
+            return 1;
+        }
+        uint32_t entry = static_cast<uint32_t>(module.find(symbols().intern("main")));
+
+        vm.attach(nullptr);
+        Value interpreted = vm.run(module , entry);
+        if(!vm.error().empty()) {
+            std::cerr<<"Runtime Error : "<<vm.error()<<std::endl;
+            return 1;
+        }
+        double interpTime = 0;
+        for(int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            vm.run(module , entry);
+            interpTime += seconds(start);
+        }
+        interpTime /= iterations;
+
+        // Compile on first call , the first run pays for it and is timed on its own
+        Jit jit(program , module , 1);
+        vm.attach(&jit);
+        auto start = std::chrono::steady_clock::now();
+        Value native = vm.run(module , entry);
+        double firstTime = seconds(start);
+        double nativeTime = 0;
+        for(int i = 0; i < iterations; i++) {
+            start = std::chrono::steady_clock::now();
+            vm.run(module , entry);
+            nativeTime += seconds(start);
+        }
+        nativeTime /= iterations;
+        vm.attach(nullptr);
+
+        bool same = interpreted.type == native.type && interpreted.i == native.i;
+        std::cout<<w.name<<std::string(8 - std::string(w.name).size() , ' ')<<": ";
+        printValue(std::cout , native);
+        std::cout<<(same ? "" : " (MISMATCH)")<<" , vm "<<interpTime * 1000<<" ms , jit "<<nativeTime * 1000
+                 <<" ms (first run "<<firstTime * 1000<<" ms) , "<<interpTime / nativeTime<<"x , "
+                 <<jit.stats().compiled<<" variants , "<<jit.stats().codeBytes<<" bytes\n";
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "VM.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Pattern of arm k for each key shape
+static std::string pattern(const std::string& kind , int k) {
+    if(kind == "dense") return std::to_string(k);
+    if(kind == "sparse") return std::to_string(k * 7919 + (k % 3) * 100003);
+    return "\"op_" + std::to_string(k) + "\"";
+}
+
+// A match with `arms` literal arms , called with 16 subjects spread over
+// them (the last arm included) in a loop
+static std::string workload(const std::string& kind , int arms) {
+    std::string src = "fn classify(x) {\n    match x {\n";
+    for(int k = 0; k < arms; k++) src += "        " + pattern(kind , k) + " => return " + std::to_string(k) + "; ,\n";
+    src += "        _ => return 0;\n    }\n}\n";
+    src += "fn main() {\n    var total = 0;\n    for i in 20000 {\n        total = total";
+    for(int s = 0; s < 16; s++) src += " + classify(" + pattern(kind , (arms - 1) * s / 15) + ")";
+    src += ";\n    }\n    return total;\n}\n";
+    return src;
+}
+
+int main(int argc , char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 3;
+    VM vm;
+    for(const char* kind : {"dense" , "sparse" , "string"}) {
+        for(int arms : {8 , 64 , 256}) {
+            std::string source = workload(kind , arms);
+            Lexer lexer(source);
+            Parser parser(lexer);
+            Program program = parser.parseProgram();
+            std::vector<CompileError> errors;
+            Module module = compileProgram(program , errors);
+            if(!errors.empty()) {
+                std::cerr<<errors.front().toString()<<std::endl;
+                return 1;
+            }
+            uint32_t entry = static_cast<uint32_t>(module.find(symbols().intern("main")));
+
+            Value result = vm.run(module , entry);
+            if(!vm.error().empty()) {
+                std::cerr<<"Runtime Error : "<<vm.error()<<std::endl;
+                return 1;
+            }
+            double time = 0;
+            for(int i = 0; i < iterations; i++) {
+                auto start = std::chrono::steady_clock::now();
+                vm.run(module , entry);
+                time += seconds(start);
+            }
+            time /= iterations;
+
+            std::string name = std::string(kind) + " x" + std::to_string(arms);
+            std::cout<<name<<std::string(13 - name.size() , ' ')<<": ";
+            printValue(std::cout , result);
+            std::cout<<" , "<<time * 1000<<" ms ("<<time / (20000 * 16) * 1e9<<" ns per match)\n";
+        }
+    }
+    return 0;
+}
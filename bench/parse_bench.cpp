@@ -0,0 +1,57 @@
+#include <sys/resource.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include "Lexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF , &usage);
+    return usage.ru_maxrss;
+}
+
+int main(int argc , char* argv[]) {
+    if(argc < 2) {
+        std::cerr<<"Usage : ./parse_bench <filename.styx> [iterations]"<<std::endl;
+        return 1;
+    }
+    SourceBuffer source;
+    if(!source.open(argv[1])) {
+        std::cerr<<"Error : Could not open file "<<argv[1]<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    // Lexing is done up front so the timings cover tree building and teardown only
+    TokenStream tokens = Lexer(source.view()).tokenize();
+    long baseRss = peakRssKb();
+
+    double parseTime = 0 , teardownTime = 0;
+    for(int i = 0; i < iterations; i++) {
+        Parser parser(tokens);
+        std::optional<decltype(parser.parseProgram())> program;
+
+        auto start = std::chrono::steady_clock::now();
+        program.emplace(parser.parseProgram());
+        parseTime += seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        program.reset();
+        teardownTime += seconds(start);
+    }
+
+    double mb = source.size() / (1024.0 * 1024.0);
+    std::cout<<"source    : "<<mb<<" MB , "<<tokens.size()<<" tokens\n";
+    std::cout<<"parse     : "<<parseTime / iterations * 1000<<" ms ("<<mb * iterations / parseTime<<" MB/s)\n";
+    std::cout<<"teardown  : "<<teardownTime / iterations * 1000<<" ms\n";
+    std::cout<<"peak RSS  : +"<<(peakRssKb() - baseRss) / 1024<<" MB over the token stream\n";
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include "ScanKernels.h"
+
+// Char-at-a-time loops the Lexer used before the bulk kernels
+static size_t skipWhitespaceBaseline(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    while(i < n && isspace(p[i])) { if(p[i] == '\n') newlines++; i++; }
+    return i;
+}
+static size_t scanIdentifierBaseline(const char* p , size_t n) {
+    size_t i = 0;
+    while(i < n && (isalnum(p[i]) || p[i] == '_')) i++;
+    return i;
+}
+static size_t scanDigitsBaseline(const char* p , size_t n) {
+    size_t i = 0;
+    while(i < n && isdigit(p[i])) i++;
+    return i;
+}
+static size_t findQuoteBaseline(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    while(i < n && p[i] != '"' && p[i] != '\0') { if(p[i] == '\n') newlines++; i++; }
+    return i;
+}
+
+// Runs of `alphabet` of random length in [1 , maxRun] , each followed by `stop`
+static std::string makeRuns(const std::string& alphabet , char stop , size_t bytes , size_t maxRun) {
+    std::mt19937 rng(42);
+    std::string out;
+    out.reserve(bytes + maxRun + 1);
+    while(out.size() < bytes) {
+        size_t run = 1 + rng() % maxRun;
+        for(size_t i = 0; i < run; i++) out += alphabet[rng() % alphabet.size()];
+        out += stop;
+    }
+    return out;
+}
+
+template <typename Scan>
+static double throughput(const std::string& buf , Scan scan , int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for(int it = 0; it < iterations; it++) {
+        size_t pos = 0;
+        while(pos < buf.size()) pos += scan(buf.data() + pos , buf.size() - pos) + 1;
+        sink += pos;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(sink == 0) std::cout<<"";
+    return buf.size() * double(iterations) / (1024.0 * 1024.0) / secs;
+}
+
+int main(int argc , char* argv[]) {
+    size_t maxRun = argc > 1 ? std::stoul(argv[1]) : 48;
+    const size_t bytes = 32 << 20;
+    const int iterations = 5;
+
+    std::string spaces = makeRuns(" \t\n  " , 'x' , bytes , maxRun);
+    std::string idents = makeRuns("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789" , ' ' , bytes , maxRun);
+    std::string digits = makeRuns("0123456789" , ';' , bytes , maxRun);
+    std::string strings = makeRuns("hello world\n, stryx" , '"' , bytes , maxRun);
+
+    struct Row { const char* name; const ScanKernels* k; };
+    Row rows[] = {
+        {"scalar" , scanKernelsFor(ScanIsa::SCALAR)} ,
+        {"sse2" , scanKernelsFor(ScanIsa::SSE2)} ,
+        {"avx2" , scanKernelsFor(ScanIsa::AVX2)} ,
+    };
+
+    std::cout<<"runs of 1-"<<maxRun<<" bytes , MB/s\n";
+    std::cout<<"kernels   whitespace  identifier  digits  string\n";
+
+    int nl = 0;
+    std::cout<<"baseline  "
+             <<throughput(spaces , [&](const char* p , size_t n) { return skipWhitespaceBaseline(p , n , nl); } , iterations)<<"  "
+             <<throughput(idents , scanIdentifierBaseline , iterations)<<"  "
+             <<throughput(digits , scanDigitsBaseline , iterations)<<"  "
+             <<throughput(strings , [&](const char* p , size_t n) { return findQuoteBaseline(p , n , nl); } , iterations)<<"\n";
+
+    for(const Row& row : rows) {
+        if(!row.k) {
+            std::cout<<row.name<<"  (unsupported on this CPU)\n";
+            continue;
+        }
+        const ScanKernels& k = *row.k;
+        std::cout<<row.name<<"  "
+                 <<throughput(spaces , [&](const char* p , size_t n) { return k.skipWhitespace(p , n , nl); } , iterations)<<"  "
+                 <<throughput(idents , k.scanIdentifier , iterations)<<"  "
+                 <<throughput(digits , k.scanDigits , iterations)<<"  "
+                 <<throughput(strings , [&](const char* p , size_t n) { return k.findQuote(p , n , nl); } , iterations)<<"\n";
+    }
+    std::cout<<"selected : "<<scanKernels().name<<"\n";
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CompileServer.h"
+#include "CorpusGenerator.h"
+
+extern char** environ;
+
+// Many small checks , the CI and editor pattern : a fresh driver process per
+// file against batches and single-file requests to an in-process stryxd ,
+// cold (every file parsed) and warm (every file answered from memory).
+// Build with bench/CorpusGenerator.cpp next to this file.
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool request(const std::string& socketPath , const std::string& text) {
+    std::string reply;
+    if(!requestServer(socketPath , text , reply) || reply.find("done ") == std::string::npos) {
+        std::cerr<<"Error : no reply from "<<socketPath<<" : "<<std::strerror(errno)<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void report(const char* name , double total , size_t files) {
+    std::cout<<name<<std::string(22 - std::strlen(name) , ' ')<<": "<<total * 1000<<" ms , "
+             <<total / files * 1e6<<" us per file\n";
+}
+
+int main(int argc , char* argv[]) {
+    if(argc < 2) {
+        std::cerr<<"Usage : ./server_bench <path to stryx_lexer> [files] [bytes per file] [threads]"<<std::endl;
+        return 1;
+    }
+    std::string driver = argv[1];
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 1000;
+    size_t bytes = argc > 3 ? std::stoul(argv[3]) : 2048;
+    size_t threads = argc > 4 ? std::stoul(argv[4]) : 0;
+
+    char dirTemplate[] = "/tmp/stryx-server-bench-XXXXXX";
+    if(!mkdtemp(dirTemplate)) {
+        std::cerr<<"Error : Could not create a temporary directory : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    std::string dir = dirTemplate;
+    std::vector<std::string> files;
+    std::string batch;
+    for(size_t i = 0; i < count; i++) {
+        std::string text;
+        CorpusGenerator(CorpusShape::SMALL , i + 1).generate(text , bytes);
+        files.push_back(dir + "/f" + std::to_string(i) + ".styx");
+        std::ofstream(files.back() , std::ios::binary)<<text;
+        batch += "check " + files.back() + "\n";
+    }
+    batch += "end\n";
+
+    // ---- One driver process per file , its summary line goes to /dev/null ----
+    posix_spawn_file_actions_t quiet;
+    posix_spawn_file_actions_init(&quiet);
+    posix_spawn_file_actions_addopen(&quiet , 2 , "/dev/null" , O_WRONLY , 0);
+    auto start = std::chrono::steady_clock::now();
+    for(const std::string& file : files) {
+        const char* args[] = {driver.c_str() , "check" , file.c_str() , nullptr};
+        pid_t pid;
+        if(posix_spawn(&pid , driver.c_str() , &quiet , nullptr , const_cast<char**>(args) , environ) != 0) {
+            std::cerr<<"Error : Could not run "<<driver<<std::endl;
+            return 1;
+        }
+        int status;
+        waitpid(pid , &status , 0);
+    }
+    double processTime = seconds(start);
+    posix_spawn_file_actions_destroy(&quiet);
+
+    // ---- stryxd ----
+    std::string socketPath = dir + "/stryxd.sock";
+    CompileServer server(socketPath , threads , size_t(1) << 30);
+    if(!server.listen()) {
+        std::cerr<<"Error : Could not listen on "<<socketPath<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    std::thread serving([&server] { server.run(); });
+
+    start = std::chrono::steady_clock::now();
+    if(!request(socketPath , batch)) return 1;
+    double coldTime = seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    if(!request(socketPath , batch)) return 1;
+    double warmTime = seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for(const std::string& file : files) {
+        if(!request(socketPath , "check " + file + "\nend\n")) return 1;
+    }
+    double singleTime = seconds(start);
+
+    request(socketPath , "shutdown\n");
+    serving.join();
+
+    CompileServer::Stats stats = server.stats();
+    std::cout<<count<<" files of ~"<<bytes<<" bytes , "<<stats.hits<<" hits , "<<stats.misses<<" misses , "
+             <<stats.cachedBytes / 1024<<" KB cached , "<<stats.symbolBytes / 1024<<" KB symbols\n";
+    report("process per file" , processTime , count);
+    report("stryxd batch , cold" , coldTime , count);
+    report("stryxd batch , warm" , warmTime , count);
+    report("stryxd single , warm" , singleTime , count);
+
+    for(const std::string& file : files) unlink(file.c_str());
+    rmdir(dir.c_str());
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Lexer.h"
+#include "Token.h"
+
+// Token layout used before the structure-of-arrays stream : one heap string per token
+struct OwnedToken {
+    TokenType type;
+    std::string value;
+    int line;
+};
+
+static std::string readFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if(!file) {
+        std::cerr<<"Error : Could not open file "<<filename<<std::endl;
+        exit(1);
+    }
+    return std::string((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc , char* argv[]) {
+    if(argc < 2) {
+        std::cerr<<"Usage : ./token_bench <filename.styx> [iterations]"<<std::endl;
+        return 1;
+    }
+    std::string source = readFile(argv[1]);
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+    double mb = source.size() / (1024.0 * 1024.0);
+
+    // ---- Packed stream ----
+    size_t count = 0 , streamBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        Lexer lexer(source);
+        TokenStream tokens = lexer.tokenize();
+        count = tokens.size();
+        streamBytes = tokens.memoryUsage();
+    }
+    double streamTime = seconds(start) / iterations;
+
+    // ---- Owning vector , every token copies its text ----
+    size_t ownedBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        Lexer lexer(source);
+        TokenStream tokens = lexer.tokenize();
+        std::vector<OwnedToken> owned;
+        for(size_t t = 0; t < tokens.size(); t++) {
+            owned.push_back(OwnedToken{tokens.kind(t) , std::string(tokens.text(t)) , tokens.line(t)});
+        }
+        ownedBytes = owned.capacity() * sizeof(OwnedToken);
+        for(const OwnedToken& tok : owned) {
+            if(tok.value.capacity() > 15) ownedBytes += tok.value.capacity() + 1; //PAST THE SSO BUFFER
+        }
+    }
+    double ownedTime = seconds(start) / iterations;
+
+    std::cout<<"source        : "<<mb<<" MB , "<<count<<" tokens\n";
+    std::cout<<"stream        : "<<count / streamTime<<" tokens/s , "<<mb / streamTime<<" MB/s , "
+             <<double(streamBytes) / count<<" bytes/token\n";
+    std::cout<<"owned vector  : "<<count / ownedTime<<" tokens/s , "<<mb / ownedTime<<" MB/s , "
+             <<double(ownedBytes) / count<<" bytes/token\n";
+    return 0;
+}
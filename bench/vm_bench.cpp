@@ -0,0 +1,114 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "VM.h"
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload WORKLOADS[] = {
+    {"fib" ,
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "fn main() { return fib(27); }\n"},
+    {"while" ,
+     "fn main() {\n"
+     "    var sum = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < 5000000) { sum = sum + i % 7; i = i + 1; }\n"
+     "    return sum;\n"
+     "}\n"},
+    {"for" ,
+     "fn main() {\n"
+     "    var sum = 0;\n"
+     "    for i in 2000 { for j in 1000 { sum = sum + (i ^ j); } }\n"
+     "    return sum;\n"
+     "}\n"},
+    {"match" ,
+     "fn classify(x) {\n"
+     "    match x % 6 {\n"
+     "        0 => { return 10; }\n"
+     "        1 => return 20; ,\n"
+     "        2 => return 30; ,\n"
+     "        3 => return 40; ,\n"
+     "        4 => return 50; ,\n"
+     "        _ => return 0;\n"
+     "    }\n"
+     "}\n"
+     "fn main() {\n"
+     "    var total = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < 1000000) { total = total + classify(i); i = i + 1; }\n"
+     "    return total;\n"
+     "}\n"},
+    // Generated-code style : named constants , unit factors and dead debug branches
+    {"const" ,
+     "fn main() {\n"
+     "    let scale = 4 * 1024 / 8;\n"
+     "    let debug = 0;\n"
+     "    let offset = (scale - 512) * 3 + 0;\n"
+     "    var acc = 0;\n"
+     "    var i = 0;\n"
+     "    while (i < 2000000) {\n"
+     "        acc = acc + (i * 1 + offset) % (scale / 4) + (2 * 3 - 6);\n"
+     "        if (debug) { acc = acc + 1000000; }\n"
+     "        i = i + 1;\n"
+     "    }\n"
+     "    return acc;\n"
+     "}\n"},
+};
+
+int main(int argc , char* argv[]) {
+    int iterations = 3;
+    bool optimize = false;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--optimize") optimize = true;
+        else iterations = std::stoi(arg);
+    }
+    VM vm;
+    for(const Workload& w : WORKLOADS) {
+        Lexer lexer(w.source);
+        Parser parser(lexer);
+        Program program = parser.parseProgram();
+        if(optimize) optimizeProgram(program);
+        std::vector<CompileError> errors;
+        Module module = compileProgram(program , errors);
+        if(!errors.empty()) {
+            std::cerr<<errors.front().toString()<<std::endl;
+            return 1;
+        }
+        uint32_t entry = static_cast<uint32_t>(module.find(symbols().intern("main")));
+
+        // One counting run for the instruction total , then timed runs without the counter
+        uint64_t executed = 0;
+        Value result = vm.run(module , entry , {} , executed);
+        if(!vm.error().empty()) {
+            std::cerr<<"Runtime Error : "<<vm.error()<<std::endl;
+            return 1;
+        }
+
+        double time = 0;
+        for(int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            vm.run(module , entry);
+            time += seconds(start);
+        }
+        time /= iterations;
+
+        std::cout<<w.name<<std::string(8 - std::string(w.name).size() , ' ')<<": ";
+        printValue(std::cout , result);
+        std::cout<<" , "<<executed<<" instructions , "<<time * 1000<<" ms ("
+                 <<executed / time / 1e6<<" M instructions/s)\n";
+    }
+    return 0;
+}
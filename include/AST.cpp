@@ -1,85 +1,195 @@
 #include "AST.h"
+#include "AstSerializer.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// print() is for debugging , it writes at once rather than buffering the way an export does
+constexpr size_t PRINT_BUFFER = 64 * 1024;
+
+void printTree(const ASTNode* root) {
+    thread_local AstSerializer printer(std::cout , AstFormat::TEXT , PRINT_BUFFER);
+    printer.node(root);
+    printer.flush();
+}
+
+} // namespace
 
 // ---- Number Expression ----
-NumberExpr::NumberExpr(std::string val) : value(val) {}
+NumberExpr::NumberExpr(NumberValue value , bool isFloat)
+    : Expression(AstKind::NUMBER), value(value), isFloat(isFloat) {}
 
 void NumberExpr::print() const {
-    std::cout << "NumberExpr(" << value << ")";
+    printTree(this);
+}
+
+// ---- String Expression ----
+StringExpr::StringExpr(SymbolId value) : Expression(AstKind::STRING), value(value) {}
+
+void StringExpr::print() const {
+    printTree(this);
 }
 
 // ---- Variable Expression ----
-VariableExpr::VariableExpr(std::string name) : name(name) {}
+VariableExpr::VariableExpr(SymbolId name) : Expression(AstKind::VARIABLE), name(name) {}
 
 void VariableExpr::print() const {
-    std::cout << "VariableExpr(" << name << ")";
+    printTree(this);
+}
+
+// ---- Unary Expression ----
+UnaryExpr::UnaryExpr(TokenType op, Expression* operand)
+    : Expression(AstKind::UNARY), op(op), operand(operand) {}
+
+void UnaryExpr::print() const {
+    printTree(this);
 }
 
 // ---- Binary Expression ----
-BinaryExpr::BinaryExpr(std::unique_ptr<Expression> left, Token op, std::unique_ptr<Expression> right)
-    : left(std::move(left)), op(op), right(std::move(right)) {}
+BinaryExpr::BinaryExpr(Expression* left, TokenType op, Expression* right)
+    : Expression(AstKind::BINARY), left(left), op(op), right(right) {}
 
 void BinaryExpr::print() const {
-    std::cout << "BinaryExpr(";
-    left->print();
-    std::cout << " " << op.value << " ";
-    right->print();
-    std::cout << ")";
+    printTree(this);
 }
 
 // ---- Let Statement ----
-LetStatement::LetStatement(std::string name, std::unique_ptr<Expression> value)
-    : name(name), value(std::move(value)) {}
+LetStatement::LetStatement(SymbolId name, Expression* value)
+    : Statement(AstKind::LET), name(name), value(value) {}
 
 void LetStatement::print() const {
-    std::cout << "LetStatement(" << name << " = ";
-    value->print();
-    std::cout << ")";
+    printTree(this);
 }
 
 // ---- Var Statement ----
-VarStatement::VarStatement(std::string name, std::unique_ptr<Expression> value)
-    : name(name), value(std::move(value)) {}
+VarStatement::VarStatement(SymbolId name, Expression* value)
+    : Statement(AstKind::VAR), name(name), value(value) {}
 
 void VarStatement::print() const {
-    std::cout << "VarStatement(" << name << " = ";
-    value->print();
-    std::cout << ")";
+    printTree(this);
 }
 
 // ---- Assign Statement ----
-AssignStatement::AssignStatement(std::string name, std::unique_ptr<Expression> value)
-    : name(name), value(std::move(value)) {}
+AssignStatement::AssignStatement(SymbolId name, Expression* value)
+    : Statement(AstKind::ASSIGN), name(name), value(value) {}
 
 void AssignStatement::print() const {
-    std::cout << "AssignStatement(" << name << " = ";
-    value->print();
-    std::cout << ")";
+    printTree(this);
 }
 
 // ---- Return Statement ----
-ReturnStatement::ReturnStatement(std::unique_ptr<Expression> value)
-    : value(std::move(value)) {}
+ReturnStatement::ReturnStatement(Expression* value)
+    : Statement(AstKind::RETURN), value(value) {}
 
 void ReturnStatement::print() const {
-    std::cout << "ReturnStatement(";
-    value->print();
-    std::cout << ")";
+    printTree(this);
+}
+
+// ---- If Statement ----
+void IfStatement::print() const {
+    printTree(this);
+}
+
+// ---- While Statement ----
+void WhileStatement::print() const {
+    printTree(this);
+}
+
+// ---- For Statement ----
+void ForStatement::print() const {
+    printTree(this);
+}
+
+// ---- Call Expression ----
+void CallExpr::print() const {
+    printTree(this);
+}
+
+// ---- Match Statement ----
+void MatchStatement::print() const {
+    printTree(this);
 }
 
 // ---- Function Declaration ----
-FunctionDecl::FunctionDecl(std::string name, std::vector<std::string> params, std::vector<std::unique_ptr<Statement>> body)
-    : name(name), params(std::move(params)), body(std::move(body)) {}
+FunctionDecl::FunctionDecl(SymbolId name, AstList<SymbolId> params, AstList<Statement*> body)
+    : ASTNode(AstKind::FUNCTION), name(name), params(params), body(body) {}
 
 void FunctionDecl::print() const {
-    std::cout << "FunctionDecl(" << name << " (";
-    for (size_t i = 0; i < params.size(); ++i) {
-        std::cout << params[i];
-        if (i < params.size() - 1) std::cout << ", ";
-    }
-    std::cout << ") { ";
-    for (const auto& stmt : body) {
-        stmt->print();
-        std::cout << "; ";
+    printTree(this);
+}
+
+size_t nestingDepth(const FunctionDecl* fn) {
+    struct Pending {
+        const ASTNode* node;
+        size_t depth;
+    };
+    std::vector<Pending> stack;
+    auto block = [&stack](const AstList<Statement*>& body , size_t depth) {
+        for(const Statement* stmt : body) stack.push_back(Pending{stmt , depth});
+    };
+    block(fn->body , 1);
+    size_t deepest = 0;
+    while(!stack.empty()) {
+        Pending top = stack.back();
+        stack.pop_back();
+        deepest = std::max(deepest , top.depth);
+        size_t next = top.depth + 1;
+        switch(top.node->kind) {
+            case AstKind::UNARY : stack.push_back(Pending{static_cast<const UnaryExpr*>(top.node)->operand , next}); break;
+            case AstKind::BINARY : {
+                auto bin = static_cast<const BinaryExpr*>(top.node);
+                stack.push_back(Pending{bin->left , next});
+                stack.push_back(Pending{bin->right , next});
+                break;
+            }
+            case AstKind::CALL : {
+                auto call = static_cast<const CallExpr*>(top.node);
+                stack.push_back(Pending{call->callee , next});
+                for(const Expression* arg : call->arguments) stack.push_back(Pending{arg , next});
+                break;
+            }
+            case AstKind::LET : stack.push_back(Pending{static_cast<const LetStatement*>(top.node)->value , next}); break;
+            case AstKind::VAR : stack.push_back(Pending{static_cast<const VarStatement*>(top.node)->value , next}); break;
+            case AstKind::ASSIGN : stack.push_back(Pending{static_cast<const AssignStatement*>(top.node)->value , next}); break;
+            case AstKind::RETURN : stack.push_back(Pending{static_cast<const ReturnStatement*>(top.node)->value , next}); break;
+            case AstKind::IF : {
+                auto branch = static_cast<const IfStatement*>(top.node);
+                stack.push_back(Pending{branch->condition , next});
+                block(branch->thenBranch , next);
+                block(branch->elseBranch , next);
+                break;
+            }
+            case AstKind::WHILE : {
+                auto loop = static_cast<const WhileStatement*>(top.node);
+                stack.push_back(Pending{loop->condition , next});
+                block(loop->body , next);
+                break;
+            }
+            case AstKind::FOR : {
+                auto loop = static_cast<const ForStatement*>(top.node);
+                stack.push_back(Pending{loop->iterable , next});
+                block(loop->body , next);
+                break;
+            }
+            case AstKind::MATCH : {
+                auto match = static_cast<const MatchStatement*>(top.node);
+                stack.push_back(Pending{match->expr , next});
+                for(const MatchArm& arm : match->arms) {
+                    stack.push_back(Pending{arm.pattern , next});
+                    block(arm.body , next);
+                }
+                break;
+            }
+            default : break;
+        }
     }
-    std::cout << "})";
+    return deepest;
+}
+
+// ---- Parse Error ----
+std::string ParseError::toString() const {
+    std::string out = "Parse Error : " + message + " at line " + std::to_string(line);
+    if(got == TokenType::END_OF_FILE) return out + " , got end of file";
+    return out + " , got '" + gotText + "'";
 }
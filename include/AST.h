@@ -1,170 +1,279 @@
 #ifndef AST_H
 #define AST_H
 
+#include "AstArena.h"
+#include "Stats.h"
 #include "Token.h"
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
-#include <memory>
+
+// Every node lives in an AstArena : children are raw pointers and child
+// arrays are AstLists. Names and string literals are interned SymbolIds ,
+// number literals hold the value the lexer converted.
+
+// ---- Where a variable lives , filled in by the resolver ----
+// `slot` indexes the enclosing function's frame , `depth` counts the lexical
+// scopes between the reference and its binding (0 = the same scope).
+struct VarRef {
+    static constexpr uint16_t UNRESOLVED = 0xFFFF;
+
+    uint16_t depth = 0;
+    uint16_t slot = UNRESOLVED;
+
+    bool resolved() const { return slot != UNRESOLVED; }
+};
+
+// Concrete node type , lets passes dispatch with a switch instead of dynamic_cast
+enum class AstKind : uint8_t {
+    NUMBER, STRING, VARIABLE, UNARY, BINARY, CALL,
+    LET, VAR, ASSIGN, RETURN, IF, WHILE, FOR, MATCH,
+    MATCH_ARM, // only materialized as a node in the flat layout
+    FUNCTION
+};
+static_assert(static_cast<size_t>(AstKind::FUNCTION) < NODE_KINDS , "grow NODE_KINDS in Stats.h");
 
 // ---- Base class for all AST nodes ----
 class ASTNode {
 public:
-    virtual ~ASTNode() = default;
+    static constexpr uint32_t UNNUMBERED = 0xFFFFFF;
+
+    const AstKind kind;
+    // Dense number of an expression within its function , set by the
+    // resolver so passes can keep per-expression facts in arrays. It fills
+    // the padding after kind. UNNUMBERED on statements , on nodes a pass
+    // made up and past a function's first 16M expressions.
+    uint32_t index : 24;
+    int line = 0; // source line the node starts on , 0 for nodes a pass made up
+
     virtual void print() const = 0;  // Pure virtual function for debugging
+
+protected:
+    explicit ASTNode(AstKind kind) : kind(kind) , index(UNNUMBERED) {
+        if(CompileStats::enabled) CompileStats::local().nodes[static_cast<size_t>(kind)]++;
+    }
+    ~ASTNode() = default; // Never deleted through a base pointer , the arena frees nodes in bulk
 };
 
 // ---- EXPRESSION NODES ----
-class Expression : public ASTNode {}; // Base class for expressions
+class Expression : public ASTNode { // Base class for expressions
+protected:
+    using ASTNode::ASTNode;
+};
 
 class NumberExpr : public Expression {
 public:
-    std::string value;
-    NumberExpr(std::string val);
+    NumberValue value;
+    bool isFloat; // value.f , otherwise value.i
+    NumberExpr(NumberValue value , bool isFloat);
     void print() const override;  // Declare print() properly
 };
 
+class StringExpr : public Expression {
+public:
+    SymbolId value; // literal text without the quotes
+    StringExpr(SymbolId value);
+    void print() const override;
+};
+
 class VariableExpr : public Expression {
 public:
-    std::string name;
-    VariableExpr(std::string name);
+    SymbolId name;
+    VarRef ref; // left unresolved for callee names and the `_` pattern
+    VariableExpr(SymbolId name);
+    void print() const override;
+};
+
+// A prefix operator , only '!' so far : 1 when the operand is falsy , else 0
+class UnaryExpr : public Expression {
+public:
+    TokenType op;
+    Expression* operand;
+
+    UnaryExpr(TokenType op, Expression* operand);
     void print() const override;
 };
 
 class BinaryExpr : public Expression {
 public:
-    std::unique_ptr<Expression> left;
-    Token op;
-    std::unique_ptr<Expression> right;
+    Expression* left;
+    TokenType op;
+    Expression* right;
 
-    BinaryExpr(std::unique_ptr<Expression> left, Token op, std::unique_ptr<Expression> right);
+    BinaryExpr(Expression* left, TokenType op, Expression* right);
     void print() const override;
 };
 
 // ---- STATEMENT NODES ----
-class Statement : public ASTNode {};
+class Statement : public ASTNode {
+protected:
+    using ASTNode::ASTNode;
+};
 
 class LetStatement : public Statement {
 public:
-    std::string name;
-    std::unique_ptr<Expression> value;
-    
-    LetStatement(std::string name, std::unique_ptr<Expression> value);
+    SymbolId name;
+    Expression* value;
+    uint16_t slot = VarRef::UNRESOLVED;
+
+    LetStatement(SymbolId name, Expression* value);
     void print() const override;
 };
 
 class VarStatement : public Statement {
 public:
-    std::string name;
-    std::unique_ptr<Expression> value;
-    
-    VarStatement(std::string name, std::unique_ptr<Expression> value);
+    SymbolId name;
+    Expression* value;
+    uint16_t slot = VarRef::UNRESOLVED;
+
+    VarStatement(SymbolId name, Expression* value);
     void print() const override;
 };
 
 class AssignStatement : public Statement {
 public:
-    std::string name;
-    std::unique_ptr<Expression> value;
+    SymbolId name;
+    Expression* value;
+    VarRef ref;
 
-    AssignStatement(std::string name, std::unique_ptr<Expression> value);
+    AssignStatement(SymbolId name, Expression* value);
     void print() const override;
 };
 
 class ReturnStatement : public Statement {
 public:
-    std::unique_ptr<Expression> value;
-    
-    ReturnStatement(std::unique_ptr<Expression> value);
+    Expression* value;
+
+    ReturnStatement(Expression* value);
     void print() const override;
 };
 
 class IfStatement : public Statement {
     public :
-        std::unique_ptr<Expression> condition;
-        std::vector<std::unique_ptr<Statement>> thenBranch;
-        std::vector<std::unique_ptr<Statement>> elseBranch;
+        Expression* condition;
+        AstList<Statement*> thenBranch;
+        AstList<Statement*> elseBranch;
 
         IfStatement(
-            std::unique_ptr<Expression> cond,
-            std::vector<std::unique_ptr<Statement>> thenB,
-            std::vector<std::unique_ptr<Statement>> elseB
-        ) : condition(std::move(cond)) 
-          , thenBranch(std::move(thenB))
-          , elseBranch(std::move(elseB))
+            Expression* cond,
+            AstList<Statement*> thenB,
+            AstList<Statement*> elseB
+        ) : Statement(AstKind::IF)
+          , condition(cond)
+          , thenBranch(thenB)
+          , elseBranch(elseB)
           {}
-        void print() const override;  
+        void print() const override;
 };
 
 class WhileStatement : public Statement {
     public :
-        std::unique_ptr<Expression> condition;
-        std::vector<std::unique_ptr<Statement>> body;
+        Expression* condition;
+        AstList<Statement*> body;
 
         WhileStatement(
-            std::unique_ptr<Expression> cond,
-            std::vector<std::unique_ptr<Statement>> body
-        ) : condition(std::move(cond)) , body(std::move(body)) {}
-        
+            Expression* cond,
+            AstList<Statement*> body
+        ) : Statement(AstKind::WHILE) , condition(cond) , body(body) {}
+
         void print() const override;
 };
 
 class ForStatement : public Statement {
     public :
-        std::string iteratorName;
-        std::unique_ptr<Expression> iterable;
-        std::vector<std::unique_ptr<Statement>> body;
+        SymbolId iteratorName;
+        Expression* iterable;
+        AstList<Statement*> body;
+        uint16_t iteratorSlot = VarRef::UNRESOLVED;
 
         ForStatement (
-            std::string itName,
-            std::unique_ptr<Expression> iterable,
-            std::vector<std::unique_ptr<Statement>> body 
-        ) : iteratorName(std::move(itName))
-          , iterable(std::move(iterable))
-          , body(std::move(body))
+            SymbolId itName,
+            Expression* iterable,
+            AstList<Statement*> body
+        ) : Statement(AstKind::FOR)
+          , iteratorName(itName)
+          , iterable(iterable)
+          , body(body)
         {}
         void print() const override;
 };
 
 class CallExpr : public Expression {
     public :
-        std::unique_ptr<Expression> callee;
-        std::vector<std::unique_ptr<Expression>> arguments;
+        Expression* callee;
+        AstList<Expression*> arguments;
 
         CallExpr(
-            std::unique_ptr<Expression> callee,
-            std::vector<std::unique_ptr<Expression>> args
-        ) : callee(std::move(callee)) , arguments(std::move(args)) {}
+            Expression* callee,
+            AstList<Expression*> args
+        ) : Expression(AstKind::CALL) , callee(callee) , arguments(args) {}
 
         void print() const override;
 };
 
 struct MatchArm
 {
-    std::unique_ptr<Expression> pattern;
-    std::vector<std::unique_ptr<Statement>> body;
-    MatchArm(std::unique_ptr<Expression> pat , std::vector<std::unique_ptr<Statement>> stmts)
-        : pattern(std::move(pat)) , body(std::move(stmts)) {}
+    Expression* pattern;
+    AstList<Statement*> body;
+    MatchArm(Expression* pat , AstList<Statement*> stmts)
+        : pattern(pat) , body(stmts) {}
 };
 
 class MatchStatement : public Statement {
-    public : 
-        std::unique_ptr<Expression> expr;
-        std::vector<MatchArm> arms;
+    public :
+        Expression* expr;
+        AstList<MatchArm> arms;
 
-        MatchStatement(std::unique_ptr<Expression> expr , std::vector<MatchArm> arms)
-            : expr(std::move(expr)) , arms(std::move(arms)) {}
+        MatchStatement(Expression* expr , AstList<MatchArm> arms)
+            : Statement(AstKind::MATCH) , expr(expr) , arms(arms) {}
 
-        void print() const override;   
+        void print() const override;
 };
 
 class FunctionDecl : public ASTNode {
 public:
-    std::string name;
-    std::vector<std::string> params;
-    std::vector<std::unique_ptr<Statement>> body;
-    
-    FunctionDecl(std::string name, std::vector<std::string> params, std::vector<std::unique_ptr<Statement>> body);
+    SymbolId name;
+    AstList<SymbolId> params;
+    AstList<Statement*> body;
+    uint16_t frameSlots = 0; // most variables live at once , set by the resolver
+    uint32_t expressions = 0; // expressions numbered by the resolver , indexes run 0 .. expressions - 1
+
+    FunctionDecl(SymbolId name, AstList<SymbolId> params, AstList<Statement*> body);
     void print() const override;
 };
 
+// Levels in the deepest chain of nested statements and expressions in `fn` ,
+// its top-level statements being level 1. Counted with an explicit stack ,
+// for passes that recurse over the tree to check before they start.
+size_t nestingDepth(const FunctionDecl* fn);
+
+// ---- A syntax error , the parser records it and carries on ----
+struct ParseError {
+    int line;
+    std::string message; // e.g. "expected ';' after return"
+    TokenType got;       // the token found instead
+    std::string gotText;
+    TokenType expected;  // the one token that would have fit , when `expectsToken`
+    bool expectsToken;
+
+    // "Parse Error : <message> at line <n> , got '<text>'"
+    std::string toString() const;
+};
+
+// ---- A parsed compilation unit : the arenas own every node below `functions` ----
+// With syntax errors `functions` holds what could be parsed around them ,
+// the statements and functions that failed are left out.
+class Program {
+public:
+    AstArena arena;
+    std::vector<AstArena> workerArenas; // filled by a parallel parse , one per worker
+    std::vector<FunctionDecl*> functions;
+    std::vector<ParseError> errors;     // in source order
+
+    Program() = default;
+    Program(Program&&) = default;
+    Program& operator=(Program&&) = default;
+};
+
 #endif // AST_H
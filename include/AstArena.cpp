@@ -0,0 +1,109 @@
+#include "AstArena.h"
+#include "Stats.h"
+#include <algorithm>
+#include <mutex>
+
+// ---- Shared cache of free standard-size blocks ----
+namespace {
+
+std::mutex cacheMutex;
+std::vector<char*> cachedBlocks;
+size_t cacheLimit = 1024; // blocks
+
+char* takeBlock() {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if(!cachedBlocks.empty()) {
+            char* block = cachedBlocks.back();
+            cachedBlocks.pop_back();
+            return block;
+        }
+    }
+    if(CompileStats::enabled) CompileStats::local().arenaHeapBytes += AstArena::BLOCK_SIZE;
+    return new char[AstArena::BLOCK_SIZE];
+}
+
+void returnBlocks(std::vector<char*>& blocks) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for(char* block : blocks) {
+        if(cachedBlocks.size() < cacheLimit) cachedBlocks.push_back(block);
+        else delete[] block;
+    }
+    blocks.clear();
+}
+
+} // namespace
+
+void AstArena::setBlockCacheLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheLimit = bytes / BLOCK_SIZE;
+    while(cachedBlocks.size() > cacheLimit) {
+        delete[] cachedBlocks.back();
+        cachedBlocks.pop_back();
+    }
+}
+
+AstArena::AstArena() : cursor(nullptr) , limit(nullptr) , used(0) , reserved(0) {}
+
+AstArena::~AstArena() {
+    release();
+}
+
+AstArena::AstArena(AstArena&& other) noexcept
+    : blocks(std::move(other.blocks)) , largeBlocks(std::move(other.largeBlocks))
+    , cursor(other.cursor) , limit(other.limit) , used(other.used) , reserved(other.reserved) {
+    other.cursor = other.limit = nullptr;
+    other.used = other.reserved = 0;
+}
+
+AstArena& AstArena::operator=(AstArena&& other) noexcept {
+    if(this != &other) {
+        release();
+        blocks = std::move(other.blocks);
+        largeBlocks = std::move(other.largeBlocks);
+        cursor = other.cursor;
+        limit = other.limit;
+        used = other.used;
+        reserved = other.reserved;
+        other.cursor = other.limit = nullptr;
+        other.used = other.reserved = 0;
+    }
+    return *this;
+}
+
+void AstArena::release() {
+    if(!blocks.empty()) returnBlocks(blocks);
+    for(char* block : largeBlocks) delete[] block;
+    largeBlocks.clear();
+    cursor = limit = nullptr;
+    used = reserved = 0;
+}
+
+void AstArena::reserve(size_t bytes) {
+    if(bytes == 0) return;
+    char* block = new char[bytes];
+    if(CompileStats::enabled) CompileStats::local().arenaHeapBytes += bytes;
+    largeBlocks.push_back(block);
+    reserved += bytes;
+    cursor = block;
+    limit = block + bytes;
+}
+
+void* AstArena::grow(size_t size , size_t align) {
+    if(size + align > BLOCK_SIZE / 4) {
+        //BIG LISTS GET THEIR OWN BLOCK SO THE CURRENT ONE KEEPS ITS TAIL
+        char* block = new char[size + align];
+        if(CompileStats::enabled) CompileStats::local().arenaHeapBytes += size + align;
+        largeBlocks.push_back(block);
+        reserved += size + align;
+        used += size;
+        uintptr_t p = (reinterpret_cast<uintptr_t>(block) + align - 1) & ~(uintptr_t(align) - 1);
+        return reinterpret_cast<void*>(p);
+    }
+    char* block = takeBlock();
+    blocks.push_back(block);
+    reserved += BLOCK_SIZE;
+    cursor = block;
+    limit = block + BLOCK_SIZE;
+    return allocate(size , align);
+}
@@ -0,0 +1,100 @@
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ---- Child array living in an arena ----
+template <typename T>
+class AstList {
+public:
+    T* items;
+    uint32_t count;
+
+    AstList() : items(nullptr) , count(0) {}
+    AstList(T* items , uint32_t count) : items(items) , count(count) {}
+
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return items[i]; }
+};
+
+// ---- Bump allocator owning every node of one compilation unit ----
+// Nodes are never destroyed one by one , so everything placed here must be
+// trivially destructible. Dropping the arena frees the whole tree at once :
+// standard blocks go back to a process-wide cache so the next compilation
+// reuses warm pages instead of faulting in fresh ones.
+class AstArena {
+    public :
+        static const size_t BLOCK_SIZE = 64 * 1024;
+
+    private :
+        std::vector<char*> blocks;      // BLOCK_SIZE each
+        std::vector<char*> largeBlocks; // single oversized allocations
+        char* cursor;
+        char* limit;
+        size_t used;
+        size_t reserved;
+
+        void* grow(size_t size , size_t align);
+        void release();
+
+    public :
+        AstArena();
+        ~AstArena();
+        AstArena(AstArena&& other) noexcept;
+        AstArena& operator=(AstArena&& other) noexcept;
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+
+        void* allocate(size_t size , size_t align) {
+            uintptr_t p = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t(align) - 1);
+            if(p + size > reinterpret_cast<uintptr_t>(limit)) return grow(size , align);
+            cursor = reinterpret_cast<char*>(p + size);
+            used += size;
+            return reinterpret_cast<void*>(p);
+        }
+
+        template <typename T , typename... Args>
+        T* create(Args&&... args) {
+            static_assert(std::is_trivially_destructible<T>::value , "arena objects are never destroyed");
+            return new (allocate(sizeof(T) , alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template <typename T>
+        AstList<T> copyList(const T* items , size_t count) {
+            static_assert(std::is_trivially_copyable<T>::value , "arena lists are copied bytewise");
+            if(count == 0) return AstList<T>();
+            T* out = static_cast<T*>(allocate(sizeof(T) * count , alignof(T)));
+            std::memcpy(static_cast<void*>(out) , items , sizeof(T) * count);
+            return AstList<T>(out , static_cast<uint32_t>(count));
+        }
+
+        std::string_view copyString(std::string_view text) {
+            if(text.empty()) return std::string_view();
+            char* out = static_cast<char*>(allocate(text.size() , 1));
+            std::memcpy(out , text.data() , text.size());
+            return std::string_view(out , text.size());
+        }
+
+        // Fill one block of exactly `bytes` next , for a copy whose size is
+        // known : the tree then sits in a single block with no idle tail
+        void reserve(size_t bytes);
+
+        size_t bytesUsed() const { return used; }
+        size_t bytesReserved() const { return reserved; }
+        size_t blockCount() const { return blocks.size() + largeBlocks.size(); }
+
+        // Upper bound on the bytes kept in the shared block cache (default 64 MB)
+        static void setBlockCacheLimit(size_t bytes);
+};
+
+#endif // AST_ARENA_H
@@ -0,0 +1,647 @@
+#include "AstSerializer.h"
+#include <charconv>
+
+namespace {
+
+bool isLeaf(AstKind kind) {
+    return kind == AstKind::NUMBER || kind == AstKind::STRING || kind == AstKind::VARIABLE;
+}
+
+// JSON "kind" and S-expression head by node kind
+struct KindNames {
+    const char* json;
+    const char* sexpr;
+};
+
+KindNames namesOf(AstKind kind) {
+    switch(kind) {
+        case AstKind::NUMBER : return {"Number" , "num"};
+        case AstKind::STRING : return {"String" , "str"};
+        case AstKind::VARIABLE : return {"Variable" , "name"};
+        case AstKind::UNARY : return {"Unary" , "unary"};
+        case AstKind::BINARY : return {"Binary" , "binary"};
+        case AstKind::CALL : return {"Call" , "call"};
+        case AstKind::LET : return {"Let" , "let"};
+        case AstKind::VAR : return {"Var" , "var"};
+        case AstKind::ASSIGN : return {"Assign" , "assign"};
+        case AstKind::RETURN : return {"Return" , "return"};
+        case AstKind::IF : return {"If" , "if"};
+        case AstKind::WHILE : return {"While" , "while"};
+        case AstKind::FOR : return {"For" , "for"};
+        case AstKind::MATCH : return {"Match" , "match"};
+        case AstKind::MATCH_ARM : return {"Arm" , "arm"};
+        case AstKind::FUNCTION : return {"Function" , "fn"};
+    }
+    return {"?" , "?"};
+}
+
+// Length of the well-formed UTF-8 sequence at text[i] , 0 if it is not one :
+// a stray continuation byte , a truncated sequence , an overlong form , a
+// surrogate or a code point past U+10FFFF
+size_t utf8Length(std::string_view text , size_t i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    size_t n;
+    unsigned char lo = 0x80 , hi = 0xBF; // range of the second byte
+    if(c >= 0xC2 && c <= 0xDF) n = 2;
+    else if(c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if(c == 0xE0) lo = 0xA0;
+        if(c == 0xED) hi = 0x9F;
+    } else if(c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if(c == 0xF0) lo = 0x90;
+        if(c == 0xF4) hi = 0x8F;
+    } else return 0;
+    if(text.size() - i < n) return 0;
+    unsigned char second = static_cast<unsigned char>(text[i + 1]);
+    if(second < lo || second > hi) return 0;
+    for(size_t k = 2; k < n; k++) {
+        if((static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+int lineOf(const void* node , AstKind kind) {
+    if(kind == AstKind::MATCH_ARM) return static_cast<const MatchArm*>(node)->pattern->line;
+    return static_cast<const ASTNode*>(node)->line;
+}
+
+} // namespace
+
+bool parseAstFormat(std::string_view name , AstFormat& format) {
+    if(name == "text") format = AstFormat::TEXT;
+    else if(name == "json") format = AstFormat::JSON;
+    else if(name == "sexpr") format = AstFormat::SEXPR;
+    else return false;
+    return true;
+}
+
+AstSerializer::AstSerializer(std::ostream& sink , AstFormat format , size_t bufferSize)
+    : sink(sink) , format(format) , bufferSize(bufferSize) , written(0) {
+    out.reserve(bufferSize + bufferSize / 4);
+}
+
+AstSerializer::~AstSerializer() {
+    flush();
+}
+
+void AstSerializer::flush() {
+    if(out.empty()) return;
+    sink.write(out.data() , static_cast<std::streamsize>(out.size()));
+    out.clear();
+}
+
+// ---- Programs ----
+
+void AstSerializer::beginProgram() {
+    written = 0;
+    if(format == AstFormat::JSON) out += "{\"functions\":[";
+    else if(format == AstFormat::SEXPR) out += "(program";
+}
+
+void AstSerializer::function(const FunctionDecl* fn) {
+    if(format == AstFormat::JSON) out += written ? ",\n" : "\n";
+    else if(format == AstFormat::SEXPR) out += "\n";
+    walk(fn , AstKind::FUNCTION);
+    if(format == AstFormat::TEXT) out += "\n";
+    written++;
+    if(out.size() >= bufferSize) flush();
+}
+
+void AstSerializer::endProgram(const std::vector<ParseError>& errors) {
+    if(format == AstFormat::JSON) {
+        out += written ? "\n],\"errors\":[" : "],\"errors\":[";
+        for(size_t i = 0; i < errors.size(); i++) {
+            out += i ? ",\n{\"line\":" : "\n{\"line\":";
+            number(errors[i].line);
+            out += ",\"message\":";
+            quoted(errors[i].message);
+            out += ",\"got\":";
+            quoted(errors[i].gotText);
+            out += "}";
+        }
+        out += errors.empty() ? "]}\n" : "\n]}\n";
+    } else if(format == AstFormat::SEXPR) {
+        out += "\n(errors";
+        for(const ParseError& error : errors) {
+            out += "\n(error ";
+            number(error.line);
+            out += " ";
+            quoted(error.message);
+            out += " ";
+            quoted(error.gotText);
+            out += ")";
+        }
+        out += "))\n";
+    }
+    flush();
+}
+
+void AstSerializer::program(const Program& program) {
+    beginProgram();
+    for(const FunctionDecl* fn : program.functions) function(fn);
+    endProgram(program.errors);
+}
+
+void AstSerializer::node(const ASTNode* node) {
+    walk(node , node->kind);
+}
+
+// ---- The walk ----
+
+void AstSerializer::walk(const void* root , AstKind kind) {
+    visit(root , kind);
+    while(!stack.empty()) {
+        if(out.size() >= bufferSize) flush();
+        if(format == AstFormat::TEXT) stepText(stack.back());
+        else stepTree(stack.back());
+    }
+}
+
+// Leaves are written on the spot , only nodes with children take a frame
+void AstSerializer::visit(const void* node , AstKind kind) {
+    if(isLeaf(kind)) leaf(static_cast<const ASTNode*>(node));
+    else stack.push_back(Frame{node , kind , 0 , 0});
+}
+
+void AstSerializer::leaf(const ASTNode* node) {
+    if(format == AstFormat::TEXT) {
+        switch(node->kind) {
+            case AstKind::NUMBER :
+                out += "NumberExpr(";
+                numberValue(static_cast<const NumberExpr*>(node));
+                out += ")";
+                return;
+            case AstKind::STRING :
+                out += "StringExpr(\"";
+                out += symbolText(static_cast<const StringExpr*>(node)->value);
+                out += "\")";
+                return;
+            default :
+                out += "VariableExpr(";
+                out += symbolText(static_cast<const VariableExpr*>(node)->name);
+                out += ")";
+                return;
+        }
+    }
+    KindNames names = namesOf(node->kind);
+    open(names.json , names.sexpr , node->line);
+    switch(node->kind) {
+        case AstKind::NUMBER :
+            out += format == AstFormat::JSON ? ",\"value\":" : " ";
+            numberValue(static_cast<const NumberExpr*>(node));
+            break;
+        case AstKind::STRING :
+            out += format == AstFormat::JSON ? ",\"value\":" : " ";
+            quoted(symbolText(static_cast<const StringExpr*>(node)->value));
+            break;
+        default :
+            name("name" , static_cast<const VariableExpr*>(node)->name);
+    }
+    close();
+}
+
+void AstSerializer::open(const char* json , const char* sexpr , int line) {
+    if(format == AstFormat::JSON) {
+        out += "{\"kind\":\"";
+        out += json;
+        out += "\",\"line\":";
+    } else {
+        out += "(";
+        out += sexpr;
+        out += " ";
+    }
+    number(line);
+}
+
+// A bare number in every format , floats always with a '.' or an exponent
+void AstSerializer::numberValue(const NumberExpr* num) {
+    char text[NUMBER_TEXT_MAX];
+    out.append(text , formatNumber(text , num->value , num->isFloat));
+}
+
+void AstSerializer::close() {
+    out += format == AstFormat::JSON ? '}' : ')';
+}
+
+// Names are identifiers , bare atoms in an S-expression unless empty (a
+// function whose header failed to parse)
+void AstSerializer::name(const char* key , SymbolId symbol) {
+    std::string_view text = symbolText(symbol);
+    if(format == AstFormat::JSON) {
+        out += ",\"";
+        out += key;
+        out += "\":";
+        quoted(text);
+        return;
+    }
+    out += " ";
+    if(text.empty()) out += "\"\"";
+    else out += text;
+}
+
+void AstSerializer::quoted(std::string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0; // start of the stretch that needs no escaping
+    for(size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if(c >= 0x20 && c < 0x80 && c != '"' && c != '\\') continue;
+        if(c >= 0x80) {
+            size_t n = utf8Length(text , i);
+            if(n) {
+                i += n - 1;
+                continue;
+            }
+        }
+        out.append(text.data() + run , i - run);
+        run = i + 1;
+        switch(c) {
+            case '"' : out += "\\\""; break;
+            case '\\' : out += "\\\\"; break;
+            case '\n' : out += "\\n"; break;
+            case '\t' : out += "\\t"; break;
+            case '\r' : out += "\\r"; break;
+            default : // a control character , or a byte that is not UTF-8 : its Latin-1 code point
+                out += "\\u00";
+                out += HEX[c >> 4];
+                out += HEX[c & 15];
+        }
+    }
+    out.append(text.data() + run , text.size() - run);
+    out += '"';
+}
+
+void AstSerializer::number(long long n) {
+    char buf[24];
+    auto result = std::to_chars(buf , buf + sizeof(buf) , n);
+    out.append(buf , static_cast<size_t>(result.ptr - buf));
+}
+
+// ---- TEXT : ASTNode::print()'s form ----
+
+// The next statement of `body` , each followed by "; ". False once the list
+// is done. A visit may move the stack , so `frame` is dead after true.
+bool AstSerializer::statements(Frame& frame , const AstList<Statement*>& body) {
+    if(frame.index > 0) out += "; ";
+    if(frame.index < body.size()) {
+        const Statement* stmt = body[frame.index++];
+        visit(stmt , stmt->kind);
+        return true;
+    }
+    frame.index = 0;
+    return false;
+}
+
+void AstSerializer::stepText(Frame& frame) {
+    const ASTNode* node = static_cast<const ASTNode*>(frame.node);
+    switch(frame.kind) {
+        case AstKind::UNARY : {
+            auto un = static_cast<const UnaryExpr*>(node);
+            if(frame.phase == 0) {
+                out += "UnaryExpr(";
+                out += tokenSpelling(un->op);
+                frame.phase = 1;
+                visit(un->operand , un->operand->kind);
+            } else {
+                out += ")";
+                stack.pop_back();
+            }
+            return;
+        }
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            if(frame.phase == 0) {
+                out += "BinaryExpr(";
+                frame.phase = 1;
+                visit(bin->left , bin->left->kind);
+            } else if(frame.phase == 1) {
+                out += " ";
+                out += tokenSpelling(bin->op);
+                out += " ";
+                frame.phase = 2;
+                visit(bin->right , bin->right->kind);
+            } else {
+                out += ")";
+                stack.pop_back();
+            }
+            return;
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(node);
+            if(frame.phase == 0) {
+                out += "CallExpr(";
+                frame.phase = 1;
+                visit(call->callee , call->callee->kind);
+                return;
+            }
+            if(frame.index == 0) out += " (";
+            if(frame.index < call->arguments.size()) {
+                if(frame.index > 0) out += ", ";
+                const Expression* arg = call->arguments[frame.index++];
+                visit(arg , arg->kind);
+                return;
+            }
+            out += "))";
+            stack.pop_back();
+            return;
+        }
+        case AstKind::LET :
+        case AstKind::VAR :
+        case AstKind::ASSIGN :
+        case AstKind::RETURN : {
+            if(frame.phase > 0) {
+                out += ")";
+                stack.pop_back();
+                return;
+            }
+            frame.phase = 1;
+            if(frame.kind == AstKind::RETURN) {
+                out += "ReturnStatement(";
+                const Expression* value = static_cast<const ReturnStatement*>(node)->value;
+                visit(value , value->kind);
+                return;
+            }
+            const Expression* value;
+            if(frame.kind == AstKind::LET) {
+                auto let = static_cast<const LetStatement*>(node);
+                out += "LetStatement(";
+                out += symbolText(let->name);
+                value = let->value;
+            } else if(frame.kind == AstKind::VAR) {
+                auto var = static_cast<const VarStatement*>(node);
+                out += "VarStatement(";
+                out += symbolText(var->name);
+                value = var->value;
+            } else {
+                auto assign = static_cast<const AssignStatement*>(node);
+                out += "AssignStatement(";
+                out += symbolText(assign->name);
+                value = assign->value;
+            }
+            out += " = ";
+            visit(value , value->kind);
+            return;
+        }
+        case AstKind::IF : {
+            auto stmt = static_cast<const IfStatement*>(node);
+            switch(frame.phase) {
+                case 0 :
+                    out += "IfStatement(";
+                    frame.phase = 1;
+                    visit(stmt->condition , stmt->condition->kind);
+                    return;
+                case 1 :
+                    out += ") { ";
+                    frame.phase = 2;
+                    [[fallthrough]];
+                case 2 :
+                    if(statements(frame , stmt->thenBranch)) return;
+                    out += "}";
+                    if(stmt->elseBranch.empty()) break;
+                    out += " else { ";
+                    frame.phase = 3;
+                    [[fallthrough]];
+                default :
+                    if(statements(frame , stmt->elseBranch)) return;
+                    out += "}";
+            }
+            stack.pop_back();
+            return;
+        }
+        case AstKind::WHILE :
+        case AstKind::FOR : {
+            bool isWhile = frame.kind == AstKind::WHILE;
+            const AstList<Statement*>& body = isWhile ? static_cast<const WhileStatement*>(node)->body
+                                                      : static_cast<const ForStatement*>(node)->body;
+            if(frame.phase == 0) {
+                frame.phase = 1;
+                if(isWhile) {
+                    out += "WhileStatement(";
+                    const Expression* cond = static_cast<const WhileStatement*>(node)->condition;
+                    visit(cond , cond->kind);
+                } else {
+                    auto stmt = static_cast<const ForStatement*>(node);
+                    out += "ForStatement(";
+                    out += symbolText(stmt->iteratorName);
+                    out += " in ";
+                    visit(stmt->iterable , stmt->iterable->kind);
+                }
+                return;
+            }
+            if(frame.phase == 1) {
+                out += ") { ";
+                frame.phase = 2;
+            }
+            if(statements(frame , body)) return;
+            out += "}";
+            stack.pop_back();
+            return;
+        }
+        case AstKind::MATCH : {
+            // Phases from 2 come in pairs per arm : its pattern , then its body
+            auto stmt = static_cast<const MatchStatement*>(node);
+            if(frame.phase == 0) {
+                out += "MatchStatement(";
+                frame.phase = 1;
+                visit(stmt->expr , stmt->expr->kind);
+                return;
+            }
+            if(frame.phase == 1) {
+                out += ") { ";
+                frame.phase = 2;
+            }
+            size_t arm = (frame.phase - 2) / 2;
+            if(arm == stmt->arms.size()) {
+                out += "}";
+                stack.pop_back();
+            } else if(frame.phase % 2 == 0) {
+                frame.phase++;
+                const Expression* pattern = stmt->arms[arm].pattern;
+                visit(pattern , pattern->kind);
+            } else {
+                if(frame.index == 0) out += " => { ";
+                if(statements(frame , stmt->arms[arm].body)) return;
+                out += "} ";
+                frame.phase++;
+            }
+            return;
+        }
+        case AstKind::FUNCTION : {
+            auto fn = static_cast<const FunctionDecl*>(node);
+            if(frame.phase == 0) {
+                out += "FunctionDecl(";
+                out += symbolText(fn->name);
+                out += " (";
+                for(size_t i = 0; i < fn->params.size(); ++i) {
+                    out += symbolText(fn->params[i]);
+                    if(i < fn->params.size() - 1) out += ", ";
+                }
+                out += ") { ";
+                frame.phase = 1;
+            }
+            if(statements(frame , fn->body)) return;
+            out += "})";
+            stack.pop_back();
+            return;
+        }
+        default :
+            stack.pop_back(); // leaves never take a frame , arms are part of their match here
+    }
+}
+
+// ---- JSON and SEXPR : a header , then the child slots in order ----
+
+// Slot `n` of the frame's node and , when `i` is inside it , its i-th child.
+// False past the last slot.
+bool AstSerializer::slot(const Frame& frame , uint32_t n , size_t i , Slot& slot , const void*& child , AstKind& kind) const {
+    auto one = [&](const char* name , const ASTNode* node) {
+        slot = Slot{name , false , 1};
+        child = node;
+        kind = node->kind;
+        return true;
+    };
+    auto list = [&](const char* name , const auto& items) {
+        slot = Slot{name , true , items.size()};
+        if(i < items.size()) {
+            child = items[i];
+            kind = items[i]->kind;
+        }
+        return true;
+    };
+    switch(frame.kind) {
+        case AstKind::UNARY : return n == 0 && one("operand" , static_cast<const UnaryExpr*>(frame.node)->operand);
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(frame.node);
+            if(n == 0) return one("left" , bin->left);
+            if(n == 1) return one("right" , bin->right);
+            return false;
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(frame.node);
+            if(n == 0) return one("callee" , call->callee);
+            if(n == 1) return list("args" , call->arguments);
+            return false;
+        }
+        case AstKind::LET : return n == 0 && one("value" , static_cast<const LetStatement*>(frame.node)->value);
+        case AstKind::VAR : return n == 0 && one("value" , static_cast<const VarStatement*>(frame.node)->value);
+        case AstKind::ASSIGN : return n == 0 && one("value" , static_cast<const AssignStatement*>(frame.node)->value);
+        case AstKind::RETURN : return n == 0 && one("value" , static_cast<const ReturnStatement*>(frame.node)->value);
+        case AstKind::IF : {
+            auto stmt = static_cast<const IfStatement*>(frame.node);
+            if(n == 0) return one("condition" , stmt->condition);
+            if(n == 1) return list("then" , stmt->thenBranch);
+            if(n == 2) return list("else" , stmt->elseBranch);
+            return false;
+        }
+        case AstKind::WHILE : {
+            auto stmt = static_cast<const WhileStatement*>(frame.node);
+            if(n == 0) return one("condition" , stmt->condition);
+            if(n == 1) return list("body" , stmt->body);
+            return false;
+        }
+        case AstKind::FOR : {
+            auto stmt = static_cast<const ForStatement*>(frame.node);
+            if(n == 0) return one("iterable" , stmt->iterable);
+            if(n == 1) return list("body" , stmt->body);
+            return false;
+        }
+        case AstKind::MATCH : {
+            auto stmt = static_cast<const MatchStatement*>(frame.node);
+            if(n == 0) return one("subject" , stmt->expr);
+            if(n > 1) return false;
+            slot = Slot{"arms" , true , stmt->arms.size()};
+            if(i < stmt->arms.size()) {
+                child = &stmt->arms[i];
+                kind = AstKind::MATCH_ARM;
+            }
+            return true;
+        }
+        case AstKind::MATCH_ARM : {
+            auto arm = static_cast<const MatchArm*>(frame.node);
+            if(n == 0) return one("pattern" , arm->pattern);
+            if(n == 1) return list("body" , arm->body);
+            return false;
+        }
+        case AstKind::FUNCTION : return n == 0 && list("body" , static_cast<const FunctionDecl*>(frame.node)->body);
+        default : return false;
+    }
+}
+
+// The opening and every field that is not a child node
+void AstSerializer::header(const Frame& frame) {
+    KindNames names = namesOf(frame.kind);
+    open(names.json , names.sexpr , lineOf(frame.node , frame.kind));
+    bool json = format == AstFormat::JSON;
+    switch(frame.kind) {
+        case AstKind::UNARY : {
+            out += json ? ",\"op\":\"" : " ";
+            out += tokenSpelling(static_cast<const UnaryExpr*>(frame.node)->op);
+            if(json) out += '"';
+            break;
+        }
+        case AstKind::BINARY : {
+            out += json ? ",\"op\":\"" : " ";
+            out += tokenSpelling(static_cast<const BinaryExpr*>(frame.node)->op);
+            if(json) out += '"';
+            break;
+        }
+        case AstKind::LET : name("name" , static_cast<const LetStatement*>(frame.node)->name); break;
+        case AstKind::VAR : name("name" , static_cast<const VarStatement*>(frame.node)->name); break;
+        case AstKind::ASSIGN : name("name" , static_cast<const AssignStatement*>(frame.node)->name); break;
+        case AstKind::FOR : name("iterator" , static_cast<const ForStatement*>(frame.node)->iteratorName); break;
+        case AstKind::FUNCTION : {
+            auto fn = static_cast<const FunctionDecl*>(frame.node);
+            name("name" , fn->name);
+            out += json ? ",\"params\":[" : " (";
+            for(size_t i = 0; i < fn->params.size(); i++) {
+                if(i > 0) out += json ? ',' : ' ';
+                if(json) quoted(symbolText(fn->params[i]));
+                else out += symbolText(fn->params[i]);
+            }
+            out += json ? ']' : ')';
+            break;
+        }
+        default : break;
+    }
+}
+
+void AstSerializer::stepTree(Frame& frame) {
+    if(frame.phase == 0) {
+        header(frame);
+        frame.phase = 1;
+        return;
+    }
+    Slot s;
+    const void* child = nullptr;
+    AstKind kind = AstKind::NUMBER;
+    if(!slot(frame , frame.phase - 1 , frame.index , s , child , kind)) {
+        close();
+        stack.pop_back();
+        return;
+    }
+    bool json = format == AstFormat::JSON;
+    if(frame.index == 0) {
+        if(json) {
+            out += ",\"";
+            out += s.name;
+            out += s.list ? "\":[" : "\":";
+        } else {
+            out += s.list ? " (" : " ";
+        }
+    }
+    if(!s.list) {
+        frame.phase++;
+        visit(child , kind); // may move the stack , `frame` is dead from here
+        return;
+    }
+    if(frame.index < s.count) {
+        if(frame.index > 0) out += json ? ',' : ' ';
+        frame.index++;
+        visit(child , kind);
+        return;
+    }
+    out += json ? ']' : ')';
+    frame.phase++;
+    frame.index = 0;
+}
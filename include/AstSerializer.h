@@ -0,0 +1,108 @@
+#ifndef AST_SERIALIZER_H
+#define AST_SERIALIZER_H
+
+#include "AST.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ---- AST export ----
+// Every node is written with its source line. Output collects in one buffer
+// that is handed to the stream in large pieces once it passes `bufferSize`,
+// so a program streamed function by function is never held whole. The walk
+// uses an explicit stack , any nesting depth the parser accepts is written.
+//
+//   TEXT   what ASTNode::print() shows , one function per line , no lines
+//   JSON   {"functions":[ one object per line ],"errors":[...]}
+//          node  {"kind":"Binary","line":3,"op":"+","left":{..},"right":{..}}
+//   SEXPR  (program <one function per line> (errors ...))
+//          node  (binary 3 + (name 3 x) (num 3 1))
+//
+// JSON keys and S-expression heads by node :
+//   Number    num     value                    Let/Var/Assign  let/var/assign  name value
+//   String    str     value                    Return  return  value
+//   Variable  name    name                     If      if      condition then[] else[]
+//   Binary    binary  op left right            While   while   condition body[]
+//   Call      call    callee args[]            For     for     iterator iterable body[]
+//   Match     match   subject arms[]           Arm     arm     pattern body[] (line of the pattern)
+//   Function  fn      name params[] body[]     Unary   unary   op operand
+// S-expressions keep that order , lists are parenthesised , names and
+// operators are bare atoms and string text is quoted. Numbers are bare in
+// every format , floats always carry a '.' or an exponent (2.0 , 1e+22).
+// Quoted text is valid UTF-8 : a byte of the source that is not part of a
+// UTF-8 sequence is written as the \u00XX escape of its Latin-1 reading.
+enum class AstFormat : uint8_t {
+    TEXT, JSON, SEXPR
+};
+
+// "text" , "json" or "sexpr" , false for anything else
+bool parseAstFormat(std::string_view name , AstFormat& format);
+
+class AstSerializer {
+    public :
+        static constexpr size_t DEFAULT_BUFFER = 1 << 20;
+
+    private :
+        // A node part way through : `phase` picks its next piece , `index`
+        // walks the list that phase writes. `node` is a MatchArm for MATCH_ARM.
+        struct Frame {
+            const void* node;
+            AstKind kind;
+            uint32_t phase;
+            uint32_t index;
+        };
+        // One child , or one list of children , of a node
+        struct Slot {
+            const char* name;
+            bool list;
+            size_t count;
+        };
+
+        std::ostream& sink;
+        AstFormat format;
+        size_t bufferSize;
+        std::string out;
+        std::vector<Frame> stack;
+        size_t written; // functions in the current program
+
+        void walk(const void* root , AstKind kind);
+        void visit(const void* node , AstKind kind);
+        void leaf(const ASTNode* node);
+        void open(const char* json , const char* sexpr , int line);
+        void close();
+        void name(const char* key , SymbolId symbol);
+        void quoted(std::string_view text);
+        void number(long long n);
+        void numberValue(const NumberExpr* num);
+
+        // TEXT
+        bool statements(Frame& frame , const AstList<Statement*>& body);
+        void stepText(Frame& frame);
+        // JSON and SEXPR
+        bool slot(const Frame& frame , uint32_t n , size_t i , Slot& slot , const void*& child , AstKind& kind) const;
+        void header(const Frame& frame);
+        void stepTree(Frame& frame);
+
+    public :
+        AstSerializer(std::ostream& sink , AstFormat format , size_t bufferSize = DEFAULT_BUFFER);
+        ~AstSerializer(); // flushes
+        AstSerializer(const AstSerializer&) = delete;
+        AstSerializer& operator=(const AstSerializer&) = delete;
+
+        // A whole program : beginProgram() , function() per FunctionDecl , endProgram()
+        void beginProgram();
+        void function(const FunctionDecl* fn);
+        // TEXT leaves the errors to the caller , the other formats close with them
+        void endProgram(const std::vector<ParseError>& errors);
+        void program(const Program& program);
+
+        // One node and its subtree , no program around it
+        void node(const ASTNode* node);
+
+        // Hand everything buffered to the stream
+        void flush();
+};
+
+#endif // AST_SERIALIZER_H
@@ -0,0 +1,338 @@
+#include "FlatAST.h"
+
+// ---- Conversion from the pointer tree ----
+// Driven by an explicit stack , so any nesting depth the parser accepts
+// converts. A node takes its id when popped and its children are pushed in
+// reverse , which keeps the ids in pre-order. Each pending child knows where
+// its id goes : a `children` entry or field a / b of its parent.
+class FlatAST::Builder {
+    private :
+        enum class Into : uint8_t { CHILD , FIELD_A , FIELD_B };
+
+        struct Pending {
+            const ASTNode* node;
+            const MatchArm* arm; // set for a MATCH_ARM , `node` is then null
+            Into into;
+            uint32_t at;         // index into `children` , or the parent's id
+        };
+
+        FlatAST& out;
+        std::vector<Pending> stack;
+
+        void push(const ASTNode* node , Into into , uint32_t at) {
+            stack.push_back(Pending{node , nullptr , into , at});
+        }
+        // The statements of a block , last first so the first pops first
+        void statements(const AstList<Statement*>& list , uint32_t start) {
+            for(size_t i = list.size(); i-- > 0;) push(list[i] , Into::CHILD , start + static_cast<uint32_t>(i));
+        }
+        void place(const Pending& pending , NodeId id) {
+            switch(pending.into) {
+                case Into::CHILD : out.children[pending.at] = id; break;
+                case Into::FIELD_A : out.fields[pending.at].a = id; break;
+                case Into::FIELD_B : out.fields[pending.at].b = id; break;
+            }
+        }
+
+        NodeId arm(const MatchArm& arm);
+        NodeId node(const ASTNode* node);
+
+    public :
+        explicit Builder(FlatAST& out) : out(out) {}
+
+        NodeId function(const FunctionDecl* fn) {
+            NodeId id = out.addNode(AstKind::FUNCTION);
+            uint32_t start = out.reserveChildren(fn->params.size() + fn->body.size());
+            for(size_t i = 0; i < fn->params.size(); i++) {
+                out.children[start + i] = fn->params[i];
+            }
+            uint32_t paramCount = static_cast<uint32_t>(fn->params.size());
+            out.fields[id] = FlatFields{fn->name , start , paramCount , static_cast<uint32_t>(fn->body.size())};
+            statements(fn->body , start + paramCount);
+            while(!stack.empty()) {
+                Pending pending = stack.back();
+                stack.pop_back();
+                place(pending , pending.arm ? arm(*pending.arm) : node(pending.node));
+            }
+            return id;
+        }
+};
+
+NodeId FlatAST::Builder::arm(const MatchArm& arm) {
+    NodeId id = out.addNode(AstKind::MATCH_ARM);
+    uint32_t start = out.reserveChildren(arm.body.size());
+    out.fields[id] = FlatFields{0 , start , static_cast<uint32_t>(arm.body.size()) , 0};
+    statements(arm.body , start);
+    push(arm.pattern , Into::FIELD_A , id);
+    return id;
+}
+
+// Adds `node` with every field but its child ids , the children follow on the stack
+NodeId FlatAST::Builder::node(const ASTNode* node) {
+    NodeId id = out.addNode(node->kind);
+    FlatFields& f = out.fields[id];
+    switch(node->kind) {
+        case AstKind::NUMBER : {
+            auto num = static_cast<const NumberExpr*>(node);
+            uint64_t bits = static_cast<uint64_t>(num->value.i);
+            f = FlatFields{static_cast<uint32_t>(bits) , static_cast<uint32_t>(bits >> 32) , num->isFloat , 0};
+            break;
+        }
+        case AstKind::STRING : f.a = static_cast<const StringExpr*>(node)->value; break;
+        case AstKind::VARIABLE : f.a = static_cast<const VariableExpr*>(node)->name; break;
+        case AstKind::UNARY : {
+            auto un = static_cast<const UnaryExpr*>(node);
+            f.c = static_cast<uint32_t>(un->op);
+            push(un->operand , Into::FIELD_A , id);
+            break;
+        }
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            f.c = static_cast<uint32_t>(bin->op);
+            push(bin->right , Into::FIELD_B , id);
+            push(bin->left , Into::FIELD_A , id);
+            break;
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(node);
+            uint32_t start = out.reserveChildren(call->arguments.size());
+            f.b = start;
+            f.c = static_cast<uint32_t>(call->arguments.size());
+            for(size_t i = call->arguments.size(); i-- > 0;) push(call->arguments[i] , Into::CHILD , start + static_cast<uint32_t>(i));
+            push(call->callee , Into::FIELD_A , id);
+            break;
+        }
+        case AstKind::LET : {
+            auto let = static_cast<const LetStatement*>(node);
+            f.a = let->name;
+            push(let->value , Into::FIELD_B , id);
+            break;
+        }
+        case AstKind::VAR : {
+            auto var = static_cast<const VarStatement*>(node);
+            f.a = var->name;
+            push(var->value , Into::FIELD_B , id);
+            break;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<const AssignStatement*>(node);
+            f.a = assign->name;
+            push(assign->value , Into::FIELD_B , id);
+            break;
+        }
+        case AstKind::RETURN : push(static_cast<const ReturnStatement*>(node)->value , Into::FIELD_A , id); break;
+        case AstKind::IF : {
+            auto ifs = static_cast<const IfStatement*>(node);
+            uint32_t thenCount = static_cast<uint32_t>(ifs->thenBranch.size());
+            uint32_t start = out.reserveChildren(ifs->thenBranch.size() + ifs->elseBranch.size());
+            f.b = start;
+            f.c = thenCount;
+            f.d = static_cast<uint32_t>(ifs->elseBranch.size());
+            statements(ifs->elseBranch , start + thenCount);
+            statements(ifs->thenBranch , start);
+            push(ifs->condition , Into::FIELD_A , id);
+            break;
+        }
+        case AstKind::WHILE : {
+            auto ws = static_cast<const WhileStatement*>(node);
+            uint32_t start = out.reserveChildren(ws->body.size());
+            f.b = start;
+            f.c = static_cast<uint32_t>(ws->body.size());
+            statements(ws->body , start);
+            push(ws->condition , Into::FIELD_A , id);
+            break;
+        }
+        case AstKind::FOR : {
+            auto fs = static_cast<const ForStatement*>(node);
+            uint32_t start = out.reserveChildren(fs->body.size());
+            f.a = fs->iteratorName;
+            f.c = start;
+            f.d = static_cast<uint32_t>(fs->body.size());
+            statements(fs->body , start);
+            push(fs->iterable , Into::FIELD_B , id);
+            break;
+        }
+        case AstKind::MATCH : {
+            auto ms = static_cast<const MatchStatement*>(node);
+            uint32_t start = out.reserveChildren(ms->arms.size());
+            f.b = start;
+            f.c = static_cast<uint32_t>(ms->arms.size());
+            for(size_t i = ms->arms.size(); i-- > 0;) {
+                stack.push_back(Pending{nullptr , &ms->arms[i] , Into::CHILD , start + static_cast<uint32_t>(i)});
+            }
+            push(ms->expr , Into::FIELD_A , id);
+            break;
+        }
+        default : break; // functions are added by function()
+    }
+    return id;
+}
+
+NodeId FlatAST::addNode(AstKind kind) {
+    kinds.push_back(kind);
+    fields.push_back(FlatFields{0 , 0 , 0 , 0});
+    return static_cast<NodeId>(kinds.size() - 1);
+}
+
+uint32_t FlatAST::reserveChildren(size_t count) {
+    uint32_t start = static_cast<uint32_t>(children.size());
+    children.resize(children.size() + count);
+    return start;
+}
+
+FlatAST FlatAST::fromProgram(const Program& program) {
+    FlatAST flat;
+    Builder builder(flat);
+    flat.functionIds.reserve(program.functions.size());
+    for(const FunctionDecl* fn : program.functions) {
+        flat.functionIds.push_back(builder.function(fn));
+    }
+    return flat;
+}
+
+FlatRange FlatAST::body(NodeId id) const {
+    const FlatFields& f = fields[id];
+    switch(kinds[id]) {
+        case AstKind::WHILE :
+        case AstKind::MATCH_ARM : return range(f.b , f.c);
+        case AstKind::FOR : return range(f.c , f.d);
+        case AstKind::FUNCTION : return range(f.b + f.c , f.d);
+        default : return range(0 , 0);
+    }
+}
+
+size_t FlatAST::memoryUsage() const {
+    return kinds.size() * sizeof(AstKind) + fields.size() * sizeof(FlatFields)
+         + children.size() * sizeof(uint32_t) + functionIds.size() * sizeof(NodeId);
+}
+
+// ---- Printing , mirrors the tree's print() output ----
+// Each node writes its head at once and stacks the rest : its children and
+// the text between them , last piece first.
+void FlatAST::print(NodeId root) const {
+    struct Piece {
+        NodeId id;
+        const char* text; // written as is when set , otherwise node `id`
+    };
+    std::vector<Piece> stack{Piece{root , nullptr}};
+    auto text = [&stack](const char* t) { stack.push_back(Piece{0 , t}); };
+    auto node = [&stack](NodeId id) { stack.push_back(Piece{id , nullptr}); };
+    auto block = [&](FlatRange stmts) {
+        for(size_t i = stmts.size(); i-- > 0;) {
+            text("; ");
+            node(stmts.first[i]);
+        }
+    };
+    while(!stack.empty()) {
+        Piece piece = stack.back();
+        stack.pop_back();
+        if(piece.text) {
+            std::cout << piece.text;
+            continue;
+        }
+        NodeId id = piece.id;
+        const FlatFields& f = fields[id];
+        switch(kinds[id]) {
+            case AstKind::NUMBER : {
+                char digits[NUMBER_TEXT_MAX];
+                std::cout << "NumberExpr(" << std::string_view(digits , formatNumber(digits , number(id) , f.c != 0)) << ")";
+                break;
+            }
+            case AstKind::STRING : std::cout << "StringExpr(\"" << symbolText(f.a) << "\")"; break;
+            case AstKind::VARIABLE : std::cout << "VariableExpr(" << symbolText(f.a) << ")"; break;
+            case AstKind::UNARY :
+                std::cout << "UnaryExpr(" << tokenSpelling(static_cast<TokenType>(f.c));
+                text(")");
+                node(f.a);
+                break;
+            case AstKind::BINARY :
+                std::cout << "BinaryExpr(";
+                text(")");
+                node(f.b);
+                text(" ");
+                text(tokenSpelling(static_cast<TokenType>(f.c)));
+                text(" ");
+                node(f.a);
+                break;
+            case AstKind::CALL : {
+                std::cout << "CallExpr(";
+                text("))");
+                FlatRange args = callArgs(id);
+                for(size_t i = args.size(); i-- > 0;) {
+                    node(args.first[i]);
+                    if(i > 0) text(", ");
+                }
+                text(" (");
+                node(f.a);
+                break;
+            }
+            case AstKind::LET :
+            case AstKind::VAR :
+            case AstKind::ASSIGN : {
+                const char* label = kinds[id] == AstKind::LET ? "LetStatement(" : kinds[id] == AstKind::VAR ? "VarStatement(" : "AssignStatement(";
+                std::cout << label << symbolText(f.a) << " = ";
+                text(")");
+                node(f.b);
+                break;
+            }
+            case AstKind::RETURN :
+                std::cout << "ReturnStatement(";
+                text(")");
+                node(f.a);
+                break;
+            case AstKind::IF :
+                std::cout << "IfStatement(";
+                if (f.d > 0) {
+                    text("}");
+                    block(elseBranch(id));
+                    text(" else { ");
+                }
+                text("}");
+                block(thenBranch(id));
+                text(") { ");
+                node(f.a);
+                break;
+            case AstKind::WHILE :
+                std::cout << "WhileStatement(";
+                text("}");
+                block(body(id));
+                text(") { ");
+                node(f.a);
+                break;
+            case AstKind::FOR :
+                std::cout << "ForStatement(" << symbolText(f.a) << " in ";
+                text("}");
+                block(body(id));
+                text(") { ");
+                node(f.b);
+                break;
+            case AstKind::MATCH : {
+                std::cout << "MatchStatement(";
+                text("}");
+                FlatRange all = arms(id);
+                for(size_t i = all.size(); i-- > 0;) node(all.first[i]);
+                text(") { ");
+                node(f.a);
+                break;
+            }
+            case AstKind::MATCH_ARM :
+                text("} ");
+                block(body(id));
+                text(" => { ");
+                node(f.a);
+                break;
+            case AstKind::FUNCTION : {
+                std::cout << "FunctionDecl(" << symbolText(f.a) << " (";
+                FlatRange ps = params(id);
+                for(size_t i = 0; i < ps.size(); ++i) {
+                    std::cout << symbolText(ps.first[i]);
+                    if (i < ps.size() - 1) std::cout << ", ";
+                }
+                std::cout << ") { ";
+                text("})");
+                block(body(id));
+                break;
+            }
+        }
+    }
+}
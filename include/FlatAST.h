@@ -0,0 +1,161 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include "AST.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Data-oriented copy of a Program. Nodes live in two parallel arrays (a kind
+// byte and four 32-bit fields) and refer to each other by index. Child lists
+// are (start , count) ranges into one shared `children` array. Names and
+// string literals are SymbolIds , numbers keep their value in the fields.
+// Nodes are stored in pre-order ,
+// so a plain loop over [0 , size()) visits parents before their children.
+//
+// Field use per kind (unused fields are 0):
+//   NUMBER    a = low 32 bits of the value   b = high 32 bits   c = isFloat
+//   STRING    a = symbol
+//   VARIABLE  a = name
+//   UNARY     a = operand                     c = operator (TokenType)
+//   BINARY    a = left   b = right   c = operator (TokenType)
+//   CALL      a = callee b = args start           c = arg count
+//   LET/VAR/ASSIGN       a = name    b = value
+//   RETURN    a = value
+//   IF        a = cond   b = children start  c = then count  d = else count
+//   WHILE     a = cond   b = body start      c = body count
+//   FOR       a = name   b = iterable        c = body start  d = body count
+//   MATCH     a = expr   b = arms start      c = arm count   (MATCH_ARM nodes)
+//   MATCH_ARM a = pattern                   b = body start  c = body count
+//   FUNCTION  a = name   b = children start  c = param count d = body count
+//             (params are symbols , the body follows them in `children`)
+
+using NodeId = uint32_t;
+
+struct FlatFields {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+};
+
+struct FlatRange {
+    const uint32_t* first;
+    const uint32_t* last;
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+};
+
+class FlatAST {
+    private :
+        std::vector<AstKind> kinds;
+        std::vector<FlatFields> fields;
+        std::vector<uint32_t> children;
+        std::vector<NodeId> functionIds;
+
+        NodeId addNode(AstKind kind);
+        uint32_t reserveChildren(size_t count);
+
+        class Builder;
+        friend class Builder;
+
+    public :
+        // Flatten a pointer tree , the result does not reference the Program
+        static FlatAST fromProgram(const Program& program);
+
+        size_t size() const { return kinds.size(); }
+        AstKind kind(NodeId id) const { return kinds[id]; }
+        const FlatFields& node(NodeId id) const { return fields[id]; }
+        NumberValue number(NodeId id) const {
+            return NumberValue::integer(static_cast<int64_t>(uint64_t(fields[id].b) << 32 | fields[id].a));
+        }
+        const std::vector<NodeId>& functions() const { return functionIds; }
+
+        FlatRange range(uint32_t start , uint32_t count) const {
+            return FlatRange{children.data() + start , children.data() + start + count};
+        }
+
+        // Typed views of the child ranges
+        FlatRange callArgs(NodeId call) const { return range(fields[call].b , fields[call].c); }
+        FlatRange thenBranch(NodeId stmt) const { return range(fields[stmt].b , fields[stmt].c); }
+        FlatRange elseBranch(NodeId stmt) const { return range(fields[stmt].b + fields[stmt].c , fields[stmt].d); }
+        FlatRange body(NodeId id) const;
+        FlatRange arms(NodeId match) const { return range(fields[match].b , fields[match].c); }
+        FlatRange params(NodeId fn) const { return range(fields[fn].b , fields[fn].c); }
+
+        // Calls visit(child) for every direct child node in source order
+        template <typename Visit>
+        void forEachChild(NodeId id , Visit&& visit) const;
+
+        // Pre-order walk of the subtree under `root` , driven by an explicit stack
+        template <typename Visit>
+        void walk(NodeId root , Visit&& visit) const;
+
+        // Same text as ASTNode::print() on the original tree
+        void print(NodeId id) const;
+
+        // Bytes held by the arrays (sizes , not capacities)
+        size_t memoryUsage() const;
+};
+
+template <typename Visit>
+void FlatAST::forEachChild(NodeId id , Visit&& visit) const {
+    const FlatFields& f = fields[id];
+    switch(kinds[id]) {
+        case AstKind::NUMBER :
+        case AstKind::STRING :
+        case AstKind::VARIABLE :
+            break;
+        case AstKind::UNARY : visit(f.a); break;
+        case AstKind::BINARY : visit(f.a); visit(f.b); break;
+        case AstKind::CALL :
+            visit(f.a);
+            for(NodeId arg : callArgs(id)) visit(arg);
+            break;
+        case AstKind::LET :
+        case AstKind::VAR :
+        case AstKind::ASSIGN : visit(f.b); break;
+        case AstKind::RETURN : visit(f.a); break;
+        case AstKind::IF :
+            visit(f.a);
+            for(NodeId stmt : range(f.b , f.c + f.d)) visit(stmt);
+            break;
+        case AstKind::WHILE :
+            visit(f.a);
+            for(NodeId stmt : range(f.b , f.c)) visit(stmt);
+            break;
+        case AstKind::FOR :
+            visit(f.b);
+            for(NodeId stmt : range(f.c , f.d)) visit(stmt);
+            break;
+        case AstKind::MATCH :
+            visit(f.a);
+            for(NodeId arm : range(f.b , f.c)) visit(arm);
+            break;
+        case AstKind::MATCH_ARM :
+            visit(f.a);
+            for(NodeId stmt : range(f.b , f.c)) visit(stmt);
+            break;
+        case AstKind::FUNCTION :
+            for(NodeId stmt : range(f.b + f.c , f.d)) visit(stmt);
+            break;
+    }
+}
+
+template <typename Visit>
+void FlatAST::walk(NodeId root , Visit&& visit) const {
+    std::vector<NodeId> stack{root};
+    std::vector<NodeId> kids;
+    while(!stack.empty()) {
+        NodeId id = stack.back();
+        stack.pop_back();
+        visit(id);
+        kids.clear();
+        forEachChild(id , [&kids](NodeId child) { kids.push_back(child); });
+        stack.insert(stack.end() , kids.rbegin() , kids.rend());
+    }
+}
+
+#endif // FLAT_AST_H
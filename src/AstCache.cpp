@@ -0,0 +1,563 @@
+#include "AstCache.h"
+#include "SourceBuffer.h"
+#include "Stats.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[4] = {'S' , 'T' , 'X' , 'C'};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t symbolCount;
+    uint32_t functionCount;
+    uint64_t payloadSize;
+    uint64_t bodyHash; // of everything after the header , catches damaged files
+};
+
+// ---- Writing : a pre-order byte stream , symbols collected on the way ----
+// The walk keeps its own stack , so any nesting depth the parser accepts is
+// stored. A node writes its own fields , stacks what follows its first child
+// (the later children and the list counts between them , last item first)
+// and hands the first child back to be written at once.
+class Writer {
+    private :
+        struct Pending {
+            const ASTNode* node;  // written when set
+            const MatchArm* arm;  // otherwise an arm when set
+            uint32_t count;       // otherwise a list count
+        };
+
+        std::unordered_map<SymbolId , uint32_t> symbolIndex;
+        std::vector<Pending> stack;
+
+        void u8(uint8_t v) { payload.push_back(static_cast<char>(v)); }
+        void u32(uint32_t v) { payload.append(reinterpret_cast<const char*>(&v) , sizeof(v)); }
+        void u64(uint64_t v) { payload.append(reinterpret_cast<const char*>(&v) , sizeof(v)); }
+
+        void symbol(SymbolId id) {
+            auto it = symbolIndex.emplace(id , static_cast<uint32_t>(symbolOrder.size()));
+            if(it.second) symbolOrder.push_back(id);
+            u32(it.first->second);
+        }
+
+        void push(const ASTNode* node) { stack.push_back(Pending{node , nullptr , 0}); }
+        // A block's count , then its statements
+        void block(const AstList<Statement*>& body) {
+            for(size_t i = body.size(); i-- > 0;) push(body[i]);
+            stack.push_back(Pending{nullptr , nullptr , body.count});
+        }
+
+        const ASTNode* node(const ASTNode* node);
+
+    public :
+        std::string payload;
+        std::vector<SymbolId> symbolOrder;
+
+        void function(const FunctionDecl* fn) {
+            u32(static_cast<uint32_t>(fn->line));
+            symbol(fn->name);
+            u32(fn->params.count);
+            for(SymbolId param : fn->params) symbol(param);
+            block(fn->body);
+            while(!stack.empty()) {
+                Pending pending = stack.back();
+                stack.pop_back();
+                if(pending.node) {
+                    for(const ASTNode* next = pending.node; next;) next = node(next);
+                }
+                else if(pending.arm) {
+                    block(pending.arm->body);
+                    push(pending.arm->pattern);
+                } else u32(pending.count);
+            }
+        }
+};
+
+const ASTNode* Writer::node(const ASTNode* node) {
+    u8(static_cast<uint8_t>(node->kind));
+    u32(static_cast<uint32_t>(node->line));
+    switch(node->kind) {
+        case AstKind::NUMBER : {
+            auto num = static_cast<const NumberExpr*>(node);
+            u8(num->isFloat);
+            u64(static_cast<uint64_t>(num->value.i)); // a float's bits , the union shares them
+            return nullptr;
+        }
+        case AstKind::STRING : symbol(static_cast<const StringExpr*>(node)->value); return nullptr;
+        case AstKind::VARIABLE : symbol(static_cast<const VariableExpr*>(node)->name); return nullptr;
+        case AstKind::UNARY : {
+            auto un = static_cast<const UnaryExpr*>(node);
+            u8(static_cast<uint8_t>(un->op));
+            return un->operand;
+        }
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            u8(static_cast<uint8_t>(bin->op));
+            push(bin->right);
+            return bin->left;
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(node);
+            for(size_t i = call->arguments.size(); i-- > 0;) push(call->arguments[i]);
+            stack.push_back(Pending{nullptr , nullptr , call->arguments.count});
+            return call->callee;
+        }
+        case AstKind::LET : {
+            auto let = static_cast<const LetStatement*>(node);
+            symbol(let->name);
+            return let->value;
+        }
+        case AstKind::VAR : {
+            auto var = static_cast<const VarStatement*>(node);
+            symbol(var->name);
+            return var->value;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<const AssignStatement*>(node);
+            symbol(assign->name);
+            return assign->value;
+        }
+        case AstKind::RETURN : return static_cast<const ReturnStatement*>(node)->value;
+        case AstKind::IF : {
+            auto branch = static_cast<const IfStatement*>(node);
+            block(branch->elseBranch);
+            block(branch->thenBranch);
+            return branch->condition;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<const WhileStatement*>(node);
+            block(loop->body);
+            return loop->condition;
+        }
+        case AstKind::FOR : {
+            auto loop = static_cast<const ForStatement*>(node);
+            symbol(loop->iteratorName);
+            block(loop->body);
+            return loop->iterable;
+        }
+        case AstKind::MATCH : {
+            auto match = static_cast<const MatchStatement*>(node);
+            for(size_t i = match->arms.size(); i-- > 0;) stack.push_back(Pending{nullptr , &match->arms[i] , 0});
+            stack.push_back(Pending{nullptr , nullptr , match->arms.count});
+            return match->expr;
+        }
+        default : return nullptr;
+    }
+}
+
+// ---- Reading : straight from the mapped file into a fresh arena ----
+// Every read is bounds checked , a damaged file fails the load instead of
+// building garbage. Lists are allocated at their final size up front. Like
+// the writer it keeps its own stack : a node is created as soon as its kind
+// is read , with its children left empty. Its first child , always an
+// expression , is read next , the stack fills the later child slots in
+// stream order.
+class Reader {
+    private :
+        // A slot waiting for the stream's next item
+        struct Pending {
+            enum What : uint8_t { EXPRESSION , STATEMENT , BLOCK , ARGUMENTS , ARMS } what;
+            void* into; // Expression** , Statement** , AstList<Statement*>* , CallExpr* or MatchStatement*
+        };
+
+        const char* p;
+        const char* end;
+        AstArena& arena;
+        const std::vector<SymbolId>& symbolTable;
+        std::vector<Pending> stack;
+
+        uint8_t u8() {
+            if(p == end) {
+                fail();
+                return 0;
+            }
+            return static_cast<uint8_t>(*p++);
+        }
+        uint32_t u32() {
+            uint32_t v = 0;
+            if(end - p < 4) {
+                fail();
+                return 0;
+            }
+            std::memcpy(&v , p , sizeof(v));
+            p += sizeof(v);
+            return v;
+        }
+        uint64_t u64() {
+            uint64_t v = 0;
+            if(end - p < 8) {
+                fail();
+                return 0;
+            }
+            std::memcpy(&v , p , sizeof(v));
+            p += sizeof(v);
+            return v;
+        }
+        SymbolId symbol() {
+            uint32_t i = u32();
+            if(i >= symbolTable.size()) {
+                fail();
+                return NO_SYMBOL;
+            }
+            return symbolTable[i];
+        }
+        // A list length , every element takes at least one byte
+        uint32_t count() {
+            uint32_t n = u32();
+            if(n > static_cast<size_t>(end - p)) {
+                fail();
+                return 0;
+            }
+            return n;
+        }
+        void fail() {
+            ok = false;
+            p = end;
+        }
+
+        template <typename T>
+        T* allocateList(uint32_t n) {
+            return n == 0 ? nullptr : static_cast<T*>(arena.allocate(sizeof(T) * n , alignof(T)));
+        }
+
+        void expression(Expression** into) { stack.push_back(Pending{Pending::EXPRESSION , into}); }
+        void statement(Statement** into) { stack.push_back(Pending{Pending::STATEMENT , into}); }
+        void block(AstList<Statement*>* into) { stack.push_back(Pending{Pending::BLOCK , into}); }
+
+        // Both leave the slot of the node's first child in `first` , null for a leaf
+        Expression* expressionOf(AstKind kind , Expression**& first);
+        Statement* statementOf(AstKind kind , Expression**& first);
+
+        // An expression and the chain of first children below it
+        void expressions(Expression** into) {
+            while(into) {
+                AstKind kind = static_cast<AstKind>(u8());
+                int line = static_cast<int>(u32());
+                Expression** first = nullptr;
+                Expression* expr = expressionOf(kind , first);
+                expr->line = line;
+                *into = expr;
+                into = first;
+            }
+        }
+
+        void read(const Pending& pending) {
+            switch(pending.what) {
+                case Pending::EXPRESSION : expressions(static_cast<Expression**>(pending.into)); return;
+                case Pending::STATEMENT : {
+                    AstKind kind = static_cast<AstKind>(u8());
+                    int line = static_cast<int>(u32());
+                    Expression** first = nullptr;
+                    Statement* stmt = statementOf(kind , first);
+                    stmt->line = line;
+                    *static_cast<Statement**>(pending.into) = stmt;
+                    expressions(first);
+                    return;
+                }
+                case Pending::BLOCK : {
+                    uint32_t n = count();
+                    Statement** items = allocateList<Statement*>(n);
+                    *static_cast<AstList<Statement*>*>(pending.into) = AstList<Statement*>(items , n);
+                    for(uint32_t i = n; i-- > 0;) statement(&items[i]);
+                    return;
+                }
+                case Pending::ARGUMENTS : {
+                    uint32_t n = count();
+                    Expression** args = allocateList<Expression*>(n);
+                    static_cast<CallExpr*>(pending.into)->arguments = AstList<Expression*>(args , n);
+                    for(uint32_t i = n; i-- > 0;) expression(&args[i]);
+                    return;
+                }
+                case Pending::ARMS : {
+                    uint32_t n = count();
+                    MatchArm* arms = allocateList<MatchArm>(n);
+                    for(uint32_t i = 0; i < n; i++) new (&arms[i]) MatchArm(nullptr , AstList<Statement*>());
+                    static_cast<MatchStatement*>(pending.into)->arms = AstList<MatchArm>(arms , n);
+                    for(uint32_t i = n; i-- > 0;) {
+                        block(&arms[i].body);
+                        expression(&arms[i].pattern);
+                    }
+                    return;
+                }
+            }
+        }
+
+    public :
+        bool ok = true;
+
+        Reader(const char* p , const char* end , AstArena& arena , const std::vector<SymbolId>& symbolTable)
+            : p(p) , end(end) , arena(arena) , symbolTable(symbolTable) {}
+
+        FunctionDecl* function() {
+            int line = static_cast<int>(u32());
+            SymbolId name = symbol();
+            uint32_t n = count();
+            SymbolId* params = allocateList<SymbolId>(n);
+            for(uint32_t i = 0; i < n; i++) params[i] = symbol();
+            FunctionDecl* fn = arena.create<FunctionDecl>(name , AstList<SymbolId>(params , n) , AstList<Statement*>());
+            fn->line = line;
+            block(&fn->body);
+            while(!stack.empty()) {
+                Pending pending = stack.back();
+                stack.pop_back();
+                read(pending);
+            }
+            return fn;
+        }
+
+        bool atEnd() const { return p == end; }
+};
+
+// Failed reads still build a node , so callers never see nullptr before the
+// load is discarded. Later children are stacked last first , they come off
+// in stream order.
+Expression* Reader::expressionOf(AstKind kind , Expression**& first) {
+    switch(kind) {
+        case AstKind::NUMBER : {
+            bool isFloat = u8() != 0;
+            return arena.create<NumberExpr>(NumberValue::integer(static_cast<int64_t>(u64())) , isFloat);
+        }
+        case AstKind::STRING : return arena.create<StringExpr>(symbol());
+        case AstKind::VARIABLE : return arena.create<VariableExpr>(symbol());
+        case AstKind::UNARY : {
+            TokenType op = static_cast<TokenType>(u8());
+            UnaryExpr* un = arena.create<UnaryExpr>(op , nullptr);
+            first = &un->operand;
+            return un;
+        }
+        case AstKind::BINARY : {
+            TokenType op = static_cast<TokenType>(u8());
+            BinaryExpr* bin = arena.create<BinaryExpr>(nullptr , op , nullptr);
+            expression(&bin->right);
+            first = &bin->left;
+            return bin;
+        }
+        case AstKind::CALL : {
+            CallExpr* call = arena.create<CallExpr>(nullptr , AstList<Expression*>());
+            stack.push_back(Pending{Pending::ARGUMENTS , call});
+            first = &call->callee;
+            return call;
+        }
+        default :
+            fail();
+            return arena.create<VariableExpr>(NO_SYMBOL);
+    }
+}
+Statement* Reader::statementOf(AstKind kind , Expression**& first) {
+    switch(kind) {
+        case AstKind::LET : {
+            LetStatement* let = arena.create<LetStatement>(symbol() , nullptr);
+            first = &let->value;
+            return let;
+        }
+        case AstKind::VAR : {
+            VarStatement* var = arena.create<VarStatement>(symbol() , nullptr);
+            first = &var->value;
+            return var;
+        }
+        case AstKind::ASSIGN : {
+            AssignStatement* assign = arena.create<AssignStatement>(symbol() , nullptr);
+            first = &assign->value;
+            return assign;
+        }
+        case AstKind::RETURN : {
+            ReturnStatement* ret = arena.create<ReturnStatement>(nullptr);
+            first = &ret->value;
+            return ret;
+        }
+        case AstKind::IF : {
+            IfStatement* branch = arena.create<IfStatement>(nullptr , AstList<Statement*>() , AstList<Statement*>());
+            block(&branch->elseBranch);
+            block(&branch->thenBranch);
+            first = &branch->condition;
+            return branch;
+        }
+        case AstKind::WHILE : {
+            WhileStatement* loop = arena.create<WhileStatement>(nullptr , AstList<Statement*>());
+            block(&loop->body);
+            first = &loop->condition;
+            return loop;
+        }
+        case AstKind::FOR : {
+            ForStatement* loop = arena.create<ForStatement>(symbol() , nullptr , AstList<Statement*>());
+            block(&loop->body);
+            first = &loop->iterable;
+            return loop;
+        }
+        case AstKind::MATCH : {
+            MatchStatement* match = arena.create<MatchStatement>(nullptr , AstList<MatchArm>());
+            stack.push_back(Pending{Pending::ARMS , match});
+            first = &match->expr;
+            return match;
+        }
+        default :
+            fail();
+            return arena.create<ReturnStatement>(arena.create<VariableExpr>(NO_SYMBOL));
+    }
+}
+
+} // namespace
+
+AstCache::AstCache(std::string dir) : dir(std::move(dir)) {}
+
+uint64_t AstCache::hashSource(std::string_view source) {
+    // Eight bytes per step , a multiply-rotate mix and a final avalanche
+    const uint64_t K = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = K ^ source.size();
+    size_t i = 0;
+    for(; i + 8 <= source.size(); i += 8) {
+        uint64_t w;
+        std::memcpy(&w , source.data() + i , sizeof(w));
+        w *= 0xff51afd7ed558ccdULL;
+        h = ((h ^ w) << 31 | (h ^ w) >> 33) * K;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail , source.data() + i , source.size() - i);
+    h = (h ^ tail * 0xff51afd7ed558ccdULL) * K;
+    h ^= h >> 32;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+std::string AstCache::pathFor(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name , sizeof(name) , "%016llx.stxc" , static_cast<unsigned long long>(hash));
+    return dir + "/" + name;
+}
+
+Program compactProgram(const Program& program) {
+    Writer writer;
+    for(const FunctionDecl* fn : program.functions) writer.function(fn);
+
+    // The copy holds no more than the parse did , nodes left behind by
+    // errors are not copied. The slack covers aligning the node after each
+    // parameter list.
+    size_t used = program.arena.bytesUsed();
+    for(const AstArena& arena : program.workerArenas) used += arena.bytesUsed();
+    Program copy;
+    copy.arena.reserve(used + program.functions.size() * alignof(FunctionDecl) + alignof(FunctionDecl));
+    Reader reader(writer.payload.data() , writer.payload.data() + writer.payload.size() , copy.arena , writer.symbolOrder);
+    copy.functions.reserve(program.functions.size());
+    for(size_t i = 0; i < program.functions.size(); i++) copy.functions.push_back(reader.function());
+    copy.errors = program.errors;
+    return copy;
+}
+
+bool AstCache::load(std::string_view source , Program& out) {
+    PhaseTimer timer(Phase::CACHE_LOAD);
+    uint64_t hash = hashSource(source);
+    SourceBuffer file;
+    if(!file.open(pathFor(hash)) || file.size() < sizeof(Header)) {
+        counters.misses++;
+        return false;
+    }
+    std::string_view data = file.view();
+    Header header;
+    std::memcpy(&header , data.data() , sizeof(header));
+    bool valid = std::memcmp(header.magic , MAGIC , sizeof(MAGIC)) == 0 && header.version == CACHE_VERSION
+              && header.sourceHash == hash && header.sourceSize == source.size()
+              && header.bodyHash == hashSource(data.substr(sizeof(Header)));
+
+    const char* p = data.data() + sizeof(Header);
+    const char* end = data.data() + data.size();
+    std::vector<SymbolId> symbolTable;
+    symbolTable.reserve(valid ? std::min<size_t>(header.symbolCount , data.size()) : 0);
+    for(uint32_t i = 0; valid && i < header.symbolCount; i++) {
+        uint32_t size;
+        if(end - p < 4) {
+            valid = false;
+            break;
+        }
+        std::memcpy(&size , p , sizeof(size));
+        p += sizeof(size);
+        if(size > static_cast<size_t>(end - p)) {
+            valid = false;
+            break;
+        }
+        SymbolId id = symbols().intern(std::string_view(p , size));
+        if(id == NO_SYMBOL) {
+            valid = false; // no room in the symbol table , the caller parses instead
+            break;
+        }
+        symbolTable.push_back(id);
+        p += size;
+    }
+    valid = valid && header.payloadSize == static_cast<uint64_t>(end - p);
+
+    Program program;
+    if(valid) {
+        Reader reader(p , end , program.arena , symbolTable);
+        program.functions.reserve(header.functionCount);
+        for(uint32_t i = 0; i < header.functionCount && reader.ok; i++) {
+            program.functions.push_back(reader.function());
+        }
+        valid = reader.ok && reader.atEnd();
+    }
+    if(!valid) {
+        counters.misses++;
+        return false;
+    }
+    if(CompileStats::enabled) CompileStats::local().astBytes += program.arena.bytesUsed();
+    out = std::move(program);
+    counters.hits++;
+    return true;
+}
+
+bool AstCache::store(std::string_view source , const Program& program) {
+    // A partial AST must not stand in for the source on the next run
+    if(!program.errors.empty()) return false;
+    PhaseTimer timer(Phase::CACHE_STORE);
+    Writer writer;
+    for(const FunctionDecl* fn : program.functions) writer.function(fn);
+
+    Header header;
+    std::memcpy(header.magic , MAGIC , sizeof(MAGIC));
+    header.version = CACHE_VERSION;
+    header.sourceHash = hashSource(source);
+    header.sourceSize = source.size();
+    header.symbolCount = static_cast<uint32_t>(writer.symbolOrder.size());
+    header.functionCount = static_cast<uint32_t>(program.functions.size());
+    header.payloadSize = writer.payload.size();
+
+    std::string body;
+    for(SymbolId id : writer.symbolOrder) {
+        std::string_view text = symbolText(id);
+        uint32_t size = static_cast<uint32_t>(text.size());
+        body.append(reinterpret_cast<const char*>(&size) , sizeof(size));
+        body.append(text.data() , text.size());
+    }
+    body += writer.payload;
+    header.bodyHash = hashSource(body);
+
+    mkdir(dir.c_str() , 0755); // EEXIST is fine , any other failure shows up when opening
+    std::string path = pathFor(header.sourceHash);
+    std::string temp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temp , std::ios::binary | std::ios::trunc);
+        if(!file) return false;
+        file.write(reinterpret_cast<const char*>(&header) , sizeof(header));
+        file.write(body.data() , body.size());
+        if(!file.flush()) {
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+    if(std::rename(temp.c_str() , path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    counters.stores++;
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include "AST.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ---- On-disk cache of parsed programs ----
+// A `.stxc` file holds one parsed Program , named after a 64-bit content
+// hash of its source : <dir>/<16 hex digits>.stxc. Layout , in host byte order :
+//
+//   header   magic "STXC" , format version , source hash , source size ,
+//            symbol count , function count , payload size , hash of the rest
+//   symbols  (length u32 , bytes) per symbol , the stream refers to them by index
+//   payload  every FunctionDecl in pre-order : a kind byte and the source
+//            line (u32) per node , then its fields and child counts as u32 ,
+//            numbers as an isFloat byte and the value's 8 bytes
+//
+// Only what the parser produces is stored : resolver slots and frame sizes
+// are recomputed by the compiler. Bump CACHE_VERSION whenever the AST or
+// the parser's output changes , older files are then misses.
+class AstCache {
+    public :
+        static constexpr uint32_t CACHE_VERSION = 4;
+
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t stores = 0;
+        };
+
+    private :
+        std::string dir;
+        Stats counters;
+
+    public :
+        explicit AstCache(std::string dir);
+
+        // Hash the cache is keyed by , not cryptographic
+        static uint64_t hashSource(std::string_view source);
+        std::string pathFor(uint64_t hash) const;
+
+        // Rebuild the program cached for `source` into `out` from the mapped
+        // file. False on a miss : no file , another version , a hash or size
+        // mismatch or a damaged file (the body hash does not match , or the
+        // stream does not decode).
+        bool load(std::string_view source , Program& out);
+        // Write `program` as the entry for `source` , through a temporary
+        // file renamed into place so readers never see half a file
+        bool store(std::string_view source , const Program& program);
+
+        const Stats& stats() const { return counters; }
+};
+
+// A copy of `program` through the cache's encoding , its nodes packed into
+// one arena block of their own size. For a program kept long after parsing ,
+// whose last arena block is mostly idle. Errors are copied , the resolver's
+// node numbering is not.
+Program compactProgram(const Program& program);
+
+#endif // AST_CACHE_H
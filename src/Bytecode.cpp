@@ -0,0 +1,214 @@
+#include "Bytecode.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+const char* typeName(ValueType type) {
+    switch(type) {
+        case ValueType::NIL : return "nil";
+        case ValueType::INT : return "int";
+        case ValueType::FLOAT : return "float";
+        case ValueType::STRING : return "string";
+    }
+    return "?";
+}
+
+void printValue(std::ostream& out , const Value& value) {
+    switch(value.type) {
+        case ValueType::NIL : out<<"nil"; break;
+        case ValueType::INT : out<<value.i; break;
+        case ValueType::FLOAT : out<<value.f; break;
+        case ValueType::STRING : out<<stringText(value); break;
+    }
+}
+
+bool valuesEqual(const Value& a , const Value& b) {
+    if(a.type == b.type) {
+        switch(a.type) {
+            case ValueType::NIL : return true;
+            case ValueType::INT : return a.i == b.i;
+            case ValueType::FLOAT : return a.f == b.f;
+            case ValueType::STRING :
+                // Interned , equal text means equal id. Other forms compare their text.
+                if(a.form == StringForm::SYMBOL && b.form == StringForm::SYMBOL) return a.s == b.s;
+                return stringText(a) == stringText(b);
+        }
+    }
+    bool numbers = (a.type == ValueType::INT || a.type == ValueType::FLOAT)
+                && (b.type == ValueType::INT || b.type == ValueType::FLOAT);
+    if(!numbers) return false;
+    double x = a.type == ValueType::INT ? static_cast<double>(a.i) : a.f;
+    double y = b.type == ValueType::INT ? static_cast<double>(b.i) : b.f;
+    return x == y;
+}
+
+bool evalBinary(Op op , const Value& a , const Value& b , Value& out) {
+    if(op == Op::EQ || op == Op::NE) {
+        out = Value::integer(valuesEqual(a , b) == (op == Op::EQ));
+        return true;
+    }
+
+    if(a.type == ValueType::STRING && b.type == ValueType::STRING) {
+        std::string_view x = stringText(a) , y = stringText(b);
+        switch(op) {
+            case Op::ADD : {
+                SymbolId joined = symbols().intern(std::string(x) + std::string(y));
+                if(joined == NO_SYMBOL) return false;
+                out = Value::string(joined);
+                return true;
+            }
+            case Op::LT : out = Value::integer(x < y); return true;
+            case Op::LE : out = Value::integer(x <= y); return true;
+            case Op::GT : out = Value::integer(x > y); return true;
+            case Op::GE : out = Value::integer(x >= y); return true;
+            default : return false;
+        }
+    }
+    bool numbers = (a.type == ValueType::INT || a.type == ValueType::FLOAT)
+                && (b.type == ValueType::INT || b.type == ValueType::FLOAT);
+    if(!numbers) return false;
+
+    if(a.type == ValueType::INT && b.type == ValueType::INT) {
+        // Ints wrap like two's complement instead of overflowing
+        uint64_t x = static_cast<uint64_t>(a.i) , y = static_cast<uint64_t>(b.i);
+        switch(op) {
+            case Op::DIV :
+            case Op::MOD :
+                if(b.i == 0) return false;
+                if(b.i == -1) out = Value::integer(op == Op::DIV ? static_cast<int64_t>(0 - x) : 0);
+                else out = Value::integer(op == Op::DIV ? a.i / b.i : a.i % b.i);
+                return true;
+            case Op::ADD : out = Value::integer(static_cast<int64_t>(x + y)); return true;
+            case Op::SUB : out = Value::integer(static_cast<int64_t>(x - y)); return true;
+            case Op::MUL : out = Value::integer(static_cast<int64_t>(x * y)); return true;
+            case Op::XOR : out = Value::integer(a.i ^ b.i); return true;
+            case Op::LT : out = Value::integer(a.i < b.i); return true;
+            case Op::LE : out = Value::integer(a.i <= b.i); return true;
+            case Op::GT : out = Value::integer(a.i > b.i); return true;
+            case Op::GE : out = Value::integer(a.i >= b.i); return true;
+            default : return false;
+        }
+    }
+
+    double x = a.type == ValueType::INT ? static_cast<double>(a.i) : a.f;
+    double y = b.type == ValueType::INT ? static_cast<double>(b.i) : b.f;
+    switch(op) {
+        case Op::ADD : out = Value::number(x + y); return true;
+        case Op::SUB : out = Value::number(x - y); return true;
+        case Op::MUL : out = Value::number(x * y); return true;
+        case Op::DIV : out = Value::number(x / y); return true;
+        case Op::MOD : out = Value::number(std::fmod(x , y)); return true;
+        case Op::LT : out = Value::integer(x < y); return true;
+        case Op::LE : out = Value::integer(x <= y); return true;
+        case Op::GT : out = Value::integer(x > y); return true;
+        case Op::GE : out = Value::integer(x >= y); return true;
+        default : return false;
+    }
+}
+
+uint32_t SwitchTable::target(const Value& subject) const {
+    int64_t key;
+    switch(subject.type) {
+        case ValueType::INT : key = subject.i; break;
+        case ValueType::FLOAT : {
+            // Int keys are at most 2^53 in magnitude , so only an integral float below that can match one
+            double f = subject.f;
+            if(!(std::fabs(f) <= 9007199254740992.0)) return fallback; // NaN too
+            key = static_cast<int64_t>(f);
+            if(static_cast<double>(key) == f) break;
+            auto it = std::lower_bound(floatKeys.begin() , floatKeys.end() , f);
+            return it != floatKeys.end() && *it == f ? floatTargets[it - floatKeys.begin()] : fallback;
+        }
+        case ValueType::STRING : {
+            if(slotKeys.empty()) return fallback;
+            SymbolId id = subject.s;
+            if(subject.form != StringForm::SYMBOL) {
+                // Built at run time : only text some pattern interned can match
+                id = symbols().find(stringText(subject));
+                if(id == NO_SYMBOL) return fallback;
+            }
+            uint32_t d = displacements[mixSymbol(id) >> bucketShift];
+            size_t slot = mixSymbol(uint64_t(id) | uint64_t(d) << 32) & (slotKeys.size() - 1);
+            return slotKeys[slot] == id ? slotTargets[slot] : fallback;
+        }
+        default : return fallback;
+    }
+    uint64_t offset = uint64_t(key) - uint64_t(denseLow);
+    if(offset < dense.size()) return dense[offset];
+    auto it = std::lower_bound(sparseKeys.begin() , sparseKeys.end() , key);
+    return it != sparseKeys.end() && *it == key ? sparseTargets[it - sparseKeys.begin()] : fallback;
+}
+
+const char* opName(Op op) {
+    switch(op) {
+#define STRYX_OPCODE_NAME(name) case Op::name : return #name;
+        STRYX_OPCODES(STRYX_OPCODE_NAME)
+#undef STRYX_OPCODE_NAME
+    }
+    return "?";
+}
+
+bool binaryOp(TokenType type , Op& op) {
+    switch(type) {
+        case TokenType::PLUS : op = Op::ADD; return true;
+        case TokenType::MINUS : op = Op::SUB; return true;
+        case TokenType::STAR : op = Op::MUL; return true;
+        case TokenType::SLASH : op = Op::DIV; return true;
+        case TokenType::MODULO : op = Op::MOD; return true;
+        case TokenType::XOR : op = Op::XOR; return true;
+        case TokenType::EQUAL : op = Op::EQ; return true;
+        case TokenType::NOT_EQUAL : op = Op::NE; return true;
+        case TokenType::LESS : op = Op::LT; return true;
+        case TokenType::LESS_EQUAL : op = Op::LE; return true;
+        case TokenType::GREATER : op = Op::GT; return true;
+        case TokenType::GREATER_EQUAL : op = Op::GE; return true;
+        default : return false;
+    }
+}
+
+long Module::find(SymbolId name) const {
+    auto it = byName.find(name);
+    return it == byName.end() ? -1 : static_cast<long>(it->second);
+}
+
+void Module::disassemble() const {
+    for(const BytecodeFunction& fn : functions) {
+        std::cout<<"fn "<<symbolText(fn.name)<<fn.signature<<" ("<<int(fn.params)<<" params , "<<fn.frameSize<<" registers)\n";
+        for(size_t k = 0; k < fn.constants.size(); k++) {
+            std::cout<<"    K"<<k<<" = ";
+            printValue(std::cout , fn.constants[k]);
+            std::cout<<"\n";
+        }
+        for(size_t pc = 0; pc < fn.code.size(); pc++) {
+            Instr i = fn.code[pc];
+            Op op = opOf(i);
+            std::cout<<"    "<<pc<<"\t"<<opName(op)<<"\t";
+            switch(op) {
+                case Op::LOADK : std::cout<<"R"<<int(argA(i))<<" K"<<argBx(i); break;
+                case Op::LOADNIL :
+                case Op::RET : std::cout<<"R"<<int(argA(i)); break;
+                case Op::MOVE :
+                case Op::NOT : std::cout<<"R"<<int(argA(i))<<" R"<<int(argB(i)); break;
+                case Op::JMP : std::cout<<"-> "<<long(pc) + 1 + argSBx(i); break;
+                case Op::JMPF :
+                case Op::JMPT : std::cout<<"R"<<int(argA(i))<<" -> "<<long(pc) + 1 + argSBx(i); break;
+                case Op::CALL :
+                    std::cout<<"R"<<int(argA(i))<<" "<<int(argB(i))<<" args "<<symbolText(functions[fn.code[pc + 1]].name)
+                             <<functions[fn.code[pc + 1]].signature;
+                    pc++; // the callee index word
+                    break;
+                case Op::MODP2 : std::cout<<"R"<<int(argA(i))<<" R"<<int(argB(i))<<" 2^"<<int(argC(i)); break;
+                case Op::PRINT : std::cout<<"R"<<int(argA(i))<<" "<<int(argB(i))<<" args"; break;
+                case Op::SWITCH : {
+                    const SwitchTable& t = fn.switches[argBx(i)];
+                    std::cout<<"R"<<int(argA(i))<<" S"<<argBx(i)<<" ("<<t.dense.size()<<" dense , "<<t.sparseKeys.size()
+                             <<" sparse , "<<t.floatKeys.size()<<" float , "<<t.slotKeys.size()<<" string slots) else -> "<<t.fallback;
+                    break;
+                }
+                default : std::cout<<"R"<<int(argA(i))<<" R"<<int(argB(i))<<" R"<<int(argC(i)); break;
+            }
+            std::cout<<"\n";
+        }
+    }
+}
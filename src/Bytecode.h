@@ -0,0 +1,233 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "Interner.h"
+#include "Token.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ---- Runtime values : 16 bytes ----
+// A STRING takes one of three forms , which the language never tells apart :
+//   SYMBOL  an interned id , for literals and constant-folded text
+//   SMALL   up to SMALL_STRING_MAX bytes held in the value itself , from
+//           `smallText` on through the payload
+//   HEAP    an immutable StringObject owned by the VM's Heap , longer than that
+enum class ValueType : uint8_t { NIL, INT, FLOAT, STRING };
+enum class StringForm : uint8_t { SYMBOL, SMALL, HEAP };
+
+// Text of a HEAP string , its bytes follow the header
+struct StringObject {
+    uint32_t length;
+    uint8_t flags; // the Heap's bookkeeping
+
+    const char* chars() const { return reinterpret_cast<const char*>(this + 1); }
+    char* chars() { return reinterpret_cast<char*>(this + 1); }
+};
+
+struct Value {
+    static constexpr size_t SMALL_STRING_MAX = 13;
+
+    ValueType type;
+    StringForm form;     // STRING only
+    uint8_t smallLength; // SMALL only
+    char smallText[5];   // SMALL only , its first bytes
+    union {
+        int64_t i;
+        double f;
+        SymbolId s;
+        StringObject* object;
+    };
+
+    static Value nil() { Value v; v.type = ValueType::NIL; v.i = 0; return v; }
+    static Value integer(int64_t i) { Value v; v.type = ValueType::INT; v.i = i; return v; }
+    static Value number(double f) { Value v; v.type = ValueType::FLOAT; v.f = f; return v; }
+    static Value string(SymbolId s) { Value v; v.type = ValueType::STRING; v.form = StringForm::SYMBOL; v.i = 0; v.s = s; return v; }
+    static Value heapString(StringObject* object) { Value v; v.type = ValueType::STRING; v.form = StringForm::HEAP; v.object = object; return v; }
+    // A SMALL string of `length` bytes , for the caller to write through smallBytes()
+    static Value smallString(size_t length) {
+        Value v;
+        v.type = ValueType::STRING;
+        v.form = StringForm::SMALL;
+        v.smallLength = static_cast<uint8_t>(length);
+        v.i = 0;
+        return v;
+    }
+
+    char* smallBytes() { return reinterpret_cast<char*>(this) + offsetof(Value , smallText); }
+    const char* smallBytes() const { return reinterpret_cast<const char*>(this) + offsetof(Value , smallText); }
+};
+static_assert(sizeof(Value) == 16 && offsetof(Value , i) == 8 , "the JIT and the VM expect a 16-byte value");
+static_assert(sizeof(Value) - offsetof(Value , smallText) >= Value::SMALL_STRING_MAX , "a SMALL string overruns its value");
+
+// Text of any string form. A SMALL string's view points into `v` itself.
+inline std::string_view stringText(const Value& v) {
+    switch(v.form) {
+        case StringForm::SYMBOL : return symbolText(v.s);
+        case StringForm::SMALL : return std::string_view(v.smallBytes() , v.smallLength);
+        case StringForm::HEAP : return std::string_view(v.object->chars() , v.object->length);
+    }
+    return std::string_view();
+}
+
+const char* typeName(ValueType type);
+void printValue(std::ostream& out , const Value& value);
+
+inline bool truthy(const Value& v) {
+    switch(v.type) {
+        case ValueType::INT : return v.i != 0;
+        case ValueType::FLOAT : return v.f != 0.0;
+        case ValueType::STRING : return !stringText(v).empty();
+        default : return false;
+    }
+}
+
+// `==` across types : ints and floats compare numerically , anything else by type and value
+bool valuesEqual(const Value& a , const Value& b);
+
+// Value of a number literal , as the lexer converted it
+inline Value numberValue(NumberValue value , bool isFloat) {
+    return isFloat ? Value::number(value.f) : Value::integer(value.i);
+}
+
+// ---- Instruction set ----
+// Each instruction is one 32-bit word : op | A << 8 | B << 16 | C << 24 , or
+// op | A << 8 | Bx << 16 with a 16-bit constant index or signed jump offset.
+// A , B and C name registers of the current frame. Jump offsets are relative
+// to the instruction after the jump.
+#define STRYX_OPCODES(X) \
+    X(LOADK)    /* R[A] = K[Bx]                                            */ \
+    X(LOADNIL)  /* R[A] = nil                                              */ \
+    X(MOVE)     /* R[A] = R[B]                                             */ \
+    X(NOT)      /* R[A] = !truthy(R[B]) , 0 or 1                           */ \
+    X(ADD)      /* R[A] = R[B] + R[C] , likewise for the operators below   */ \
+    X(SUB)                                                                    \
+    X(MUL)                                                                    \
+    X(DIV)                                                                    \
+    X(MOD)                                                                    \
+    X(MODP2)    /* R[A] = R[B] % 2^C , C is an immediate shift             */ \
+    X(XOR)                                                                    \
+    X(EQ)                                                                     \
+    X(NE)                                                                     \
+    X(LT)                                                                     \
+    X(LE)                                                                     \
+    X(GT)                                                                     \
+    X(GE)                                                                     \
+    X(IADD)     /* R[A] = R[B] + R[C] , both known ints : no tag checks    */ \
+    X(ISUB)                                                                   \
+    X(IMUL)                                                                   \
+    X(ILT)                                                                    \
+    X(ILE)                                                                    \
+    X(IGT)                                                                    \
+    X(IGE)                                                                    \
+    X(FADD)     /* R[A] = R[B] + R[C] , both known floats                  */ \
+    X(FSUB)                                                                   \
+    X(FMUL)                                                                   \
+    X(FDIV)                                                                   \
+    X(FLT)                                                                    \
+    X(FLE)                                                                    \
+    X(FGT)                                                                    \
+    X(FGE)                                                                    \
+    X(JMP)      /* pc += sBx                                               */ \
+    X(JMPF)     /* if !truthy(R[A]) pc += sBx                              */ \
+    X(JMPT)     /* if truthy(R[A]) pc += sBx                               */ \
+    X(SWITCH)   /* pc = S[Bx].target(R[A]) , a compiled match             */ \
+    X(CALL)     /* R[A] = F[next word](R[A] .. R[A + B - 1])               */ \
+    X(PRINT)    /* print R[A] .. R[A + B - 1] , R[A] = nil                 */ \
+    X(RET)      /* return R[A]                                             */
+
+enum class Op : uint8_t {
+#define STRYX_OPCODE_ENUM(name) name,
+    STRYX_OPCODES(STRYX_OPCODE_ENUM)
+#undef STRYX_OPCODE_ENUM
+};
+
+using Instr = uint32_t;
+
+inline Instr encode(Op op , uint8_t a , uint8_t b , uint8_t c) {
+    return uint32_t(op) | uint32_t(a) << 8 | uint32_t(b) << 16 | uint32_t(c) << 24;
+}
+inline Instr encodeBx(Op op , uint8_t a , uint16_t bx) {
+    return uint32_t(op) | uint32_t(a) << 8 | uint32_t(bx) << 16;
+}
+
+inline Op opOf(Instr i) { return static_cast<Op>(i & 0xFF); }
+inline uint8_t argA(Instr i) { return static_cast<uint8_t>(i >> 8); }
+inline uint8_t argB(Instr i) { return static_cast<uint8_t>(i >> 16); }
+inline uint8_t argC(Instr i) { return static_cast<uint8_t>(i >> 24); }
+inline uint16_t argBx(Instr i) { return static_cast<uint16_t>(i >> 16); }
+inline int16_t argSBx(Instr i) { return static_cast<int16_t>(i >> 16); }
+
+const char* opName(Op op);
+
+// Opcode computing a binary operator token , false for && , || and operators without one
+bool binaryOp(TokenType type , Op& op);
+
+// Apply an arithmetic or comparison opcode with the VM's semantics. Returns
+// false on a type error or an integer division by zero , shared by the VM's
+// slow path and constant folding so the two always agree. Adding two strings
+// interns the result , the VM concatenates into its heap before getting here ;
+// false too when the symbol table is full , the addition is then left unfolded.
+bool evalBinary(Op op , const Value& a , const Value& b , Value& out);
+
+// ---- Multi-way branch for a match whose patterns are all literals ----
+// Targets are absolute code offsets. The first arm with a given key wins ,
+// int patterns and integral float patterns share the int keys so `1` and
+// `1.0` are one key , as `==` has it.
+struct SwitchTable {
+    // Int keys , either a jump table over [denseLow , denseLow + dense.size())
+    // with `fallback` in the holes , or sorted for binary search
+    int64_t denseLow = 0;
+    std::vector<uint32_t> dense;
+    std::vector<int64_t> sparseKeys;
+    std::vector<uint32_t> sparseTargets;
+    // Float patterns with a fraction , sorted
+    std::vector<double> floatKeys;
+    std::vector<uint32_t> floatTargets;
+    // String patterns , a perfect hash on the interned ids : a key's bucket
+    // picks the displacement that sends it to a slot no other key uses
+    uint8_t bucketShift = 63;
+    std::vector<uint32_t> displacements;
+    std::vector<SymbolId> slotKeys;
+    std::vector<uint32_t> slotTargets;
+    uint32_t fallback = 0; // the `_` arm or the end of the match
+
+    uint32_t target(const Value& subject) const;
+};
+
+// Hash of an interned id , for SwitchTable's string slots
+inline uint64_t mixSymbol(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// ---- Compiled code ----
+struct BytecodeFunction {
+    SymbolId name;
+    uint8_t params;
+    uint16_t frameSize;   // registers used , the VM reserves them on call
+    uint32_t source = 0;  // index of the FunctionDecl , several specializations share one
+    std::string signature; // inferred "(int) -> int" , for listings
+    std::vector<Instr> code;
+    std::vector<Value> constants;
+    std::vector<SwitchTable> switches;
+};
+
+struct Module {
+    std::vector<BytecodeFunction> functions;
+    std::unordered_map<SymbolId , uint32_t> byName;
+
+    // Index of the named function , or -1
+    long find(SymbolId name) const;
+    // Human-readable listing of every function
+    void disassemble() const;
+};
+
+#endif // BYTECODE_H
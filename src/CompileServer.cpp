@@ -0,0 +1,361 @@
+#include "CompileServer.h"
+#include "AstCache.h"
+#include "Interner.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr size_t READ_CHUNK = 64 * 1024;
+
+// Buffered reading and writing on one connected socket
+class Connection {
+    private :
+        int fd;
+        std::string in;
+        size_t pos = 0;
+        bool closed = false;
+
+        bool fill() {
+            if(closed) return false;
+            if(pos > 0) {
+                in.erase(0 , pos);
+                pos = 0;
+            }
+            char chunk[READ_CHUNK];
+            ssize_t n;
+            do n = ::read(fd , chunk , sizeof(chunk)); while(n < 0 && errno == EINTR);
+            if(n <= 0) {
+                closed = true;
+                timedOut = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                return false;
+            }
+            in.append(chunk , static_cast<size_t>(n));
+            return true;
+        }
+
+    public :
+        std::string out;
+        bool timedOut = false; // a read waited longer than the socket's timeout
+
+        explicit Connection(int fd) : fd(fd) {}
+
+        // The next line without its '\n' , false once the peer is done
+        bool readLine(std::string& line) {
+            for(;;) {
+                size_t nl = in.find('\n' , pos);
+                if(nl != std::string::npos) {
+                    line.assign(in , pos , nl - pos);
+                    pos = nl + 1;
+                    return true;
+                }
+                if(!fill()) {
+                    // A last line without '\n' still counts , unless the peer stalled in it
+                    if(pos == in.size() || timedOut) return false;
+                    line.assign(in , pos , std::string::npos);
+                    pos = in.size();
+                    return true;
+                }
+            }
+        }
+
+        bool readBytes(size_t n , std::string& text) {
+            while(in.size() - pos < n) {
+                if(!fill()) return false;
+            }
+            text.assign(in , pos , n);
+            pos += n;
+            return true;
+        }
+
+        bool flush() {
+            size_t sent = 0;
+            while(sent < out.size()) {
+                ssize_t n = ::send(fd , out.data() + sent , out.size() - sent , MSG_NOSIGNAL);
+                if(n < 0 && errno == EINTR) continue;
+                if(n <= 0) return false;
+                sent += static_cast<size_t>(n);
+            }
+            out.clear();
+            return true;
+        }
+};
+
+bool socketAddress(const std::string& path , sockaddr_un& addr) {
+    std::memset(&addr , 0 , sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::memcpy(addr.sun_path , path.data() , path.size());
+    return true;
+}
+
+size_t entryBytes(const CompileServer::Entry& entry) {
+    const Program& program = entry.program;
+    size_t bytes = entry.text.capacity() + entry.tokens.memoryUsage() + entry.lexErrors.capacity() * sizeof(LexError) + program.arena.bytesReserved()
+                 + program.functions.capacity() * sizeof(FunctionDecl*);
+    for(const ParseError& error : program.errors) bytes += sizeof(ParseError) + error.message.size() + error.gotText.size();
+    return bytes;
+}
+
+void reportEntry(std::string& out , const std::string& name , const CompileServer::Entry& entry , bool hit) {
+    const Program& program = entry.program;
+    out += "file " + std::to_string(program.errors.size()) + " " + std::to_string(program.functions.size()) + " "
+         + std::to_string(entry.tokens.size() ? entry.tokens.size() - 1 : 0) + (hit ? " hit " : " miss ") + name + "\n";
+    for(const LexError& error : entry.lexErrors) out += "lexer " + error.toString() + "\n";
+    for(const ParseError& error : program.errors) out += "error " + error.toString() + "\n";
+}
+
+} // namespace
+
+CompileServer::CompileServer(std::string socketPath , size_t threads , size_t memoryLimit)
+    : socketPath(std::move(socketPath)) , memoryLimit(memoryLimit) , listenFd(-1) , stopping(false) , pool(threads) {}
+
+CompileServer::~CompileServer() {
+    pool.wait();
+    if(listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+}
+
+bool CompileServer::listen() {
+    sockaddr_un addr;
+    if(!socketAddress(socketPath , addr)) return false;
+    // Only a socket nobody accepts on is removed : a live daemon keeps its
+    // path , and a file that is not a socket is never touched
+    struct stat st;
+    if(::lstat(socketPath.c_str() , &st) == 0) {
+        if(!S_ISSOCK(st.st_mode)) {
+            errno = ENOTSOCK;
+            return false;
+        }
+        int probe = ::socket(AF_UNIX , SOCK_STREAM | SOCK_CLOEXEC , 0);
+        if(probe < 0) return false;
+        int connected = ::connect(probe , reinterpret_cast<sockaddr*>(&addr) , sizeof(addr));
+        int saved = connected == 0 ? EADDRINUSE : errno;
+        ::close(probe);
+        if(saved != ECONNREFUSED) {
+            errno = saved;
+            return false;
+        }
+        ::unlink(socketPath.c_str());
+    } else if(errno != ENOENT) {
+        return false;
+    }
+
+    listenFd = ::socket(AF_UNIX , SOCK_STREAM | SOCK_CLOEXEC , 0);
+    if(listenFd < 0) return false;
+    if(::bind(listenFd , reinterpret_cast<sockaddr*>(&addr) , sizeof(addr)) < 0 || ::listen(listenFd , SOMAXCONN) < 0) {
+        int saved = errno;
+        ::close(listenFd);
+        listenFd = -1;
+        errno = saved;
+        return false;
+    }
+    return true;
+}
+
+void CompileServer::run() {
+    while(!stopping.load()) {
+        int fd = ::accept4(listenFd , nullptr , nullptr , SOCK_CLOEXEC);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            break; // shut down by stop() , or the socket is gone
+        }
+        // Bounds every read and write , an idle or stuck client gives up its worker
+        timeval idle{IDLE_SECONDS , 0};
+        ::setsockopt(fd , SOL_SOCKET , SO_RCVTIMEO , &idle , sizeof(idle));
+        ::setsockopt(fd , SOL_SOCKET , SO_SNDTIMEO , &idle , sizeof(idle));
+        pool.submit([this , fd] {
+            serve(fd);
+            ::close(fd);
+        });
+    }
+    pool.wait();
+}
+
+void CompileServer::stop() {
+    stopping.store(true);
+    ::shutdown(listenFd , SHUT_RDWR); // wakes the accept() in run()
+}
+
+std::shared_ptr<const CompileServer::Entry> CompileServer::check(std::string_view source , bool& hit) {
+    uint64_t hash = AstCache::hashSource(source);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.files++;
+        auto it = entries.find(hash);
+        if(it != entries.end() && it->second.entry->text == source) {
+            recent.splice(recent.begin() , recent , it->second.recent);
+            counters.hits++;
+            hit = true;
+            return it->second.entry;
+        }
+    }
+
+    // Parsed outside the lock , two batches missing on the same text both parse it
+    auto entry = std::make_shared<Entry>();
+    entry->text.assign(source.data() , source.size());
+    Lexer lexer(entry->text);
+    lexer.captureErrors(entry->lexErrors); // into the reply , not the daemon's stderr
+    entry->tokens = lexer.tokenize();
+    entry->program = Parser(entry->tokens , 0 , entry->tokens.size()).parseProgram();
+    // Cached for as long as the file is unchanged : the token arrays give back
+    // their spare capacity , and a small file whose nodes fill a fraction of
+    // one arena block keeps a copy packed to its own size
+    entry->tokens.shrinkToFit();
+    if(entry->program.arena.bytesReserved() > 2 * entry->program.arena.bytesUsed()) entry->program = compactProgram(entry->program);
+    entry->bytes = entryBytes(*entry);
+    // The symbols this parse interned stay for the life of the process ,
+    // the cache makes room for them
+    size_t interned = symbols().memoryUsage();
+    hit = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.misses++;
+    auto it = entries.find(hash);
+    if(it != entries.end()) {
+        // A racing batch or a hash collision , the newest text wins
+        counters.cachedBytes -= it->second.entry->bytes;
+        recent.erase(it->second.recent);
+        entries.erase(it);
+    }
+    recent.push_front(hash);
+    entries.emplace(hash , Slot{entry , recent.begin()});
+    counters.cachedBytes += entry->bytes;
+    counters.symbolBytes = std::max(counters.symbolBytes , interned);
+    // The entry just added always stays , even when it alone is over budget
+    while(counters.cachedBytes + counters.symbolBytes > memoryLimit && recent.size() > 1) {
+        auto victim = entries.find(recent.back());
+        counters.cachedBytes -= victim->second.entry->bytes;
+        entries.erase(victim);
+        recent.pop_back();
+        counters.evictions++;
+    }
+    counters.cachedFiles = entries.size();
+    // Symbols are never freed , once they alone fill the budget only a new
+    // process brings memory back down
+    if(counters.symbolBytes > memoryLimit) stop();
+    return entry;
+}
+
+CompileServer::Stats CompileServer::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void CompileServer::serve(int fd) {
+    Connection conn(fd);
+    size_t files = 0 , errors = 0;
+    std::string line , text;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.batches++;
+    }
+
+    while(conn.readLine(line)) {
+        if(line.empty()) continue; // e.g. the newline after a buffer's text
+        if(line == "end") break;
+
+        std::shared_ptr<const Entry> entry;
+        std::string name;
+        bool hit = false;
+        if(line.compare(0 , 6 , "check ") == 0) {
+            name = line.substr(6);
+            SourceBuffer source;
+            bool opened = source.open(name);
+            if(opened && source.size() > MAX_SOURCE) {
+                opened = false;
+                errno = EFBIG;
+            }
+            if(!opened) {
+                conn.out += std::string("unreadable ") + std::strerror(errno) + " " + name + "\n";
+                files++;
+                continue;
+            }
+            entry = check(source.view() , hit);
+        } else if(line.compare(0 , 7 , "buffer ") == 0) {
+            char* rest = nullptr;
+            unsigned long long length = std::strtoull(line.c_str() + 7 , &rest , 10);
+            if(rest == line.c_str() + 7 || *rest != ' ' || length > MAX_SOURCE || !conn.readBytes(length , text)) {
+                if(conn.timedOut) break;
+                conn.out += "bad request " + line + "\n";
+                break;
+            }
+            name = rest + 1;
+            entry = check(text , hit);
+        } else if(line == "stats") {
+            Stats s = stats();
+            conn.out += "stats batches=" + std::to_string(s.batches) + " files=" + std::to_string(s.files)
+                      + " hits=" + std::to_string(s.hits) + " misses=" + std::to_string(s.misses)
+                      + " evictions=" + std::to_string(s.evictions) + " cached=" + std::to_string(s.cachedFiles)
+                      + " bytes=" + std::to_string(s.cachedBytes) + " symbols=" + std::to_string(symbols().size())
+                      + " symbolBytes=" + std::to_string(s.symbolBytes) + "\n";
+            continue;
+        } else if(line == "shutdown") {
+            stop();
+            break;
+        } else {
+            conn.out += "bad request " + line + "\n";
+            break;
+        }
+
+        files++;
+        errors += entry->program.errors.size();
+        reportEntry(conn.out , name , *entry , hit);
+    }
+
+    // One reply per batch , written after the whole request was read : a
+    // client that sends everything before reading can never deadlock on
+    // both sides' socket buffers filling up
+    if(conn.timedOut) {
+        conn.out += "timeout\n";
+        conn.flush();
+        return;
+    }
+    conn.out += "done " + std::to_string(files) + " " + std::to_string(errors) + "\n";
+    conn.flush();
+}
+
+std::string defaultSocketPath() {
+    if(const char* runtime = std::getenv("XDG_RUNTIME_DIR")) {
+        if(*runtime) return std::string(runtime) + "/stryxd.sock";
+    }
+    return "/tmp/stryxd-" + std::to_string(::getuid()) + ".sock";
+}
+
+bool requestServer(const std::string& socketPath , std::string_view request , std::string& reply) {
+    sockaddr_un addr;
+    if(!socketAddress(socketPath , addr)) return false;
+    int fd = ::socket(AF_UNIX , SOCK_STREAM | SOCK_CLOEXEC , 0);
+    if(fd < 0) return false;
+    if(::connect(fd , reinterpret_cast<sockaddr*>(&addr) , sizeof(addr)) < 0) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+
+    Connection conn(fd);
+    conn.out.assign(request.data() , request.size());
+    bool sent = conn.flush();
+    ::shutdown(fd , SHUT_WR);
+    std::string line;
+    reply.clear();
+    while(conn.readLine(line)) reply += line + "\n";
+    ::close(fd);
+    return sent || !reply.empty();
+}
@@ -0,0 +1,124 @@
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include "AST.h"
+#include "Lexer.h"
+#include "ThreadPool.h"
+#include "Token.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ---- stryxd : a long-lived checker on a Unix domain socket ----
+// One connection carries one batch. Requests are lines , except that a
+// buffer's text follows its header line byte for byte :
+//
+//   check <path>                   parse the file at <path> (absolute , the
+//                                  daemon's working directory is not the client's)
+//   buffer <length> <name>\n<text> parse <length> bytes sent inline , e.g. an
+//                                  unsaved editor buffer
+//   stats                          counters , see Stats
+//   shutdown                       stop accepting , finish open batches , exit
+//   end                            (or closing the write side) ends the batch
+//
+// Empty lines are skipped , so a buffer's text may be followed by a newline.
+//
+// Every check and buffer is answered in order with
+//
+//   file <errors> <functions> <tokens> <hit|miss> <name>
+//   lexer <LexError::toString()>        one line per unexpected character
+//   error <ParseError::toString()>      one line per syntax error
+//
+// or `unreadable <reason> <name>` , and the batch closes with
+// `done <files> <errors>`. The reply is written once the whole batch has
+// been read , so a client may send everything before reading.
+//
+// A malformed request , or a buffer longer than MAX_SOURCE , ends the batch
+// with `bad request <line>` ; a file longer than MAX_SOURCE is unreadable.
+// A connection that sends nothing for IDLE_SECONDS is answered `timeout`
+// and closed without `done` , so a stalled client cannot hold a worker.
+//
+// Parsed sources stay in memory keyed by content hash with their tokens and
+// AST , so an unchanged file is answered without lexing or parsing. Least
+// recently used entries are dropped past the memory budget. Interned symbols
+// are process-wide and never freed : they count against the budget too , and
+// once they alone pass it the daemon stops accepting , finishes the open
+// batches and exits so a restart can release them.
+class CompileServer {
+    public :
+        static constexpr size_t MAX_SOURCE = size_t(256) << 20;
+        static constexpr int IDLE_SECONDS = 10;
+
+        struct Stats {
+            size_t batches = 0;
+            size_t files = 0;
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            size_t cachedFiles = 0;
+            size_t cachedBytes = 0;
+            size_t symbolBytes = 0; // the interner , see Interner::memoryUsage
+        };
+
+        // A parsed source , shared with the batches reading it
+        struct Entry {
+            std::string text;
+            TokenStream tokens; // views into `text`
+            std::vector<LexError> lexErrors;
+            Program program;
+            size_t bytes;       // text , tokens and arena , counted against the budget
+        };
+
+    private :
+        struct Slot {
+            std::shared_ptr<const Entry> entry;
+            std::list<uint64_t>::iterator recent;
+        };
+
+        std::string socketPath;
+        size_t memoryLimit;
+        int listenFd;
+        std::atomic<bool> stopping;
+        ThreadPool pool;
+
+        std::mutex mutex; // guards everything below
+        std::unordered_map<uint64_t , Slot> entries;
+        std::list<uint64_t> recent; // content hashes , most recently used first
+        Stats counters;
+
+        void serve(int fd);
+        void stop();
+
+    public :
+        // 0 threads means one per hardware thread
+        CompileServer(std::string socketPath , size_t threads , size_t memoryLimit);
+        ~CompileServer();
+        CompileServer(const CompileServer&) = delete;
+        CompileServer& operator=(const CompileServer&) = delete;
+
+        // Bind and listen , replacing the socket file of a daemon that did not
+        // exit cleanly. False with errno set : EADDRINUSE when a daemon still
+        // answers on the path , ENOTSOCK when the path is not a socket.
+        bool listen();
+        // Accept connections until a shutdown request , each batch runs on the pool
+        void run();
+
+        // The parse of `source` , from memory when the same text was seen before
+        std::shared_ptr<const Entry> check(std::string_view source , bool& hit);
+        Stats stats();
+};
+
+// $XDG_RUNTIME_DIR/stryxd.sock , or /tmp/stryxd-<uid>.sock
+std::string defaultSocketPath();
+
+// Client side : send `request` as one batch and read the reply until the
+// server closes. False with errno set when the server cannot be reached.
+bool requestServer(const std::string& socketPath , std::string_view request , std::string& reply);
+
+#endif // COMPILE_SERVER_H
@@ -0,0 +1,480 @@
+#include "Compiler.h"
+#include "MatchCompiler.h"
+#include "Resolver.h"
+#include "Stats.h"
+#include "TypeInference.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+constexpr int MAX_REGISTERS = 256;
+constexpr uint32_t NOT_COMPILED = UINT32_MAX;
+
+// Thrown once FunctionCompiler::error has recorded the error , abandons the function
+struct CompileFailure {};
+
+// Tag-free version of `op` when both operands are known ints or known floats , else `op`
+Op typedOp(Op op , StaticType left , StaticType right) {
+    if(left != right) return op;
+    if(left == StaticType::INT) {
+        switch(op) {
+            case Op::ADD : return Op::IADD;
+            case Op::SUB : return Op::ISUB;
+            case Op::MUL : return Op::IMUL;
+            case Op::LT : return Op::ILT;
+            case Op::LE : return Op::ILE;
+            case Op::GT : return Op::IGT;
+            case Op::GE : return Op::IGE;
+            default : return op; // division checks for zero , EQ and NE are already int fast paths
+        }
+    }
+    if(left == StaticType::FLOAT) {
+        switch(op) {
+            case Op::ADD : return Op::FADD;
+            case Op::SUB : return Op::FSUB;
+            case Op::MUL : return Op::FMUL;
+            case Op::DIV : return Op::FDIV;
+            case Op::LT : return Op::FLT;
+            case Op::LE : return Op::FLE;
+            case Op::GT : return Op::FGT;
+            case Op::GE : return Op::FGE;
+            default : return op;
+        }
+    }
+    return op;
+}
+
+// Variables sit in the registers the resolver gave them as frame slots ,
+// temporaries and loop state go above them. One specialization at a time :
+// its inferred types pick typed opcodes and its calls the callee's version.
+class FunctionCompiler {
+    private :
+        const Module& module;
+        BytecodeFunction& fn;
+        const Specialization& spec;
+        const std::vector<uint32_t>& compiled; // module index of each specialization
+        std::vector<CompileError>& errors;
+        bool warn; // report match warnings , once per function rather than per specialization
+        int top;   // next free register
+        int floor; // registers below are variables or loop state , kept across statements
+        int line;  // of the statement or call being compiled , for errors
+
+        std::unordered_map<int64_t , uint16_t> intConstants;
+        std::unordered_map<uint64_t , uint16_t> floatConstants;
+        std::unordered_map<SymbolId , uint16_t> stringConstants;
+
+        [[noreturn]] void error(const std::string& message) const {
+            errors.push_back(CompileError{line , message + " in function " + std::string(symbolText(fn.name))});
+            throw CompileFailure{};
+        }
+
+        uint8_t allocReg() {
+            if(top >= MAX_REGISTERS) error("expression needs more than 256 registers");
+            if(top + 1 > fn.frameSize) fn.frameSize = static_cast<uint16_t>(top + 1);
+            return static_cast<uint8_t>(top++);
+        }
+
+        uint8_t target(int dest) { return dest >= 0 ? static_cast<uint8_t>(dest) : allocReg(); }
+
+        template <typename Key>
+        uint16_t constant(std::unordered_map<Key , uint16_t>& pool , Key key , Value value) {
+            auto it = pool.find(key);
+            if(it != pool.end()) return it->second;
+            if(fn.constants.size() > UINT16_MAX) error("more than 65536 constants");
+            uint16_t k = static_cast<uint16_t>(fn.constants.size());
+            fn.constants.push_back(value);
+            pool.emplace(key , k);
+            return k;
+        }
+
+        uint16_t intConstant(int64_t v) { return constant(intConstants , v , Value::integer(v)); }
+
+        void emit(Instr i) { fn.code.push_back(i); }
+
+        size_t emitJump(Op op , uint8_t a) {
+            emit(encodeBx(op , a , 0));
+            return fn.code.size() - 1;
+        }
+
+        Instr withOffset(Instr i , long offset) const {
+            if(offset < INT16_MIN || offset > INT16_MAX) error("jump too far , function too large");
+            return (i & 0xFFFF) | uint32_t(static_cast<uint16_t>(offset)) << 16;
+        }
+
+        // Point the jump at `at` to the next instruction emitted
+        void patch(size_t at) {
+            fn.code[at] = withOffset(fn.code[at] , static_cast<long>(fn.code.size()) - static_cast<long>(at) - 1);
+        }
+
+        void emitLoop(size_t start) {
+            emit(withOffset(encodeBx(Op::JMP , 0 , 0) , static_cast<long>(start) - static_cast<long>(fn.code.size()) - 1));
+        }
+
+        // Compile into register `dest` , or anywhere when dest is -1 : a
+        // variable is then used in place. Returns the register holding the value.
+        uint8_t compileExpr(const Expression* expr , int dest);
+        uint8_t compileNumber(const NumberExpr* num , int dest);
+        uint8_t compileUnary(const UnaryExpr* un , int dest);
+        uint8_t compileBinary(const BinaryExpr* bin , int dest);
+        uint8_t compileCall(const CallExpr* call , int dest);
+
+        void body(const FunctionDecl* decl);
+        void compileStatement(const Statement* stmt);
+        void compileBlock(const AstList<Statement*>& body);
+        void compileFor(const ForStatement* loop);
+        void compileMatch(const MatchStatement* match);
+
+    public :
+        FunctionCompiler(const Module& module , BytecodeFunction& fn , const Specialization& spec ,
+                         const std::vector<uint32_t>& compiled , std::vector<CompileError>& errors , bool warn)
+            : module(module) , fn(fn) , spec(spec) , compiled(compiled) , errors(errors) , warn(warn) ,
+              top(0) , floor(0) , line(0) {}
+
+        // False once an error is recorded , `fn` is then unusable
+        bool compile(const FunctionDecl* decl);
+};
+
+bool FunctionCompiler::compile(const FunctionDecl* decl) {
+    try {
+        line = decl->line;
+        body(decl);
+    } catch(const CompileFailure&) {
+        return false;
+    }
+    return true;
+}
+
+void FunctionCompiler::body(const FunctionDecl* decl) {
+    if(decl->params.size() > MAX_REGISTERS - 1) error("more than 255 parameters");
+    if(decl->frameSlots > MAX_REGISTERS - 1) error("more than 255 variables live at once");
+    fn.params = static_cast<uint8_t>(decl->params.size());
+    fn.frameSize = decl->frameSlots;
+    top = floor = decl->frameSlots;
+    compileBlock(decl->body);
+    // Falling off the end returns nil
+    uint8_t r = allocReg();
+    emit(encode(Op::LOADNIL , r , 0 , 0));
+    emit(encode(Op::RET , r , 0 , 0));
+}
+
+void FunctionCompiler::compileBlock(const AstList<Statement*>& body) {
+    int savedFloor = floor;
+    for(const Statement* stmt : body) {
+        compileStatement(stmt);
+        top = floor;
+    }
+    top = floor = savedFloor;
+}
+
+void FunctionCompiler::compileStatement(const Statement* stmt) {
+    line = stmt->line;
+    switch(stmt->kind) {
+        case AstKind::LET :
+        case AstKind::VAR : {
+            // The slot is free until the binding starts , so the value goes straight there
+            if(stmt->kind == AstKind::LET) {
+                auto let = static_cast<const LetStatement*>(stmt);
+                compileExpr(let->value , let->slot);
+            } else {
+                auto var = static_cast<const VarStatement*>(stmt);
+                compileExpr(var->value , var->slot);
+            }
+            return;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<const AssignStatement*>(stmt);
+            compileExpr(assign->value , assign->ref.slot);
+            return;
+        }
+        case AstKind::RETURN : {
+            uint8_t r = compileExpr(static_cast<const ReturnStatement*>(stmt)->value , -1);
+            emit(encode(Op::RET , r , 0 , 0));
+            return;
+        }
+        case AstKind::IF : {
+            auto branch = static_cast<const IfStatement*>(stmt);
+            uint8_t cond = compileExpr(branch->condition , -1);
+            top = floor;
+            size_t skipThen = emitJump(Op::JMPF , cond);
+            compileBlock(branch->thenBranch);
+            if(branch->elseBranch.empty()) {
+                patch(skipThen);
+                return;
+            }
+            size_t skipElse = emitJump(Op::JMP , 0);
+            patch(skipThen);
+            compileBlock(branch->elseBranch);
+            patch(skipElse);
+            return;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<const WhileStatement*>(stmt);
+            size_t start = fn.code.size();
+            uint8_t cond = compileExpr(loop->condition , -1);
+            top = floor;
+            size_t done = emitJump(Op::JMPF , cond);
+            compileBlock(loop->body);
+            emitLoop(start);
+            patch(done);
+            return;
+        }
+        case AstKind::FOR : compileFor(static_cast<const ForStatement*>(stmt)); return;
+        case AstKind::MATCH : compileMatch(static_cast<const MatchStatement*>(stmt)); return;
+        default : error("unsupported statement");
+    }
+}
+
+// for x in n { body } counts a hidden register from 0 to n - 1 and copies it
+// into x at the top of each iteration , so the body may reassign x freely
+void FunctionCompiler::compileFor(const ForStatement* loop) {
+    int savedFloor = floor;
+
+    uint8_t limit = allocReg();
+    compileExpr(loop->iterable , limit);
+    uint8_t counter = allocReg();
+    emit(encodeBx(Op::LOADK , counter , intConstant(0)));
+    uint8_t one = allocReg();
+    emit(encodeBx(Op::LOADK , one , intConstant(1)));
+    uint8_t item = static_cast<uint8_t>(loop->iteratorSlot);
+    uint8_t cond = allocReg();
+    floor = top;
+
+    size_t start = fn.code.size();
+    emit(encode(typedOp(Op::LT , StaticType::INT , spec.typeOf(loop->iterable)) , cond , counter , limit));
+    size_t done = emitJump(Op::JMPF , cond);
+    emit(encode(Op::MOVE , item , counter , 0));
+    compileBlock(loop->body);
+    emit(encode(Op::IADD , counter , counter , one));
+    emitLoop(start);
+    patch(done);
+
+    top = floor = savedFloor;
+}
+
+// Arms with literal patterns dispatch through one SWITCH , others test
+// their patterns in order. Dead arms are not compiled either way.
+void FunctionCompiler::compileMatch(const MatchStatement* match) {
+    MatchPlan plan = planMatch(match);
+    if(warn) {
+        for(const std::string& w : plan.warnings) std::cerr<<"Compile Warning : "<<w<<" in function "<<symbolText(fn.name)<<"\n";
+    }
+    uint8_t subject = compileExpr(match->expr , -1);
+    int savedFloor = floor;
+    floor = top; // keep a temporary subject alive across the arms
+
+    std::vector<size_t> exits;
+    if(plan.table) {
+        if(fn.switches.size() > UINT16_MAX) error("more than 65536 match tables");
+        uint16_t index = static_cast<uint16_t>(fn.switches.size());
+        fn.switches.push_back(std::move(plan.switchTable));
+        emit(encodeBx(Op::SWITCH , subject , index));
+        std::vector<uint32_t> offsets;
+        for(uint32_t arm : plan.arms) {
+            offsets.push_back(static_cast<uint32_t>(fn.code.size()));
+            compileBlock(match->arms[arm].body);
+            exits.push_back(emitJump(Op::JMP , 0));
+        }
+        offsets.push_back(static_cast<uint32_t>(fn.code.size())); // no arm matched
+        retarget(fn.switches[index] , offsets);
+    } else {
+        for(size_t n = 0; n < plan.arms.size(); n++) {
+            const MatchArm& arm = match->arms[plan.arms[n]];
+            bool wildcard = plan.hasWildcard && n + 1 == plan.arms.size();
+            size_t next = 0;
+            if(!wildcard) {
+                uint8_t value = compileExpr(arm.pattern , -1);
+                uint8_t cond = allocReg();
+                emit(encode(Op::EQ , cond , subject , value));
+                top = floor;
+                next = emitJump(Op::JMPF , cond);
+            }
+            compileBlock(arm.body);
+            exits.push_back(emitJump(Op::JMP , 0));
+            if(!wildcard) patch(next);
+        }
+    }
+    for(size_t at : exits) patch(at);
+    top = floor = savedFloor;
+}
+
+uint8_t FunctionCompiler::compileExpr(const Expression* expr , int dest) {
+    switch(expr->kind) {
+        case AstKind::NUMBER : return compileNumber(static_cast<const NumberExpr*>(expr) , dest);
+        case AstKind::STRING : {
+            SymbolId s = static_cast<const StringExpr*>(expr)->value;
+            uint8_t r = target(dest);
+            emit(encodeBx(Op::LOADK , r , constant(stringConstants , s , Value::string(s))));
+            return r;
+        }
+        case AstKind::VARIABLE : {
+            int reg = static_cast<const VariableExpr*>(expr)->ref.slot;
+            if(dest < 0) return static_cast<uint8_t>(reg);
+            if(dest != reg) emit(encode(Op::MOVE , static_cast<uint8_t>(dest) , static_cast<uint8_t>(reg) , 0));
+            return static_cast<uint8_t>(dest);
+        }
+        case AstKind::UNARY : return compileUnary(static_cast<const UnaryExpr*>(expr) , dest);
+        case AstKind::BINARY : return compileBinary(static_cast<const BinaryExpr*>(expr) , dest);
+        case AstKind::CALL : return compileCall(static_cast<const CallExpr*>(expr) , dest);
+        default : error("unsupported expression");
+    }
+}
+
+uint8_t FunctionCompiler::compileNumber(const NumberExpr* num , int dest) {
+    Value v = numberValue(num->value , num->isFloat);
+    uint16_t k;
+    if(v.type == ValueType::INT) {
+        k = intConstant(v.i);
+    } else {
+        uint64_t bits;
+        std::memcpy(&bits , &v.f , sizeof(bits));
+        k = constant(floatConstants , bits , v);
+    }
+    uint8_t r = target(dest);
+    emit(encodeBx(Op::LOADK , r , k));
+    return r;
+}
+
+uint8_t FunctionCompiler::compileUnary(const UnaryExpr* un , int dest) {
+    if(un->op != TokenType::NOT) error(std::string("unsupported operator '") + tokenSpelling(un->op) + "'");
+    int mark = top;
+    uint8_t operand = compileExpr(un->operand , -1);
+    top = mark;
+    uint8_t r = target(dest);
+    emit(encode(Op::NOT , r , operand , 0));
+    return r;
+}
+
+uint8_t FunctionCompiler::compileBinary(const BinaryExpr* bin , int dest) {
+    if(bin->op == TokenType::AND || bin->op == TokenType::OR) {
+        // A fresh register , so `x = y && x` does not clobber x before reading it
+        int mark = top;
+        uint8_t r = allocReg();
+        compileExpr(bin->left , r);
+        size_t skip = emitJump(bin->op == TokenType::AND ? Op::JMPF : Op::JMPT , r);
+        compileExpr(bin->right , r);
+        patch(skip);
+        top = mark;
+        if(dest < 0) return allocReg();
+        emit(encode(Op::MOVE , static_cast<uint8_t>(dest) , r , 0));
+        return static_cast<uint8_t>(dest);
+    }
+
+    Op op;
+    if(!binaryOp(bin->op , op)) error(std::string("unsupported operator '") + tokenSpelling(bin->op) + "'");
+    int mark = top;
+    uint8_t left = compileExpr(bin->left , -1);
+    // x % 2^k masks instead of dividing
+    Value divisor = Value::nil();
+    if(bin->right->kind == AstKind::NUMBER) {
+        auto num = static_cast<const NumberExpr*>(bin->right);
+        divisor = numberValue(num->value , num->isFloat);
+    }
+    if(op == Op::MOD && divisor.type == ValueType::INT && divisor.i > 0 && divisor.i <= (int64_t(1) << 62)
+       && (divisor.i & (divisor.i - 1)) == 0) {
+        uint8_t shift = 0;
+        while((int64_t(1) << shift) != divisor.i) shift++;
+        top = mark;
+        uint8_t r = target(dest);
+        emit(encode(Op::MODP2 , r , left , shift));
+        return r;
+    }
+    uint8_t right = compileExpr(bin->right , -1);
+    top = mark; // operands are read before the result is written , so it may reuse them
+    uint8_t r = target(dest);
+    emit(encode(typedOp(op , spec.typeOf(bin->left) , spec.typeOf(bin->right)) , r , left , right));
+    return r;
+}
+
+uint8_t FunctionCompiler::compileCall(const CallExpr* call , int dest) {
+    if(call->line > 0) line = call->line; // nodes the optimizer made have none
+    if(call->callee->kind != AstKind::VARIABLE) error("only named functions can be called");
+    SymbolId name = static_cast<const VariableExpr*>(call->callee)->name;
+    long index = module.find(name);
+    bool builtinPrint = index < 0 && symbolText(name) == "print";
+    if(index < 0 && !builtinPrint) error("call to undefined function '" + std::string(symbolText(name)) + "'");
+    if(call->arguments.size() > MAX_REGISTERS - 1) error("more than 255 call arguments");
+    if(index >= 0 && module.functions[index].params != call->arguments.size()) {
+        error("'" + std::string(symbolText(name)) + "' takes " + std::to_string(module.functions[index].params)
+              + " arguments , got " + std::to_string(call->arguments.size()));
+    }
+
+    // Arguments go to consecutive registers from `base` , which become the callee's R[0] ..
+    int mark = top;
+    uint8_t base = allocReg();
+    for(size_t i = 0; i < call->arguments.size(); i++) {
+        uint8_t reg = i == 0 ? base : allocReg();
+        compileExpr(call->arguments[i] , reg);
+    }
+    uint8_t argc = static_cast<uint8_t>(call->arguments.size());
+    if(builtinPrint) {
+        emit(encode(Op::PRINT , base , argc , 0));
+    } else {
+        // The specialization for these argument types , when inference found one
+        uint32_t target = spec.callOf(call);
+        uint32_t callee = target == Specialization::NO_CALL ? NOT_COMPILED : compiled[target];
+        emit(encode(Op::CALL , base , argc , 0));
+        emit(static_cast<Instr>(callee == NOT_COMPILED ? static_cast<uint32_t>(index) : callee));
+    }
+    top = mark;
+    if(dest < 0) return allocReg(); // == base
+    if(dest != base) emit(encode(Op::MOVE , static_cast<uint8_t>(dest) , base , 0));
+    return static_cast<uint8_t>(dest);
+}
+
+} // namespace
+
+Module compileProgram(Program& program , std::vector<CompileError>& errors) {
+    Module module;
+    errors = resolveProgram(program);
+    if(!errors.empty()) return module;
+    for(size_t i = 0; i < program.functions.size(); i++) {
+        const FunctionDecl* decl = program.functions[i];
+        if(!module.byName.emplace(decl->name , static_cast<uint32_t>(i)).second) {
+            errors.push_back(CompileError{decl->line , "function " + std::string(symbolText(decl->name)) + " is defined twice"});
+        }
+    }
+    if(!errors.empty()) return module;
+    TypeInfo types = inferTypes(program);
+    PhaseTimer timer(Phase::COMPILE); // code generation , resolve and infer time themselves
+
+    // Generic versions keep the function indices , the specializations their
+    // calls reach are appended after them
+    std::vector<uint32_t> compiled(types.specs.size() , NOT_COMPILED);
+    std::vector<uint32_t> order;
+    for(uint32_t i = 0; i < program.functions.size(); i++) {
+        compiled[i] = i;
+        order.push_back(i);
+    }
+    for(size_t next = 0; next < order.size(); next++) {
+        for(uint32_t target : types.specs[order[next]].calls) {
+            if(target == Specialization::NO_CALL || compiled[target] != NOT_COMPILED) continue;
+            compiled[target] = static_cast<uint32_t>(order.size());
+            order.push_back(target);
+        }
+    }
+
+    module.functions.resize(order.size());
+    for(size_t i = 0; i < order.size(); i++) {
+        const Specialization& spec = types.specs[order[i]];
+        const FunctionDecl* decl = program.functions[spec.function];
+        BytecodeFunction& fn = module.functions[i];
+        fn.name = decl->name;
+        fn.params = static_cast<uint8_t>(std::min<size_t>(decl->params.size() , UINT8_MAX));
+        fn.frameSize = 0;
+        fn.source = spec.function;
+        fn.signature = spec.signature();
+    }
+    for(size_t i = 0; i < order.size(); i++) {
+        // A specialization fails where its generic version did , so stop after those
+        bool generic = i < program.functions.size();
+        if(!generic && !errors.empty()) break;
+        const Specialization& spec = types.specs[order[i]];
+        FunctionCompiler(module , module.functions[i] , spec , compiled , errors , generic)
+            .compile(program.functions[spec.function]);
+    }
+    return module;
+}
@@ -0,0 +1,31 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "AST.h"
+#include "Bytecode.h"
+#include "Resolver.h"
+#include <vector>
+
+// Lower every FunctionDecl to register bytecode. Runs resolveProgram and
+// inferTypes first. Module function i is FunctionDecl i's generic version ,
+// the specializations its calls reach follow , and operators whose operands
+// are both known ints or both known floats become tag-free typed opcodes.
+// Variables live in the registers numbered by their frame slots ,
+// temporaries are allocated stack-wise above them , and call
+// arguments are placed in consecutive registers that become the callee's
+// frame. A call to `print` that no user function shadows is a builtin.
+// Match statements follow planMatch : literal arms share one SWITCH.
+// Undefined names , assignments to let bindings , functions defined twice ,
+// arity mismatches and oversized functions are compile errors , duplicate
+// match patterns and arms after `_` warnings on stderr. Errors come back in
+// `errors` and the module is then unusable : the resolver's when it finds
+// any , else every duplicate name , else the first error of each function.
+//
+// Runtime semantics : ints are 64-bit and wrap , mixing int and float
+// promotes to float , `+` concatenates strings , comparisons yield 0 or 1 ,
+// `&&` and `||` short-circuit to the deciding operand , `for x in n` counts
+// x from 0 to n - 1 , and a match arm pattern is compared with `==` unless
+// it is `_`.
+Module compileProgram(Program& program , std::vector<CompileError>& errors);
+
+#endif // COMPILER_H
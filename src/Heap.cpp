@@ -0,0 +1,154 @@
+#include "Heap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+enum : uint8_t {
+    OLD = 1 ,       // allocated on its own , listed in Heap::old
+    MARKED = 2 ,    // reached by the running major collection
+    FORWARDED = 4   // a nursery string already copied old , its text holds the copy's address
+};
+
+static_assert(Value::SMALL_STRING_MAX >= sizeof(StringObject*) , "a forwarded string's text holds the new address");
+
+// Header and text , rounded up to keep the next nursery string aligned
+size_t objectSize(size_t length) {
+    return (sizeof(StringObject) + length + 7) & ~size_t(7);
+}
+
+bool isHeapString(const Value& v) {
+    return v.type == ValueType::STRING && v.form == StringForm::HEAP;
+}
+
+} // namespace
+
+Heap::Heap(size_t nurseryBytes , size_t oldLimit)
+    : nursery(new char[nurseryBytes]) , nurserySize(nurseryBytes) , base(0) , cursor(0) ,
+      oldBytes(0) , oldLimit(oldLimit) , minOldLimit(oldLimit) {}
+
+Heap::~Heap() {
+    delete[] nursery;
+    for(StringObject* s : old) delete[] reinterpret_cast<char*>(s);
+}
+
+StringObject* Heap::allocateOld(size_t size) {
+    StringObject* s = reinterpret_cast<StringObject*>(new char[size]);
+    s->flags = OLD;
+    old.push_back(s);
+    oldBytes += size;
+    counters.peakOldBytes = std::max<uint64_t>(counters.peakOldBytes , oldBytes);
+    return s;
+}
+
+void Heap::release(uint64_t mark , Value& result) {
+    // A collection since `mark` already emptied the nursery below `base`
+    uint64_t keep = std::max(mark , base);
+    counters.regionsDropped++;
+    counters.droppedBytes += cursor - keep;
+    cursor = keep;
+    if(!isHeapString(result) || !inNursery(result.object)) return;
+    char* from = reinterpret_cast<char*>(result.object);
+    char* to = nursery + (keep - base);
+    if(from < to) return; // from a region that stays
+    size_t size = objectSize(result.object->length);
+    std::memmove(to , from , size);
+    result.object = reinterpret_cast<StringObject*>(to);
+    cursor += size;
+    counters.droppedBytes -= size;
+    counters.escapes++;
+}
+
+bool Heap::full(size_t length) const {
+    if(length <= Value::SMALL_STRING_MAX) return false;
+    size_t size = objectSize(length);
+    if(size > nurserySize / 4) return oldBytes + size > oldLimit;
+    return cursor - base + size > nurserySize;
+}
+
+Value Heap::concat(std::string_view x , std::string_view y) {
+    size_t length = x.size() + y.size();
+    Value v;
+    char* out;
+    if(length <= Value::SMALL_STRING_MAX) {
+        v = Value::smallString(length);
+        out = v.smallBytes();
+        counters.smallStrings++;
+    } else {
+        size_t size = objectSize(length);
+        StringObject* s;
+        if(size > nurserySize / 4) {
+            s = allocateOld(size);
+            counters.pretenured++;
+        } else {
+            s = reinterpret_cast<StringObject*>(nursery + (cursor - base));
+            s->flags = 0;
+            cursor += size;
+        }
+        s->length = static_cast<uint32_t>(length);
+        v = Value::heapString(s);
+        out = s->chars();
+        counters.allocations++;
+        counters.allocatedBytes += size;
+    }
+    if(!x.empty()) std::memcpy(out , x.data() , x.size());
+    if(!y.empty()) std::memcpy(out + x.size() , y.data() , y.size());
+    return v;
+}
+
+void Heap::minor(Value* roots , size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        Value& v = roots[i];
+        if(!isHeapString(v) || !inNursery(v.object)) continue;
+        StringObject* s = v.object;
+        if(s->flags & FORWARDED) {
+            std::memcpy(&v.object , s->chars() , sizeof(StringObject*));
+            continue;
+        }
+        size_t size = objectSize(s->length);
+        StringObject* copy = allocateOld(size);
+        copy->length = s->length;
+        std::memcpy(copy->chars() , s->chars() , s->length);
+        s->flags = FORWARDED;
+        std::memcpy(s->chars() , &copy , sizeof(StringObject*));
+        v.object = copy;
+        counters.promotedBytes += size;
+    }
+    base = cursor;
+    counters.minorCollections++;
+}
+
+void Heap::major(Value* roots , size_t count) {
+    // After a minor collection every string the roots reach is old
+    for(size_t i = 0; i < count; i++) {
+        if(isHeapString(roots[i])) roots[i].object->flags |= MARKED;
+    }
+    size_t kept = 0;
+    size_t live = 0;
+    for(StringObject* s : old) {
+        size_t size = objectSize(s->length);
+        if(s->flags & MARKED) {
+            s->flags &= static_cast<uint8_t>(~MARKED);
+            old[kept++] = s;
+            live += size;
+        } else {
+            delete[] reinterpret_cast<char*>(s);
+            counters.sweptBytes += size;
+        }
+    }
+    old.resize(kept);
+    oldBytes = live;
+    // As much room again as survived , so a large live set is not swept over and over
+    oldLimit = std::max(minOldLimit , 2 * live);
+    counters.majorCollections++;
+}
+
+void Heap::collect(Value* roots , size_t count , size_t length) {
+    auto start = std::chrono::steady_clock::now();
+    minor(roots , count);
+    size_t size = objectSize(length);
+    if(oldBytes + (size > nurserySize / 4 ? size : 0) > oldLimit) major(roots , count);
+    counters.collectNanos += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
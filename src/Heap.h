@@ -0,0 +1,77 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "Bytecode.h"
+#include "Stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// ---- Runtime heap for the strings a running program builds ----
+// Strings of up to Value::SMALL_STRING_MAX bytes never get here , they sit in
+// their value. Longer ones are immutable StringObjects in two generations :
+//
+//   nursery  one block , bump-allocated and carved into per-call regions. A
+//            call's region starts where the cursor stood at its first
+//            allocation and goes whole when it returns , a string it returns
+//            first moves down into its caller's region. Strings too large for
+//            a quarter of the nursery skip it and start out old.
+//   old      one allocation per string. A minor collection copies the nursery
+//            strings the roots still reach into it and empties the nursery ,
+//            a major one frees what the roots no longer reach.
+//
+// A string refers to nothing , so no old object points into the nursery and
+// stores need no barrier. Positions count bytes from the heap's creation ,
+// less what regions gave back , so a frame's mark survives a collection
+// emptying the nursery under it. The VM passes the roots : a run of values
+// in which every HEAP string is live or at least still allocated.
+class Heap {
+    public :
+        static constexpr size_t DEFAULT_NURSERY = 1 << 20;
+        static constexpr size_t DEFAULT_OLD_LIMIT = 8 << 20;
+
+    private :
+        char* nursery;
+        size_t nurserySize;
+        uint64_t base;   // position of nursery byte 0 , the cursor at the last minor collection
+        uint64_t cursor; // position of the next free nursery byte
+        std::vector<StringObject*> old;
+        size_t oldBytes;
+        size_t oldLimit; // the old generation size that triggers a major collection
+        size_t minOldLimit;
+        HeapStats counters;
+
+        bool inNursery(const StringObject* s) const {
+            return reinterpret_cast<const char*>(s) >= nursery && reinterpret_cast<const char*>(s) < nursery + nurserySize;
+        }
+        StringObject* allocateOld(size_t size);
+        void minor(Value* roots , size_t count);
+        void major(Value* roots , size_t count);
+
+    public :
+        explicit Heap(size_t nurseryBytes = DEFAULT_NURSERY , size_t oldLimit = DEFAULT_OLD_LIMIT);
+        ~Heap();
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        // Start of a region opened now
+        uint64_t mark() const { return cursor; }
+        // Whether anything was allocated , and kept , since `mark`
+        bool allocatedSince(uint64_t mark) const { return cursor != mark; }
+        // Drop the region above `mark` , moving `result` down into the one
+        // below when it lives there
+        void release(uint64_t mark , Value& result);
+
+        // Whether a string of `length` bytes needs a collection before concat()
+        bool full(size_t length) const;
+        // x followed by y , in the current region unless short or large
+        Value concat(std::string_view x , std::string_view y);
+        // Make room for a string of `length` bytes : a minor collection , then
+        // a major one if the old generation would pass its limit
+        void collect(Value* roots , size_t count , size_t length);
+
+        const HeapStats& stats() const { return counters; }
+};
+
+#endif // HEAP_H
@@ -0,0 +1,276 @@
+#include "Incremental.h"
+#include "Lexer.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// Byte span of a token in the source , string literals include their quotes.
+// `size` is the length of the source the token was lexed from.
+size_t spanStart(const TokenStream& tokens , size_t i) {
+    return tokens.offset(i) - (tokens.kind(i) == TokenType::STRING_LITERAL ? 1 : 0);
+}
+
+size_t spanEnd(const TokenStream& tokens , size_t i , size_t size) {
+    size_t end = tokens.offset(i) + tokens.length(i) + (tokens.kind(i) == TokenType::STRING_LITERAL ? 1 : 0);
+    return std::min(end , size);
+}
+
+// Line the lexer is on once past token i : a string literal is on the line
+// it opens on , the newlines inside it come after
+int lineAfter(const TokenStream& tokens , size_t i , std::string_view text) {
+    if(tokens.kind(i) != TokenType::STRING_LITERAL) return tokens.line(i);
+    auto begin = text.begin() + tokens.offset(i);
+    return tokens.line(i) + static_cast<int>(std::count(begin , begin + tokens.length(i) , '\n'));
+}
+
+// Dead arena bytes tolerated before an edit compacts by re-parsing everything
+constexpr size_t COMPACT_SLACK = 1 << 20;
+
+// A kept function below an edit that added or removed lines : move its nodes
+// by `delta` lines , walking with an explicit stack like the parser
+void shiftLines(FunctionDecl* fn , int delta) {
+    fn->line += delta;
+    std::vector<ASTNode*> stack(fn->body.begin() , fn->body.end());
+    while(!stack.empty()) {
+        ASTNode* node = stack.back();
+        stack.pop_back();
+        node->line += delta;
+        switch(node->kind) {
+            case AstKind::UNARY : stack.push_back(static_cast<UnaryExpr*>(node)->operand); break;
+            case AstKind::BINARY : {
+                auto bin = static_cast<BinaryExpr*>(node);
+                stack.push_back(bin->left);
+                stack.push_back(bin->right);
+                break;
+            }
+            case AstKind::CALL : {
+                auto call = static_cast<CallExpr*>(node);
+                stack.push_back(call->callee);
+                stack.insert(stack.end() , call->arguments.begin() , call->arguments.end());
+                break;
+            }
+            case AstKind::LET : stack.push_back(static_cast<LetStatement*>(node)->value); break;
+            case AstKind::VAR : stack.push_back(static_cast<VarStatement*>(node)->value); break;
+            case AstKind::ASSIGN : stack.push_back(static_cast<AssignStatement*>(node)->value); break;
+            case AstKind::RETURN : stack.push_back(static_cast<ReturnStatement*>(node)->value); break;
+            case AstKind::IF : {
+                auto stmt = static_cast<IfStatement*>(node);
+                stack.push_back(stmt->condition);
+                stack.insert(stack.end() , stmt->thenBranch.begin() , stmt->thenBranch.end());
+                stack.insert(stack.end() , stmt->elseBranch.begin() , stmt->elseBranch.end());
+                break;
+            }
+            case AstKind::WHILE : {
+                auto stmt = static_cast<WhileStatement*>(node);
+                stack.push_back(stmt->condition);
+                stack.insert(stack.end() , stmt->body.begin() , stmt->body.end());
+                break;
+            }
+            case AstKind::FOR : {
+                auto stmt = static_cast<ForStatement*>(node);
+                stack.push_back(stmt->iterable);
+                stack.insert(stack.end() , stmt->body.begin() , stmt->body.end());
+                break;
+            }
+            case AstKind::MATCH : {
+                auto stmt = static_cast<MatchStatement*>(node);
+                stack.push_back(stmt->expr);
+                for(const MatchArm& arm : stmt->arms) {
+                    stack.push_back(arm.pattern);
+                    stack.insert(stack.end() , arm.body.begin() , arm.body.end());
+                }
+                break;
+            }
+            default : break;
+        }
+    }
+}
+
+} // namespace
+
+bool relex(TokenStream& tokens , std::string_view newText , const TextEdit& edit , TokenDamage& damage) {
+    if(newText.size() > UINT32_MAX) return false;
+    size_t oldSize = newText.size() - edit.inserted.size() + edit.removed;
+
+    // First token whose lexing looked at a byte at or past the edit. A
+    // token reads one byte past its end to find where it stops.
+    size_t lo = 0 , hi = tokens.size();
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(spanEnd(tokens , mid , oldSize) < edit.offset) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t first = lo;
+
+    Lexer lexer(newText);
+    lexer.reset(first > 0 ? spanEnd(tokens , first - 1 , oldSize) : 0 , first > 0 ? lineAfter(tokens , first - 1 , newText) : 1);
+
+    size_t insertedEnd = edit.offset + edit.inserted.size();
+    uint32_t offsetDelta = static_cast<uint32_t>(edit.inserted.size() - edit.removed); // wraps for deletions
+    TokenStream fresh(newText);
+    size_t resume = tokens.size(); // first old token kept unchanged
+    int lineDelta = 0;
+    size_t k = first;
+    while(!lexer.atEnd()) {
+        Token tok = lexer.next();
+        if(tok.type != TokenType::END_OF_FILE) {
+            size_t start = static_cast<size_t>(tok.value.data() - newText.data())
+                         - (tok.type == TokenType::STRING_LITERAL ? 1 : 0);
+            if(start >= insertedEnd) {
+                // Same byte , same text from here on : the old tokens are still valid
+                size_t oldStart = start - edit.inserted.size() + edit.removed;
+                while(k < tokens.size() && spanStart(tokens , k) < oldStart) k++;
+                if(k < tokens.size() && spanStart(tokens , k) == oldStart && tokens.kind(k) == tok.type) {
+                    resume = k;
+                    lineDelta = tok.line - tokens.line(k);
+                    break;
+                }
+            }
+        }
+        lexer.append(fresh , tok);
+    }
+    if(resume == tokens.size()) {
+        fresh.push(TokenType::END_OF_FILE , static_cast<uint32_t>(newText.size()) , 0 , lexer.currentLine());
+    }
+
+    tokens.replace(first , resume - first , fresh , offsetDelta , lineDelta);
+    damage = TokenDamage{first , resume - first , fresh.size() , lineDelta};
+    return true;
+}
+
+IncrementalDocument::IncrementalDocument(std::string source) : text(std::move(source)) , liveBytes(0) {
+    Lexer lexer(text);
+    tokens = lexer.tokenize();
+    parseAll();
+}
+
+void IncrementalDocument::parseAll() {
+    program = Program();
+    ranges = findFunctionBoundaries(tokens);
+    nodeBytes.clear();
+    rangeErrors.clear();
+    liveBytes = 0;
+    for(const auto& range : ranges) {
+        size_t before = program.arena.bytesUsed();
+        Parser parser(tokens , range.first , range.second);
+        FunctionDecl* fn;
+        if(!parser.parseSingleFunction(program.arena , fn)) {
+            ranges.clear();
+            break;
+        }
+        program.functions.push_back(fn);
+        rangeErrors.push_back(parser.errors());
+        nodeBytes.push_back(program.arena.bytesUsed() - before);
+        liveBytes += nodeBytes.back();
+    }
+    if(ranges.empty()) {
+        // Empty source , unbalanced braces or a range the parser did not end
+        // on : the sequential parser recovers and reports , and every edit
+        // re-parses until the functions split cleanly again
+        program = Program();
+        nodeBytes.clear();
+        rangeErrors.clear();
+        liveBytes = 0;
+        Parser parser(tokens , 0 , tokens.size());
+        program = parser.parseProgram();
+        return;
+    }
+    collectErrors();
+}
+
+void IncrementalDocument::collectErrors() {
+    program.errors.clear();
+    for(const std::vector<ParseError>& errors : rangeErrors) appendErrors(program.errors , errors);
+}
+
+bool IncrementalDocument::apply(const TextEdit& edit , EditStats& stats) {
+    if(edit.offset > text.size() || edit.removed > text.size() - edit.offset) return false;
+    if(text.size() - edit.removed + edit.inserted.size() > UINT32_MAX) return false;
+    text.replace(edit.offset , edit.removed , edit.inserted);
+    TokenDamage damage;
+    relex(tokens , text , edit , damage); // cannot fail , the size is checked above
+
+    stats = EditStats{damage.newCount , 0 , 0 , false};
+    auto reparseAll = [&]() {
+        parseAll();
+        stats.functionsReparsed = program.functions.size();
+        stats.functionsReused = 0;
+        stats.fullReparse = true;
+        return true;
+    };
+    if(ranges.empty()) return reparseAll();
+
+    // Old functions [i , j) overlap the damage. Re-scan the new stream from
+    // the start of function i until a boundary past the damage lines up
+    // with an old function start , which also catches merged or split functions.
+    long shift = static_cast<long>(damage.newCount) - static_cast<long>(damage.oldCount);
+    size_t m = ranges.size();
+    size_t i = 0;
+    // A range also reads the token just past it , a 'fn' there closes its blocks
+    while(i < m && ranges[i].second < damage.first) i++;
+    size_t pos = i < m ? ranges[i].first : ranges[m - 1].second;
+    size_t damageEnd = damage.first + damage.newCount;
+
+    std::vector<std::pair<size_t , size_t>> fresh;
+    size_t j = m;
+    while(pos < tokens.size() && tokens.kind(pos) != TokenType::END_OF_FILE) {
+        if(pos >= damageEnd) {
+            size_t oldPos = static_cast<size_t>(static_cast<long>(pos) - shift);
+            auto it = std::lower_bound(ranges.begin() + i , ranges.end() , oldPos ,
+                [](const std::pair<size_t , size_t>& r , size_t p) { return r.first < p; });
+            if(it != ranges.end() && it->first == oldPos) {
+                j = static_cast<size_t>(it - ranges.begin());
+                break;
+            }
+        }
+        size_t end = functionEnd(tokens , pos);
+        if(end == 0) return reparseAll();
+        fresh.emplace_back(pos , end);
+        pos = end;
+    }
+
+    std::vector<FunctionDecl*> parsed;
+    std::vector<size_t> parsedBytes;
+    std::vector<std::vector<ParseError>> parsedErrors;
+    for(const auto& range : fresh) {
+        size_t before = program.arena.bytesUsed();
+        Parser parser(tokens , range.first , range.second);
+        FunctionDecl* fn;
+        if(!parser.parseSingleFunction(program.arena , fn)) return reparseAll();
+        parsed.push_back(fn);
+        parsedErrors.push_back(parser.errors());
+        parsedBytes.push_back(program.arena.bytesUsed() - before);
+        liveBytes += parsedBytes.back();
+    }
+    for(size_t f = i; f < j; f++) liveBytes -= nodeBytes[f];
+    // Functions past the damage keep their nodes , their lines move with the tokens
+    for(size_t f = j; f < m && damage.lineDelta != 0; f++) {
+        if(program.functions[f]) shiftLines(program.functions[f] , damage.lineDelta);
+        for(ParseError& error : rangeErrors[f]) error.line += damage.lineDelta;
+    }
+    for(size_t f = j; f < m; f++) {
+        ranges[f].first = static_cast<size_t>(static_cast<long>(ranges[f].first) + shift);
+        ranges[f].second = static_cast<size_t>(static_cast<long>(ranges[f].second) + shift);
+    }
+
+    program.functions.erase(program.functions.begin() + i , program.functions.begin() + j);
+    program.functions.insert(program.functions.begin() + i , parsed.begin() , parsed.end());
+    ranges.erase(ranges.begin() + i , ranges.begin() + j);
+    ranges.insert(ranges.begin() + i , fresh.begin() , fresh.end());
+    nodeBytes.erase(nodeBytes.begin() + i , nodeBytes.begin() + j);
+    nodeBytes.insert(nodeBytes.begin() + i , parsedBytes.begin() , parsedBytes.end());
+    rangeErrors.erase(rangeErrors.begin() + i , rangeErrors.begin() + j);
+    rangeErrors.insert(rangeErrors.begin() + i , parsedErrors.begin() , parsedErrors.end());
+
+    size_t arenaBytes = program.arena.bytesUsed();
+    for(const AstArena& arena : program.workerArenas) arenaBytes += arena.bytesUsed();
+    if(arenaBytes > 2 * liveBytes + COMPACT_SLACK) return reparseAll();
+    collectErrors();
+
+    stats.functionsReparsed = parsed.size();
+    stats.functionsReused = program.functions.size() - parsed.size();
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "AST.h"
+#include "Token.h"
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Replace source[offset , offset + removed) with `inserted`
+struct TextEdit {
+    size_t offset;
+    size_t removed;
+    std::string inserted;
+};
+
+// Old tokens [first , first + oldCount) became new tokens [first , first + newCount) ,
+// the tokens after them moved by `lineDelta` lines
+struct TokenDamage {
+    size_t first;
+    size_t oldCount;
+    size_t newCount;
+    int lineDelta;
+};
+
+// Re-lex `newText` , which is the source of `tokens` with `edit` applied ,
+// and patch `tokens` in place to match it. Lexing restarts at the last token
+// boundary before the edit and stops as soon as it lands on the start of an
+// old token past the edit , the tokens after that keep their slots with
+// offsets and lines shifted. The result is identical to Lexer(newText).tokenize().
+// False , with `tokens` untouched , when `newText` is too large for 32-bit offsets.
+bool relex(TokenStream& tokens , std::string_view newText , const TextEdit& edit , TokenDamage& damage);
+
+// A parsed source kept up to date across edits. Only the functions whose
+// tokens changed are re-parsed , every other FunctionDecl keeps its node.
+// Replaced functions stay in the arena until the dead bytes outweigh the
+// live ones , then the next edit re-parses the whole document to compact it.
+class IncrementalDocument {
+    public :
+        struct EditStats {
+            size_t tokensRelexed;
+            size_t functionsReparsed;
+            size_t functionsReused;
+            bool fullReparse;
+        };
+
+    private :
+        std::string text;
+        TokenStream tokens;
+        Program program;
+        std::vector<std::pair<size_t , size_t>> ranges; // token range of each function
+        std::vector<size_t> nodeBytes;                  // arena bytes of each function
+        std::vector<std::vector<ParseError>> rangeErrors; // syntax errors of each function
+        size_t liveBytes;
+
+        void parseAll();
+        void collectErrors();
+
+    public :
+        explicit IncrementalDocument(std::string source);
+        IncrementalDocument(const IncrementalDocument&) = delete;
+        IncrementalDocument& operator=(const IncrementalDocument&) = delete;
+
+        // False , with the document untouched , when the edit reaches past the
+        // end of the source or the result is too large for 32-bit offsets
+        bool apply(const TextEdit& edit , EditStats& stats);
+
+        const std::string& source() const { return text; }
+        const TokenStream& tokenStream() const { return tokens; }
+        const Program& ast() const { return program; }
+};
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,135 @@
+#include "Interner.h"
+#include <cstring>
+
+Interner::Shard::~Shard() {
+    for(std::atomic<std::string_view*>& page : pages) delete[] page.load();
+    for(char* block : textBlocks) delete[] block;
+}
+
+std::string_view Interner::Shard::store(std::string_view text) {
+    if(text.empty()) return std::string_view();
+    if(text.size() > remaining) {
+        // Long literals get a block of their own , the current block keeps filling
+        size_t size = text.size() > TEXT_BLOCK / 4 ? text.size() : TEXT_BLOCK;
+        char* block = new char[size];
+        textBlocks.push_back(block);
+        textReserved += size;
+        if(size != TEXT_BLOCK) {
+            std::memcpy(block , text.data() , text.size());
+            return std::string_view(block , text.size());
+        }
+        cursor = block;
+        remaining = size;
+    }
+    char* out = cursor;
+    std::memcpy(out , text.data() , text.size());
+    cursor += text.size();
+    remaining -= text.size();
+    return std::string_view(out , text.size());
+}
+
+void Interner::Shard::rehash() {
+    std::vector<uint64_t> old(slots.empty() ? 256 : slots.size() * 2 , 0);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for(uint64_t slot : old) {
+        if(slot == 0) continue;
+        size_t i = (slot >> 32) & mask;
+        while(slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+// FNV-1a , identifiers are short so a byte loop is as fast as anything wider
+uint32_t Interner::hash(std::string_view text) {
+    uint32_t h = 2166136261u;
+    for(char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+SymbolId Interner::intern(std::string_view text) {
+    uint32_t h = hash(text);
+    // Low bits pick the slot , high bits pick the shard
+    unsigned shardIndex = h >> (32 - SHARD_BITS);
+    Shard& shard = shards[shardIndex];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if((shard.count + 1) * 4 > shard.slots.size() * 3) shard.rehash();
+
+    size_t mask = shard.slots.size() - 1;
+    size_t i = h & mask;
+    while(shard.slots[i] != 0) {
+        uint64_t slot = shard.slots[i];
+        if(static_cast<uint32_t>(slot >> 32) == h) {
+            uint32_t local = static_cast<uint32_t>(slot) - 1;
+            if(entry(shard , local) == text) return (local << SHARD_BITS) | shardIndex;
+        }
+        i = (i + 1) & mask;
+    }
+
+    uint32_t local = static_cast<uint32_t>(shard.count);
+    size_t page = local >> PAGE_BITS;
+    if(page >= MAX_PAGES) return NO_SYMBOL;
+    std::string_view* entries = shard.pages[page].load(std::memory_order_relaxed);
+    if(!entries) {
+        entries = new std::string_view[PAGE_SIZE];
+        shard.pages[page].store(entries , std::memory_order_release);
+    }
+    entries[local & (PAGE_SIZE - 1)] = shard.store(text);
+    shard.slots[i] = (uint64_t(h) << 32) | (local + 1);
+    shard.count++;
+    return (local << SHARD_BITS) | shardIndex;
+}
+
+SymbolId Interner::find(std::string_view text) const {
+    uint32_t h = hash(text);
+    unsigned shardIndex = h >> (32 - SHARD_BITS);
+    const Shard& shard = shards[shardIndex];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if(shard.slots.empty()) return NO_SYMBOL;
+    size_t mask = shard.slots.size() - 1;
+    for(size_t i = h & mask; shard.slots[i] != 0; i = (i + 1) & mask) {
+        uint64_t slot = shard.slots[i];
+        if(static_cast<uint32_t>(slot >> 32) == h) {
+            uint32_t local = static_cast<uint32_t>(slot) - 1;
+            if(entry(shard , local) == text) return (local << SHARD_BITS) | shardIndex;
+        }
+    }
+    return NO_SYMBOL;
+}
+
+size_t Interner::size() const {
+    size_t total = 0;
+    for(const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.count;
+    }
+    return total;
+}
+
+size_t Interner::memoryUsage() const {
+    size_t total = 0;
+    for(const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.slots.capacity() * sizeof(uint64_t);
+        total += ((shard.count + PAGE_SIZE - 1) >> PAGE_BITS) * PAGE_SIZE * sizeof(std::string_view);
+        total += shard.textReserved;
+    }
+    return total;
+}
+
+Interner& symbols() {
+    // Never destroyed , views may outlive static teardown. The names the parser
+    // makes up itself are in from the start , a full table never refuses them.
+    static Interner* interner = [] {
+        Interner* table = new Interner();
+        table->intern("");
+        table->intern("_");
+        return table;
+    }();
+    return *interner;
+}
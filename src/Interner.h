@@ -0,0 +1,78 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Stable 32-bit handle for an interned identifier or string literal. Two
+// symbols are equal exactly when their texts are equal.
+using SymbolId = uint32_t;
+constexpr SymbolId NO_SYMBOL = UINT32_MAX;
+
+// Thread-safe string interner. The table is split into shards , each with its
+// own lock , hash index and text storage , so parallel lexer chunks rarely
+// contend. Interned text is never moved or freed : text() views stay valid for
+// the lifetime of the interner and lookups by id take no lock.
+class Interner {
+    public :
+        static constexpr unsigned SHARD_BITS = 4;
+        static constexpr unsigned SHARDS = 1u << SHARD_BITS;
+
+    private :
+        static constexpr unsigned PAGE_BITS = 12;
+        static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;  // entries per page
+        static constexpr size_t MAX_PAGES = 4096;                      // 16M symbols per shard
+        static constexpr size_t TEXT_BLOCK = 64 * 1024;
+
+        struct Shard {
+            mutable std::mutex mutex;
+            // Open addressing : (hash << 32) | (local index + 1) , 0 marks an empty slot
+            std::vector<uint64_t> slots;
+            size_t count = 0;
+            std::atomic<std::string_view*> pages[MAX_PAGES] = {};
+            std::vector<char*> textBlocks;
+            char* cursor = nullptr;
+            size_t remaining = 0;
+            size_t textReserved = 0;
+
+            ~Shard();
+            std::string_view store(std::string_view text);
+            void rehash();
+        };
+
+        Shard shards[SHARDS];
+
+        static uint32_t hash(std::string_view text);
+        std::string_view entry(const Shard& shard , uint32_t local) const {
+            return shard.pages[local >> PAGE_BITS].load(std::memory_order_acquire)[local & (PAGE_SIZE - 1)];
+        }
+
+    public :
+        Interner() = default;
+        Interner(const Interner&) = delete;
+        Interner& operator=(const Interner&) = delete;
+
+        // NO_SYMBOL when `text` is new and its shard already holds 16M names
+        SymbolId intern(std::string_view text);
+        // Id of `text` if it was ever interned , NO_SYMBOL otherwise. Adds nothing.
+        SymbolId find(std::string_view text) const;
+        std::string_view text(SymbolId id) const {
+            return entry(shards[id & (SHARDS - 1)] , id >> SHARD_BITS);
+        }
+
+        size_t size() const;
+        // Bytes held by hash indexes , entry pages and text blocks
+        size_t memoryUsage() const;
+};
+
+// Process-wide interner used by the lexer and every AST
+Interner& symbols();
+
+// Shorthand for symbols().text(id)
+inline std::string_view symbolText(SymbolId id) { return symbols().text(id); }
+
+#endif // INTERNER_H
@@ -0,0 +1,783 @@
+#include "Jit.h"
+#include "X64Assembler.h"
+#include <cmath>
+#include <csetjmp>
+#include <cstring>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define STRYX_JIT_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define STRYX_JIT_X64 0
+#endif
+
+using namespace x64;
+
+namespace {
+
+enum class Num : uint8_t { INT , FLOAT };
+
+constexpr size_t MAX_SIGNATURE = 64;              // parameters , one signature bit each
+constexpr size_t NATIVE_STACK_BYTES = size_t(1) << 20;
+constexpr int MAX_ATTEMPTS = 4;                   // retries after a wrong recursive result guess
+
+// Locals of type int live in callee-saved registers while they last , so
+// they survive calls without spilling
+constexpr Reg SAVED[] = {RBX , R12 , R13 , R14 , R15};
+constexpr int SAVED_COUNT = 5;
+
+// Native code checks rsp against this in every prologue and bails out below it
+uintptr_t stackLimit = 0;
+jmp_buf bailout;
+
+enum Bailout { DIVIDE_BY_ZERO = 1 , STACK_EXHAUSTED };
+
+[[noreturn]] void divideByZero() { longjmp(bailout , DIVIDE_BY_ZERO); }
+[[noreturn]] void stackExhausted() { longjmp(bailout , STACK_EXHAUSTED); }
+
+double floatMod(double x , double y) { return std::fmod(x , y); }
+
+uint64_t bitsOf(double d) {
+    uint64_t bits;
+    std::memcpy(&bits , &d , sizeof(bits));
+    return bits;
+}
+
+bool alwaysReturns(const AstList<Statement*>& body) {
+    if(body.empty()) return false;
+    const Statement* last = body[body.size() - 1];
+    if(last->kind == AstKind::RETURN) return true;
+    if(last->kind != AstKind::IF) return false;
+    auto branch = static_cast<const IfStatement*>(last);
+    return alwaysReturns(branch->thenBranch) && alwaysReturns(branch->elseBranch);
+}
+
+bool isComparison(Op op) {
+    return op == Op::EQ || op == Op::NE || op == Op::LT || op == Op::LE || op == Op::GT || op == Op::GE;
+}
+
+Cond intCond(Op op) {
+    switch(op) {
+        case Op::EQ : return E;
+        case Op::NE : return NE;
+        case Op::LT : return L;
+        case Op::LE : return LE;
+        case Op::GT : return G;
+        default : return GE;
+    }
+}
+
+} // namespace
+
+// ---- One compilation request : the root variant and every callee it pulls in ----
+// Nothing becomes visible to the VM unless the whole set compiles.
+class Jit::Session {
+    public :
+        enum class Status { OK , RETRY , REJECT };
+
+        struct Pending {
+            uint32_t index;
+            uint64_t signature;
+            NativeFn* slot;
+            bool hasResult = false;
+            bool floatResult = false;
+            bool assumed = false; // result type guessed for a recursive call before any return was seen
+            std::vector<uint8_t> code;
+        };
+
+        struct Target {
+            NativeFn* slot;
+            bool floatResult;
+        };
+
+        Jit& jit;
+        Status status = Status::OK;
+        std::vector<std::unique_ptr<Pending>> pending;
+        std::vector<std::pair<uint32_t , uint64_t>> rejected;
+
+        explicit Session(Jit& jit) : jit(jit) {}
+
+        // Native entry of function `index` for `signature` , compiling it when needed
+        bool require(uint32_t index , uint64_t signature , Target& out);
+
+        void reject(const Pending& p) {
+            if(status == Status::OK) status = Status::REJECT;
+            rejected.emplace_back(p.index , p.signature);
+        }
+
+        void retry(const Pending& p , bool floatResult) {
+            if(status == Status::OK) status = Status::RETRY;
+            jit.floatHints[{p.index , p.signature}] = floatResult;
+        }
+
+        // Copy every pending variant into executable memory and publish it
+        bool install();
+};
+
+// ---- Code generation for one variant ----
+// Values are computed in rax (int) or xmm0 (float) , a binary operator's
+// right operand goes to rcx or xmm1. Temporaries and float locals live in
+// 8-byte slots addressed from rsp , which stays 16-byte aligned in the body.
+class Jit::FunctionJit {
+    private :
+        struct Home {
+            Num type;
+            bool inReg;
+            Reg reg;
+            int32_t disp;
+        };
+
+        Session& session;
+        Session::Pending& self;
+        const FunctionDecl* decl;
+        Assembler a;
+        std::vector<Home> homes;    // by frame slot
+        std::vector<int> tempSlots; // slot per expression depth
+        std::vector<size_t> exits;  // returns , jumping to the epilogue
+        int slots = 0;
+        int regsInUse = 0;
+        int regsSaved = 0;
+
+        bool unsupported() {
+            session.reject(self);
+            return false;
+        }
+
+        int32_t temp(int depth) {
+            while(static_cast<int>(tempSlots.size()) <= depth) tempSlots.push_back(slots++);
+            return 8 * tempSlots[depth];
+        }
+
+        const Home& home(const VarRef& ref) const { return homes[ref.slot]; }
+
+        const Home& declare(uint16_t slot , Num type) {
+            Home h{type , false , RAX , 0};
+            if(type == Num::INT && regsInUse < SAVED_COUNT) {
+                h.inReg = true;
+                h.reg = SAVED[regsInUse++];
+                if(regsInUse > regsSaved) regsSaved = regsInUse;
+            } else {
+                h.disp = 8 * slots++;
+            }
+            homes[slot] = h;
+            return homes[slot];
+        }
+
+        void callHelper(const void* fn) {
+            a.mov(RAX , static_cast<int64_t>(reinterpret_cast<uintptr_t>(fn)));
+            a.call(RAX);
+        }
+
+        void storeHome(const Home& h);
+        void loadHome(const Home& h , bool second);
+        void loadNumber(const Value& v , bool second);
+        bool leafType(const Expression* expr , Num& type) const;
+        void loadLeaf(const Expression* expr);
+
+        // Jumps taken when the value in rax / xmm0 is truthy (or falsy)
+        void truthJumps(Num type , bool whenTrue , std::vector<size_t>& jumps);
+
+        bool genExpr(const Expression* expr , int depth , Num& type);
+        bool genOperands(const BinaryExpr* bin , int depth , Num& left , Num& right);
+        bool genNot(const UnaryExpr* un , int depth , Num& type);
+        bool genBinary(const BinaryExpr* bin , int depth , Num& type);
+        bool genCall(const CallExpr* call , int depth , Num& type);
+        bool genBranchFalse(const Expression* cond , std::vector<size_t>& jumps);
+        bool genStatement(const Statement* stmt);
+        bool genBlock(const AstList<Statement*>& body);
+
+    public :
+        FunctionJit(Session& session , Session::Pending& self , const FunctionDecl* decl)
+            : session(session) , self(self) , decl(decl) {}
+
+        bool compile();
+};
+
+void Jit::FunctionJit::storeHome(const Home& h) {
+    if(h.type == Num::FLOAT) a.movsd(RSP , h.disp , XMM0);
+    else if(h.inReg) a.mov(h.reg , RAX);
+    else a.store(RSP , h.disp , RAX);
+}
+
+// Into rax / xmm0 , or rcx / xmm1 for the second operand
+void Jit::FunctionJit::loadHome(const Home& h , bool second) {
+    if(h.type == Num::FLOAT) a.movsd(second ? XMM1 : XMM0 , RSP , h.disp);
+    else if(h.inReg) a.mov(second ? RCX : RAX , h.reg);
+    else a.load(second ? RCX : RAX , RSP , h.disp);
+}
+
+void Jit::FunctionJit::loadNumber(const Value& v , bool second) {
+    Reg r = second ? RCX : RAX;
+    if(v.type == ValueType::INT) {
+        a.mov(r , v.i);
+    } else {
+        a.mov(r , static_cast<int64_t>(bitsOf(v.f)));
+        a.movq(second ? XMM1 : XMM0 , r);
+    }
+}
+
+// Numbers and variables load straight into the second operand , no spill needed
+bool Jit::FunctionJit::leafType(const Expression* expr , Num& type) const {
+    if(expr->kind == AstKind::NUMBER) {
+        type = static_cast<const NumberExpr*>(expr)->isFloat ? Num::FLOAT : Num::INT;
+        return true;
+    }
+    if(expr->kind == AstKind::VARIABLE) {
+        type = home(static_cast<const VariableExpr*>(expr)->ref).type;
+        return true;
+    }
+    return false;
+}
+
+void Jit::FunctionJit::loadLeaf(const Expression* expr) {
+    if(expr->kind == AstKind::NUMBER) {
+        auto num = static_cast<const NumberExpr*>(expr);
+        loadNumber(numberValue(num->value , num->isFloat) , true);
+    } else {
+        loadHome(home(static_cast<const VariableExpr*>(expr)->ref) , true);
+    }
+}
+
+void Jit::FunctionJit::truthJumps(Num type , bool whenTrue , std::vector<size_t>& jumps) {
+    if(type == Num::INT) {
+        a.test(RAX , RAX);
+        jumps.push_back(a.jcc(whenTrue ? NE : E));
+        return;
+    }
+    // NaN is truthy : unordered sets ZF and PF
+    a.xorpd(XMM1 , XMM1);
+    a.ucomisd(XMM0 , XMM1);
+    if(whenTrue) {
+        jumps.push_back(a.jcc(P));
+        jumps.push_back(a.jcc(NE));
+    } else {
+        size_t nan = a.jcc(P);
+        jumps.push_back(a.jcc(E));
+        a.bind(nan);
+    }
+}
+
+bool Jit::FunctionJit::genExpr(const Expression* expr , int depth , Num& type) {
+    switch(expr->kind) {
+        case AstKind::NUMBER : {
+            auto num = static_cast<const NumberExpr*>(expr);
+            Value v = numberValue(num->value , num->isFloat);
+            loadNumber(v , false);
+            type = v.type == ValueType::INT ? Num::INT : Num::FLOAT;
+            return true;
+        }
+        case AstKind::VARIABLE : {
+            const Home& h = home(static_cast<const VariableExpr*>(expr)->ref);
+            loadHome(h , false);
+            type = h.type;
+            return true;
+        }
+        case AstKind::UNARY : return genNot(static_cast<const UnaryExpr*>(expr) , depth , type);
+        case AstKind::BINARY : return genBinary(static_cast<const BinaryExpr*>(expr) , depth , type);
+        case AstKind::CALL : return genCall(static_cast<const CallExpr*>(expr) , depth , type);
+        default : return unsupported(); // strings
+    }
+}
+
+// 1 for 0 or 0.0 , else 0 : NaN is truthy , so a float needs ZF set and PF clear
+bool Jit::FunctionJit::genNot(const UnaryExpr* un , int depth , Num& type) {
+    if(un->op != TokenType::NOT) return unsupported();
+    Num operand;
+    if(!genExpr(un->operand , depth , operand)) return false;
+    if(operand == Num::INT) {
+        a.test(RAX , RAX);
+        a.setcc(E , RAX);
+    } else {
+        a.xorpd(XMM1 , XMM1);
+        a.ucomisd(XMM0 , XMM1);
+        a.setcc(E , RAX);
+        a.setcc(NP , RCX);
+        a.andByte(RAX , RCX);
+    }
+    a.movzxByte(RAX , RAX);
+    type = Num::INT;
+    return true;
+}
+
+// Leaves int operands in rax and rcx , otherwise both as doubles in xmm0 and xmm1
+bool Jit::FunctionJit::genOperands(const BinaryExpr* bin , int depth , Num& left , Num& right) {
+    if(leafType(bin->right , right)) {
+        if(!genExpr(bin->left , depth , left)) return false;
+        loadLeaf(bin->right);
+    } else {
+        if(!genExpr(bin->left , depth , left)) return false;
+        int32_t spill = temp(depth);
+        if(left == Num::INT) a.store(RSP , spill , RAX);
+        else a.movsd(RSP , spill , XMM0);
+        if(!genExpr(bin->right , depth + 1 , right)) return false;
+        if(right == Num::INT) a.mov(RCX , RAX);
+        else a.movsd(XMM1 , XMM0);
+        if(left == Num::INT) a.load(RAX , RSP , spill);
+        else a.movsd(XMM0 , RSP , spill);
+    }
+    // Mixed operands compute in double , like the VM
+    if(left != right) {
+        if(left == Num::INT) a.cvtsi2sd(XMM0 , RAX);
+        else a.cvtsi2sd(XMM1 , RCX);
+    }
+    return true;
+}
+
+bool Jit::FunctionJit::genBinary(const BinaryExpr* bin , int depth , Num& type) {
+    if(bin->op == TokenType::AND || bin->op == TokenType::OR) {
+        // The deciding operand is the result , so both sides must agree on a type
+        Num left , right;
+        if(!genExpr(bin->left , depth , left)) return false;
+        std::vector<size_t> decided;
+        truthJumps(left , bin->op == TokenType::OR , decided);
+        if(!genExpr(bin->right , depth , right)) return false;
+        if(right != left) return unsupported();
+        for(size_t at : decided) a.bind(at);
+        type = left;
+        return true;
+    }
+
+    Op op;
+    if(!binaryOp(bin->op , op)) return unsupported();
+    Num left , right;
+    if(!genOperands(bin , depth , left , right)) return false;
+
+    if(left == Num::INT && right == Num::INT) {
+        type = Num::INT;
+        switch(op) {
+            case Op::ADD : a.add(RAX , RCX); return true;
+            case Op::SUB : a.sub(RAX , RCX); return true;
+            case Op::MUL : a.imul(RAX , RCX); return true;
+            case Op::XOR : a.xor_(RAX , RCX); return true;
+            case Op::DIV :
+            case Op::MOD : {
+                // Division by zero goes back to the interpreter , which reports it
+                a.test(RCX , RCX);
+                size_t nonZero = a.jcc(NE);
+                callHelper(reinterpret_cast<const void*>(&divideByZero));
+                a.bind(nonZero);
+                // idiv faults on INT64_MIN / -1 , the VM wraps instead
+                a.cmp(RCX , static_cast<int8_t>(-1));
+                size_t general = a.jcc(NE);
+                if(op == Op::DIV) a.neg(RAX);
+                else a.xor_(RAX , RAX);
+                size_t done = a.jmp();
+                a.bind(general);
+                a.cqo();
+                a.idiv(RCX);
+                if(op == Op::MOD) a.mov(RAX , RDX);
+                a.bind(done);
+                return true;
+            }
+            default :
+                a.cmp(RAX , RCX);
+                a.setcc(intCond(op) , RAX);
+                a.movzxByte(RAX , RAX);
+                return true;
+        }
+    }
+
+    type = Num::FLOAT;
+    switch(op) {
+        case Op::ADD : a.addsd(XMM0 , XMM1); return true;
+        case Op::SUB : a.subsd(XMM0 , XMM1); return true;
+        case Op::MUL : a.mulsd(XMM0 , XMM1); return true;
+        case Op::DIV : a.divsd(XMM0 , XMM1); return true;
+        case Op::MOD : callHelper(reinterpret_cast<const void*>(&floatMod)); return true;
+        case Op::XOR : return unsupported();
+        default : break;
+    }
+    // Comparisons : unordered (NaN) operands compare false , except for !=
+    type = Num::INT;
+    switch(op) {
+        case Op::EQ :
+            a.ucomisd(XMM0 , XMM1);
+            a.setcc(E , RAX);
+            a.setcc(NP , RCX);
+            a.andByte(RAX , RCX);
+            break;
+        case Op::NE :
+            a.ucomisd(XMM0 , XMM1);
+            a.setcc(NE , RAX);
+            a.setcc(P , RCX);
+            a.orByte(RAX , RCX);
+            break;
+        case Op::LT : a.ucomisd(XMM1 , XMM0); a.setcc(A , RAX); break;
+        case Op::LE : a.ucomisd(XMM1 , XMM0); a.setcc(AE , RAX); break;
+        case Op::GT : a.ucomisd(XMM0 , XMM1); a.setcc(A , RAX); break;
+        default : a.ucomisd(XMM0 , XMM1); a.setcc(AE , RAX); break;
+    }
+    a.movzxByte(RAX , RAX);
+    return true;
+}
+
+// Arguments are stored to a block of slots whose address is the callee's only parameter
+bool Jit::FunctionJit::genCall(const CallExpr* call , int depth , Num& type) {
+    if(call->callee->kind != AstKind::VARIABLE) return unsupported();
+    long index = session.jit.module.find(static_cast<const VariableExpr*>(call->callee)->name);
+    if(index < 0 || call->arguments.size() > MAX_SIGNATURE) return unsupported(); // print
+    int block = slots;
+    slots += static_cast<int>(call->arguments.size());
+
+    uint64_t signature = 0;
+    for(size_t i = 0; i < call->arguments.size(); i++) {
+        Num arg;
+        if(!genExpr(call->arguments[i] , depth , arg)) return false;
+        int32_t disp = 8 * (block + static_cast<int>(i));
+        if(arg == Num::INT) {
+            a.store(RSP , disp , RAX);
+        } else {
+            a.movsd(RSP , disp , XMM0);
+            signature |= uint64_t(1) << i;
+        }
+    }
+
+    Session::Target target;
+    if(!session.require(static_cast<uint32_t>(index) , signature , target)) return false;
+    a.lea(RDI , RSP , 8 * block);
+    a.mov(RAX , static_cast<int64_t>(reinterpret_cast<uintptr_t>(target.slot)));
+    a.callMem(RAX);
+    if(target.floatResult) {
+        a.movq(XMM0 , RAX);
+        type = Num::FLOAT;
+    } else {
+        type = Num::INT;
+    }
+    return true;
+}
+
+// Comparisons branch on the flags directly instead of materializing 0 / 1
+bool Jit::FunctionJit::genBranchFalse(const Expression* cond , std::vector<size_t>& jumps) {
+    Op op;
+    if(cond->kind == AstKind::BINARY && binaryOp(static_cast<const BinaryExpr*>(cond)->op , op) && isComparison(op)) {
+        Num left , right;
+        if(!genOperands(static_cast<const BinaryExpr*>(cond) , 0 , left , right)) return false;
+        if(left == Num::INT && right == Num::INT) {
+            a.cmp(RAX , RCX);
+            jumps.push_back(a.jcc(invert(intCond(op))));
+            return true;
+        }
+        switch(op) {
+            case Op::EQ :
+                a.ucomisd(XMM0 , XMM1);
+                jumps.push_back(a.jcc(NE));
+                jumps.push_back(a.jcc(P));
+                break;
+            case Op::NE : {
+                a.ucomisd(XMM0 , XMM1);
+                size_t nan = a.jcc(P);
+                jumps.push_back(a.jcc(E));
+                a.bind(nan);
+                break;
+            }
+            case Op::LT : a.ucomisd(XMM1 , XMM0); jumps.push_back(a.jcc(BE)); break;
+            case Op::LE : a.ucomisd(XMM1 , XMM0); jumps.push_back(a.jcc(B)); break;
+            case Op::GT : a.ucomisd(XMM0 , XMM1); jumps.push_back(a.jcc(BE)); break;
+            default : a.ucomisd(XMM0 , XMM1); jumps.push_back(a.jcc(B)); break;
+        }
+        return true;
+    }
+    Num type;
+    if(!genExpr(cond , 0 , type)) return false;
+    truthJumps(type , false , jumps);
+    return true;
+}
+
+// Registers of the block's variables are free again after it , like their slots
+bool Jit::FunctionJit::genBlock(const AstList<Statement*>& body) {
+    int savedRegs = regsInUse;
+    for(const Statement* stmt : body) {
+        if(!genStatement(stmt)) return false;
+    }
+    regsInUse = savedRegs;
+    return true;
+}
+
+bool Jit::FunctionJit::genStatement(const Statement* stmt) {
+    switch(stmt->kind) {
+        case AstKind::LET :
+        case AstKind::VAR : {
+            uint16_t slot;
+            const Expression* value;
+            if(stmt->kind == AstKind::LET) {
+                auto let = static_cast<const LetStatement*>(stmt);
+                slot = let->slot; value = let->value;
+            } else {
+                auto var = static_cast<const VarStatement*>(stmt);
+                slot = var->slot; value = var->value;
+            }
+            Num type;
+            if(!genExpr(value , 0 , type)) return false;
+            storeHome(declare(slot , type));
+            return true;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<const AssignStatement*>(stmt);
+            Num type;
+            if(!genExpr(assign->value , 0 , type)) return false;
+            const Home& h = home(assign->ref);
+            if(h.type != type) return unsupported(); // a local changing type
+            storeHome(h);
+            return true;
+        }
+        case AstKind::RETURN : {
+            Num type;
+            if(!genExpr(static_cast<const ReturnStatement*>(stmt)->value , 0 , type)) return false;
+            bool isFloat = type == Num::FLOAT;
+            if(!self.hasResult) {
+                self.hasResult = true;
+                self.floatResult = isFloat;
+            } else if(isFloat != self.floatResult) {
+                if(!self.assumed) return unsupported(); // returns both ints and floats
+                session.retry(self , isFloat);
+                return false;
+            }
+            if(isFloat) a.movq(RAX , XMM0);
+            exits.push_back(a.jmp());
+            return true;
+        }
+        case AstKind::IF : {
+            auto branch = static_cast<const IfStatement*>(stmt);
+            std::vector<size_t> skipThen;
+            if(!genBranchFalse(branch->condition , skipThen)) return false;
+            if(!genBlock(branch->thenBranch)) return false;
+            if(branch->elseBranch.empty()) {
+                for(size_t at : skipThen) a.bind(at);
+                return true;
+            }
+            size_t skipElse = a.jmp();
+            for(size_t at : skipThen) a.bind(at);
+            if(!genBlock(branch->elseBranch)) return false;
+            a.bind(skipElse);
+            return true;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<const WhileStatement*>(stmt);
+            size_t start = a.size();
+            std::vector<size_t> done;
+            if(!genBranchFalse(loop->condition , done)) return false;
+            if(!genBlock(loop->body)) return false;
+            a.jmp(start);
+            for(size_t at : done) a.bind(at);
+            return true;
+        }
+        default : return unsupported(); // for , match
+    }
+}
+
+bool Jit::FunctionJit::compile() {
+    // A path falling off the end returns nil , which native code cannot
+    if(decl->params.size() > MAX_SIGNATURE || !alwaysReturns(decl->body)) return unsupported();
+
+    // Arguments arrive as raw 64-bit values behind rdi , parameter i is slot i
+    homes.resize(decl->frameSlots);
+    for(size_t i = 0; i < decl->params.size(); i++) {
+        Num type = (self.signature >> i & 1) ? Num::FLOAT : Num::INT;
+        const Home& h = declare(static_cast<uint16_t>(i) , type);
+        if(h.inReg) {
+            a.load(h.reg , RDI , static_cast<int32_t>(8 * i));
+        } else {
+            a.load(RAX , RDI , static_cast<int32_t>(8 * i));
+            a.store(RSP , h.disp , RAX);
+        }
+    }
+    if(!genBlock(decl->body)) return false;
+
+    // The frame is sized now that every slot is known , keeping rsp 16-byte
+    // aligned in the body after the return address and the saved registers
+    int32_t frame = 8 * slots;
+    if((8 + 8 * regsSaved + frame) % 16 != 0) frame += 8;
+
+    for(size_t at : exits) a.bind(at);
+    a.addImm(RSP , frame);
+    for(int r = regsSaved; r-- > 0;) a.pop(SAVED[r]);
+    a.ret();
+
+    // Body jumps are relative and calls absolute , so the prologue can go in front
+    Assembler head;
+    for(int r = 0; r < regsSaved; r++) head.push(SAVED[r]);
+    head.subImm(RSP , frame);
+    head.mov(RAX , static_cast<int64_t>(reinterpret_cast<uintptr_t>(&stackLimit)));
+    head.cmp(RSP , RAX , 0);
+    size_t enough = head.jcc(AE);
+    head.mov(RAX , static_cast<int64_t>(reinterpret_cast<uintptr_t>(&stackExhausted)));
+    head.call(RAX);
+    head.bind(enough);
+
+    self.code = head.bytes();
+    self.code.insert(self.code.end() , a.bytes().begin() , a.bytes().end());
+    return true;
+}
+
+bool Jit::Session::require(uint32_t index , uint64_t signature , Target& out) {
+    const Variant& known = jit.variant(index , signature);
+    if(known.state == State::NATIVE) {
+        out = Target{known.slot , known.floatResult};
+        return true;
+    }
+    if(known.state == State::REJECTED) {
+        if(status == Status::OK) status = Status::REJECT;
+        return false;
+    }
+    for(const std::unique_ptr<Pending>& p : pending) {
+        if(p->index != index || p->signature != signature) continue;
+        // A recursive call before any return : guess , a wrong guess retries the session
+        if(!p->hasResult) {
+            auto hint = jit.floatHints.find({index , signature});
+            p->hasResult = true;
+            p->assumed = true;
+            p->floatResult = hint != jit.floatHints.end() && hint->second;
+        }
+        out = Target{p->slot , p->floatResult};
+        return true;
+    }
+
+    jit.slots.push_back(nullptr);
+    pending.push_back(std::make_unique<Pending>());
+    Pending& p = *pending.back();
+    p.index = index;
+    p.signature = signature;
+    p.slot = &jit.slots.back();
+    if(!FunctionJit(*this , p , jit.program.functions[index]).compile()) return false;
+    out = Target{p.slot , p.floatResult};
+    return true;
+}
+
+bool Jit::Session::install() {
+#if STRYX_JIT_X64
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    for(const std::unique_ptr<Pending>& p : pending) {
+        total = (total + 15) & ~size_t(15);
+        offsets.push_back(total);
+        total += p->code.size();
+    }
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t bytes = (total + page - 1) / page * page;
+    void* memory = mmap(nullptr , bytes , PROT_READ | PROT_WRITE , MAP_PRIVATE | MAP_ANONYMOUS , -1 , 0);
+    if(memory == MAP_FAILED) return false;
+    char* base = static_cast<char*>(memory);
+    for(size_t i = 0; i < pending.size(); i++) {
+        std::memcpy(base + offsets[i] , pending[i]->code.data() , pending[i]->code.size());
+    }
+    // Never writable and executable at the same time
+    if(mprotect(memory , bytes , PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory , bytes);
+        return false;
+    }
+    jit.regions.emplace_back(memory , bytes);
+
+    for(size_t i = 0; i < pending.size(); i++) {
+        const Pending& p = *pending[i];
+        *p.slot = reinterpret_cast<NativeFn>(base + offsets[i]);
+        Variant& v = jit.variant(p.index , p.signature);
+        v.state = State::NATIVE;
+        v.slot = p.slot;
+        v.floatResult = p.floatResult;
+        jit.counters.compiled++;
+    }
+    jit.counters.codeBytes += total;
+    return true;
+#else
+    return false;
+#endif
+}
+
+Jit::Jit(const Program& program , const Module& module , uint32_t hotCalls)
+    : program(program) , module(module) , hotCalls(hotCalls) , variants(program.functions.size()) {}
+
+Jit::~Jit() {
+#if STRYX_JIT_X64
+    for(const auto& region : regions) munmap(region.first , region.second);
+#endif
+}
+
+Jit::Variant& Jit::variant(uint32_t index , uint64_t signature) {
+    std::vector<Variant>& list = variants[index];
+    for(Variant& v : list) {
+        if(v.signature == signature) return v;
+    }
+    Variant v;
+    v.signature = signature;
+    list.push_back(v);
+    return list.back();
+}
+
+void Jit::compile(uint32_t index , uint64_t signature) {
+#if STRYX_JIT_X64
+    for(int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        Session session(*this);
+        Session::Target target;
+        if(session.require(index , signature , target)) {
+            if(session.install()) return;
+            break;
+        }
+        if(session.status == Session::Status::RETRY) continue;
+        for(const auto& key : session.rejected) {
+            Variant& v = variant(key.first , key.second);
+            if(v.state == State::COLD) {
+                v.state = State::REJECTED;
+                counters.rejected++;
+            }
+        }
+        break;
+    }
+#endif
+    Variant& v = variant(index , signature);
+    if(v.state == State::COLD) {
+        v.state = State::REJECTED;
+        counters.rejected++;
+    }
+}
+
+bool Jit::tryCall(uint32_t index , const Value* args , size_t argc , Value& result) {
+    if(argc > MAX_SIGNATURE) return false;
+    index = module.functions[index].source; // specializations share their function's variants
+    uint64_t signature = 0;
+    for(size_t i = 0; i < argc; i++) {
+        if(args[i].type == ValueType::FLOAT) signature |= uint64_t(1) << i;
+        else if(args[i].type != ValueType::INT) return false;
+    }
+    Variant* v = &variant(index , signature);
+    if(v->state == State::COLD) {
+        if(++v->calls < hotCalls) return false;
+        compile(index , signature);
+        v = &variant(index , signature);
+    }
+    if(v->state != State::NATIVE) return false;
+
+    return enter(*v , args , argc , result);
+}
+
+// Apart from tryCall so no local is reassigned after setjmp
+bool Jit::enter(Variant& v , const Value* args , size_t argc , Value& result) {
+    uint64_t raw[MAX_SIGNATURE];
+    for(size_t i = 0; i < argc; i++) {
+        raw[i] = args[i].type == ValueType::INT ? static_cast<uint64_t>(args[i].i) : bitsOf(args[i].f);
+    }
+    counters.nativeCalls++;
+
+    char marker;
+    stackLimit = reinterpret_cast<uintptr_t>(&marker) - NATIVE_STACK_BYTES;
+    int reason = setjmp(bailout);
+    if(reason != 0) {
+        counters.bailouts++;
+        // Recursion this deep would bail again on every interpreted level below
+        if(reason == STACK_EXHAUSTED) {
+            v.state = State::REJECTED;
+            counters.rejected++;
+        }
+        return false;
+    }
+    uint64_t bits = (*v.slot)(raw);
+    if(v.floatResult) {
+        double d;
+        std::memcpy(&d , &bits , sizeof(d));
+        result = Value::number(d);
+    } else {
+        result = Value::integer(static_cast<int64_t>(bits));
+    }
+    return true;
+}
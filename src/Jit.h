@@ -0,0 +1,81 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "AST.h"
+#include "Bytecode.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Native tier for hot numeric functions. A function is compiled straight from
+// its FunctionDecl to x86-64 machine code , once per argument signature (each
+// parameter int or float) , into mmap'd pages that are made executable only
+// after the code is written.
+//
+// Supported : let / var / assignment , binary operators , if , while , return
+// and calls to functions that are themselves supported. Every local keeps one
+// type , every path ends in a return and all returns agree on int or float.
+// Anything else - strings , print , for , match - keeps the function in the
+// interpreter , as do calls with non-numeric arguments.
+//
+// Such functions have no side effects , so native code that hits an integer
+// division by zero or runs out of native stack simply abandons the call and
+// the interpreter runs it again from the start , reporting errors itself.
+//
+// Only available on x86-64 Linux and macOS , elsewhere tryCall always
+// declines. Not thread-safe : one Jit per VM , one VM per thread.
+class Jit {
+    public :
+        struct Stats {
+            size_t compiled = 0;      // native signature variants
+            size_t rejected = 0;      // signatures left to the interpreter
+            size_t codeBytes = 0;
+            uint64_t nativeCalls = 0; // calls from the VM into native code
+            uint64_t bailouts = 0;    // native calls handed back to the interpreter
+        };
+
+        // `module` must be compiled from `program` , so function i of both is
+        // the same. A signature is compiled on its `hotCalls`-th call.
+        Jit(const Program& program , const Module& module , uint32_t hotCalls = 2);
+        ~Jit();
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        // Call module.functions[index] natively , false when the call has to
+        // be interpreted (not hot yet , unsupported or non-numeric arguments)
+        bool tryCall(uint32_t index , const Value* args , size_t argc , Value& result);
+
+        const Stats& stats() const { return counters; }
+
+    private :
+        using NativeFn = uint64_t (*)(const uint64_t* args);
+        enum class State : uint8_t { COLD , NATIVE , REJECTED };
+
+        struct Variant {
+            uint64_t signature;   // bit i set when parameter i is a float
+            uint32_t calls = 0;
+            State state = State::COLD;
+            bool floatResult = false;
+            NativeFn* slot = nullptr;
+        };
+
+        class Session;
+        class FunctionJit;
+
+        const Program& program;
+        const Module& module;
+        uint32_t hotCalls;
+        std::vector<std::vector<Variant>> variants; // per function
+        std::deque<NativeFn> slots;                 // stable cells native calls go through
+        std::map<std::pair<uint32_t , uint64_t> , bool> floatHints; // result types of recursive variants
+        std::vector<std::pair<void* , size_t>> regions;
+        Stats counters;
+
+        Variant& variant(uint32_t index , uint64_t signature);
+        void compile(uint32_t index , uint64_t signature);
+        bool enter(Variant& v , const Value* args , size_t argc , Value& result);
+};
+
+#endif // JIT_H
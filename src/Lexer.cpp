@@ -1,9 +1,20 @@
 #include "Lexer.h"
-#include <cctype>
-#include <unordered_map>
+#include "Stats.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
 
-std::unordered_map<std::string, TokenType> keywords = {
+namespace {
+
+// ---- Keywords : perfect hash built at compile time ----
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+// Adding a keyword is one line here , the seed search below re-runs at compile time
+constexpr Keyword KEYWORDS[] = {
     {"fn", TokenType::FN},
     {"class", TokenType::CLASS},
     {"let", TokenType::LET},
@@ -15,10 +26,129 @@ std::unordered_map<std::string, TokenType> keywords = {
     {"break", TokenType::BREAK},
     {"match" , TokenType::MATCH},
     {"continue", TokenType::CONTINUE},
-    {"var",TokenType::VAR}
+    {"var",TokenType::VAR},
+    {"in", TokenType::IN},
+    {"_", TokenType::UNDERSCORE}
+};
+
+constexpr unsigned KEYWORD_BITS = 6;
+constexpr size_t KEYWORD_SLOTS = size_t(1) << KEYWORD_BITS;
+
+// Mixes length , first and last byte , enough to separate every keyword
+constexpr uint32_t keywordHash(std::string_view s , uint32_t seed) {
+    uint32_t key = (uint32_t(static_cast<unsigned char>(s[0])) << 16)
+                 | (uint32_t(static_cast<unsigned char>(s[s.size() - 1])) << 8)
+                 | uint32_t(s.size() & 0xFF);
+    return (key * seed) >> (32 - KEYWORD_BITS);
+}
+
+struct KeywordTable {
+    uint32_t seed;
+    std::string_view text[KEYWORD_SLOTS];
+    TokenType type[KEYWORD_SLOTS];
+
+    constexpr KeywordTable() : seed(0) , text() , type() {
+        for(uint32_t candidate = 0x9E3779B1u; ; candidate += 2) {
+            bool used[KEYWORD_SLOTS] = {};
+            bool collision = false;
+            for(const Keyword& kw : KEYWORDS) {
+                uint32_t h = keywordHash(kw.text , candidate);
+                if(used[h]) { collision = true; break; }
+                used[h] = true;
+            }
+            if(!collision) { seed = candidate; break; }
+        }
+        for(const Keyword& kw : KEYWORDS) {
+            uint32_t h = keywordHash(kw.text , seed);
+            text[h] = kw.text;
+            type[h] = kw.type;
+        }
+    }
+
+    TokenType lookup(std::string_view id) const {
+        uint32_t h = keywordHash(id , seed);
+        return text[h] == id ? type[h] : TokenType::IDENTIFIER;
+    }
+};
+
+constexpr KeywordTable keywords;
+
+// ---- Per-character dispatch table ----
+enum class CharClass : uint8_t { INVALID, SPACE, DIGIT, IDENT, QUOTE, OPERATOR, END };
+
+// An operator byte lexes as `single` unless followed by `next1`/`next2` ,
+// which turn it into `pair1`/`pair2`. hasSingle is false for '&' and '|'.
+struct CharEntry {
+    CharClass cls;
+    bool hasSingle;
+    TokenType single;
+    char next1;
+    TokenType pair1;
+    char next2;
+    TokenType pair2;
 };
 
-Lexer::Lexer(const std::string& source) : source(source) , index(0) , line(1) {
+struct CharTable {
+    CharEntry entries[256];
+
+    constexpr void op(char c , TokenType single) {
+        CharEntry& e = entries[static_cast<unsigned char>(c)];
+        e.cls = CharClass::OPERATOR;
+        e.hasSingle = true;
+        e.single = single;
+    }
+
+    constexpr void pair(char c , char next , TokenType type) {
+        CharEntry& e = entries[static_cast<unsigned char>(c)];
+        e.cls = CharClass::OPERATOR;
+        if(e.next1 == '\0') { e.next1 = next; e.pair1 = type; }
+        else { e.next2 = next; e.pair2 = type; }
+    }
+
+    constexpr CharTable() : entries() {
+        for(int c = 0; c < 256; c++) {
+            CharEntry& e = entries[c];
+            e = CharEntry{CharClass::INVALID , false , TokenType::END_OF_FILE , '\0' , TokenType::END_OF_FILE , '\0' , TokenType::END_OF_FILE};
+            if(c == ' ' || (c >= '\t' && c <= '\r')) e.cls = CharClass::SPACE;
+            if(c >= '0' && c <= '9') e.cls = CharClass::DIGIT;
+            if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') e.cls = CharClass::IDENT;
+        }
+        entries[static_cast<unsigned char>('"')].cls = CharClass::QUOTE;
+        entries[0].cls = CharClass::END;
+
+        op('+' , TokenType::PLUS);      op('-' , TokenType::MINUS);
+        op('*' , TokenType::STAR);      op('/' , TokenType::SLASH);
+        op('%' , TokenType::MODULO);    op('^' , TokenType::XOR);
+        op('=' , TokenType::ASSIGN);    pair('=' , '=' , TokenType::EQUAL);    pair('=' , '>' , TokenType::ARROW);
+        op('!' , TokenType::NOT);       pair('!' , '=' , TokenType::NOT_EQUAL);
+        op('<' , TokenType::LESS);      pair('<' , '=' , TokenType::LESS_EQUAL);
+        op('>' , TokenType::GREATER);   pair('>' , '=' , TokenType::GREATER_EQUAL);
+        pair('&' , '&' , TokenType::AND);
+        pair('|' , '|' , TokenType::OR);
+        op('(' , TokenType::LPAREN);    op(')' , TokenType::RPAREN);
+        op('{' , TokenType::LBRACE);    op('}' , TokenType::RBRACE);
+        op('[' , TokenType::LBRACKET);  op(']' , TokenType::RBRACKET);
+        op(',' , TokenType::COMMA);     op(';' , TokenType::SEMICOLON);
+        op(':' , TokenType::COLON);     op('?' , TokenType::QUESTION);
+    }
+};
+
+constexpr CharTable chars;
+
+// 1e0 to 1e15 , every one exact in a double
+constexpr double POWERS_OF_TEN[] = {1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 , 1e7 ,
+                                    1e8 , 1e9 , 1e10 , 1e11 , 1e12 , 1e13 , 1e14 , 1e15};
+
+// A number literal runs on through letters , digits , '_' and '.'
+bool continuesNumber(char c) {
+    CharClass cls = chars.entries[static_cast<unsigned char>(c)].cls;
+    return cls == CharClass::DIGIT || cls == CharClass::IDENT || c == '.';
+}
+
+} // namespace
+
+Lexer::Lexer(std::string_view source)
+    : source(source) , index(0) , line(1) , kernels(scanKernels()) , errors(nullptr) {
     currentChar = source.empty() ? '\0' : source[0];
 }
 
@@ -31,104 +161,188 @@ void Lexer::advance() {
     }
 }
 
+void Lexer::seek(size_t pos) {
+    index = pos;
+    currentChar = index < source.size() ? source[index] : '\0';
+}
+
 void Lexer::skipWhitespace() {
-    while(isspace(currentChar)) {
-        if(currentChar == '\n') line++;
-        advance();
-    }
+    int newlines = 0;
+    size_t n = kernels.skipWhitespace(source.data() + index , source.size() - index , newlines);
+    line += newlines;
+    seek(index + n);
 }
 
 Token Lexer::number() {
-    std::string num;
-    bool isFloat = false;
+    size_t start = index;
+    size_t digits = kernels.scanDigits(source.data() + index , source.size() - index);
+    seek(index + digits);
 
-    while(isdigit(currentChar) || currentChar == '.') {
-        if(currentChar == '.') {
-            if(isFloat) break; //SECOND DOT IS NOT ALLOWED
-            isFloat = true;
+    // Plain decimal ints are most literals , up to 18 digits cannot overflow
+    if(!continuesNumber(currentChar) && digits <= 18) {
+        int64_t value = 0;
+        for(size_t k = start; k < index; k++) value = value * 10 + (source[k] - '0');
+        return Token(TokenType::INTEGER_LITERAL , source.substr(start , digits) , line ,
+                     NumberValue::integer(value) , NumberError::NONE);
+    }
+    // Plain floats , digits '.' digits
+    if(currentChar == '.') {
+        size_t fraction = kernels.scanDigits(source.data() + index + 1 , source.size() - index - 1);
+        size_t end = index + 1 + fraction;
+        if(fraction > 0 && !continuesNumber(end < source.size() ? source[end] : '\0')) {
+            double value = 0;
+            NumberError error = NumberError::NONE;
+            if(digits + fraction <= 15) {
+                // Both sides exact in a double , so the one division rounds correctly
+                int64_t mantissa = 0;
+                for(size_t k = start; k < end; k++) {
+                    if(k != index) mantissa = mantissa * 10 + (source[k] - '0');
+                }
+                value = static_cast<double>(mantissa) / POWERS_OF_TEN[fraction];
+            } else if(std::from_chars(source.data() + start , source.data() + end , value , std::chars_format::fixed).ec != std::errc()) {
+                error = NumberError::OUT_OF_RANGE;
+            }
+            seek(end);
+            return Token(TokenType::FLOAT_LITERAL , source.substr(start , end - start) , line , NumberValue::floating(value) , error);
         }
-        num += currentChar;
+    }
+
+    // Anything else : the whole run of letters , digits , '_' and '.' is one literal
+    while(true) {
+        seek(index + kernels.scanIdentifier(source.data() + index , source.size() - index));
+        if(currentChar != '.') break;
         advance();
     }
-    return isFloat ? Token(TokenType::FLOAT_LITERAL,num,line) : Token(TokenType::INTEGER_LITERAL,num,line);
+    std::string_view num = source.substr(start , index - start);
+    TokenType type;
+    NumberValue value;
+    NumberError error = readNumber(num , type , value);
+    return Token(type , num , line , value , error);
 }
 
 Token Lexer::identifier() {
-    std::string id;
-    while(isalnum(currentChar) || currentChar == '_') {
-        id += currentChar;
-        advance();
-    }
-    if(keywords.find(id) != keywords.end()) {
-        return Token(keywords[id],id,line);
-    }
-    return Token(TokenType::IDENTIFIER,id,line);
+    size_t start = index;
+    seek(index + kernels.scanIdentifier(source.data() + index , source.size() - index));
+    std::string_view id = source.substr(start , index - start);
+    TokenType type = keywords.lookup(id);
+    if(type != TokenType::IDENTIFIER) return Token(type,id,line);
+    SymbolId symbol = symbols().intern(id);
+    if(symbol == NO_SYMBOL) return symbolTableFull(start , line);
+    return Token(type,id,line,symbol);
 }
 
 Token Lexer::stringLiteral() {
+    int startLine = line; // a literal may span lines , its token is on the first
     advance(); //SKIP THE OPENING QUOTE
-    std::string str;
-    while(currentChar != '"' && currentChar != '\0') {
-        str += currentChar;
-        advance();
+    size_t start = index;
+    int newlines = 0;
+    seek(index + kernels.findQuote(source.data() + index , source.size() - index , newlines));
+    line += newlines;
+    std::string_view str = source.substr(start , index - start);
+    if(currentChar == '"') advance(); //SKIP THE CLOSING QUOTE , NOT A NUL THAT ENDS THE INPUT
+    SymbolId symbol = symbols().intern(str);
+    if(symbol == NO_SYMBOL) return symbolTableFull(start - 1 , startLine);
+    return Token(TokenType::STRING_LITERAL,str,startLine,symbol);
+}
+
+Token Lexer::punct(TokenType type , size_t start) {
+    return Token(type , source.substr(start , index - start) , line);
+}
+
+std::string LexError::toString() const {
+    switch(kind) {
+        case SOURCE_TOO_LARGE : return "Source too large : more than " + std::to_string(UINT32_MAX) + " bytes , offsets are 32-bit";
+        case SYMBOL_TABLE_FULL : return "Symbol table full : no room for another name at line " + std::to_string(line);
+        default : return std::string("Unexpected character : ") + character + " at line " + std::to_string(line);
     }
-    advance(); //SKIP THE CLOSING QUOTE
-    return Token(TokenType::STRING_LITERAL,str,line);
+}
+
+void Lexer::report(const LexError& error) {
+    if(errors) errors->push_back(error);
+    else std::cerr<<error.toString()<<"\n";
+}
+
+void Lexer::unexpected(char c) {
+    report(LexError{line , c});
+}
+
+// The input ends where the token that did not fit starts , as it does at a NUL
+Token Lexer::symbolTableFull(size_t start , int startLine) {
+    seek(start);
+    line = startLine;
+    currentChar = '\0';
+    report(LexError{line , '\0' , LexError::SYMBOL_TABLE_FULL});
+    return Token(TokenType::END_OF_FILE,"EOF",line);
 }
 
 Token Lexer::nextToken() {
     skipWhitespace();
-    if(isdigit(currentChar)) return number();
-    if(isalpha(currentChar) || currentChar == '_') return identifier();
-    if(currentChar == '"') return stringLiteral();
-
-    switch (currentChar) {
-        case '+' : advance(); return Token(TokenType::PLUS,"+",line);
-        case '-' : advance(); return Token(TokenType::MINUS,"-",line);
-        case '*' : advance(); return Token(TokenType::STAR,"*",line);
-        case '/' : advance(); return Token(TokenType::SLASH,"/",line);
-        case '%' : advance(); return Token(TokenType::MODULO,"%",line);
-        case '=' :
-            advance();
-            if(currentChar == '=') { advance(); return Token(TokenType::EQUAL,"==",line); }
-            if(currentChar == '>') { advance(); return Token(TokenType::ARROW,"=>",line); }
-            return Token(TokenType::ASSIGN,"=",line);
-        case '!' :
-            advance();
-            if(currentChar == '=') { advance(); return Token(TokenType::NOT_EQUAL,"!=",line); }  
-            return Token(TokenType::IDENTIFIER,"!",line);
-        case '<' :
-            advance();
-            if(currentChar == '=') { advance(); return Token(TokenType::LESS_EQUAL,"<=",line); }
-            return Token(TokenType::LESS,"<",line);   
-        case '>' :
+    const CharEntry& e = chars.entries[static_cast<unsigned char>(currentChar)];
+
+    size_t start = index;
+    switch (e.cls) {
+        case CharClass::DIGIT : return number();
+        case CharClass::IDENT : return identifier();
+        case CharClass::QUOTE : return stringLiteral();
+        case CharClass::END : return Token(TokenType::END_OF_FILE,"EOF",line); // stays put , a NUL ends the input
+        case CharClass::OPERATOR :
             advance();
-            if(currentChar == '=') { advance(); return Token(TokenType::GREATER_EQUAL,">=",line); }
-            return Token(TokenType::GREATER,">",line);
-        case '(' : advance(); return Token(TokenType::LPAREN,"(",line);
-        case ')' : advance(); return Token(TokenType::RPAREN,")",line);
-        case '{' : advance(); return Token(TokenType::LBRACE,"{",line);
-        case '}' : advance(); return Token(TokenType::RBRACE,"}",line);
-        case '[' : advance(); return Token(TokenType::LBRACKET,"[",line);
-        case ']' : advance(); return Token(TokenType::RBRACKET,"]",line);
-        case ',' : advance(); return Token(TokenType::COMMA,",",line);
-        case ';' : advance(); return Token(TokenType::SEMICOLON,";",line);
-        case '\0' : advance(); return Token(TokenType::END_OF_FILE,"EOF",line);
-        case ':' : advance(); return Token(TokenType::COLON , ":" , line);
-        case '?' : advance(); return Token(TokenType::QUESTION , "?" , line);
-        case '_' : advance(); return Token(TokenType::UNDERSCORE,"_",line);
+            if(e.next1 != '\0' && currentChar == e.next1) { advance(); return punct(e.pair1,start); }
+            if(e.next2 != '\0' && currentChar == e.next2) { advance(); return punct(e.pair2,start); }
+            if(e.hasSingle) return punct(e.single,start);
+            unexpected(source[start]);
+            return Token(TokenType::END_OF_FILE,"EOF",line);
         default :
-            std::cerr<<"Unexpected character : "<<currentChar<<" at line "<<line<<"\n";
+            unexpected(currentChar);
             advance();
             return Token(TokenType::END_OF_FILE,"EOF",line);           
     }
 }
 
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
+TokenStream Lexer::tokenize() {
+    PhaseTimer timer(Phase::LEX);
+    TokenStream tokens(source);
+    if(source.size() > UINT32_MAX) {
+        report(LexError{1 , '\0' , LexError::SOURCE_TOO_LARGE});
+        tokens.push(TokenType::END_OF_FILE , 0 , 0 , 1);
+        return tokens;
+    }
+    tokens.reserve(source.size() / 4 + 1); //ROUGH AVERAGE OF BYTES PER TOKEN
     while(currentChar != '\0') {
-        tokens.push_back(nextToken());
+        append(tokens , nextToken());
+    }
+    tokens.push(TokenType::END_OF_FILE , static_cast<uint32_t>(source.size()) , 0 , line);
+    if(CompileStats::enabled) {
+        // One pass over the kind bytes afterwards keeps the loop above free of hooks
+        StatsCounters& stats = CompileStats::local();
+        for(size_t i = 0; i < tokens.size(); i++) stats.tokens[static_cast<size_t>(tokens.kind(i))]++;
+        stats.tokens[static_cast<size_t>(TokenType::END_OF_FILE)] = 0;
+        stats.tokenBytes += tokens.memoryUsage();
     }
-    tokens.push_back(Token(TokenType::END_OF_FILE,"EOF",line));
     return tokens;
-}
\ No newline at end of file
+}
+
+void Lexer::append(TokenStream& tokens , const Token& tok) const {
+    if(tok.type == TokenType::END_OF_FILE) {
+        tokens.push(tok.type , static_cast<uint32_t>(std::min(index , source.size())) , 0 , tok.line);
+    } else if(isNumberLiteral(tok.type)) {
+        tokens.pushNumber(tok.type , static_cast<uint32_t>(tok.value.data() - source.data()) ,
+                          static_cast<uint32_t>(tok.value.size()) , tok.line , tok.number ,
+                          tok.numberError == NumberError::NONE);
+    } else {
+        tokens.push(tok.type , static_cast<uint32_t>(tok.value.data() - source.data()) ,
+                    static_cast<uint32_t>(tok.value.size()) , tok.line , tok.symbol);
+    }
+}
+
+void Lexer::reset(size_t position , int startLine) {
+    seek(std::min(position , source.size()));
+    line = startLine;
+}
+
+Token Lexer::next() {
+    if(currentChar == '\0') return Token(TokenType::END_OF_FILE,"EOF",line);
+    Token tok = nextToken();
+    countToken(tok.type);
+    return tok;
+}
@@ -1,27 +1,71 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "ScanKernels.h"
 #include "Token.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
+// ---- What the lexer reports ----
+// A character no token starts with is reported and lexing carries on. A
+// source too large for 32-bit offsets is not lexed at all , and a name or
+// string the symbol table has no room for ends the input where it starts.
+struct LexError {
+    enum Kind : uint8_t { UNEXPECTED_CHARACTER , SOURCE_TOO_LARGE , SYMBOL_TABLE_FULL };
+
+    int line;
+    char character; // UNEXPECTED_CHARACTER only
+    Kind kind = UNEXPECTED_CHARACTER;
+
+    // "Unexpected character : <c> at line <n>" , "Source too large : ..." or
+    // "Symbol table full : ... at line <n>"
+    std::string toString() const;
+};
+
+// The input ends at the end of the source or at its first NUL byte ,
+// whichever comes first.
 class Lexer {
     private :  
-        std::string source;
-        int index;
+        std::string_view source;
+        size_t index;
         int line; 
         char currentChar;
+        const ScanKernels& kernels;
+        std::vector<LexError>* errors; // null : printed to std::cerr
 
         void advance();
+        void seek(size_t pos);
         void skipWhitespace();
         Token number();
         Token identifier();
         Token stringLiteral();
+        Token punct(TokenType type , size_t start);
+        void report(const LexError& error);
+        void unexpected(char c);
+        Token symbolTableFull(size_t start , int startLine);
         Token nextToken();
     
     public :
-        Lexer(const std::string& source);
-        std::vector<Token> tokenize();  
+        // The lexer does not copy the source , tokens view it directly
+        Lexer(std::string_view source);
+        // A source over 4 GB is reported as a LexError and gives a stream
+        // holding only END_OF_FILE
+        TokenStream tokenize();  
+
+        // Append errors to `out` instead of printing them. `out` must outlive the lexer.
+        void captureErrors(std::vector<LexError>& out) { errors = &out; }
+
+        // Pull a single token , END_OF_FILE is returned forever once the source is exhausted
+        Token next();
+
+        // Restart at a token boundary , used to re-lex part of an edited source
+        void reset(size_t position , int line);
+        bool atEnd() const { return currentChar == '\0'; }
+        size_t position() const { return index; }
+        int currentLine() const { return line; }
+        // Append a token produced by next() to a stream over the same source
+        void append(TokenStream& tokens , const Token& tok) const;
 };
 
-#endif
\ No newline at end of file
+#endif
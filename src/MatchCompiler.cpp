@@ -0,0 +1,192 @@
+#include "MatchCompiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <utility>
+
+namespace {
+
+constexpr size_t MIN_TABLE_CASES = 4;
+constexpr double EXACT_LIMIT = 9007199254740992.0; // 2^53 , every int up to here is an exact double
+constexpr uint32_t MAX_DISPLACEMENT = 1 << 16;
+
+// The key a literal pattern matches under `==` : ints and integral floats
+// below 2^53 as ints , other floats as floats. `exact` is false when a
+// SwitchTable cannot reproduce `==` for it (ints beyond 2^53 compared with
+// floats).
+bool literalKey(const Expression* pattern , Value& key , bool& exact) {
+    exact = true;
+    if(pattern->kind == AstKind::STRING) {
+        key = Value::string(static_cast<const StringExpr*>(pattern)->value);
+        return true;
+    }
+    if(pattern->kind != AstKind::NUMBER) return false;
+    auto num = static_cast<const NumberExpr*>(pattern);
+    key = numberValue(num->value , num->isFloat);
+    if(key.type == ValueType::INT) {
+        exact = key.i >= -(int64_t(1) << 53) && key.i <= int64_t(1) << 53;
+        return true;
+    }
+    double f = key.f;
+    if(std::isfinite(f) && std::trunc(f) == f) {
+        if(std::fabs(f) < EXACT_LIMIT) key = Value::integer(static_cast<int64_t>(f));
+        else exact = false;
+    }
+    return true;
+}
+
+std::string patternText(const Expression* pattern) {
+    if(pattern->kind == AstKind::STRING) return "\"" + std::string(symbolText(static_cast<const StringExpr*>(pattern)->value)) + "\"";
+    auto num = static_cast<const NumberExpr*>(pattern);
+    char text[NUMBER_TEXT_MAX];
+    return std::string(text , formatNumber(text , num->value , num->isFloat));
+}
+
+// Strings : hash and displace. Buckets are placed largest first , each
+// trying displacements until all its keys land in free , distinct slots.
+bool buildStringHash(SwitchTable& table , const std::vector<std::pair<SymbolId , uint32_t>>& cases) {
+    if(cases.empty()) return true;
+    uint8_t slotsLog = 1;
+    while((size_t(1) << slotsLog) < 2 * cases.size()) slotsLog++;
+
+    for(uint8_t grow = 0; grow < 4; grow++ , slotsLog++) {
+        size_t slots = size_t(1) << slotsLog;
+        uint8_t bucketsLog = slotsLog > 3 ? slotsLog - 2 : 1; // about two keys per bucket
+        std::vector<std::vector<size_t>> buckets(size_t(1) << bucketsLog);
+        for(size_t i = 0; i < cases.size(); i++) buckets[mixSymbol(cases[i].first) >> (64 - bucketsLog)].push_back(i);
+        std::vector<size_t> order(buckets.size());
+        for(size_t b = 0; b < order.size(); b++) order[b] = b;
+        std::stable_sort(order.begin() , order.end() , [&](size_t a , size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<uint32_t> displacements(buckets.size() , 0);
+        std::vector<bool> used(slots , false);
+        std::vector<size_t> placed;
+        bool ok = true;
+        for(size_t b : order) {
+            if(buckets[b].empty()) break;
+            bool found = false;
+            for(uint32_t d = 0; d < MAX_DISPLACEMENT && !found; d++) {
+                placed.clear();
+                found = true;
+                for(size_t i : buckets[b]) {
+                    size_t slot = mixSymbol(uint64_t(cases[i].first) | uint64_t(d) << 32) & (slots - 1);
+                    if(used[slot] || std::find(placed.begin() , placed.end() , slot) != placed.end()) {
+                        found = false;
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+                if(found) {
+                    displacements[b] = d;
+                    for(size_t slot : placed) used[slot] = true;
+                }
+            }
+            if(!found) {
+                ok = false;
+                break;
+            }
+        }
+        if(!ok) continue;
+
+        table.bucketShift = static_cast<uint8_t>(64 - bucketsLog);
+        table.displacements = std::move(displacements);
+        table.slotKeys.assign(slots , NO_SYMBOL);
+        table.slotTargets.assign(slots , table.fallback);
+        for(const auto& c : cases) {
+            uint32_t d = table.displacements[mixSymbol(c.first) >> table.bucketShift];
+            size_t slot = mixSymbol(uint64_t(c.first) | uint64_t(d) << 32) & (slots - 1);
+            table.slotKeys[slot] = c.first;
+            table.slotTargets[slot] = c.second;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool buildSwitch(SwitchTable& table , const std::vector<std::pair<Value , uint32_t>>& cases) {
+    std::vector<std::pair<int64_t , uint32_t>> ints;
+    std::vector<std::pair<double , uint32_t>> floats;
+    std::vector<std::pair<SymbolId , uint32_t>> strings;
+    for(const auto& c : cases) {
+        switch(c.first.type) {
+            case ValueType::INT : ints.emplace_back(c.first.i , c.second); break;
+            case ValueType::FLOAT : floats.emplace_back(c.first.f , c.second); break;
+            default : strings.emplace_back(c.first.s , c.second); break;
+        }
+    }
+
+    // Ints : a jump table when at least half of the range is used , else a sorted array
+    std::sort(ints.begin() , ints.end());
+    if(!ints.empty()) {
+        uint64_t span = uint64_t(ints.back().first - ints.front().first) + 1; // keys are within +-2^53
+        if(span <= 2 * ints.size() && span <= UINT16_MAX) {
+            table.denseLow = ints.front().first;
+            table.dense.assign(span , table.fallback);
+            for(const auto& c : ints) table.dense[uint64_t(c.first - table.denseLow)] = c.second;
+        } else {
+            for(const auto& c : ints) {
+                table.sparseKeys.push_back(c.first);
+                table.sparseTargets.push_back(c.second);
+            }
+        }
+    }
+    std::sort(floats.begin() , floats.end());
+    for(const auto& c : floats) {
+        table.floatKeys.push_back(c.first);
+        table.floatTargets.push_back(c.second);
+    }
+    return buildStringHash(table , strings);
+}
+
+} // namespace
+
+MatchPlan planMatch(const MatchStatement* match) {
+    MatchPlan plan;
+    SymbolId wildcard = symbols().intern("_");
+    std::set<std::pair<ValueType , uint64_t>> seen;
+    std::vector<std::pair<Value , uint32_t>> cases;
+    bool allLiterals = true;
+
+    for(uint32_t i = 0; i < match->arms.size(); i++) {
+        const Expression* pattern = match->arms[i].pattern;
+        if(plan.hasWildcard) {
+            plan.warnings.push_back("match arm " + std::to_string(i + 1) + " is unreachable after '_'");
+            continue;
+        }
+        if(pattern->kind == AstKind::VARIABLE && static_cast<const VariableExpr*>(pattern)->name == wildcard) {
+            plan.arms.push_back(i);
+            plan.hasWildcard = true;
+            continue;
+        }
+        Value key;
+        bool exact;
+        if(!literalKey(pattern , key , exact)) {
+            allLiterals = false;
+            plan.arms.push_back(i);
+            continue;
+        }
+        uint64_t bits = key.type == ValueType::STRING ? key.s : static_cast<uint64_t>(key.i);
+        if(key.type == ValueType::FLOAT) std::memcpy(&bits , &key.f , sizeof(bits));
+        if(!seen.emplace(key.type , bits).second) {
+            plan.warnings.push_back("duplicate match pattern " + patternText(pattern) + " in arm " + std::to_string(i + 1));
+            continue;
+        }
+        allLiterals = allLiterals && exact;
+        cases.emplace_back(key , static_cast<uint32_t>(plan.arms.size()));
+        plan.arms.push_back(i);
+    }
+
+    if(!allLiterals || cases.size() < MIN_TABLE_CASES) return plan;
+    plan.switchTable.fallback = plan.hasWildcard ? static_cast<uint32_t>(plan.arms.size() - 1) : static_cast<uint32_t>(plan.arms.size());
+    plan.table = buildSwitch(plan.switchTable , cases);
+    return plan;
+}
+
+void retarget(SwitchTable& table , const std::vector<uint32_t>& offsets) {
+    for(uint32_t& t : table.dense) t = offsets[t];
+    for(uint32_t& t : table.sparseTargets) t = offsets[t];
+    for(uint32_t& t : table.floatTargets) t = offsets[t];
+    for(uint32_t& t : table.slotTargets) t = offsets[t];
+    table.fallback = offsets[table.fallback];
+}
@@ -0,0 +1,32 @@
+#ifndef MATCH_COMPILER_H
+#define MATCH_COMPILER_H
+
+#include "AST.h"
+#include "Bytecode.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How to compile one match statement. Arms that can never run are dropped :
+// a literal pattern equal to an earlier one , and everything after `_`.
+// Each drop adds a warning.
+//
+// When at least 4 arms have literal patterns and every pattern is a literal
+// (or `_`) , the arms become a SwitchTable instead of a chain of `==` tests.
+// Dense int keys get a jump table , sparse ones a sorted array searched in
+// O(log n) , strings a perfect hash on their interned ids. The table's
+// targets are then positions in `arms` , with arms.size() for "no arm".
+struct MatchPlan {
+    std::vector<uint32_t> arms; // indices into match->arms , in order
+    bool hasWildcard = false;   // the last of `arms` is `_`
+    bool table = false;
+    SwitchTable switchTable;
+    std::vector<std::string> warnings;
+};
+
+MatchPlan planMatch(const MatchStatement* match);
+
+// Replace every target t of a planned table with offsets[t]
+void retarget(SwitchTable& table , const std::vector<uint32_t>& offsets);
+
+#endif // MATCH_COMPILER_H
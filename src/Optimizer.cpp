@@ -0,0 +1,379 @@
+#include "Optimizer.h"
+#include "Bytecode.h"
+#include "Resolver.h"
+#include "Stats.h"
+#include "TypeInference.h"
+#include <cmath>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+size_t countNodes(const Expression* expr);
+size_t countNodes(const AstList<Statement*>& body);
+
+size_t countNodes(const Expression* expr) {
+    switch(expr->kind) {
+        case AstKind::UNARY : return 1 + countNodes(static_cast<const UnaryExpr*>(expr)->operand);
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            return 1 + countNodes(bin->left) + countNodes(bin->right);
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<const CallExpr*>(expr);
+            size_t n = 1 + countNodes(call->callee);
+            for(const Expression* arg : call->arguments) n += countNodes(arg);
+            return n;
+        }
+        default : return 1;
+    }
+}
+
+size_t countNodes(const Statement* stmt) {
+    switch(stmt->kind) {
+        case AstKind::LET : return 1 + countNodes(static_cast<const LetStatement*>(stmt)->value);
+        case AstKind::VAR : return 1 + countNodes(static_cast<const VarStatement*>(stmt)->value);
+        case AstKind::ASSIGN : return 1 + countNodes(static_cast<const AssignStatement*>(stmt)->value);
+        case AstKind::RETURN : return 1 + countNodes(static_cast<const ReturnStatement*>(stmt)->value);
+        case AstKind::IF : {
+            auto branch = static_cast<const IfStatement*>(stmt);
+            return 1 + countNodes(branch->condition) + countNodes(branch->thenBranch) + countNodes(branch->elseBranch);
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<const WhileStatement*>(stmt);
+            return 1 + countNodes(loop->condition) + countNodes(loop->body);
+        }
+        case AstKind::FOR : {
+            auto loop = static_cast<const ForStatement*>(stmt);
+            return 1 + countNodes(loop->iterable) + countNodes(loop->body);
+        }
+        case AstKind::MATCH : {
+            auto match = static_cast<const MatchStatement*>(stmt);
+            size_t n = 1 + countNodes(match->expr);
+            for(const MatchArm& arm : match->arms) n += countNodes(arm.pattern) + countNodes(arm.body);
+            return n;
+        }
+        default : return 1;
+    }
+}
+
+size_t countNodes(const AstList<Statement*>& body) {
+    size_t n = 0;
+    for(const Statement* stmt : body) n += countNodes(stmt);
+    return n;
+}
+
+size_t countNodes(const FunctionDecl* fn) {
+    return 1 + countNodes(fn->body);
+}
+
+// Names that are assignment targets somewhere in the body , never propagated
+void collectAssigned(const AstList<Statement*>& body , std::unordered_set<SymbolId>& assigned) {
+    for(const Statement* stmt : body) {
+        switch(stmt->kind) {
+            case AstKind::ASSIGN : assigned.insert(static_cast<const AssignStatement*>(stmt)->name); break;
+            case AstKind::IF : {
+                auto branch = static_cast<const IfStatement*>(stmt);
+                collectAssigned(branch->thenBranch , assigned);
+                collectAssigned(branch->elseBranch , assigned);
+                break;
+            }
+            case AstKind::WHILE : collectAssigned(static_cast<const WhileStatement*>(stmt)->body , assigned); break;
+            case AstKind::FOR : collectAssigned(static_cast<const ForStatement*>(stmt)->body , assigned); break;
+            case AstKind::MATCH :
+                for(const MatchArm& arm : static_cast<const MatchStatement*>(stmt)->arms) collectAssigned(arm.body , assigned);
+                break;
+            default : break;
+        }
+    }
+}
+
+bool isWildcard(const Expression* expr) {
+    return expr->kind == AstKind::VARIABLE && symbolText(static_cast<const VariableExpr*>(expr)->name) == "_";
+}
+
+class FunctionOptimizer {
+    private :
+        // A let binding in scope , `known` is false for a shadowing non-constant binding
+        struct Binding {
+            SymbolId name;
+            bool known;
+            Value value;
+        };
+
+        AstArena& arena;
+        OptimizerStats& stats;
+        const Specialization& types; // the function's generic version , every parameter ANY
+        std::unordered_set<SymbolId> assigned;
+        std::vector<Binding> scope;
+
+        bool constantOf(const Expression* expr , Value& out) const;
+        Expression* literal(const Value& value);
+        bool isInt(const Expression* expr , int64_t v) const;
+        bool isNumber(const Expression* expr , bool floatToo) const;
+
+        Expression* expr(Expression* e);
+        Expression* binary(BinaryExpr* bin);
+        void statement(Statement* stmt , std::vector<Statement*>& out);
+        AstList<Statement*> block(const AstList<Statement*>& body);
+        bool splice(const AstList<Statement*>& body , std::vector<Statement*>& out);
+
+    public :
+        FunctionOptimizer(AstArena& arena , OptimizerStats& stats , const Specialization& types)
+            : arena(arena) , stats(stats) , types(types) {}
+
+        void optimize(FunctionDecl* fn);
+};
+
+void FunctionOptimizer::optimize(FunctionDecl* fn) {
+    collectAssigned(fn->body , assigned);
+    fn->body = block(fn->body);
+}
+
+bool FunctionOptimizer::constantOf(const Expression* e , Value& out) const {
+    if(e->kind == AstKind::NUMBER) {
+        auto num = static_cast<const NumberExpr*>(e);
+        out = numberValue(num->value , num->isFloat);
+        return true;
+    }
+    if(e->kind == AstKind::STRING) {
+        out = Value::string(static_cast<const StringExpr*>(e)->value);
+        return true;
+    }
+    return false;
+}
+
+bool FunctionOptimizer::isInt(const Expression* e , int64_t v) const {
+    Value c;
+    return constantOf(e , c) && c.type == ValueType::INT && c.i == v;
+}
+
+// Whether inference proved `e` an int (or a float , with `floatToo`) on every
+// call. Nodes the optimizer made itself have no type and never qualify.
+bool FunctionOptimizer::isNumber(const Expression* e , bool floatToo) const {
+    StaticType type = types.typeOf(e);
+    return type == StaticType::INT || (floatToo && type == StaticType::FLOAT);
+}
+
+// A literal node for `value` , or nullptr when it has no literal spelling (nil , inf , nan)
+Expression* FunctionOptimizer::literal(const Value& value) {
+    switch(value.type) {
+        case ValueType::INT : return arena.create<NumberExpr>(NumberValue::integer(value.i) , false);
+        case ValueType::STRING : return arena.create<StringExpr>(value.s);
+        case ValueType::FLOAT :
+            if(!std::isfinite(value.f)) return nullptr;
+            return arena.create<NumberExpr>(NumberValue::floating(value.f) , true);
+        default : return nullptr;
+    }
+}
+
+Expression* FunctionOptimizer::expr(Expression* e) {
+    switch(e->kind) {
+        case AstKind::VARIABLE : {
+            SymbolId name = static_cast<VariableExpr*>(e)->name;
+            for(size_t i = scope.size(); i-- > 0;) {
+                if(scope[i].name != name) continue;
+                if(!scope[i].known) return e;
+                Expression* lit = literal(scope[i].value);
+                if(!lit) return e;
+                lit->line = e->line;
+                stats.propagated++;
+                return lit;
+            }
+            return e;
+        }
+        case AstKind::UNARY : {
+            auto un = static_cast<UnaryExpr*>(e);
+            un->operand = expr(un->operand);
+            Value v;
+            if(!constantOf(un->operand , v)) return e;
+            Expression* lit = literal(Value::integer(truthy(v) ? 0 : 1));
+            lit->line = e->line;
+            stats.folded++;
+            return lit;
+        }
+        case AstKind::BINARY : return binary(static_cast<BinaryExpr*>(e));
+        case AstKind::CALL : {
+            auto call = static_cast<CallExpr*>(e);
+            for(Expression*& arg : call->arguments) arg = expr(arg);
+            return e;
+        }
+        default : return e;
+    }
+}
+
+Expression* FunctionOptimizer::binary(BinaryExpr* bin) {
+    bin->left = expr(bin->left);
+    bin->right = expr(bin->right);
+    Value a , b;
+    bool leftConst = constantOf(bin->left , a);
+    bool rightConst = constantOf(bin->right , b);
+
+    // && and || evaluate to the deciding operand
+    if(bin->op == TokenType::AND || bin->op == TokenType::OR) {
+        if(!leftConst) return bin;
+        stats.folded++;
+        return truthy(a) == (bin->op == TokenType::AND) ? bin->right : bin->left;
+    }
+
+    Op op;
+    if(!binaryOp(bin->op , op)) return bin;
+    if(leftConst && rightConst) {
+        Value result;
+        if(evalBinary(op , a , b , result)) {
+            if(Expression* lit = literal(result)) {
+                lit->line = bin->line;
+                stats.folded++;
+                return lit;
+            }
+        }
+        return bin;
+    }
+
+    Expression* x = leftConst ? bin->right : bin->left;
+    Expression* k = leftConst ? bin->left : bin->right;
+    bool commutes = op == Op::ADD || op == Op::MUL;
+    if(leftConst && !commutes) return bin;
+    // Strings and nil would raise where x alone does not , and -0.0 + 0 is 0.0
+    if(op == Op::ADD && isInt(k , 0) && isNumber(x , false)) {
+        stats.simplified++;
+        return x;
+    }
+    if(op == Op::SUB && isInt(k , 0) && isNumber(x , true)) {
+        stats.simplified++;
+        return x;
+    }
+    if((op == Op::MUL || op == Op::DIV) && isInt(k , 1) && isNumber(x , true)) {
+        stats.simplified++;
+        return x;
+    }
+    // x * 2 -> x + x , only when x can be evaluated twice for free and
+    // is a number , "ab" + "ab" would not raise as "ab" * 2 does
+    if(op == Op::MUL && isInt(k , 2) && x->kind == AstKind::VARIABLE && isNumber(x , true)) {
+        stats.simplified++;
+        bin->left = x;
+        bin->right = arena.create<VariableExpr>(static_cast<VariableExpr*>(x)->name);
+        bin->right->line = x->line;
+        bin->op = TokenType::PLUS;
+        return bin;
+    }
+    return bin;
+}
+
+AstList<Statement*> FunctionOptimizer::block(const AstList<Statement*>& body) {
+    size_t mark = scope.size();
+    std::vector<Statement*> out;
+    out.reserve(body.size());
+    for(Statement* stmt : body) statement(stmt , out);
+    scope.resize(mark);
+
+    bool same = out.size() == body.size();
+    for(size_t i = 0; same && i < out.size(); i++) same = out[i] == body[i];
+    return same ? body : arena.copyList(out.data() , out.size());
+}
+
+// Inline the statements of a taken branch into the enclosing block. Refused
+// when the branch declares names , which would then leak into the outer scope.
+bool FunctionOptimizer::splice(const AstList<Statement*>& body , std::vector<Statement*>& out) {
+    for(const Statement* stmt : body) {
+        if(stmt->kind == AstKind::LET || stmt->kind == AstKind::VAR) return false;
+    }
+    out.insert(out.end() , body.begin() , body.end());
+    return true;
+}
+
+void FunctionOptimizer::statement(Statement* stmt , std::vector<Statement*>& out) {
+    switch(stmt->kind) {
+        case AstKind::LET : {
+            auto let = static_cast<LetStatement*>(stmt);
+            let->value = expr(let->value);
+            Value v;
+            bool known = assigned.count(let->name) == 0 && constantOf(let->value , v);
+            scope.push_back(Binding{let->name , known , v});
+            break;
+        }
+        case AstKind::VAR : {
+            auto var = static_cast<VarStatement*>(stmt);
+            var->value = expr(var->value);
+            scope.push_back(Binding{var->name , false , Value::nil()});
+            break;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<AssignStatement*>(stmt);
+            assign->value = expr(assign->value);
+            break;
+        }
+        case AstKind::RETURN : {
+            auto ret = static_cast<ReturnStatement*>(stmt);
+            ret->value = expr(ret->value);
+            break;
+        }
+        case AstKind::IF : {
+            auto branch = static_cast<IfStatement*>(stmt);
+            branch->condition = expr(branch->condition);
+            Value c{};
+            if(constantOf(branch->condition , c)) {
+                stats.branchesPruned++;
+                AstList<Statement*> taken = block(truthy(c) ? branch->thenBranch : branch->elseBranch);
+                if(splice(taken , out)) return;
+                // Keep the branch as its own scope : if (1) { taken }
+                int line = branch->condition->line;
+                branch->condition = literal(Value::integer(1));
+                branch->condition->line = line;
+                branch->thenBranch = taken;
+                branch->elseBranch = AstList<Statement*>();
+                break;
+            }
+            branch->thenBranch = block(branch->thenBranch);
+            branch->elseBranch = block(branch->elseBranch);
+            break;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<WhileStatement*>(stmt);
+            loop->condition = expr(loop->condition);
+            Value c{};
+            if(constantOf(loop->condition , c) && !truthy(c)) {
+                stats.branchesPruned++;
+                return;
+            }
+            loop->body = block(loop->body);
+            break;
+        }
+        case AstKind::FOR : {
+            auto loop = static_cast<ForStatement*>(stmt);
+            loop->iterable = expr(loop->iterable);
+            scope.push_back(Binding{loop->iteratorName , false , Value::nil()});
+            loop->body = block(loop->body);
+            scope.pop_back();
+            break;
+        }
+        case AstKind::MATCH : {
+            auto match = static_cast<MatchStatement*>(stmt);
+            match->expr = expr(match->expr);
+            for(MatchArm& arm : match->arms) {
+                if(!isWildcard(arm.pattern)) arm.pattern = expr(arm.pattern);
+                arm.body = block(arm.body);
+            }
+            break;
+        }
+        default : break;
+    }
+    out.push_back(stmt);
+}
+
+} // namespace
+
+OptimizerStats optimizeProgram(Program& program) {
+    OptimizerStats stats;
+    if(!resolveProgram(program).empty()) return stats; // left for compileProgram to report
+    TypeInfo types = inferTypes(program);
+    PhaseTimer timer(Phase::OPTIMIZE); // resolve and infer time themselves
+    for(size_t i = 0; i < program.functions.size(); i++) {
+        FunctionDecl* fn = program.functions[i];
+        stats.nodesBefore += countNodes(fn);
+        FunctionOptimizer(program.arena , stats , types.specs[i]).optimize(fn);
+        stats.nodesAfter += countNodes(fn);
+    }
+    return stats;
+}
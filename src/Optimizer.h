@@ -0,0 +1,30 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "AST.h"
+#include <cstddef>
+
+struct OptimizerStats {
+    size_t nodesBefore = 0;
+    size_t nodesAfter = 0;
+    size_t folded = 0;         // constant subexpressions evaluated
+    size_t simplified = 0;     // identity and strength-reduction rewrites
+    size_t propagated = 0;     // uses of constant let bindings replaced by their value
+    size_t branchesPruned = 0; // if / while statements with a constant condition
+
+    size_t eliminated() const { return nodesBefore - nodesAfter; }
+};
+
+// Rewrite every function of `program` in place , new nodes and lists go to
+// program.arena. Folding uses the VM's own arithmetic , so results never
+// differ from running the code , and expressions that would raise a runtime
+// error (integer division by zero , mixing strings and numbers) are left alone.
+// The identity rules (x + 0 , x - 0 , x * 1 , x / 1) and x * 2 -> x + x
+// apply only where type inference proves x a number on every call , which
+// resolves the program first : a program with compile errors is left as it is.
+//
+// A let binding is propagated only when its name is never the target of an
+// assignment anywhere in the function.
+OptimizerStats optimizeProgram(Program& program);
+
+#endif // OPTIMIZER_H
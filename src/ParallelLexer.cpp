@@ -0,0 +1,114 @@
+#include "ParallelLexer.h"
+#include "Lexer.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+std::vector<size_t> findChunkBoundaries(std::string_view source , size_t chunks) {
+    std::vector<size_t> bounds;
+    bounds.push_back(0);
+    if(chunks < 2) {
+        bounds.push_back(source.size());
+        return bounds;
+    }
+
+    // Strings have no escapes , so a position is inside a literal exactly
+    // when an odd number of quotes precede it.
+    size_t pos = 0;
+    bool inString = false;
+    for(size_t k = 1; k < chunks; k++) {
+        size_t target = source.size() / chunks * k;
+        if(target <= pos) continue;
+        size_t quotes = std::count(source.begin() + pos , source.begin() + target , '"');
+        if(quotes & 1) inString = !inString;
+        pos = target;
+
+        while(pos < source.size() && (inString || source[pos] != '\n')) {
+            if(source[pos] == '"') inString = !inString;
+            pos++;
+        }
+        pos++; //SPLIT JUST AFTER THE NEWLINE
+        if(pos >= source.size()) break; // no empty last chunk
+        bounds.push_back(pos);
+    }
+    bounds.push_back(source.size());
+    return bounds;
+}
+
+TokenStream tokenizeParallel(std::string_view source , ThreadPool& pool , size_t minChunkSize) {
+    size_t chunks = std::min(pool.size() * 4 , source.size() / std::max<size_t>(minChunkSize , 1));
+    // A source too large for 32-bit offsets is reported by the sequential lexer
+    if(chunks < 2 || source.size() > UINT32_MAX) {
+        Lexer lexer(source);
+        return lexer.tokenize();
+    }
+
+    std::vector<size_t> bounds = findChunkBoundaries(source , chunks);
+    size_t parts = bounds.size() - 1;
+
+    // Chunk lexers count lines from 1 and keep their errors , both are
+    // rebased once the lines before every chunk are known
+    std::vector<TokenStream> streams(parts);
+    std::vector<std::vector<LexError>> errors(parts);
+    std::vector<size_t> stops(parts); // where each chunk lexer stopped , before the end at a NUL
+    for(size_t i = 0; i < parts; i++) {
+        pool.submit([&streams , &errors , &stops , &bounds , source , i] {
+            Lexer lexer(source.substr(bounds[i] , bounds[i + 1] - bounds[i]));
+            lexer.captureErrors(errors[i]);
+            streams[i] = lexer.tokenize();
+            stops[i] = lexer.position();
+        });
+    }
+    pool.wait();
+    // The first NUL ends the input , the chunks after the one holding it are
+    // never reached. A chunk that opens with the NUL is dropped too : the
+    // sequential lexer meets it skipping the newline before , and the
+    // previous chunk already ends with the END_OF_FILE it makes there.
+    for(size_t i = 0; i < parts; i++) {
+        if(stops[i] < bounds[i + 1] - bounds[i]) {
+            parts = stops[i] == 0 && i > 0 ? i : i + 1;
+            break;
+        }
+    }
+
+    // Every chunk but the last ends on a newline , so its trailing
+    // END_OF_FILE tokens are artifacts of the split and get dropped. The
+    // last chunk's closing END_OF_FILE is pushed afresh at the end of the
+    // source , where the sequential lexer puts it even after a NUL.
+    std::vector<size_t> keep(parts) , at(parts) , lineBase(parts) , numberAt(parts);
+    size_t total = 0 , numbers = 0;
+    int line = 0;
+    for(size_t i = 0; i < parts; i++) {
+        const TokenStream& s = streams[i];
+        size_t n = s.size();
+        if(i + 1 < parts) {
+            uint32_t end = static_cast<uint32_t>(bounds[i + 1] - bounds[i]);
+            while(n > 0 && s.kind(n - 1) == TokenType::END_OF_FILE && s.offset(n - 1) == end) n--;
+        } else {
+            n--;
+        }
+        keep[i] = n;
+        at[i] = total;
+        lineBase[i] = line;
+        numberAt[i] = numbers;
+        total += n;
+        numbers += s.numberCount();
+        for(LexError error : errors[i]) {
+            error.line += line;
+            std::cerr<<error.toString()<<"\n";
+        }
+        line += s.line(s.size() - 1) - 1; //NEWLINES CONSUMED BY THE CHUNK
+    }
+
+    TokenStream tokens(source);
+    tokens.resize(total , numbers);
+    for(size_t i = 0; i < parts; i++) {
+        pool.submit([&tokens , &streams , &keep , &at , &lineBase , &numberAt , &bounds , i] {
+            tokens.splice(at[i] , streams[i] , 0 , keep[i] ,
+                          static_cast<uint32_t>(bounds[i]) , static_cast<int>(lineBase[i]) , numberAt[i]);
+        });
+    }
+    pool.wait();
+    tokens.push(TokenType::END_OF_FILE , static_cast<uint32_t>(source.size()) , 0 , line + 1);
+    return tokens;
+}
@@ -0,0 +1,19 @@
+#ifndef PARALLEL_LEXER_H
+#define PARALLEL_LEXER_H
+
+#include "ThreadPool.h"
+#include "Token.h"
+#include <string_view>
+#include <vector>
+
+// Split points for chunked lexing : each boundary sits just past a newline
+// that is outside any string literal , so no token straddles two chunks.
+std::vector<size_t> findChunkBoundaries(std::string_view source , size_t chunks);
+
+// Lex the source in chunks on the pool and stitch the streams back together.
+// The result is identical to Lexer(source).tokenize() , and so are the
+// LexError messages : same lines , same order.
+TokenStream tokenizeParallel(std::string_view source , ThreadPool& pool ,
+                             size_t minChunkSize = 1 << 20);
+
+#endif // PARALLEL_LEXER_H
@@ -0,0 +1,99 @@
+#include "ParallelParser.h"
+#include "Parser.h"
+#include <atomic>
+#include <functional>
+
+namespace {
+
+// `let fn = ...` : the parser reports the `fn` as a bad variable name and
+// steps over it rather than starting a function there
+bool namesVariable(const TokenStream& tokens , size_t i) {
+    TokenType before = tokens.kind(i - 1);
+    return (before == TokenType::LET || before == TokenType::VAR)
+        && i + 1 < tokens.size() && tokens.kind(i + 1) == TokenType::ASSIGN;
+}
+
+} // namespace
+
+size_t functionEnd(const TokenStream& tokens , size_t start) {
+    size_t n = tokens.size();
+    size_t i = start;
+    if(i >= n || tokens.kind(i) != TokenType::FN) return 0;
+    // Skip the header up to the body's opening brace
+    while(i < n && tokens.kind(i) != TokenType::LBRACE && tokens.kind(i) != TokenType::END_OF_FILE) i++;
+    if(i == n || tokens.kind(i) != TokenType::LBRACE) return 0;
+    int depth = 0;
+    for(; i < n; i++) {
+        TokenType kind = tokens.kind(i);
+        if(kind == TokenType::LBRACE) depth++;
+        else if(kind == TokenType::RBRACE && --depth == 0) return i + 1;
+        else if(kind == TokenType::FN && !namesVariable(tokens , i)) return i; // closes the open blocks , as in Parser::blockContinues
+        else if(kind == TokenType::END_OF_FILE) return 0;
+    }
+    return 0;
+}
+
+std::vector<std::pair<size_t , size_t>> findFunctionBoundaries(const TokenStream& tokens) {
+    std::vector<std::pair<size_t , size_t>> ranges;
+    size_t i = 0;
+    while(i < tokens.size() && tokens.kind(i) != TokenType::END_OF_FILE) {
+        size_t end = functionEnd(tokens , i);
+        if(end == 0) return {};
+        ranges.emplace_back(i , end);
+        i = end;
+    }
+    return ranges;
+}
+
+void appendErrors(std::vector<ParseError>& errors , const std::vector<ParseError>& more) {
+    for(const ParseError& error : more) {
+        if(!errors.empty()) {
+            const ParseError& last = errors.back();
+            if(last.line == error.line && last.message == error.message && last.got == error.got
+               && last.gotText == error.gotText) continue;
+        }
+        errors.push_back(error);
+    }
+}
+
+Program parseParallel(const TokenStream& tokens , WorkStealingPool& pool , size_t grain) {
+    std::vector<std::pair<size_t , size_t>> ranges = findFunctionBoundaries(tokens);
+    if(ranges.size() < 2 || pool.size() < 2) {
+        Parser parser(tokens , 0 , tokens.size());
+        return parser.parseProgram();
+    }
+
+    Program program;
+    program.workerArenas.resize(pool.size());
+    program.functions.resize(ranges.size());
+    std::vector<std::vector<ParseError>> errors(ranges.size());
+    std::atomic<bool> whole{true};
+    if(grain == 0) grain = 1;
+
+    // Each task halves its range , leaving the upper half on the local deque
+    // for idle workers to steal , then parses what is left sequentially.
+    std::function<void(size_t , size_t , size_t)> parseRange =
+        [&](size_t first , size_t last , size_t worker) {
+            while(last - first > grain) {
+                size_t mid = first + (last - first) / 2;
+                pool.submit([&parseRange , mid , last](size_t w) { parseRange(mid , last , w); });
+                last = mid;
+            }
+            PhaseTimer timer(Phase::PARSE);
+            AstArena& arena = program.workerArenas[worker];
+            for(size_t f = first; f < last; f++) {
+                Parser parser(tokens , ranges[f].first , ranges[f].second);
+                if(!parser.parseSingleFunction(arena , program.functions[f])) whole.store(false , std::memory_order_relaxed);
+                errors[f] = parser.errors();
+            }
+        };
+    pool.submit([&parseRange , &ranges](size_t w) { parseRange(0 , ranges.size() , w); });
+    pool.wait();
+    if(!whole.load()) {
+        Parser parser(tokens , 0 , tokens.size());
+        return parser.parseProgram();
+    }
+    // Every range opens a body , so no function is null ; errors go in source order
+    for(const std::vector<ParseError>& e : errors) appendErrors(program.errors , e);
+    return program;
+}
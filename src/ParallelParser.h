@@ -0,0 +1,30 @@
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include "AST.h"
+#include "Token.h"
+#include "WorkStealingPool.h"
+#include <utility>
+#include <vector>
+
+// Index just past the closing brace of the function starting at tokens[start] ,
+// or of the `fn` met inside its body , which the parser takes as closing every
+// block left open , unless it is the bad name in `let fn =` or `var fn =`.
+// 0 when no `fn ... {` starts there or input ends first.
+size_t functionEnd(const TokenStream& tokens , size_t start);
+
+// Token ranges [first , second) of the top-level functions , found by brace
+// depth and `fn` tokens alone. Returns an empty list when the top level is not a clean
+// sequence of `fn ... { }` blocks , the sequential parser then reports the error.
+std::vector<std::pair<size_t , size_t>> findFunctionBoundaries(const TokenStream& tokens);
+
+// Append the errors of the next range , dropping a repeat of the last one as
+// Parser::error does within a single parse
+void appendErrors(std::vector<ParseError>& errors , const std::vector<ParseError>& more);
+
+// Parse every top-level function on the pool and merge them in source order.
+// Each worker allocates into its own arena , kept alive in Program::workerArenas.
+// The result prints identically to Parser(tokens).parseProgram().
+Program parseParallel(const TokenStream& tokens , WorkStealingPool& pool , size_t grain = 16);
+
+#endif // PARALLEL_PARSER_H
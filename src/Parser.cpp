@@ -1,20 +1,76 @@
 #include "Parser.h"
 #include "AST.h"
-#include <iostream>
 
-Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) , index(0) {}
+namespace {
 
-Token Parser::peek() const {
-    return (index < tokens.size()) ? tokens[index] : Token(TokenType::END_OF_FILE ,"EOF",-1);
+// ---- Binary operator precedence by TokenType , -1 for every other token ----
+struct PrecedenceTable {
+    int8_t of[static_cast<size_t>(TokenType::END_OF_FILE) + 1];
+
+    constexpr void set(TokenType type , int8_t precedence) { of[static_cast<size_t>(type)] = precedence; }
+
+    constexpr PrecedenceTable() : of() {
+        for(int8_t& p : of) p = -1;
+        set(TokenType::STAR , 5);          set(TokenType::SLASH , 5);      set(TokenType::MODULO , 5);
+        set(TokenType::PLUS , 4);          set(TokenType::MINUS , 4);
+        set(TokenType::LESS , 3);          set(TokenType::LESS_EQUAL , 3);
+        set(TokenType::GREATER , 3);       set(TokenType::GREATER_EQUAL , 3);
+        set(TokenType::EQUAL , 2);         set(TokenType::NOT_EQUAL , 2);
+        set(TokenType::AND , 1);           set(TokenType::OR , 1);
+        set(TokenType::XOR , 1);
+    }
+
+    int operator()(TokenType type) const { return of[static_cast<size_t>(type)]; }
+};
+
+constexpr PrecedenceTable precedence;
+
+} // namespace
+
+Parser::Parser(TokenStream tokens)
+    : tokens(std::move(tokens)) , stream(&this->tokens) , lexer(nullptr) , index(0) , end(this->tokens.size())
+    , head(0) , count(0) , arena(nullptr) , statementLine(0) , consumed(0) , lastLine(1) , statementStart() , statementConsumed(0) {}
+
+Parser::Parser(Lexer& lexer)
+    : stream(nullptr) , lexer(&lexer) , index(0) , end(0) , head(0) , count(0) , arena(nullptr) , statementLine(0) , consumed(0) , lastLine(1) , statementStart() , statementConsumed(0) {}
+
+Parser::Parser(const TokenStream& tokens , size_t begin , size_t end)
+    : stream(&tokens) , lexer(nullptr) , index(begin) , end(end) , head(0) , count(0) , arena(nullptr) , statementLine(0) , consumed(0) , lastLine(1) , statementStart() , statementConsumed(0) {}
+
+Token Parser::pull() {
+    if(lexer) return lexer->next();
+    if(index < end) return (*stream)[index++];
+    // A range cut at a 'fn' still shows it , so the blocks it leaves open
+    // close with the same errors as in a parse of the whole stream
+    if(index == end && end < stream->size() && stream->kind(end) == TokenType::FN) return (*stream)[index++];
+    return Token(TokenType::END_OF_FILE ,"EOF",-1);
+}
+
+void Parser::fill(size_t n) {
+    while(count < n) {
+        ring[(head + count) & (RING_SIZE - 1)] = pull();
+        count++;
+    }
+}
+
+const Token& Parser::peek() {
+    if(count == 0) fill(1);
+    return ring[head];
 }
 
-Token Parser::peek(size_t offsett) const {
-    size_t pos = index + offsett;
-    return (pos < tokens.size() ? tokens[pos] : Token(TokenType::END_OF_FILE , "EOF",-1));
+const Token& Parser::peek(size_t offsett) {
+    if(count <= offsett) fill(offsett + 1);
+    return ring[(head + offsett) & (RING_SIZE - 1)];
 }
 
 Token Parser::consume() {
-    return (index < tokens.size() ? tokens[index++] : Token(TokenType::END_OF_FILE , "EOF" , -1));
+    if(count == 0) fill(1);
+    Token tok = ring[head];
+    head = (head + 1) & (RING_SIZE - 1);
+    count--;
+    consumed++;
+    if(tok.line >= 0) lastLine = tok.line;
+    return tok;
 }
 
 bool Parser::match(TokenType type) {
@@ -25,52 +81,348 @@ bool Parser::match(TokenType type) {
     return false;
 }
 
-void Parser::expect(TokenType type, const std::string& errMsg) {
+void Parser::expect(TokenType type, const char* errMsg) {
     if (!match(type)) {
-        auto tk = peek();
-        std::cerr << "Parse Error: " << errMsg
-                  << " at line " << tk.line
-                  << ", got '" << tk.value << "'\n";
-        exit(1);
+        error(peek() , errMsg , type , true);
+        throw SyntaxError{};
     }
 }
 
-std::vector<std::unique_ptr<FunctionDecl>> Parser::parseProgram() {
-    std::vector<std::unique_ptr<FunctionDecl>> functions;
-    while(peek().type != TokenType::END_OF_FILE) {
-        functions.push_back(parseFunction());
+void Parser::error(const Token& got , const char* message , TokenType expected , bool expectsToken) {
+    int line = got.line >= 0 ? got.line : lastLine;
+    // A missing '}' is seen by every block it leaves open , at the same token , report it once
+    if(!diagnostics.empty()) {
+        const ParseError& last = diagnostics.back();
+        if(last.line == line && last.message == message && last.got == got.type && last.gotText == got.value) return;
+    }
+    diagnostics.push_back(ParseError{line , message , got.type , std::string(got.value) , expected , expectsToken});
+}
+
+void Parser::fail(const Token& got , const char* message) {
+    error(got , message , TokenType::END_OF_FILE , false);
+    throw SyntaxError{};
+}
+
+Parser::ScratchMarks Parser::marks() const {
+    return ScratchMarks{stmtScratch.size() , exprScratch.size() , armScratch.size() , paramScratch.size() ,
+                        ifScratch.size() , operandScratch.size() , operatorScratch.size()};
+}
+
+void Parser::restore(const ScratchMarks& m) {
+    stmtScratch.resize(m.stmts);
+    exprScratch.resize(m.exprs);
+    armScratch.erase(armScratch.begin() + m.arms , armScratch.end());
+    paramScratch.resize(m.params);
+    ifScratch.erase(ifScratch.begin() + m.ifs , ifScratch.end());
+    operandScratch.resize(m.operands);
+    operatorScratch.resize(m.operators);
+}
+
+// Skip to where the next statement can start : past a ';' , or before a
+// statement keyword , an assignment or the '}' closing the enclosing block.
+// A 'fn' or the end of input always stops. Braces opened while skipping are
+// skipped whole , so a broken `if` does not close the block around it.
+void Parser::synchronize() {
+    int depth = 0;
+    for(;;) {
+        TokenType type = peek().type;
+        if(type == TokenType::END_OF_FILE || type == TokenType::FN) return;
+        if(depth == 0) {
+            switch(type) {
+                case TokenType::RBRACE :
+                case TokenType::LET : case TokenType::VAR : case TokenType::RETURN :
+                case TokenType::IF : case TokenType::WHILE : case TokenType::FOR : case TokenType::MATCH :
+                    return;
+                case TokenType::IDENTIFIER :
+                    if(peek(1).type == TokenType::ASSIGN) return;
+                    break;
+                default : break;
+            }
+        }
+        consume();
+        if(type == TokenType::LBRACE) depth++;
+        else if(type == TokenType::RBRACE) depth--;
+        else if(type == TokenType::SEMICOLON && depth == 0) return;
+    }
+}
+
+// Drop what a failed statement built and skip to the next one
+void Parser::recover(const ScratchMarks& start , size_t startConsumed) {
+    restore(start);
+    TokenType type = peek().type;
+    bool closes = type == TokenType::RBRACE || type == TokenType::FN || type == TokenType::END_OF_FILE;
+    if(consumed == startConsumed && !closes) consume(); // could not even start , step over the culprit
+    synchronize();
+}
+
+// Parse one statement onto stmtScratch , or the header of one that opens a block
+void Parser::statementOrRecover() {
+    statementStart = marks();
+    statementConsumed = consumed;
+    try {
+        if(Statement* stmt = parseStatement()) stmtScratch.push_back(stmt);
+    } catch(const SyntaxError&) {
+        recover(statementStart , statementConsumed);
+    }
+}
+
+// The innermost block failed to close : drop the statement that opened it
+void Parser::dropBlock() {
+    OpenBlock block = blocks.back();
+    blocks.pop_back();
+    recover(block.start , block.startConsumed);
+}
+
+// False where a block's '}' is missing : at a 'fn' or the end of input
+bool Parser::blockContinues() {
+    TokenType type = peek().type;
+    if(type != TokenType::END_OF_FILE && type != TokenType::FN) return true;
+    error(peek() , "expected '}' to close block" , TokenType::RBRACE , true);
+    return false;
+}
+
+// False , with the error reported , for a literal the lexer found no value in
+bool Parser::checkNumber(const Token& tok) {
+    switch(tok.numberError) {
+        case NumberError::NONE : return true;
+        case NumberError::MALFORMED : error(tok , "malformed number literal" , TokenType::END_OF_FILE , false); return false;
+        case NumberError::OUT_OF_RANGE : error(tok , "number literal out of range" , TokenType::END_OF_FILE , false); return false;
+    }
+    return false;
+}
+
+// Identifiers arrive interned from the lexer , anything else used as a name is interned here
+SymbolId Parser::symbolOf(const Token& tok) {
+    return tok.symbol != NO_SYMBOL ? tok.symbol : symbols().intern(tok.value);
+}
+
+// The name a let , var or assignment binds : an identifier or `_`. Anything
+// else is stepped over when '=' follows it , so `let fn = 2;` resumes after
+// its ';' instead of taking the 'fn' for the next function.
+SymbolId Parser::bindingName() {
+    Token tok = peek();
+    if(tok.type == TokenType::IDENTIFIER || tok.type == TokenType::UNDERSCORE) return symbolOf(consume());
+    if(peek(1).type == TokenType::ASSIGN) consume();
+    fail(tok , "expected variable name");
+}
+
+Program Parser::parseProgram() {
+    PhaseTimer timer(Phase::PARSE);
+    Program program;
+    FunctionDecl* fn;
+    while(parseNextFunction(program.arena , fn)) {
+        if(fn) program.functions.push_back(fn);
+    }
+    program.errors = std::move(diagnostics);
+    diagnostics.clear();
+    return program;
+}
+
+bool Parser::parseNextFunction(AstArena& target , FunctionDecl*& fn) {
+    fn = nullptr;
+    if(peek().type != TokenType::FN && peek().type != TokenType::END_OF_FILE) {
+        error(peek() , "expected 'fn' to start function" , TokenType::FN , true);
+        do consume(); while(peek().type != TokenType::FN && peek().type != TokenType::END_OF_FILE);
+    }
+    if(peek().type == TokenType::END_OF_FILE) return false;
+    arena = &target;
+    size_t before = target.bytesUsed();
+    fn = parseFunction();
+    if(CompileStats::enabled) CompileStats::local().astBytes += target.bytesUsed() - before;
+    arena = nullptr;
+    return true;
+}
+
+bool Parser::parseSingleFunction(AstArena& target , FunctionDecl*& fn) {
+    arena = &target;
+    size_t before = target.bytesUsed();
+    fn = parseFunction();
+    if(CompileStats::enabled) CompileStats::local().astBytes += target.bytesUsed() - before;
+    arena = nullptr;
+    return peek().type == TokenType::END_OF_FILE || peek().type == TokenType::FN;
+}
+
+FunctionDecl* Parser::parseFunction() {
+    SymbolId name = NO_SYMBOL;
+    size_t paramMark = paramScratch.size();
+    int line = peek().line;
+    try {
+        expect(TokenType::FN , "expected 'fn' to start function");
+        Token nameTok = peek();
+        if(nameTok.type != TokenType::IDENTIFIER) fail(nameTok , "expected function name");
+        name = symbolOf(consume());
+        expect(TokenType::LPAREN , "expected '(' after function name");
+
+        if(peek().type != TokenType::RPAREN) {
+            do {
+                Token p = peek();
+                if(p.type != TokenType::IDENTIFIER) fail(p , "expected parameter name");
+                paramScratch.push_back(symbolOf(consume()));
+            } while(match(TokenType::COMMA));
+        }
+        expect(TokenType::RPAREN,"expected ')' after parameters");
+        expect(TokenType::LBRACE,"expected '{' before function body");
+    } catch(const SyntaxError&) {
+        // Skip the rest of the header , the body is still worth parsing
+        while(peek().type != TokenType::LBRACE && peek().type != TokenType::END_OF_FILE) consume();
+        if(!match(TokenType::LBRACE)) {
+            paramScratch.resize(paramMark);
+            return nullptr;
+        }
+        if(name == NO_SYMBOL) name = symbols().intern("");
     }
-    return functions;
+
+    AstList<SymbolId> params = finish(paramScratch , paramMark);
+
+    size_t bodyMark = stmtScratch.size();
+    statementStart = marks();
+    statementConsumed = consumed;
+    openBlock(BlockKind::BODY , nullptr);
+    parseBlocks();
+    AstList<Statement*> body = finish(stmtScratch , bodyMark);
+
+    return make<FunctionDecl>(line , name , params , body);
 }
 
-std::unique_ptr<FunctionDecl> Parser::parseFunction() {
-    expect(TokenType::FN , "expected 'fn' to start function");
-    Token name = consume();
-    expect(TokenType::LPAREN , "expected '(' after function name");
+// ---- Blocks ----
 
-    std::vector<std::string> params;
-    if(peek().type != TokenType::RPAREN) {
-        do {
-            Token p = consume();
-            if(p.type != TokenType::IDENTIFIER) {
-                std::cerr << "Parse Error : expected parameter name , got '" << p.value <<"'\n";
-                exit(1);
+void Parser::openBlock(BlockKind kind , Expression* expr , SymbolId name) {
+    size_t mark = kind == BlockKind::MATCH ? armScratch.size() : ifScratch.size();
+    blocks.push_back(OpenBlock{kind , false , stmtScratch.size() , mark , expr , name , statementStart , statementConsumed ,
+                               statementLine});
+}
+
+// Parse statements into the innermost open block , closing blocks at their
+// '}' , until the block that was innermost on entry has closed
+void Parser::parseBlocks() {
+    size_t depth = blocks.size();
+    while(blocks.size() >= depth) {
+        OpenBlock& top = blocks.back();
+        if(top.kind == BlockKind::MATCH) {
+            try {
+                nextArm();
+            } catch(const SyntaxError&) {
+                dropBlock();
+            }
+            continue;
+        }
+        if(top.kind == BlockKind::ARM_SINGLE) {
+            if(top.filled) {
+                closeBlock();
+                continue;
             }
-            params.push_back(p.value);
-        } while(match(TokenType::COMMA));
+            top.filled = true;
+        } else if(match(TokenType::RBRACE) || !blockContinues()) {
+            try {
+                closeBlock();
+            } catch(const SyntaxError&) {
+                dropBlock();
+            }
+            continue;
+        }
+        statementOrRecover();
     }
-    expect(TokenType::RPAREN,"expected ')' after parameters");
-    expect(TokenType::LBRACE,"expected '{' before function body");
+}
 
-    std::vector<std::unique_ptr<Statement>> body;
-    while(!match(TokenType::RBRACE)) {
-        body.push_back(parseStatement());
+// Build the innermost block's statement into the block around it
+void Parser::closeBlock() {
+    OpenBlock& top = blocks.back();
+    Statement* stmt = nullptr;
+    switch(top.kind) {
+        case BlockKind::BODY :
+            blocks.pop_back();
+            return;
+        case BlockKind::THEN : {
+            ifScratch.push_back(IfLink{top.expr , finish(stmtScratch , top.stmts) , top.line});
+            if(!match(TokenType::ELSE)) {
+                closeIf(AstList<Statement*>());
+                return;
+            }
+            // The chain goes on in the same block , an error here drops all of it
+            if(peek().type == TokenType::IF) {
+                top.line = consume().line;
+                expect(TokenType::LPAREN , "expected '(' after if");
+                top.expr = parseExpression();
+                expect(TokenType::RPAREN , "expected ')' after condition");
+                expect(TokenType::LBRACE , "expected '{' then");
+            } else {
+                expect(TokenType::LBRACE , "expected '{' after else");
+                top.kind = BlockKind::ELSE;
+            }
+            top.stmts = stmtScratch.size();
+            return;
+        }
+        case BlockKind::ELSE :
+            closeIf(finish(stmtScratch , top.stmts));
+            return;
+        case BlockKind::WHILE :
+            stmt = make<WhileStatement>(top.line , top.expr , finish(stmtScratch , top.stmts));
+            break;
+        case BlockKind::FOR :
+            stmt = make<ForStatement>(top.line , top.name , top.expr , finish(stmtScratch , top.stmts));
+            break;
+        case BlockKind::MATCH :
+            stmt = make<MatchStatement>(top.line , top.expr , finish(armScratch , top.mark));
+            break;
+        case BlockKind::ARM :
+        case BlockKind::ARM_SINGLE :
+            if(top.expr) armScratch.emplace_back(top.expr , finish(stmtScratch , top.stmts));
+            else stmtScratch.resize(top.stmts);
+            blocks.pop_back();
+            match(TokenType::COMMA);
+            return;
+    }
+    blocks.pop_back();
+    stmtScratch.push_back(stmt);
+}
+
+// `else if` nests : each link becomes the else branch of the one before it
+void Parser::closeIf(AstList<Statement*> elseBranch) {
+    size_t chain = blocks.back().mark;
+    Statement* stmt = nullptr;
+    for(size_t i = ifScratch.size(); i-- > chain;) {
+        stmt = make<IfStatement>(ifScratch[i].line , ifScratch[i].condition , ifScratch[i].thenBranch , elseBranch);
+        elseBranch = arena->copyList(&stmt , 1);
+    }
+    ifScratch.erase(ifScratch.begin() + chain , ifScratch.end());
+    blocks.pop_back();
+    stmtScratch.push_back(stmt);
+}
+
+// Inside a match , between arms : open the next arm or close the match
+void Parser::nextArm() {
+    if(peek().type == TokenType::RBRACE || !blockContinues()) {
+        match(TokenType::RBRACE); // a missing one was reported by blockContinues()
+        closeBlock();
+        return;
     }
 
-    return std::make_unique<FunctionDecl>(name.value , std::move(params) , std::move(body)); 
+    Expression* pat = nullptr;
+    Token t = peek();
+    if (isNumberLiteral(t.type) && !checkNumber(t)) {
+        consume(); // reported , the arm is parsed and dropped
+    } else if (isNumberLiteral(t.type) || t.type == TokenType::STRING_LITERAL || t.type == TokenType::IDENTIFIER) {
+        pat = parsePrimary();
+    } else if (t.type == TokenType::UNDERSCORE) {
+        consume();
+        pat = make<VariableExpr>(t.line , symbols().intern("_"));
+    } else {
+        // Skip to the arm's '=>' , its body is parsed and dropped
+        error(t , "expected a match pattern" , TokenType::END_OF_FILE , false);
+        while (peek().type != TokenType::ARROW && peek().type != TokenType::RBRACE &&
+               peek().type != TokenType::FN && peek().type != TokenType::END_OF_FILE) consume();
+        if (peek().type != TokenType::ARROW) return;
+    }
+
+    expect(TokenType::ARROW, "expected '=>' after match pattern");
+    // An arm never fails to close , the recovery marks it keeps go unused
+    openBlock(match(TokenType::LBRACE) ? BlockKind::ARM : BlockKind::ARM_SINGLE , pat);
 }
 
-std::unique_ptr<Statement> Parser::parseStatement() {
+// ---- Statements ----
+
+Statement* Parser::parseStatement() {
+    statementLine = peek().line;
     if(match(TokenType::LET)) return parseLetStatement();
     if(match(TokenType::VAR)) return parseVarStatement();
     if(match(TokenType::RETURN)) return parseReturnStatement();
@@ -80,171 +432,178 @@ std::unique_ptr<Statement> Parser::parseStatement() {
     if (match(TokenType::MATCH)) return parseMatchStatement();
     if(peek().type == TokenType::IDENTIFIER && peek(1).type == TokenType::ASSIGN) return parseAssignStatement();
 
-    std::cerr << "Parse Error : unexpected statement at line "<< peek().line <<"\n";
-    exit(1);
+    fail(peek() , "expected a statement");
 }
 
-std::unique_ptr<Statement> Parser::parseLetStatement() {
-    Token name = consume();
+Statement* Parser::parseLetStatement() {
+    SymbolId name = bindingName();
     expect(TokenType::ASSIGN , "expected '=' after variable name");
     auto value = parseExpression();
     expect(TokenType::SEMICOLON , "expected ';' after let declaration");
-    return std::make_unique<LetStatement>(name.value , std::move(value));
+    return make<LetStatement>(statementLine , name , value);
 }
 
-std::unique_ptr<Statement> Parser::parseVarStatement() {
-    Token name = consume();
+Statement* Parser::parseVarStatement() {
+    SymbolId name = bindingName();
     expect(TokenType::ASSIGN , "expected '=' after variable name");
     auto value = parseExpression();
     expect(TokenType::SEMICOLON , "expected ';' after var declaration");
-    return std::make_unique<VarStatement>(name.value , std::move(value));
+    return make<VarStatement>(statementLine , name , value);
 }
 
-std::unique_ptr<Statement> Parser::parseAssignStatement() {
-    Token name = consume();                      
+Statement* Parser::parseAssignStatement() {
+    SymbolId name = bindingName();
     expect(TokenType::ASSIGN, "expected '=' in assignment");
     auto value = parseExpression();
     expect(TokenType::SEMICOLON, "expected ';' after assignment");
-    return std::make_unique<AssignStatement>(name.value, std::move(value));
+    return make<AssignStatement>(statementLine , name , value);
 }
 
-std::unique_ptr<Statement> Parser::parseReturnStatement() {
+Statement* Parser::parseReturnStatement() {
     auto value = parseExpression();
     expect(TokenType::SEMICOLON, "expected ';' after return");
-    return std::make_unique<ReturnStatement>(std::move(value));
+    return make<ReturnStatement>(statementLine , value);
 }
 
-std::unique_ptr<Statement> Parser::parseIfStatement() {
+// The compound statements parse their header and open a block , closeBlock()
+// builds the node once the block's '}' is reached
+
+Statement* Parser::parseIfStatement() {
     expect(TokenType::LPAREN , "expected '(' after if");
     auto cond = parseExpression();
     expect(TokenType::RPAREN , "expected ')' after condition");
     expect(TokenType::LBRACE , "expected '{' then");
-    std::vector<std::unique_ptr<Statement>> thenStmts = parseBlock() ;
-    std::vector<std::unique_ptr<Statement>> elseStmts;
-    
-    if(match(TokenType::ELSE)) {
-        if(match(TokenType::IF)) {
-            elseStmts.push_back(parseIfStatement());
-        } else {
-            expect(TokenType::LBRACE , "expected '{' after else");
-            elseStmts = parseBlock(); 
-        }
-    }
-    return std::make_unique<IfStatement>(std::move(cond) , std::move(thenStmts) , std::move(elseStmts));
+    openBlock(BlockKind::THEN , cond);
+    return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::parseWhileStatement() {
+Statement* Parser::parseWhileStatement() {
     expect(TokenType::LPAREN , "expected '(' after while");
     auto cond = parseExpression();
     expect(TokenType::RPAREN , "expected ')' after condition");
     expect(TokenType::LBRACE , "expected '{' after while");
-    auto body = parseBlock();
-    return std::make_unique<WhileStatement>(std::move(cond) , std::move(body));
+    openBlock(BlockKind::WHILE , cond);
+    return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::parseForStatement() {
-    Token itname = consume();
+Statement* Parser::parseForStatement() {
+    Token itname = peek();
     expect(TokenType::IDENTIFIER , "expected iterator name");
     expect(TokenType::IN , "expected 'in' in for");
     auto iterable = parseExpression();
     expect(TokenType::LBRACE , "expected '{' after for");
-    auto body = parseBlock();
-    return std::make_unique<ForStatement>(itname.value , std::move(iterable) , std::move(body));
+    openBlock(BlockKind::FOR , iterable , itname.symbol);
+    return nullptr;
 }
 
-std::unique_ptr<Statement> Parser::parseMatchStatement() {
+Statement* Parser::parseMatchStatement() {
     auto expr = parseExpression();
-
     expect(TokenType::LBRACE, "expected '{' after match expression");
+    openBlock(BlockKind::MATCH , expr);
+    return nullptr;
+}
 
-    std::vector<MatchArm> arms;
-    while (peek().type != TokenType::RBRACE && peek().type != TokenType::END_OF_FILE) {
-        std::unique_ptr<Expression> pat;
-        Token t = peek();
-        if (t.type == TokenType::INTEGER_LITERAL || t.type == TokenType::FLOAT_LITERAL ||
-            t.type == TokenType::STRING_LITERAL || t.type == TokenType::IDENTIFIER) {
-            pat = parsePrimary();
-        } else if (t.type == TokenType::UNDERSCORE) {
-            consume();
-            pat = std::make_unique<VariableExpr>("_");
-        } else {
-            std::cerr << "Parse Error: unexpected pattern '" 
-                      << t.value << "' in match arm at line " 
-                      << t.line << "\n";
-            exit(1);
+// ---- Expressions ----
+
+// Operator precedence over explicit operand and operator stacks. '(' and the
+// '(' of a call push a marker , ')' and ',' reduce down to it , so neither
+// nesting nor long chains use the native stack. Builds the same tree as
+// precedence climbing : binary operators are left associative , calls bind
+// tighter than any of them and a prefix '!' binds tighter than a binary
+// operator but looser than a call.
+Expression* Parser::parseExpression() {
+    size_t operatorBase = operatorScratch.size();
+    for(;;) {
+        // An operand : a literal or a name after any number of '(' and '!'
+        for(;;) {
+            if(match(TokenType::LPAREN)) operatorScratch.push_back(PendingOp{TokenType::LPAREN , GROUP , 0});
+            else if(peek().type == TokenType::NOT) {
+                operatorScratch.push_back(PendingOp{TokenType::NOT , PREFIX , static_cast<size_t>(peek().line)});
+                consume();
+            } else break;
         }
+        operandScratch.push_back(parsePrimary());
+
+        // Then calls and closing groups , until a binary operator wants the
+        // next operand or a token ends the expression
+        for(;;) {
+            TokenType type = peek().type;
+            int prec = precedence(type);
+            if(prec >= 0) {
+                reduce(operatorBase , prec);
+                consume();
+                operatorScratch.push_back(PendingOp{type , static_cast<int8_t>(prec) , 0});
+                break;
+            }
+            if(type == TokenType::LPAREN) {
+                consume();
+                if(match(TokenType::RPAREN)) {
+                    Expression* callee = operandScratch.back();
+                    operandScratch.back() = make<CallExpr>(callee->line , callee , AstList<Expression*>());
+                    continue;
+                }
+                operatorScratch.push_back(PendingOp{TokenType::LPAREN , CALL , exprScratch.size()});
+                break;
+            }
 
-        expect(TokenType::ARROW, "expected '=>' after match pattern");
-        std::vector<std::unique_ptr<Statement>> body;
-        if (match(TokenType::LBRACE)) {
-            while (!match(TokenType::RBRACE)) {
-                body.push_back(parseStatement());
+            reduce(operatorBase , 0);
+            if(operatorScratch.size() == operatorBase) {
+                Expression* expr = operandScratch.back();
+                operandScratch.pop_back();
+                return expr;
+            }
+            PendingOp group = operatorScratch.back();
+            if(group.precedence == GROUP) {
+                expect(TokenType::RPAREN , "expected ')' after expression");
+                operatorScratch.pop_back();
+                continue;
             }
-        } else {
-            body.push_back(parseStatement());
+            // An argument is complete
+            exprScratch.push_back(operandScratch.back());
+            operandScratch.pop_back();
+            if(match(TokenType::COMMA)) break;
+            expect(TokenType::RPAREN , "expected ')' after call args");
+            operatorScratch.pop_back();
+            AstList<Expression*> args = finish(exprScratch , group.args);
+            Expression* callee = operandScratch.back();
+            operandScratch.back() = make<CallExpr>(callee->line , callee , args);
         }
-
-        arms.emplace_back(std::move(pat), std::move(body));
-        match(TokenType::COMMA);
     }
-
-    expect(TokenType::RBRACE, "expected '}' to close match");
-    
-    return std::make_unique<MatchStatement>(std::move(expr), std::move(arms));
 }
 
-
-std::vector<std::unique_ptr<Statement>> Parser::parseBlock() {
-    std::vector<std::unique_ptr<Statement>> stmts;
-    while(!match(TokenType::RBRACE) && peek().type != TokenType::END_OF_FILE) {
-        stmts.push_back(parseStatement());
+// Fold pending operators of at least `minPrecedence` , stopping at a marker
+void Parser::reduce(size_t operatorBase , int minPrecedence) {
+    while(operatorScratch.size() > operatorBase && operatorScratch.back().precedence >= minPrecedence) {
+        PendingOp pending = operatorScratch.back();
+        TokenType op = pending.op;
+        operatorScratch.pop_back();
+        if(pending.precedence == PREFIX) {
+            operandScratch.back() = make<UnaryExpr>(static_cast<int>(pending.args) , op , operandScratch.back());
+            continue;
+        }
+        Expression* right = operandScratch.back();
+        operandScratch.pop_back();
+        Expression* left = operandScratch.back();
+        operandScratch.back() = make<BinaryExpr>(left->line , left , op , right);
     }
-    return stmts;
 }
 
-std::unique_ptr<Expression> Parser::parseExpression() {
-    return parseBinary(0);
-}
-
-std::unique_ptr<Expression> Parser::parseBinary(int minPerc) {
-    auto left = parsePrimary();
-
-    while(true) {
-        auto op = peek();
-        int prec = PRECEDENCE[op.type];
-        if(prec < minPerc) break;
+// A literal or a name , also the whole of a match pattern
+Expression* Parser::parsePrimary() {
+    Token tok = peek();
+    if(isNumberLiteral(tok.type)) {
         consume();
-        auto right = parseBinary(prec+1);
-        left = std::make_unique<BinaryExpr>(std::move(left) , op , std::move(right));
-    }
-    return left;
-}
-
-std::unique_ptr<Expression> Parser::parsePrimary() {
-    Token tok = consume();
-    if(tok.type == TokenType::INTEGER_LITERAL || tok.type == TokenType::FLOAT_LITERAL) {
-        return std::make_unique<NumberExpr>(tok.value);
+        if(!checkNumber(tok)) throw SyntaxError{};
+        return make<NumberExpr>(tok.line , tok.number , tok.type == TokenType::FLOAT_LITERAL);
     }
     if(tok.type == TokenType::IDENTIFIER) {
-        return std::make_unique<VariableExpr>(tok.value);
-    } 
-    std::cerr << "Parse Error : unexpected token '" << tok.value << "' at line" << tok.line << "\n";
-    exit(1);
-}
-
-std::unique_ptr<Expression> Parser::parseCallOrPrimary() {
-    auto expr = parsePrimary();
-    while(match(TokenType::LPAREN)) {
-        std::vector<std::unique_ptr<Expression>> args;
-        if(peek().type != TokenType::RPAREN) {
-            do {
-                args.push_back(parseExpression());
-            } while(match(TokenType::COMMA));
-        }
-        expect(TokenType::RPAREN , "expected ')' after call args");
-        expr = std::make_unique<CallExpr>(std::move(expr) , std::move(args)); 
+        consume();
+        return make<VariableExpr>(tok.line , tok.symbol);
     }
-    return expr; 
+    if(tok.type == TokenType::STRING_LITERAL) {
+        consume();
+        return make<StringExpr>(tok.line , tok.symbol);
+    }
+    // Not consumed : a '}' or 'fn' here is where recovery resumes
+    fail(tok , "expected an expression");
 }
-
-
@@ -4,54 +4,191 @@
 #include "Lexer.h"
 #include "AST.h"
 #include <vector>
-#include <memory>
-#include <unordered_map>
-
-static std::unordered_map<TokenType , int> PRECEDENCE = {
-    {TokenType::STAR , 5} , {TokenType::SLASH , 5} , {TokenType::MODULO , 5},
-    {TokenType::PLUS , 4} , {TokenType::MINUS , 4} ,
-    {TokenType::LESS , 3} , {TokenType::LESS_EQUAL , 3},
-    {TokenType::GREATER , 3} , {TokenType::GREATER_EQUAL , 3},
-    {TokenType::EQUAL , 2} , {TokenType::NOT_EQUAL , 2},
-    {TokenType::AND , 1} , {TokenType::OR , 1} , {TokenType::NOT , 1} , {TokenType::XOR , 1},
-};
 
+// Recursion-free : nested blocks and nested expressions are kept on heap
+// stacks , so how deep a source nests is bounded by memory , not by the
+// native stack.
 class Parser {
     private:
-        std::vector<Token> tokens;
+        // Maximum lookahead of the grammar : IDENTIFIER ASSIGN in parseStatement
+        static constexpr size_t LOOKAHEAD = 2;
+        static constexpr size_t RING_SIZE = 4; // power of two >= LOOKAHEAD
+        static_assert((RING_SIZE & (RING_SIZE - 1)) == 0 && RING_SIZE >= LOOKAHEAD , "bad ring size");
+
+        // Token source : either a prebuilt stream or a lexer pulled on demand.
+        // `stream` points at `tokens` or at a caller's stream parsed by range.
+        TokenStream tokens;
+        const TokenStream* stream;
+        Lexer* lexer;
         size_t index;
+        size_t end;
+
+        // Ring buffer holding the next few tokens
+        Token ring[RING_SIZE];
+        size_t head;
+        size_t count;
+
+        // Nodes go to the arena of the program being parsed. Child lists are
+        // collected on scratch stacks and copied out once complete.
+        AstArena* arena;
+        int statementLine; // of the statement being parsed , its node starts there
+        std::vector<Statement*> stmtScratch;
+        std::vector<Expression*> exprScratch;
+        std::vector<MatchArm> armScratch;
+        std::vector<SymbolId> paramScratch;
+
+        // Syntax errors are recorded and then thrown as SyntaxError , which
+        // is caught where the parser can resynchronize : around each
+        // statement and around a function header. Nothing escapes the parser.
+        struct SyntaxError {};
+        struct ScratchMarks {
+            size_t stmts , exprs , arms , params , ifs , operands , operators;
+        };
+        std::vector<ParseError> diagnostics;
+        size_t consumed; // tokens taken so far , tells a recovery whether it moved
+        int lastLine;    // of the last token taken , for errors at the end of a range
+
+        // ---- Statement nesting ----
+        // A block being filled. Statements go to stmtScratch from `stmts` on
+        // and the node is built when the block closes. An error while closing
+        // (a bad `else if` header , a bad arm) drops the statement that opened
+        // it , back to `start`.
+        enum class BlockKind : uint8_t {
+            BODY,       // a function body , built by parseFunction
+            THEN,       // if and else if , `mark` is where the chain starts in ifScratch
+            ELSE,
+            WHILE,
+            FOR,
+            MATCH,      // between arms , `mark` is the armScratch mark
+            ARM,        // `pattern => { ... }` , a null `expr` drops the arm
+            ARM_SINGLE  // `pattern => statement`
+        };
+        struct OpenBlock {
+            BlockKind kind;
+            bool filled;        // ARM_SINGLE : its one statement was parsed
+            size_t stmts;
+            size_t mark;
+            Expression* expr;   // condition , iterable , match subject or arm pattern
+            SymbolId name;      // FOR : iterator
+            ScratchMarks start;
+            size_t startConsumed;
+            int line;           // of the statement the block builds
+        };
+        // A parsed `if` or `else if` , linked into nested IfStatements when the chain ends
+        struct IfLink {
+            Expression* condition;
+            AstList<Statement*> thenBranch;
+            int line;
+        };
+        std::vector<OpenBlock> blocks;
+        std::vector<IfLink> ifScratch;
+        ScratchMarks statementStart; // of the statement being parsed , a block it opens keeps it
+        size_t statementConsumed;
+
+        // ---- Expression nesting ----
+        // Operands and pending operators. An open '(' and an open call sit on
+        // the operator stack as markers below every binary precedence , a
+        // prefix '!' above them all.
+        static constexpr int8_t GROUP = -2;
+        static constexpr int8_t CALL = -3; // `args` is the exprScratch mark of its arguments
+        static constexpr int8_t PREFIX = 6; // `args` is the line of the '!'
+        struct PendingOp {
+            TokenType op;
+            int8_t precedence;
+            size_t args;
+        };
+        std::vector<Expression*> operandScratch;
+        std::vector<PendingOp> operatorScratch;
+
+        template <typename T>
+        AstList<T> finish(std::vector<T>& scratch , size_t mark) {
+            AstList<T> list = arena->copyList(scratch.data() + mark , scratch.size() - mark);
+            scratch.erase(scratch.begin() + mark , scratch.end());
+            return list;
+        }
+
+        // A node in the current arena , starting at `line`
+        template <typename T , typename... Args>
+        T* make(int line , Args&&... args) {
+            T* node = arena->create<T>(std::forward<Args>(args)...);
+            node->line = line;
+            return node;
+        }
 
         // Helpers
-        Token peek() const;
-        Token peek(size_t offset) const;
+        Token pull();
+        void fill(size_t n);
+        const Token& peek();
+        const Token& peek(size_t offset);
         Token consume();
         bool match(TokenType type);
-        void expect(TokenType type , const std::string& errorMessage);
+        void expect(TokenType type , const char* errorMessage);
+        SymbolId symbolOf(const Token& tok);
+        SymbolId bindingName();
+        bool checkNumber(const Token& tok);
+
+        // Error recovery
+        void error(const Token& got , const char* message , TokenType expected , bool expectsToken);
+        [[noreturn]] void fail(const Token& got , const char* message);
+        ScratchMarks marks() const;
+        void restore(const ScratchMarks& marks);
+        void synchronize();
+        void recover(const ScratchMarks& start , size_t startConsumed);
+        void statementOrRecover();
+        void dropBlock();
+        bool blockContinues();
 
         // Parsing primitives
-        std::unique_ptr<Expression> parseExpression();
-        std::unique_ptr<Expression> parsePrimary();
-        std::unique_ptr<Expression> parseBinary(int minPrecedence);
-        std::unique_ptr<Expression> parseCallOrPrimary();
-        std::vector<std::unique_ptr<Statement>> parseBlock();
-
-        // Statements
-        std::unique_ptr<Statement> parseStatement();
-        std::unique_ptr<Statement> parseLetStatement();
-        std::unique_ptr<Statement> parseVarStatement();
-        std::unique_ptr<Statement> parseAssignStatement();
-        std::unique_ptr<Statement> parseIfStatement();
-        std::unique_ptr<Statement> parseWhileStatement();
-        std::unique_ptr<Statement> parseForStatement();
-        std::unique_ptr<Statement> parseMatchStatement();
-        std::unique_ptr<Statement> parseReturnStatement();
+        Expression* parseExpression();
+        Expression* parsePrimary();
+        void reduce(size_t operatorBase , int minPrecedence);
+
+        // Blocks
+        void openBlock(BlockKind kind , Expression* expr , SymbolId name = NO_SYMBOL);
+        void parseBlocks();
+        void closeBlock();
+        void closeIf(AstList<Statement*> elseBranch);
+        void nextArm();
+
+        // Statements : null when the statement opened a block instead
+        Statement* parseStatement();
+        Statement* parseLetStatement();
+        Statement* parseVarStatement();
+        Statement* parseAssignStatement();
+        Statement* parseIfStatement();
+        Statement* parseWhileStatement();
+        Statement* parseForStatement();
+        Statement* parseMatchStatement();
+        Statement* parseReturnStatement();
         
         // Functions
-        std::unique_ptr<FunctionDecl> parseFunction();
+        FunctionDecl* parseFunction();
     
     public:
-        Parser(std::vector<Token> tokens);
-        std::vector<std::unique_ptr<FunctionDecl>> parseProgram();     
+        Parser(TokenStream tokens);
+        // Streaming mode : tokens are pulled from the lexer as the parser needs them
+        Parser(Lexer& lexer);
+        // Parse tokens [begin , end) of a stream owned by the caller , which must outlive the parser
+        Parser(const TokenStream& tokens , size_t begin , size_t end);
+        Parser(const Parser&) = delete;
+        Parser& operator=(const Parser&) = delete;
+
+        // Never stops at a syntax error : every error lands in Program::errors
+        // and the functions around it are still parsed
+        Program parseProgram();
+        // Parse exactly one function into `target` , used by the parallel and
+        // incremental drivers. False when the function ended before the range
+        // did : recovery saw the braces differently from the boundary scan , so
+        // the caller parses the whole stream instead. Errors stay in errors() ;
+        // `fn` is null only when no '{' opens a body.
+        bool parseSingleFunction(AstArena& target , FunctionDecl*& fn);
+        // Parse the next function of the input into `target` , skipping what
+        // cannot start one. False at the end of input. `fn` is null when the
+        // function was too broken to keep , its errors are in errors().
+        // Streams a program one function at a time : each may go to its own arena.
+        bool parseNextFunction(AstArena& target , FunctionDecl*& fn);
+
+        const std::vector<ParseError>& errors() const { return diagnostics; }
 };
 
 
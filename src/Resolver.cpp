@@ -0,0 +1,211 @@
+#include "Resolver.h"
+#include "Stats.h"
+#include <algorithm>
+
+namespace {
+
+class FunctionResolver {
+    private :
+        struct Binding {
+            SymbolId name;
+            uint16_t slot;
+            uint16_t scope;
+            bool constant; // a let
+        };
+
+        // Where to unwind to when a scope closes
+        struct Mark {
+            size_t bindings;
+            uint16_t nextSlot;
+        };
+
+        FunctionDecl* fn;
+        SymbolId wildcard;
+        std::vector<CompileError>& errors;
+        std::vector<Binding> bindings;
+        uint16_t scope = 0;
+        uint16_t nextSlot = 0;
+        uint16_t frameSlots = 0;
+        uint32_t numbered = 0;
+        bool outOfSlots = false; // reported once , later bindings get no slot
+
+        void error(int line , const std::string& message) {
+            errors.push_back(CompileError{line , message + " in function " + std::string(symbolText(fn->name))});
+        }
+
+        uint16_t bind(SymbolId name , bool constant , int line) {
+            uint16_t slot = nextSlot;
+            if(slot == VarRef::UNRESOLVED) {
+                if(!outOfSlots) error(line , "too many local variables");
+                outOfSlots = true;
+            } else {
+                frameSlots = std::max<uint16_t>(frameSlots , ++nextSlot);
+            }
+            // Bound even without a slot , so its uses are not reported as undefined
+            bindings.push_back(Binding{name , slot , scope , constant});
+            return slot;
+        }
+
+        const Binding* lookup(SymbolId name) const {
+            for(size_t i = bindings.size(); i-- > 0;) {
+                if(bindings[i].name == name) return &bindings[i];
+            }
+            return nullptr;
+        }
+
+        VarRef refer(const Binding& b) {
+            VarRef ref;
+            ref.depth = static_cast<uint16_t>(scope - b.scope);
+            ref.slot = b.slot;
+            return ref;
+        }
+
+        Mark open() {
+            scope++;
+            return Mark{bindings.size() , nextSlot};
+        }
+
+        void close(const Mark& mark) {
+            bindings.resize(mark.bindings);
+            nextSlot = mark.nextSlot;
+            scope--;
+        }
+
+        void expression(Expression* expr);
+        void statement(Statement* stmt);
+        void block(const AstList<Statement*>& body);
+
+    public :
+        FunctionResolver(FunctionDecl* fn , std::vector<CompileError>& errors)
+            : fn(fn) , wildcard(symbols().intern("_")) , errors(errors) {}
+
+        void resolve();
+};
+
+void FunctionResolver::resolve() {
+    if(nestingDepth(fn) > MAX_NESTING) { // too deep to walk safely , left unresolved
+        error(fn->line , "nesting deeper than " + std::to_string(MAX_NESTING) + " levels");
+        return;
+    }
+    for(SymbolId param : fn->params) bind(param , false , fn->line);
+    block(fn->body);
+    fn->frameSlots = frameSlots;
+    fn->expressions = numbered;
+}
+
+void FunctionResolver::block(const AstList<Statement*>& body) {
+    Mark mark = open();
+    for(Statement* stmt : body) statement(stmt);
+    close(mark);
+}
+
+void FunctionResolver::expression(Expression* expr) {
+    expr->index = numbered < ASTNode::UNNUMBERED ? numbered++ : ASTNode::UNNUMBERED;
+    switch(expr->kind) {
+        case AstKind::VARIABLE : {
+            auto var = static_cast<VariableExpr*>(expr);
+            const Binding* b = lookup(var->name);
+            if(!b) {
+                error(var->line , "undefined variable '" + std::string(symbolText(var->name)) + "'");
+                var->ref = VarRef();
+                return;
+            }
+            var->ref = refer(*b);
+            return;
+        }
+        case AstKind::UNARY : return expression(static_cast<UnaryExpr*>(expr)->operand);
+        case AstKind::BINARY : {
+            auto bin = static_cast<BinaryExpr*>(expr);
+            expression(bin->left);
+            expression(bin->right);
+            return;
+        }
+        case AstKind::CALL : {
+            auto call = static_cast<CallExpr*>(expr);
+            if(call->callee->kind != AstKind::VARIABLE) expression(call->callee);
+            for(Expression* arg : call->arguments) expression(arg);
+            return;
+        }
+        default : return; // literals
+    }
+}
+
+void FunctionResolver::statement(Statement* stmt) {
+    switch(stmt->kind) {
+        case AstKind::LET : {
+            auto let = static_cast<LetStatement*>(stmt);
+            expression(let->value);
+            let->slot = bind(let->name , true , let->line);
+            return;
+        }
+        case AstKind::VAR : {
+            auto var = static_cast<VarStatement*>(stmt);
+            expression(var->value);
+            var->slot = bind(var->name , false , var->line);
+            return;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<AssignStatement*>(stmt);
+            expression(assign->value);
+            const Binding* b = lookup(assign->name);
+            std::string name(symbolText(assign->name));
+            if(!b) {
+                error(assign->line , "assignment to undefined variable '" + name + "'");
+                assign->ref = VarRef();
+                return;
+            }
+            if(b->constant) error(assign->line , "cannot assign to let binding '" + name + "'");
+            assign->ref = refer(*b);
+            return;
+        }
+        case AstKind::RETURN : expression(static_cast<ReturnStatement*>(stmt)->value); return;
+        case AstKind::IF : {
+            auto branch = static_cast<IfStatement*>(stmt);
+            expression(branch->condition);
+            block(branch->thenBranch);
+            block(branch->elseBranch);
+            return;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<WhileStatement*>(stmt);
+            expression(loop->condition);
+            block(loop->body);
+            return;
+        }
+        case AstKind::FOR : {
+            // The iterator gets a scope of its own around the body , the body may reassign it
+            auto loop = static_cast<ForStatement*>(stmt);
+            expression(loop->iterable);
+            Mark mark = open();
+            loop->iteratorSlot = bind(loop->iteratorName , false , loop->line);
+            block(loop->body);
+            close(mark);
+            return;
+        }
+        case AstKind::MATCH : {
+            auto match = static_cast<MatchStatement*>(stmt);
+            expression(match->expr);
+            for(MatchArm& arm : match->arms) {
+                bool isWildcard = arm.pattern->kind == AstKind::VARIABLE
+                               && static_cast<VariableExpr*>(arm.pattern)->name == wildcard;
+                if(!isWildcard) expression(arm.pattern);
+                block(arm.body);
+            }
+            return;
+        }
+        default : error(stmt->line , "unsupported statement");
+    }
+}
+
+} // namespace
+
+std::string CompileError::toString() const {
+    return "Compile Error : " + message + " at line " + std::to_string(line);
+}
+
+std::vector<CompileError> resolveProgram(Program& program) {
+    PhaseTimer timer(Phase::RESOLVE);
+    std::vector<CompileError> errors;
+    for(FunctionDecl* fn : program.functions) FunctionResolver(fn , errors).resolve();
+    return errors;
+}
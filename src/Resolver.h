@@ -0,0 +1,48 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "AST.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Deepest nesting resolveProgram accepts , as counted by nestingDepth. The
+// resolver , type inference , the optimizer and the compiler recurse once per
+// level , the limit keeps them well inside the native stack.
+constexpr size_t MAX_NESTING = 4000;
+
+// Bind every variable of every function to a frame slot , so backends index
+// a frame instead of looking names up. References and assignments get a
+// VarRef , declarations and for iterators their slot and each FunctionDecl
+// its frameSlots. Parameters take slots 0 .. n - 1. A scope's slots are
+// reused once it closes , so frameSlots is the most variables ever live at once.
+//
+// Scopes follow the compiler : the parameters , every block (function body ,
+// branches , loop bodies , match arm bodies) and a for loop's iterator. A let
+// or var value is resolved before its own name is bound , so `let x = x + 1`
+// reads an outer x. Callee names are functions rather than variables and `_`
+// as a match pattern is the wildcard , neither is resolved.
+//
+// Every other expression gets its ASTNode::index , numbered per function in
+// walk order , and each FunctionDecl the count in `expressions`. Past
+// 16M expressions the rest stay unnumbered and passes know nothing of them.
+//
+// ---- A compile error , the resolver records it and carries on ----
+struct CompileError {
+    int line;
+    std::string message; // e.g. "undefined variable 'x' in function main"
+
+    // "Compile Error : <message> at line <n>"
+    std::string toString() const;
+};
+
+// Undefined variables , assignments to let bindings and functions nested
+// deeper than MAX_NESTING are compile errors. They come back in walk order ,
+// every function resolved around them , so one run lists them all. Nothing
+// may run a program that had any : an undefined name keeps an unresolved
+// VarRef and a function nested too deep is not walked at all.
+// Running it again on the same program is harmless , which lets passes that
+// add nodes (the optimizer) run first.
+std::vector<CompileError> resolveProgram(Program& program);
+
+#endif // RESOLVER_H
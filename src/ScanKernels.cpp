@@ -0,0 +1,248 @@
+#include "ScanKernels.h"
+#include <cstdint>
+
+#if !defined(STRYX_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define STRYX_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// ---- Scalar ----
+namespace {
+
+enum : uint8_t { CC_SPACE = 1 , CC_IDENT = 2 , CC_DIGIT = 4 };
+
+struct ClassTable {
+    uint8_t bits[256];
+    constexpr ClassTable() : bits() {
+        for(int c = 0; c < 256; c++) {
+            uint8_t b = 0;
+            if(c == ' ' || (c >= '\t' && c <= '\r')) b |= CC_SPACE;
+            if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') b |= CC_IDENT;
+            if(c >= '0' && c <= '9') b |= CC_IDENT | CC_DIGIT;
+            bits[c] = b;
+        }
+    }
+};
+
+constexpr ClassTable CLASSES;
+
+inline bool is(char c , uint8_t cls) {
+    return CLASSES.bits[static_cast<unsigned char>(c)] & cls;
+}
+
+size_t skipWhitespaceScalar(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    while(i < n && is(p[i] , CC_SPACE)) {
+        if(p[i] == '\n') newlines++;
+        i++;
+    }
+    return i;
+}
+
+size_t scanIdentifierScalar(const char* p , size_t n) {
+    size_t i = 0;
+    while(i < n && is(p[i] , CC_IDENT)) i++;
+    return i;
+}
+
+size_t scanDigitsScalar(const char* p , size_t n) {
+    size_t i = 0;
+    while(i < n && is(p[i] , CC_DIGIT)) i++;
+    return i;
+}
+
+size_t findQuoteScalar(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    while(i < n && p[i] != '"' && p[i] != '\0') {
+        if(p[i] == '\n') newlines++;
+        i++;
+    }
+    return i;
+}
+
+const ScanKernels SCALAR_KERNELS = {
+    ScanIsa::SCALAR , "scalar" ,
+    skipWhitespaceScalar , scanIdentifierScalar , scanDigitsScalar , findQuoteScalar
+};
+
+} // namespace
+
+#ifdef STRYX_X86_SIMD
+
+// ---- SSE2 (16 bytes per step) ----
+// Bytes >= 0x80 compare as negative , so signed range checks reject them.
+namespace {
+
+__attribute__((target("sse2")))
+inline __m128i inRange16(__m128i x , char lo , char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x , _mm_set1_epi8(static_cast<char>(lo - 1))) ,
+                         _mm_cmplt_epi8(x , _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+inline uint32_t lowBits(uint32_t mask , unsigned count) {
+    return count >= 32 ? mask : mask & ((1u << count) - 1);
+}
+
+__attribute__((target("sse2")))
+size_t skipWhitespaceSse2(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(x , _mm_set1_epi8(' ')) , inRange16(x , '\t' , '\r'));
+        uint32_t nl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x , _mm_set1_epi8('\n'))));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFF;
+        if(stop) {
+            unsigned at = __builtin_ctz(stop);
+            newlines += __builtin_popcount(lowBits(nl , at));
+            return i + at;
+        }
+        newlines += __builtin_popcount(nl);
+    }
+    return i + skipWhitespaceScalar(p + i , n - i , newlines);
+}
+
+__attribute__((target("sse2")))
+size_t scanIdentifierSse2(const char* p , size_t n) {
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i lower = _mm_or_si128(x , _mm_set1_epi8(0x20));
+        __m128i id = _mm_or_si128(_mm_or_si128(inRange16(lower , 'a' , 'z') , inRange16(x , '0' , '9')) ,
+                                  _mm_cmpeq_epi8(x , _mm_set1_epi8('_')));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(id)) & 0xFFFF;
+        if(stop) return i + __builtin_ctz(stop);
+    }
+    return i + scanIdentifierScalar(p + i , n - i);
+}
+
+__attribute__((target("sse2")))
+size_t scanDigitsSse2(const char* p , size_t n) {
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(inRange16(x , '0' , '9'))) & 0xFFFF;
+        if(stop) return i + __builtin_ctz(stop);
+    }
+    return i + scanDigitsScalar(p + i , n - i);
+}
+
+__attribute__((target("sse2")))
+size_t findQuoteSse2(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(x , _mm_set1_epi8('"')) , _mm_cmpeq_epi8(x , _mm_setzero_si128()));
+        uint32_t nl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x , _mm_set1_epi8('\n'))));
+        uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if(stop) {
+            unsigned at = __builtin_ctz(stop);
+            newlines += __builtin_popcount(lowBits(nl , at));
+            return i + at;
+        }
+        newlines += __builtin_popcount(nl);
+    }
+    return i + findQuoteScalar(p + i , n - i , newlines);
+}
+
+const ScanKernels SSE2_KERNELS = {
+    ScanIsa::SSE2 , "sse2" ,
+    skipWhitespaceSse2 , scanIdentifierSse2 , scanDigitsSse2 , findQuoteSse2
+};
+
+// ---- AVX2 (32 bytes per step) ----
+__attribute__((target("avx2")))
+inline __m256i inRange32(__m256i x , char lo , char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x , _mm256_set1_epi8(static_cast<char>(lo - 1))) ,
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)) , x));
+}
+
+__attribute__((target("avx2")))
+size_t skipWhitespaceAvx2(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(x , _mm256_set1_epi8(' ')) , inRange32(x , '\t' , '\r'));
+        uint32_t nl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x , _mm256_set1_epi8('\n'))));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+        if(stop) {
+            unsigned at = __builtin_ctz(stop);
+            newlines += __builtin_popcount(lowBits(nl , at));
+            return i + at;
+        }
+        newlines += __builtin_popcount(nl);
+    }
+    return i + skipWhitespaceSse2(p + i , n - i , newlines);
+}
+
+__attribute__((target("avx2")))
+size_t scanIdentifierAvx2(const char* p , size_t n) {
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i lower = _mm256_or_si256(x , _mm256_set1_epi8(0x20));
+        __m256i id = _mm256_or_si256(_mm256_or_si256(inRange32(lower , 'a' , 'z') , inRange32(x , '0' , '9')) ,
+                                     _mm256_cmpeq_epi8(x , _mm256_set1_epi8('_')));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(id));
+        if(stop) return i + __builtin_ctz(stop);
+    }
+    return i + scanIdentifierSse2(p + i , n - i);
+}
+
+__attribute__((target("avx2")))
+size_t scanDigitsAvx2(const char* p , size_t n) {
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(inRange32(x , '0' , '9')));
+        if(stop) return i + __builtin_ctz(stop);
+    }
+    return i + scanDigitsSse2(p + i , n - i);
+}
+
+__attribute__((target("avx2")))
+size_t findQuoteAvx2(const char* p , size_t n , int& newlines) {
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(x , _mm256_set1_epi8('"')) ,
+                                      _mm256_cmpeq_epi8(x , _mm256_setzero_si256()));
+        uint32_t nl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x , _mm256_set1_epi8('\n'))));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if(stop) {
+            unsigned at = __builtin_ctz(stop);
+            newlines += __builtin_popcount(lowBits(nl , at));
+            return i + at;
+        }
+        newlines += __builtin_popcount(nl);
+    }
+    return i + findQuoteSse2(p + i , n - i , newlines);
+}
+
+const ScanKernels AVX2_KERNELS = {
+    ScanIsa::AVX2 , "avx2" ,
+    skipWhitespaceAvx2 , scanIdentifierAvx2 , scanDigitsAvx2 , findQuoteAvx2
+};
+
+} // namespace
+
+#endif // STRYX_X86_SIMD
+
+const ScanKernels* scanKernelsFor(ScanIsa isa) {
+    switch(isa) {
+        case ScanIsa::SCALAR : return &SCALAR_KERNELS;
+#ifdef STRYX_X86_SIMD
+        case ScanIsa::SSE2 : return __builtin_cpu_supports("sse2") ? &SSE2_KERNELS : nullptr;
+        case ScanIsa::AVX2 : return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr;
+#endif
+        default : return nullptr;
+    }
+}
+
+const ScanKernels& scanKernels() {
+    static const ScanKernels* best = [] {
+        if(const ScanKernels* k = scanKernelsFor(ScanIsa::AVX2)) return k;
+        if(const ScanKernels* k = scanKernelsFor(ScanIsa::SSE2)) return k;
+        return &SCALAR_KERNELS;
+    }();
+    return *best;
+}
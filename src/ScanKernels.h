@@ -0,0 +1,30 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+
+// Bulk character-class scanners used by the Lexer. Every kernel looks at
+// p[0 , n) only and never reads past it. Classes follow the "C" locale.
+enum class ScanIsa { SCALAR, SSE2, AVX2 };
+
+struct ScanKernels {
+    ScanIsa isa;
+    const char* name;
+    // Length of the leading whitespace run , adds the newlines in it to `newlines`
+    size_t (*skipWhitespace)(const char* p , size_t n , int& newlines);
+    // Length of the leading [A-Za-z0-9_] run
+    size_t (*scanIdentifier)(const char* p , size_t n);
+    // Length of the leading [0-9] run
+    size_t (*scanDigits)(const char* p , size_t n);
+    // Index of the first '"' or NUL (n if none) , adds the newlines before it to `newlines`
+    size_t (*findQuote)(const char* p , size_t n , int& newlines);
+};
+
+// Kernels for one instruction set , nullptr if the build or the CPU lacks it
+const ScanKernels* scanKernelsFor(ScanIsa isa);
+
+// Fastest kernels for this CPU , chosen once at first use.
+// Building with -DSTRYX_NO_SIMD forces the scalar path.
+const ScanKernels& scanKernels();
+
+#endif // SCAN_KERNELS_H
@@ -0,0 +1,95 @@
+#include "SourceBuffer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <fstream>
+#include <utility>
+
+SourceBuffer::SourceBuffer() : mapped(nullptr) , mappedSize(0) {}
+
+SourceBuffer::~SourceBuffer() {
+    release();
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : mapped(other.mapped) , mappedSize(other.mappedSize)
+    , owned(std::move(other.owned)) , path(std::move(other.path)) {
+    other.mapped = nullptr;
+    other.mappedSize = 0;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if(this != &other) {
+        release();
+        mapped = other.mapped;
+        mappedSize = other.mappedSize;
+        owned = std::move(other.owned);
+        path = std::move(other.path);
+        other.mapped = nullptr;
+        other.mappedSize = 0;
+    }
+    return *this;
+}
+
+void SourceBuffer::release() {
+    if(mapped) munmap(const_cast<char*>(mapped) , mappedSize);
+    mapped = nullptr;
+    mappedSize = 0;
+    owned.clear();
+}
+
+bool SourceBuffer::open(const std::string& filename) {
+    release();
+    path = filename;
+
+    int fd = ::open(filename.c_str() , O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd , &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return false;
+    }
+
+    if(!S_ISREG(st.st_mode)) {
+        //PIPES AND DEVICES CAN'T BE MAPPED , FALL BACK TO READING THEM
+        close(fd);
+        std::ifstream file(filename);
+        if(!file) return false;
+        owned.assign(std::istreambuf_iterator<char>(file) , std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    if(st.st_size == 0) { //MMAP REJECTS ZERO LENGTH
+        close(fd);
+        return true;
+    }
+
+    void* addr = mmap(nullptr , static_cast<size_t>(st.st_size) , PROT_READ , MAP_PRIVATE , fd , 0);
+    int err = errno;
+    close(fd);
+    if(addr == MAP_FAILED) {
+        errno = err;
+        return false;
+    }
+    madvise(addr , static_cast<size_t>(st.st_size) , MADV_SEQUENTIAL);
+    mapped = static_cast<const char*>(addr);
+    mappedSize = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+SourceBuffer SourceBuffer::fromString(std::string text , std::string name) {
+    SourceBuffer buffer;
+    buffer.owned = std::move(text);
+    buffer.path = std::move(name);
+    return buffer;
+}
+
+std::string_view SourceBuffer::view() const {
+    if(mapped) return std::string_view(mapped , mappedSize);
+    return owned;
+}
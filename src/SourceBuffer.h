@@ -0,0 +1,36 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <string>
+#include <string_view>
+
+// Read-only source text. Files are memory mapped so the Lexer reads the
+// page cache directly , in-memory buffers are owned as a plain string.
+class SourceBuffer {
+    private :
+        const char* mapped;
+        size_t mappedSize;
+        std::string owned;
+        std::string path;
+
+        void release();
+
+    public :
+        SourceBuffer();
+        ~SourceBuffer();
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+        SourceBuffer(SourceBuffer&& other) noexcept;
+        SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+
+        // Map a file , returns false and leaves the buffer empty on failure (errno is kept)
+        bool open(const std::string& filename);
+        static SourceBuffer fromString(std::string text , std::string name = "<memory>");
+
+        std::string_view view() const;
+        const std::string& name() const { return path; }
+        size_t size() const { return view().size(); }
+        bool isMapped() const { return mapped != nullptr; }
+};
+
+#endif // SOURCE_BUFFER_H
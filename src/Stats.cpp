@@ -0,0 +1,276 @@
+#include "Stats.h"
+#include "AST.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+
+namespace {
+
+const char* const NODE_NAMES[] = {
+    "NUMBER" , "STRING" , "VARIABLE" , "UNARY" , "BINARY" , "CALL" ,
+    "LET" , "VAR" , "ASSIGN" , "RETURN" , "IF" , "WHILE" , "FOR" , "MATCH" ,
+    "MATCH_ARM" , "FUNCTION"
+};
+constexpr size_t NAMED_NODES = sizeof(NODE_NAMES) / sizeof(NODE_NAMES[0]);
+static_assert(NAMED_NODES == static_cast<size_t>(AstKind::FUNCTION) + 1 , "a node kind has no name");
+
+std::chrono::steady_clock::time_point epoch;
+
+struct ThreadStats;
+
+// Never destroyed : pool threads may exit after static teardown began
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadStats*> live;
+    StatsCounters retired;
+    std::vector<TraceEvent> retiredEvents;
+    uint32_t nextThread = 0;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry();
+    return *r;
+}
+
+struct ThreadStats {
+    StatsCounters counters;
+    std::vector<TraceEvent> events;
+    uint32_t thread;
+
+    ThreadStats() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        thread = r.nextThread++;
+        r.live.push_back(this);
+    }
+
+    ~ThreadStats() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.add(counters);
+        r.retiredEvents.insert(r.retiredEvents.end() , events.begin() , events.end());
+        r.live.erase(std::find(r.live.begin() , r.live.end() , this));
+    }
+};
+
+thread_local ThreadStats current;
+
+double ms(uint64_t nanos) {
+    return nanos / 1e6;
+}
+
+double mb(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+template <typename F>
+void eachToken(const StatsCounters& s , F f) {
+    for(size_t t = 0; t < TOKEN_KINDS; t++) {
+        if(s.tokens[t]) f(tokenSpelling(static_cast<TokenType>(t)) , s.tokens[t]);
+    }
+}
+
+template <typename F>
+void eachNode(const StatsCounters& s , F f) {
+    for(size_t k = 0; k < NAMED_NODES; k++) {
+        if(s.nodes[k]) f(NODE_NAMES[k] , s.nodes[k]);
+    }
+}
+
+uint64_t sum(const uint64_t* counts , size_t n) {
+    uint64_t total = 0;
+    for(size_t i = 0; i < n; i++) total += counts[i];
+    return total;
+}
+
+// Token spellings are JSON-safe except for a quote or backslash , none today
+void jsonKey(std::ostream& out , const char* key) {
+    out<<'"';
+    for(const char* c = key; *c; c++) {
+        if(*c == '"' || *c == '\\') out<<'\\';
+        out<<*c;
+    }
+    out<<"\":";
+}
+
+} // namespace
+
+const char* phaseName(Phase phase) {
+    switch(phase) {
+        case Phase::LEX : return "lex";
+        case Phase::PARSE : return "parse";
+        case Phase::CACHE_LOAD : return "cache load";
+        case Phase::CACHE_STORE : return "cache store";
+        case Phase::OPTIMIZE : return "optimize";
+        case Phase::RESOLVE : return "resolve";
+        case Phase::INFER : return "infer types";
+        case Phase::COMPILE : return "compile";
+        case Phase::RUN : return "run";
+    }
+    return "?";
+}
+
+void HeapStats::add(const HeapStats& other) {
+    smallStrings += other.smallStrings;
+    allocations += other.allocations;
+    allocatedBytes += other.allocatedBytes;
+    pretenured += other.pretenured;
+    regionsDropped += other.regionsDropped;
+    droppedBytes += other.droppedBytes;
+    escapes += other.escapes;
+    minorCollections += other.minorCollections;
+    promotedBytes += other.promotedBytes;
+    majorCollections += other.majorCollections;
+    sweptBytes += other.sweptBytes;
+    collectNanos += other.collectNanos;
+    peakOldBytes = std::max(peakOldBytes , other.peakOldBytes);
+}
+
+void StatsCounters::add(const StatsCounters& other) {
+    for(size_t i = 0; i < TOKEN_KINDS; i++) tokens[i] += other.tokens[i];
+    for(size_t i = 0; i < NODE_KINDS; i++) nodes[i] += other.nodes[i];
+    tokenBytes += other.tokenBytes;
+    astBytes += other.astBytes;
+    arenaHeapBytes += other.arenaHeapBytes;
+    for(size_t i = 0; i < PHASE_COUNT; i++) {
+        phaseNanos[i] += other.phaseNanos[i];
+        phaseCalls[i] += other.phaseCalls[i];
+    }
+    heap.add(other.heap);
+}
+
+void CompileStats::enable() {
+    epoch = std::chrono::steady_clock::now();
+    local(); // the enabling thread registers first and becomes thread 0
+    enabled = true;
+}
+
+uint64_t CompileStats::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+StatsCounters& CompileStats::local() {
+    return current.counters;
+}
+
+void CompileStats::record(Phase phase , uint64_t start) {
+    uint64_t duration = now() - start;
+    current.counters.phaseNanos[static_cast<size_t>(phase)] += duration;
+    current.counters.phaseCalls[static_cast<size_t>(phase)]++;
+    current.events.push_back(TraceEvent{phase , current.thread , start , duration});
+}
+
+StatsCounters CompileStats::snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    StatsCounters total = r.retired;
+    for(const ThreadStats* t : r.live) total.add(t->counters);
+    return total;
+}
+
+std::vector<TraceEvent> CompileStats::events() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<TraceEvent> all = r.retiredEvents;
+    for(const ThreadStats* t : r.live) all.insert(all.end() , t->events.begin() , t->events.end());
+    std::sort(all.begin() , all.end() , [](const TraceEvent& a , const TraceEvent& b) { return a.start < b.start; });
+    return all;
+}
+
+long CompileStats::peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF , &usage);
+    return usage.ru_maxrss;
+}
+
+void CompileStats::printTable(std::ostream& out) {
+    StatsCounters s = snapshot();
+    std::ios::fmtflags flags = out.flags();
+    out<<std::fixed<<std::setprecision(2);
+
+    // Summed over threads : with --jobs a phase can exceed the wall time
+    out<<"phase            calls        time ms\n";
+    for(size_t p = 0; p < PHASE_COUNT; p++) {
+        if(!s.phaseCalls[p]) continue;
+        out<<std::left<<std::setw(14)<<phaseName(static_cast<Phase>(p))<<std::right<<std::setw(8)<<s.phaseCalls[p]
+           <<std::setw(15)<<ms(s.phaseNanos[p])<<"\n";
+    }
+
+    out<<"\ntokens           "<<sum(s.tokens , TOKEN_KINDS)<<"\n";
+    eachToken(s , [&](const char* name , uint64_t n) { out<<"  "<<std::left<<std::setw(18)<<name<<std::right<<std::setw(12)<<n<<"\n"; });
+    out<<"\nnodes            "<<sum(s.nodes , NODE_KINDS)<<"\n";
+    eachNode(s , [&](const char* name , uint64_t n) { out<<"  "<<std::left<<std::setw(18)<<name<<std::right<<std::setw(12)<<n<<"\n"; });
+
+    out<<"\nmemory\n";
+    out<<"  token stream    "<<std::setw(12)<<mb(s.tokenBytes)<<" MB\n";
+    out<<"  AST             "<<std::setw(12)<<mb(s.astBytes)<<" MB\n";
+    out<<"  arena heap      "<<std::setw(12)<<mb(s.arenaHeapBytes)<<" MB\n";
+    out<<"  peak RSS        "<<std::setw(12)<<peakRssKb() / 1024.0<<" MB\n";
+
+    const HeapStats& h = s.heap;
+    if(h.smallStrings || h.allocations) {
+        out<<"\nheap\n";
+        out<<"  small strings   "<<std::setw(12)<<h.smallStrings<<"\n";
+        out<<"  allocations     "<<std::setw(12)<<h.allocations<<"   "<<mb(h.allocatedBytes)<<" MB , "<<h.pretenured<<" pretenured\n";
+        out<<"  regions dropped "<<std::setw(12)<<h.regionsDropped<<"   "<<mb(h.droppedBytes)<<" MB , "<<h.escapes<<" escapes\n";
+        out<<"  minor GCs       "<<std::setw(12)<<h.minorCollections<<"   "<<mb(h.promotedBytes)<<" MB promoted\n";
+        out<<"  major GCs       "<<std::setw(12)<<h.majorCollections<<"   "<<mb(h.sweptBytes)<<" MB swept\n";
+        out<<"  GC time         "<<std::setw(12)<<ms(h.collectNanos)<<" ms\n";
+        out<<"  old peak        "<<std::setw(12)<<mb(h.peakOldBytes)<<" MB\n";
+    }
+    out.flags(flags);
+}
+
+void CompileStats::printJson(std::ostream& out) {
+    StatsCounters s = snapshot();
+    out<<"{\"phases\":{";
+    bool first = true;
+    for(size_t p = 0; p < PHASE_COUNT; p++) {
+        if(!s.phaseCalls[p]) continue;
+        if(!first) out<<",";
+        first = false;
+        jsonKey(out , phaseName(static_cast<Phase>(p)));
+        out<<"{\"calls\":"<<s.phaseCalls[p]<<",\"ns\":"<<s.phaseNanos[p]<<"}";
+    }
+    out<<"},\"tokens\":{";
+    first = true;
+    eachToken(s , [&](const char* name , uint64_t n) {
+        if(!first) out<<",";
+        first = false;
+        jsonKey(out , name);
+        out<<n;
+    });
+    out<<"},\"nodes\":{";
+    first = true;
+    eachNode(s , [&](const char* name , uint64_t n) {
+        if(!first) out<<",";
+        first = false;
+        jsonKey(out , name);
+        out<<n;
+    });
+    out<<"},\"bytes\":{\"tokenStream\":"<<s.tokenBytes<<",\"ast\":"<<s.astBytes<<",\"arenaHeap\":"<<s.arenaHeapBytes
+       <<"},\"heap\":{\"smallStrings\":"<<s.heap.smallStrings<<",\"allocations\":"<<s.heap.allocations
+       <<",\"allocatedBytes\":"<<s.heap.allocatedBytes<<",\"pretenured\":"<<s.heap.pretenured
+       <<",\"regionsDropped\":"<<s.heap.regionsDropped<<",\"droppedBytes\":"<<s.heap.droppedBytes<<",\"escapes\":"<<s.heap.escapes
+       <<",\"minorCollections\":"<<s.heap.minorCollections<<",\"promotedBytes\":"<<s.heap.promotedBytes
+       <<",\"majorCollections\":"<<s.heap.majorCollections<<",\"sweptBytes\":"<<s.heap.sweptBytes
+       <<",\"collectNs\":"<<s.heap.collectNanos<<",\"peakOldBytes\":"<<s.heap.peakOldBytes
+       <<"},\"peakRssKb\":"<<peakRssKb()<<"}\n";
+}
+
+void CompileStats::writeTrace(std::ostream& out) {
+    std::ios::fmtflags flags = out.flags();
+    out<<std::fixed<<std::setprecision(3);
+    out<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for(const TraceEvent& e : events()) {
+        if(!first) out<<",";
+        first = false;
+        out<<"\n{\"name\":\""<<phaseName(e.phase)<<"\",\"cat\":\"stryx\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<e.thread
+           <<",\"ts\":"<<e.start / 1e3<<",\"dur\":"<<e.duration / 1e3<<"}";
+    }
+    out<<"\n]}\n";
+    out.flags(flags);
+}
@@ -0,0 +1,106 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "Token.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// ---- Compile instrumentation ----
+// Off unless CompileStats::enable() is called before any work starts. Every
+// hook is then a load of `enabled` and a branch that is never taken , so a
+// normal compile pays nothing measurable. When on , each thread counts into
+// its own block (the parallel lexer and parser workers never share a cache
+// line) ; a block folds into the process totals when its thread exits and
+// snapshot() adds the ones still alive , so read it once the workers are done.
+
+enum class Phase : uint8_t {
+    LEX, PARSE, CACHE_LOAD, CACHE_STORE, OPTIMIZE, RESOLVE, INFER, COMPILE, RUN
+};
+
+constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::RUN) + 1;
+constexpr size_t TOKEN_KINDS = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+constexpr size_t NODE_KINDS = 16; // >= AstKind values , checked in AST.h
+
+const char* phaseName(Phase phase);
+
+// Runtime string heap , counted by the VM's Heap and folded in after a run
+struct HeapStats {
+    uint64_t smallStrings = 0;     // strings short enough to live inside their value
+    uint64_t allocations = 0;      // strings allocated on the heap
+    uint64_t allocatedBytes = 0;
+    uint64_t pretenured = 0;       // too large for the nursery , allocated old
+    uint64_t regionsDropped = 0;   // returns that freed their frame's region
+    uint64_t droppedBytes = 0;
+    uint64_t escapes = 0;          // returned strings moved down into the caller's region
+    uint64_t minorCollections = 0;
+    uint64_t promotedBytes = 0;    // nursery bytes that survived into the old generation
+    uint64_t majorCollections = 0;
+    uint64_t sweptBytes = 0;       // old generation bytes freed
+    uint64_t collectNanos = 0;
+    uint64_t peakOldBytes = 0;
+
+    void add(const HeapStats& other);
+};
+
+struct StatsCounters {
+    uint64_t tokens[TOKEN_KINDS] = {}; // END_OF_FILE is not counted
+    uint64_t nodes[NODE_KINDS] = {};   // by AstKind , counted in the ASTNode constructor
+    uint64_t tokenBytes = 0;           // TokenStream storage built by tokenize()
+    uint64_t astBytes = 0;             // arena bytes the parser used for nodes , lists and text
+    uint64_t arenaHeapBytes = 0;       // arena blocks taken from the heap , not the block cache
+    uint64_t phaseNanos[PHASE_COUNT] = {};
+    uint64_t phaseCalls[PHASE_COUNT] = {};
+    HeapStats heap;
+
+    void add(const StatsCounters& other);
+};
+
+// One timed span , for the trace export. Times are ns since enable().
+struct TraceEvent {
+    Phase phase;
+    uint32_t thread; // 0 is the thread that called enable()
+    uint64_t start;
+    uint64_t duration;
+};
+
+class CompileStats {
+    public :
+        static inline bool enabled = false;
+
+        static void enable();
+        static uint64_t now();
+        static StatsCounters& local(); // the calling thread's block
+        static void record(Phase phase , uint64_t start);
+
+        static StatsCounters snapshot();
+        static std::vector<TraceEvent> events();
+        static long peakRssKb();
+
+        static void printTable(std::ostream& out);
+        static void printJson(std::ostream& out);
+        // Chrome trace-event JSON : open in chrome://tracing or Perfetto
+        static void writeTrace(std::ostream& out);
+};
+
+inline void countToken(TokenType type) {
+    if(CompileStats::enabled && type != TokenType::END_OF_FILE) CompileStats::local().tokens[static_cast<size_t>(type)]++;
+}
+
+// Times the enclosing scope as one span of `phase`
+class PhaseTimer {
+    private :
+        Phase phase;
+        uint64_t start;
+
+    public :
+        explicit PhaseTimer(Phase phase) : phase(phase) , start(CompileStats::enabled ? CompileStats::now() : 0) {}
+        ~PhaseTimer() {
+            if(CompileStats::enabled) CompileStats::record(phase , start);
+        }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+#endif // STATS_H
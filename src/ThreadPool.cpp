@@ -0,0 +1,52 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads) : pending(0) , stopping(false) {
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    if(threads == 0) threads = 1;
+    workers.reserve(threads);
+    for(size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for(auto& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(task));
+        pending++;
+    }
+    available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock , [this] { return pending == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock , [this] { return stopping || !queue.empty(); });
+            if(queue.empty()) return; //STOPPING AND DRAINED
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+            if(pending == 0) idle.notify_all();
+        }
+    }
+}
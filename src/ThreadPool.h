@@ -0,0 +1,37 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads fed from a shared FIFO queue
+class ThreadPool {
+    private :
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> queue;
+        std::mutex mutex;
+        std::condition_variable available;
+        std::condition_variable idle;
+        size_t pending;
+        bool stopping;
+
+        void workerLoop();
+
+    public :
+        // 0 threads means one per hardware thread
+        explicit ThreadPool(size_t threads = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(std::function<void()> task);
+        // Block until every submitted task has finished
+        void wait();
+        size_t size() const { return workers.size(); }
+};
+
+#endif // THREAD_POOL_H
@@ -1,9 +1,281 @@
 #include "Token.h"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 
-Token::Token(TokenType type , std::string value , int line) :
-    type(type) , value(value) , line(line) {}
+const char* tokenSpelling(TokenType type) {
+    switch(type) {
+        case TokenType::FN : return "fn";
+        case TokenType::CLASS : return "class";
+        case TokenType::LET : return "let";
+        case TokenType::VAR : return "var";
+        case TokenType::RETURN : return "return";
+        case TokenType::IF : return "if";
+        case TokenType::ELSE : return "else";
+        case TokenType::FOR : return "for";
+        case TokenType::WHILE : return "while";
+        case TokenType::BREAK : return "break";
+        case TokenType::CONTINUE : return "continue";
+        case TokenType::MATCH : return "match";
+        case TokenType::INT : return "int";
+        case TokenType::FLOAT : return "float";
+        case TokenType::STRING : return "string";
+        case TokenType::BOOL : return "bool";
+        case TokenType::VOID : return "void";
+        case TokenType::PLUS : return "+";
+        case TokenType::MINUS : return "-";
+        case TokenType::STAR : return "*";
+        case TokenType::SLASH : return "/";
+        case TokenType::MODULO : return "%";
+        case TokenType::ASSIGN : return "=";
+        case TokenType::EQUAL : return "==";
+        case TokenType::NOT_EQUAL : return "!=";
+        case TokenType::LESS : return "<";
+        case TokenType::LESS_EQUAL : return "<=";
+        case TokenType::GREATER : return ">";
+        case TokenType::GREATER_EQUAL : return ">=";
+        case TokenType::AND : return "&&";
+        case TokenType::OR : return "||";
+        case TokenType::NOT : return "!";
+        case TokenType::XOR : return "^";
+        case TokenType::IN : return "in";
+        case TokenType::ARROW : return "=>";
+        case TokenType::LPAREN : return "(";
+        case TokenType::RPAREN : return ")";
+        case TokenType::LBRACE : return "{";
+        case TokenType::RBRACE : return "}";
+        case TokenType::LBRACKET : return "[";
+        case TokenType::RBRACKET : return "]";
+        case TokenType::COMMA : return ",";
+        case TokenType::SEMICOLON : return ";";
+        case TokenType::COLON : return ":";
+        case TokenType::QUESTION : return "?";
+        case TokenType::UNDERSCORE : return "_";
+        case TokenType::IDENTIFIER : return "identifier";
+        case TokenType::INTEGER_LITERAL : return "integer literal";
+        case TokenType::FLOAT_LITERAL : return "float literal";
+        case TokenType::STRING_LITERAL : return "string literal";
+        case TokenType::END_OF_FILE : return "EOF";
+    }
+    return "?";
+}
+
+namespace {
+
+bool isDigitOf(char c , int base) {
+    if(base == 16) return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+    return c >= '0' && c < '0' + base;
+}
+
+} // namespace
+
+NumberError readNumber(std::string_view text , TokenType& type , NumberValue& value) {
+    type = text.find('.') != std::string_view::npos ? TokenType::FLOAT_LITERAL : TokenType::INTEGER_LITERAL;
+    value = NumberValue::integer(0);
+
+    int base = 10;
+    std::string_view digits = text;
+    if(text.size() > 1 && text[0] == '0' && ((text[1] | 0x20) == 'x' || (text[1] | 0x20) == 'b')) {
+        base = (text[1] | 0x20) == 'x' ? 16 : 2;
+        digits = text.substr(2);
+    }
+    if(digits.empty()) return NumberError::MALFORMED;
+
+    // '_' and '.' need a digit on both sides , a second '.' never fits
+    bool separators = false , isFloat = false;
+    for(size_t k = 0; k < digits.size(); k++) {
+        char c = digits[k];
+        if(isDigitOf(c , base)) continue;
+        bool between = k > 0 && k + 1 < digits.size()
+                    && isDigitOf(digits[k - 1] , base) && isDigitOf(digits[k + 1] , base);
+        if(c == '_' && between) separators = true;
+        else if(c == '.' && between && base == 10 && !isFloat) isFloat = true;
+        else return NumberError::MALFORMED;
+    }
+
+    std::string clean;
+    if(separators) {
+        clean.reserve(digits.size());
+        for(char c : digits) if(c != '_') clean += c;
+        digits = clean;
+    }
+    const char* first = digits.data();
+    const char* last = first + digits.size();
+    std::from_chars_result result;
+    if(isFloat) {
+        double f = 0;
+        result = std::from_chars(first , last , f , std::chars_format::fixed);
+        value = NumberValue::floating(f);
+    } else if(base == 10) {
+        int64_t i = 0;
+        result = std::from_chars(first , last , i);
+        value = NumberValue::integer(i);
+    } else {
+        uint64_t bits = 0;
+        result = std::from_chars(first , last , bits , base);
+        value = NumberValue::integer(static_cast<int64_t>(bits));
+    }
+    return result.ec == std::errc::result_out_of_range ? NumberError::OUT_OF_RANGE : NumberError::NONE;
+}
+
+size_t formatNumber(char* out , NumberValue value , bool isFloat) {
+    if(!isFloat) return static_cast<size_t>(std::to_chars(out , out + NUMBER_TEXT_MAX , value.i).ptr - out);
+    char* end = std::to_chars(out , out + NUMBER_TEXT_MAX - 2 , value.f).ptr;
+    // "3" or "-3" , but not "1e+22" or "inf"
+    if(std::all_of(out , end , [](char c) { return c == '-' || (c >= '0' && c <= '9'); })) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    return static_cast<size_t>(end - out);
+}
+
+Token::Token() : type(TokenType::END_OF_FILE) , numberError(NumberError::NONE) , value("EOF") , line(-1) ,
+    symbol(NO_SYMBOL) , number(NumberValue::integer(0)) {}
+
+Token::Token(TokenType type , std::string_view value , int line , SymbolId symbol) :
+    type(type) , numberError(NumberError::NONE) , value(value) , line(line) , symbol(symbol) ,
+    number(NumberValue::integer(0)) {}
+
+Token::Token(TokenType type , std::string_view value , int line , NumberValue number , NumberError error) :
+    type(type) , numberError(error) , value(value) , line(line) , symbol(NO_SYMBOL) , number(number) {}
 
 std::string Token::toString() const {
-    return "Token (" + value + ", line " + std::to_string(line) + ")";
-}    
\ No newline at end of file
+    return "Token (" + std::string(value) + ", line " + std::to_string(line) + ")";
+}
+
+TokenStream::TokenStream(std::string_view source) : source(source) {}
+
+void TokenStream::reserve(size_t count) {
+    kinds.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    lines.reserve(count);
+    symbolIds.reserve(count);
+    numbers.reserve(count / 4); // number literals , a generous share of the tokens
+}
+
+void TokenStream::shrinkToFit() {
+    kinds.shrink_to_fit();
+    offsets.shrink_to_fit();
+    lengths.shrink_to_fit();
+    lines.shrink_to_fit();
+    symbolIds.shrink_to_fit();
+    numbers.shrink_to_fit();
+}
+
+void TokenStream::push(TokenType type , uint32_t offset , uint32_t length , int line , SymbolId symbol) {
+    kinds.push_back(type);
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    lines.push_back(static_cast<uint32_t>(line));
+    symbolIds.push_back(symbol);
+}
+
+void TokenStream::pushNumber(TokenType type , uint32_t offset , uint32_t length , int line ,
+                             NumberValue value , bool valid) {
+    uint32_t slot = NO_NUMBER;
+    if(valid) {
+        slot = static_cast<uint32_t>(numbers.size());
+        numbers.push_back(value);
+    }
+    push(type , offset , length , line , slot);
+}
+
+void TokenStream::resize(size_t count , size_t numberCount) {
+    kinds.resize(count);
+    offsets.resize(count);
+    lengths.resize(count);
+    lines.resize(count);
+    symbolIds.resize(count);
+    numbers.resize(numberCount);
+}
+
+void TokenStream::splice(size_t at , const TokenStream& part , size_t first , size_t n ,
+                         uint32_t offsetDelta , int lineDelta , size_t numberAt) {
+    for(size_t i = 0; i < n; i++) {
+        kinds[at + i] = part.kinds[first + i];
+        offsets[at + i] = part.offsets[first + i] + offsetDelta;
+        lengths[at + i] = part.lengths[first + i];
+        lines[at + i] = part.lines[first + i] + static_cast<uint32_t>(lineDelta);
+        symbolIds[at + i] = part.symbolIds[first + i];
+        if(isNumberLiteral(kinds[at + i]) && symbolIds[at + i] != NO_NUMBER) {
+            numbers[numberAt] = part.numbers[symbolIds[at + i]];
+            symbolIds[at + i] = static_cast<uint32_t>(numberAt++);
+        }
+    }
+}
+
+namespace {
+
+template <typename T>
+void replaceRange(std::vector<T>& v , size_t first , size_t count , const std::vector<T>& part) {
+    size_t common = std::min(count , part.size());
+    std::copy(part.begin() , part.begin() + common , v.begin() + first);
+    if(count > common) v.erase(v.begin() + first + common , v.begin() + first + count);
+    else v.insert(v.begin() + first + common , part.begin() + common , part.end());
+}
+
+} // namespace
+
+void TokenStream::replace(size_t first , size_t count , const TokenStream& part ,
+                          uint32_t offsetDelta , int lineDelta) {
+    for(size_t i = first; i < first + count; i++) {
+        if(isNumberLiteral(kinds[i]) && symbolIds[i] != NO_NUMBER) deadNumbers++;
+    }
+    source = part.source;
+    replaceRange(kinds , first , count , part.kinds);
+    replaceRange(offsets , first , count , part.offsets);
+    replaceRange(lengths , first , count , part.lengths);
+    replaceRange(lines , first , count , part.lines);
+    replaceRange(symbolIds , first , count , part.symbolIds);
+    size_t tail = first + part.size();
+    // part's values go at the end of the pool , the ones they replace stay until compacted
+    uint32_t base = static_cast<uint32_t>(numbers.size());
+    numbers.insert(numbers.end() , part.numbers.begin() , part.numbers.end());
+    for(size_t i = first; i < tail; i++) {
+        if(isNumberLiteral(kinds[i]) && symbolIds[i] != NO_NUMBER) symbolIds[i] += base;
+    }
+    if(deadNumbers > numbers.size() / 2) compactNumbers();
+    if(offsetDelta != 0) {
+        for(size_t i = tail; i < offsets.size(); i++) offsets[i] += offsetDelta;
+    }
+    if(lineDelta != 0) {
+        for(size_t i = tail; i < lines.size(); i++) lines[i] += static_cast<uint32_t>(lineDelta);
+    }
+}
+
+void TokenStream::compactNumbers() {
+    std::vector<NumberValue> live;
+    live.reserve(numbers.size() - deadNumbers);
+    for(size_t i = 0; i < kinds.size(); i++) {
+        if(!isNumberLiteral(kinds[i]) || symbolIds[i] == NO_NUMBER) continue;
+        live.push_back(numbers[symbolIds[i]]);
+        symbolIds[i] = static_cast<uint32_t>(live.size() - 1);
+    }
+    numbers = std::move(live);
+    deadNumbers = 0;
+}
+
+std::string_view TokenStream::text(size_t i) const {
+    if(kinds[i] == TokenType::END_OF_FILE) return "EOF";
+    return source.substr(offsets[i] , lengths[i]);
+}
+
+Token TokenStream::operator[](size_t i) const {
+    if(!isNumberLiteral(kinds[i])) return Token(kinds[i] , text(i) , line(i) , symbolIds[i]);
+    if(symbolIds[i] != NO_NUMBER) return Token(kinds[i] , text(i) , line(i) , numbers[symbolIds[i]] , NumberError::NONE);
+    // Only broken literals are read twice , to tell the parser what is wrong with them
+    TokenType type;
+    NumberValue value;
+    NumberError error = readNumber(text(i) , type , value);
+    return Token(kinds[i] , text(i) , line(i) , value , error);
+}
+
+size_t TokenStream::memoryUsage() const {
+    return kinds.capacity() * sizeof(TokenType)
+         + offsets.capacity() * sizeof(uint32_t)
+         + lengths.capacity() * sizeof(uint32_t)
+         + lines.capacity() * sizeof(uint32_t)
+         + symbolIds.capacity() * sizeof(SymbolId)
+         + numbers.capacity() * sizeof(NumberValue);
+}
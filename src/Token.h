@@ -1,19 +1,23 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "Interner.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // Enum for token types
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Keywords
     FN, CLASS, LET , VAR , RETURN, IF, ELSE, FOR, WHILE, BREAK, CONTINUE, MATCH,
-    
+
     // Data Types
     INT, FLOAT, STRING, BOOL, VOID,
 
     // Operators
-    PLUS, MINUS, STAR, SLASH, MODULO, 
-    ASSIGN, EQUAL, NOT_EQUAL, 
+    PLUS, MINUS, STAR, SLASH, MODULO,
+    ASSIGN, EQUAL, NOT_EQUAL,
     LESS, LESS_EQUAL, GREATER, GREATER_EQUAL,
     AND , OR , NOT , XOR, IN, ARROW,
 
@@ -27,15 +31,121 @@ enum class TokenType {
     END_OF_FILE
 };
 
-// Token class
+inline bool isNumberLiteral(TokenType type) {
+    return type == TokenType::INTEGER_LITERAL || type == TokenType::FLOAT_LITERAL;
+}
+
+// Source spelling of fixed tokens ("+" , "=>" , "fn" ...) or the kind name for literals
+const char* tokenSpelling(TokenType type);
+
+// ---- Number literals ----
+//   decimal  42 , 1_000_000        a 64-bit int , at most 9223372036854775807
+//   hex      0xFF , 0xDEAD_BEEF    any 64-bit pattern , 0xFFFFFFFFFFFFFFFF is -1
+//   binary   0b1010 , 0b1111_0000  likewise
+//   float    3.25 , 1_000.5        digits on both sides of the '.'
+// A '_' may only sit between two digits. The lexer takes any run of
+// letters , digits , '_' and '.' that starts with a digit as one literal ,
+// so `1.2.3` or `12ab` is a single malformed one rather than several tokens.
+union NumberValue {
+    int64_t i;
+    double f;
+
+    static NumberValue integer(int64_t i) { NumberValue v; v.i = i; return v; }
+    static NumberValue floating(double f) { NumberValue v; v.f = f; return v; }
+};
+
+enum class NumberError : uint8_t {
+    NONE,
+    MALFORMED,    // not one of the forms above
+    OUT_OF_RANGE  // an int past 64 bits , or a float a double cannot hold
+};
+
+// Value of a literal's text , `type` becomes INTEGER_LITERAL or FLOAT_LITERAL
+NumberError readNumber(std::string_view text , TokenType& type , NumberValue& value);
+
+// Shortest text that reads back as the same value , integral floats keep a
+// ".0" so they still look like floats. Writes at most NUMBER_TEXT_MAX bytes.
+constexpr size_t NUMBER_TEXT_MAX = 32;
+size_t formatNumber(char* out , NumberValue value , bool isFloat);
+
+// Token class : a lightweight view, value points back into the source buffer.
+// Identifiers and string literals also carry their interned symbol , number
+// literals their value , or why they have none.
 class Token {
 public:
     TokenType type;
-    std::string value;
+    NumberError numberError;
+    std::string_view value;
     int line;
+    SymbolId symbol;
+    NumberValue number;
 
-    Token(TokenType type, std::string value, int line);
+    Token();
+    Token(TokenType type, std::string_view value, int line, SymbolId symbol = NO_SYMBOL);
+    Token(TokenType type , std::string_view value , int line , NumberValue number , NumberError error);
     std::string toString() const;
 };
 
+// Structure-of-arrays token buffer. Kinds are packed one byte per token and
+// the text of each token is an (offset , length) pair into the source buffer,
+// so the source must outlive the stream. Number values sit in a pool of
+// their own , only the literals pay for them.
+class TokenStream {
+    public :
+        static constexpr uint32_t NO_NUMBER = UINT32_MAX;
+
+    private :
+        std::string_view source;
+        std::vector<TokenType> kinds;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> lengths;
+        std::vector<uint32_t> lines;
+        // NO_SYMBOL for tokens without text of their own. For number
+        // literals the index of their value in `numbers` , NO_NUMBER when
+        // the text has none.
+        std::vector<SymbolId> symbolIds;
+        std::vector<NumberValue> numbers;
+        size_t deadNumbers = 0; // pool entries of literals replace() dropped
+
+        void compactNumbers();
+
+    public :
+        TokenStream() = default;
+        explicit TokenStream(std::string_view source);
+
+        void reserve(size_t count);
+        // Give back what reserve() over-estimated , for a stream kept long after lexing
+        void shrinkToFit();
+        void push(TokenType type , uint32_t offset , uint32_t length , int line , SymbolId symbol = NO_SYMBOL);
+        void pushNumber(TokenType type , uint32_t offset , uint32_t length , int line ,
+                        NumberValue value , bool valid);
+        void resize(size_t count , size_t numberCount);
+        // Copy part[first , first + n) into slots [at , at + n) , rebasing
+        // offsets and lines. The range's number values go to pool slots
+        // numberAt onwards , in order.
+        void splice(size_t at , const TokenStream& part , size_t first , size_t n ,
+                    uint32_t offsetDelta , int lineDelta , size_t numberAt);
+        // Swap tokens [first , first + count) for all of `part` and rebase the
+        // tokens after them , leaving the stream viewing part's source
+        void replace(size_t first , size_t count , const TokenStream& part ,
+                     uint32_t offsetDelta , int lineDelta);
+
+        size_t size() const { return kinds.size(); }
+        TokenType kind(size_t i) const { return kinds[i]; }
+        uint32_t offset(size_t i) const { return offsets[i]; }
+        uint32_t length(size_t i) const { return lengths[i]; }
+        int line(size_t i) const { return static_cast<int>(lines[i]); }
+        SymbolId symbol(size_t i) const { return symbolIds[i]; }
+        // Only for number literals that have a value
+        NumberValue number(size_t i) const { return numbers[symbolIds[i]]; }
+        size_t numberCount() const { return numbers.size(); }
+        std::string_view text(size_t i) const;
+        std::string_view sourceText() const { return source; }
+
+        Token operator[](size_t i) const;
+
+        // Heap bytes held by the stream (capacity , not size)
+        size_t memoryUsage() const;
+};
+
 #endif // TOKEN_H
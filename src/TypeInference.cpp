@@ -0,0 +1,354 @@
+#include "TypeInference.h"
+#include "Bytecode.h"
+#include "Stats.h"
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t MAX_SPECIALIZATIONS = 8;
+
+// Result type of a binary operator , following evalBinary. A combination
+// that always raises a runtime error yields NONE.
+StaticType binaryType(Op op , StaticType a , StaticType b) {
+    if(a == StaticType::NONE || b == StaticType::NONE) return StaticType::NONE;
+    bool comparison = op == Op::EQ || op == Op::NE || op == Op::LT || op == Op::LE || op == Op::GT || op == Op::GE;
+    if(op == Op::EQ || op == Op::NE) return StaticType::INT;
+    if(a == StaticType::ANY || b == StaticType::ANY) return comparison ? StaticType::INT : StaticType::ANY;
+
+    if(a == StaticType::STRING && b == StaticType::STRING) {
+        if(op == Op::ADD) return StaticType::STRING;
+        return comparison ? StaticType::INT : StaticType::NONE;
+    }
+    bool numbers = (a == StaticType::INT || a == StaticType::FLOAT) && (b == StaticType::INT || b == StaticType::FLOAT);
+    if(!numbers) return StaticType::NONE;
+    if(comparison) return StaticType::INT;
+    if(a == StaticType::INT && b == StaticType::INT) return StaticType::INT;
+    return op == Op::XOR ? StaticType::NONE : StaticType::FLOAT;
+}
+
+// Slot types at one program point , `live` is false past a return
+struct Env {
+    bool live = true;
+    std::vector<StaticType> slots;
+
+    bool operator==(const Env& other) const { return live == other.live && slots == other.slots; }
+    bool operator!=(const Env& other) const { return !(*this == other); }
+};
+
+Env joinEnv(const Env& a , const Env& b) {
+    if(!a.live) return b;
+    if(!b.live) return a;
+    Env out = a;
+    for(size_t i = 0; i < out.slots.size(); i++) out.slots[i] = join(a.slots[i] , b.slots[i]);
+    return out;
+}
+
+class Analyzer {
+    private :
+        const Program& program;
+        TypeInfo& info;
+        std::unordered_map<SymbolId , uint32_t> byName;
+        std::vector<size_t> specCount; // per function , not counting the generic one
+        SymbolId print;
+        SymbolId wildcard;
+
+        // Specializations still to analyze , in order , and the specs that
+        // called each one when last analyzed. A spec may be listed twice
+        // under one callee , queueing it again is a no-op.
+        std::vector<uint32_t> work;
+        size_t next = 0;
+        std::vector<bool> queued;
+        std::vector<std::vector<uint32_t>> callers;
+
+        // State of the specialization being analyzed , written back when done
+        std::vector<StaticType> types;
+        std::vector<uint32_t> calls;
+        StaticType result;
+
+        void record(const Expression* expr , StaticType type) {
+            if(expr->index < types.size()) types[expr->index] = join(types[expr->index] , type);
+        }
+
+        void enqueue(uint32_t index) {
+            if(queued[index]) return;
+            queued[index] = true;
+            work.push_back(index);
+        }
+
+        StaticType expression(const Expression* expr , const Env& env);
+        StaticType call(const CallExpr* call , const Env& env);
+        void statement(const Statement* stmt , Env& env);
+        void block(const AstList<Statement*>& body , Env& env);
+
+    public :
+        Analyzer(const Program& program , TypeInfo& info);
+
+        // New specializations join the worklist
+        uint32_t specialize(uint32_t function , const std::vector<StaticType>& args);
+        // Recompute specs[index] from the current results of its callees
+        void analyze(uint32_t index);
+        // Analyze queued specs until no result changes
+        void run();
+};
+
+Analyzer::Analyzer(const Program& program , TypeInfo& info)
+    : program(program) , info(info) , specCount(program.functions.size() , 0)
+    , print(symbols().intern("print")) , wildcard(symbols().intern("_")) , result(StaticType::NONE) {
+    for(size_t i = 0; i < program.functions.size(); i++) {
+        byName.emplace(program.functions[i]->name , static_cast<uint32_t>(i));
+    }
+}
+
+uint32_t Analyzer::specialize(uint32_t function , const std::vector<StaticType>& args) {
+    auto it = info.index.find({function , args});
+    if(it != info.index.end()) return it->second;
+    bool generic = true;
+    for(StaticType t : args) generic = generic && t == StaticType::ANY;
+    if(!generic && specCount[function] >= MAX_SPECIALIZATIONS) return function;
+    if(!generic) specCount[function]++;
+
+    uint32_t index = static_cast<uint32_t>(info.specs.size());
+    Specialization spec;
+    spec.function = function;
+    spec.params = args;
+    info.specs.push_back(std::move(spec));
+    info.index.emplace(std::make_pair(function , args) , index);
+    queued.push_back(false);
+    callers.emplace_back();
+    enqueue(index);
+    return index;
+}
+
+void Analyzer::analyze(uint32_t index) {
+    const Specialization& spec = info.specs[index];
+    const FunctionDecl* decl = program.functions[spec.function];
+    types.assign(decl->expressions , StaticType::NONE);
+    calls.assign(decl->expressions , Specialization::NO_CALL);
+    result = StaticType::NONE;
+
+    Env env;
+    env.slots.assign(decl->frameSlots , StaticType::NONE);
+    for(size_t i = 0; i < spec.params.size(); i++) env.slots[i] = spec.params[i];
+    block(decl->body , env);
+    if(env.live) result = join(result , StaticType::NIL); // falling off the end
+
+    // specialize() may have grown the vector , so index again. The result
+    // only ever widens , which bounds how often a spec is queued.
+    Specialization& out = info.specs[index];
+    out.types.swap(types);
+    out.calls.swap(calls);
+    StaticType before = out.result;
+    out.result = join(out.result , result);
+    for(uint32_t target : out.calls) {
+        if(target == Specialization::NO_CALL) continue;
+        std::vector<uint32_t>& list = callers[target];
+        if(list.empty() || list.back() != index) list.push_back(index);
+    }
+    if(out.result != before) {
+        for(uint32_t caller : callers[index]) enqueue(caller);
+    }
+}
+
+void Analyzer::run() {
+    // First in , first out : functions tend to call ones defined earlier ,
+    // so most callees settle before their callers are analyzed
+    while(next < work.size()) {
+        uint32_t index = work[next++];
+        queued[index] = false;
+        analyze(index);
+    }
+}
+
+StaticType Analyzer::expression(const Expression* expr , const Env& env) {
+    StaticType type = StaticType::ANY;
+    switch(expr->kind) {
+        case AstKind::NUMBER :
+            type = static_cast<const NumberExpr*>(expr)->isFloat ? StaticType::FLOAT : StaticType::INT;
+            break;
+        case AstKind::STRING : type = StaticType::STRING; break;
+        case AstKind::VARIABLE : {
+            const VarRef& ref = static_cast<const VariableExpr*>(expr)->ref;
+            type = ref.resolved() ? env.slots[ref.slot] : StaticType::ANY;
+            break;
+        }
+        case AstKind::UNARY : {
+            // '!' takes any value and yields 0 or 1
+            StaticType operand = expression(static_cast<const UnaryExpr*>(expr)->operand , env);
+            type = operand == StaticType::NONE ? StaticType::NONE : StaticType::INT;
+            break;
+        }
+        case AstKind::BINARY : {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            StaticType left = expression(bin->left , env);
+            StaticType right = expression(bin->right , env);
+            Op op;
+            if(bin->op == TokenType::AND || bin->op == TokenType::OR) type = join(left , right); // the deciding operand
+            else if(binaryOp(bin->op , op)) type = binaryType(op , left , right);
+            break;
+        }
+        case AstKind::CALL : type = call(static_cast<const CallExpr*>(expr) , env); break;
+        default : break;
+    }
+    record(expr , type);
+    return type;
+}
+
+StaticType Analyzer::call(const CallExpr* c , const Env& env) {
+    std::vector<StaticType> args;
+    args.reserve(c->arguments.size());
+    bool reached = true;
+    for(const Expression* arg : c->arguments) {
+        args.push_back(expression(arg , env));
+        reached = reached && args.back() != StaticType::NONE;
+    }
+    if(c->callee->kind != AstKind::VARIABLE) return StaticType::ANY;
+    SymbolId name = static_cast<const VariableExpr*>(c->callee)->name;
+    auto it = byName.find(name);
+    if(it == byName.end()) return name == print ? StaticType::NIL : StaticType::ANY;
+    if(program.functions[it->second]->params.size() != args.size()) return StaticType::ANY; // a compile error
+    if(!reached) return StaticType::NONE;
+
+    uint32_t target = specialize(it->second , args);
+    if(c->index < calls.size()) calls[c->index] = target;
+    return info.specs[target].result;
+}
+
+void Analyzer::block(const AstList<Statement*>& body , Env& env) {
+    for(const Statement* stmt : body) {
+        if(!env.live) break;
+        statement(stmt , env);
+    }
+    // The block's own variables go out of scope. Clearing them keeps dead
+    // slots NONE , so a loop whose body only declares locals reaches its
+    // fixed point in one pass instead of two , which nested loops multiply.
+    for(const Statement* stmt : body) {
+        if(stmt->kind == AstKind::LET) env.slots[static_cast<const LetStatement*>(stmt)->slot] = StaticType::NONE;
+        else if(stmt->kind == AstKind::VAR) env.slots[static_cast<const VarStatement*>(stmt)->slot] = StaticType::NONE;
+    }
+}
+
+void Analyzer::statement(const Statement* stmt , Env& env) {
+    switch(stmt->kind) {
+        case AstKind::LET : {
+            auto let = static_cast<const LetStatement*>(stmt);
+            env.slots[let->slot] = expression(let->value , env);
+            return;
+        }
+        case AstKind::VAR : {
+            auto var = static_cast<const VarStatement*>(stmt);
+            env.slots[var->slot] = expression(var->value , env);
+            return;
+        }
+        case AstKind::ASSIGN : {
+            auto assign = static_cast<const AssignStatement*>(stmt);
+            env.slots[assign->ref.slot] = expression(assign->value , env);
+            return;
+        }
+        case AstKind::RETURN :
+            result = join(result , expression(static_cast<const ReturnStatement*>(stmt)->value , env));
+            env.live = false;
+            return;
+        case AstKind::IF : {
+            auto branch = static_cast<const IfStatement*>(stmt);
+            expression(branch->condition , env);
+            Env taken = env;
+            block(branch->thenBranch , taken);
+            block(branch->elseBranch , env);
+            env = joinEnv(taken , env);
+            return;
+        }
+        case AstKind::WHILE : {
+            auto loop = static_cast<const WhileStatement*>(stmt);
+            Env head = env;
+            for(;;) {
+                expression(loop->condition , head);
+                Env body = head;
+                block(loop->body , body);
+                Env next = joinEnv(head , body);
+                if(next == head) break;
+                head = std::move(next);
+            }
+            env = std::move(head);
+            return;
+        }
+        case AstKind::FOR : {
+            // The iterator is a fresh copy of the int counter at the top of every iteration
+            auto loop = static_cast<const ForStatement*>(stmt);
+            expression(loop->iterable , env);
+            Env head = env;
+            for(;;) {
+                Env body = head;
+                body.slots[loop->iteratorSlot] = StaticType::INT;
+                block(loop->body , body);
+                body.slots[loop->iteratorSlot] = StaticType::NONE; // scoped to the loop
+                Env next = joinEnv(head , body);
+                if(next == head) break;
+                head = std::move(next);
+            }
+            env = std::move(head);
+            return;
+        }
+        case AstKind::MATCH : {
+            auto match = static_cast<const MatchStatement*>(stmt);
+            expression(match->expr , env);
+            Env done;
+            done.live = false;
+            for(const MatchArm& arm : match->arms) {
+                bool isWildcard = arm.pattern->kind == AstKind::VARIABLE
+                               && static_cast<const VariableExpr*>(arm.pattern)->name == wildcard;
+                if(!isWildcard) expression(arm.pattern , env);
+                Env taken = env;
+                block(arm.body , taken);
+                done = joinEnv(done , taken);
+                if(isWildcard) env.live = false; // later arms are never tried
+            }
+            env = joinEnv(done , env); // no arm matched
+            return;
+        }
+        default : return;
+    }
+}
+
+} // namespace
+
+const char* staticTypeName(StaticType type) {
+    switch(type) {
+        case StaticType::NONE : return "none";
+        case StaticType::INT : return "int";
+        case StaticType::FLOAT : return "float";
+        case StaticType::STRING : return "string";
+        case StaticType::NIL : return "nil";
+        default : return "any";
+    }
+}
+
+StaticType Specialization::typeOf(const Expression* expr) const {
+    return expr->index < types.size() ? types[expr->index] : StaticType::NONE;
+}
+
+uint32_t Specialization::callOf(const CallExpr* call) const {
+    return call->index < calls.size() ? calls[call->index] : NO_CALL;
+}
+
+std::string Specialization::signature() const {
+    std::string out = "(";
+    for(size_t i = 0; i < params.size(); i++) {
+        if(i > 0) out += " , ";
+        out += staticTypeName(params[i]);
+    }
+    return out + ") -> " + staticTypeName(result);
+}
+
+TypeInfo inferTypes(const Program& program) {
+    PhaseTimer timer(Phase::INFER);
+    TypeInfo info;
+    Analyzer analyzer(program , info);
+    for(size_t i = 0; i < program.functions.size(); i++) {
+        analyzer.specialize(static_cast<uint32_t>(i) , std::vector<StaticType>(program.functions[i]->params.size() , StaticType::ANY));
+    }
+    // Each result changes at most twice (NONE , one type , ANY) and every
+    // change requeues the callers , so each spec's types end up computed
+    // against the final results of its callees
+    analyzer.run();
+    return info;
+}
@@ -0,0 +1,64 @@
+#ifndef TYPE_INFERENCE_H
+#define TYPE_INFERENCE_H
+
+#include "AST.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ---- Static types : NONE below INT , FLOAT , STRING and NIL , ANY above ----
+// NONE means no value gets there : not analyzed yet , or the code raises or
+// never returns. ANY means it may be more than one type.
+enum class StaticType : uint8_t { NONE , INT , FLOAT , STRING , NIL , ANY };
+
+inline StaticType join(StaticType a , StaticType b) {
+    if(a == b || b == StaticType::NONE) return a;
+    if(a == StaticType::NONE) return b;
+    return StaticType::ANY;
+}
+
+const char* staticTypeName(StaticType type);
+
+// One function analyzed for one tuple of argument types
+struct Specialization {
+    static constexpr uint32_t NO_CALL = UINT32_MAX;
+
+    uint32_t function;              // index into program.functions
+    std::vector<StaticType> params;
+    StaticType result = StaticType::NONE;
+    // Both indexed by ASTNode::index , as numbered by the resolver
+    std::vector<StaticType> types; // NONE where no analyzed path reaches
+    std::vector<uint32_t> calls;   // specialization a call reaches , NO_CALL elsewhere
+
+    // NONE for an expression no analyzed path reaches or the resolver did
+    // not number
+    StaticType typeOf(const Expression* expr) const;
+    // NO_CALL unless the call reaches a user function
+    uint32_t callOf(const CallExpr* call) const;
+    // "(int , float) -> int"
+    std::string signature() const;
+};
+
+struct TypeInfo {
+    // specs[i] for i < program.functions.size() is function i's generic
+    // version , all parameters ANY , the rest come from calls
+    std::vector<Specialization> specs;
+    std::map<std::pair<uint32_t , std::vector<StaticType>> , uint32_t> index;
+};
+
+// Flow-sensitive inference over resolved programs (run resolveProgram
+// first). Within a function every slot carries the type of its latest
+// assignment , branches join and loops iterate to a fixed point. Across
+// functions each call's argument types pick a specialization , whose result
+// type feeds back into its callers : a worklist reanalyzes just the callers
+// of a specialization whose result changed , until nothing changes. A function gets at
+// most 8 specializations besides the generic one , later signatures share
+// the generic one.
+//
+// Every type is sound for all executions : an expression typed INT always
+// evaluates to an int , so backends may drop the tag checks.
+TypeInfo inferTypes(const Program& program);
+
+#endif // TYPE_INFERENCE_H
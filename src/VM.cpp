@@ -0,0 +1,308 @@
+#include "VM.h"
+#include "Jit.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(STRYX_SWITCH_DISPATCH)
+#define STRYX_THREADED_DISPATCH 1
+#else
+#define STRYX_THREADED_DISPATCH 0
+#endif
+
+namespace {
+
+// Thrown by runtimeError , run() catches it and abandons the calls in
+// progress. Native code never calls back into the VM , so it only ever
+// unwinds interpreter frames.
+struct RuntimeFailure {
+    std::string message;
+};
+
+[[noreturn]] void runtimeError(const std::string& message) {
+    throw RuntimeFailure{message};
+}
+
+const char* opSymbol(Op op) {
+    switch(op) {
+        case Op::ADD : return "+";
+        case Op::SUB : return "-";
+        case Op::MUL : return "*";
+        case Op::DIV : return "/";
+        case Op::MOD : return "%";
+        case Op::XOR : return "^";
+        case Op::EQ : return "==";
+        case Op::NE : return "!=";
+        case Op::LT : return "<";
+        case Op::LE : return "<=";
+        case Op::GT : return ">";
+        case Op::GE : return ">=";
+        default : return opName(op);
+    }
+}
+
+[[noreturn]] void typeError(Op op , const Value& a , const Value& b) {
+    runtimeError(std::string("cannot apply '") + opSymbol(op) + "' to " + typeName(a.type) + " and " + typeName(b.type));
+}
+
+// Ints wrap like two's complement instead of overflowing
+inline int64_t wrapAdd(int64_t a , int64_t b) { return static_cast<int64_t>(uint64_t(a) + uint64_t(b)); }
+inline int64_t wrapSub(int64_t a , int64_t b) { return static_cast<int64_t>(uint64_t(a) - uint64_t(b)); }
+inline int64_t wrapMul(int64_t a , int64_t b) { return static_cast<int64_t>(uint64_t(a) * uint64_t(b)); }
+
+// Everything the int fast paths in the dispatch loop do not handle
+__attribute__((noinline)) Value slowBinary(Op op , const Value& a , const Value& b) {
+    Value out;
+    if(evalBinary(op , a , b , out)) return out;
+    if(a.type == ValueType::INT && b.type == ValueType::INT) runtimeError("integer division by zero");
+    typeError(op , a , b);
+}
+
+} // namespace
+
+VM::VM(size_t stackSlots , size_t maxDepth , size_t nurseryBytes)
+    : stack(stackSlots , Value::nil()) , frames(maxDepth) , heap(nurseryBytes) , regionOwner(nullptr) ,
+      highWater(stack.data()) {}
+
+void VM::enter(const Module& module , uint32_t entry , const std::vector<Value>& args) {
+    const BytecodeFunction& fn = module.functions.at(entry);
+    if(args.size() != fn.params) {
+        runtimeError(std::string(symbolText(fn.name)) + " takes " + std::to_string(fn.params)
+                     + " arguments , got " + std::to_string(args.size()));
+    }
+    if(fn.frameSize > stack.size()) runtimeError("stack overflow");
+    std::copy(args.begin() , args.end() , stack.begin());
+}
+
+Value VM::run(const Module& module , uint32_t entry , const std::vector<Value>& args) {
+    uint64_t unused = 0;
+    return guarded<false>(module , entry , args , unused);
+}
+
+Value VM::run(const Module& module , uint32_t entry , const std::vector<Value>& args , uint64_t& executed) {
+    return guarded<true>(module , entry , args , executed);
+}
+
+template <bool COUNT>
+Value VM::guarded(const Module& module , uint32_t entry , const std::vector<Value>& args , uint64_t& executed) {
+    failure.clear();
+    try {
+        enter(module , entry , args);
+        Value result;
+        if(jit && jit->tryCall(entry , args.data() , args.size() , result)) return result;
+        return execute<COUNT>(module , entry , executed);
+    } catch(const RuntimeFailure& error) {
+        failure = error.message;
+        return Value::nil();
+    }
+}
+
+__attribute__((noinline)) Value VM::concat(const Value& a , const Value& b , const Frame* owner , Value* top) {
+    size_t length = stringText(a).size() + stringText(b).size();
+    if(length > UINT32_MAX) runtimeError("string of " + std::to_string(length) + " bytes is too long");
+    // A collection moves strings , the texts are read after it
+    if(heap.full(length)) heap.collect(stack.data() , static_cast<size_t>(top - stack.data()) , length);
+    uint64_t mark = heap.mark();
+    Value result = heap.concat(stringText(a) , stringText(b));
+    if(heap.allocatedSince(mark)) openRegion(owner , mark);
+    return result;
+}
+
+void VM::openRegion(const Frame* owner , uint64_t mark) {
+    if(owner == regionOwner) return;
+    regions.push_back(Region{owner , mark});
+    regionOwner = owner;
+}
+
+__attribute__((noinline)) Value VM::dropRegion(const Frame* callee , Value* calleeBase , Value result) {
+    uint64_t mark = regions.back().mark;
+    regions.pop_back();
+    regionOwner = regions.empty() ? nullptr : regions.back().owner;
+    heap.release(mark , result);
+    const Frame& caller = callee[-1];
+    std::fill(calleeBase + 1 , highWater , Value::nil());
+    highWater = caller.base + caller.fn->frameSize;
+    // A result that escaped now starts the caller's region
+    if(heap.allocatedSince(mark)) openRegion(&caller , mark);
+    return result;
+}
+
+template <bool COUNT>
+Value VM::execute(const Module& module , uint32_t entry , uint64_t& executed) {
+    const BytecodeFunction* fn = &module.functions[entry];
+    const Instr* pc = fn->code.data();
+    const Value* K = fn->constants.data();
+    Value* base = stack.data();
+    Value* stackEnd = stack.data() + stack.size();
+    Frame* frame = frames.data();
+    Frame* frameEnd = frames.data() + frames.size();
+    Jit* const native = jit;
+    // Whatever the last run left in the heap stays , in no region
+    regions.clear();
+    regionOwner = nullptr;
+    highWater = std::max(highWater , base + fn->frameSize);
+    uint64_t count = 0;
+    Instr i;
+
+#if STRYX_THREADED_DISPATCH
+    static void* const labels[] = {
+#define STRYX_OPCODE_LABEL(name) &&op_##name,
+        STRYX_OPCODES(STRYX_OPCODE_LABEL)
+#undef STRYX_OPCODE_LABEL
+    };
+#define CASE(name) op_##name:
+#define DISPATCH() do { if(COUNT) count++; i = *pc++; goto *labels[i & 0xFF]; } while(0)
+    DISPATCH();
+#else
+#define CASE(name) case Op::name:
+#define DISPATCH() continue
+    for(;;) {
+    if(COUNT) count++;
+    i = *pc++;
+    switch(opOf(i)) {
+#endif
+
+#define R(n) base[n]
+#define INT_OP(name , expr)                                                   \
+    CASE(name) {                                                              \
+        const Value& b = R(argB(i));                                          \
+        const Value& c = R(argC(i));                                          \
+        if(b.type == ValueType::INT && c.type == ValueType::INT) {            \
+            int64_t x = b.i , y = c.i;                                        \
+            R(argA(i)) = Value::integer(expr);                                \
+        } else {                                                              \
+            R(argA(i)) = slowBinary(Op::name , b , c);                        \
+        }                                                                     \
+        DISPATCH();                                                           \
+    }
+
+    CASE(LOADK) { R(argA(i)) = K[argBx(i)]; DISPATCH(); }
+    CASE(LOADNIL) { R(argA(i)) = Value::nil(); DISPATCH(); }
+    CASE(MOVE) { R(argA(i)) = R(argB(i)); DISPATCH(); }
+    CASE(NOT) { R(argA(i)) = Value::integer(!truthy(R(argB(i)))); DISPATCH(); }
+    CASE(ADD) {
+        const Value& b = R(argB(i));
+        const Value& c = R(argC(i));
+        if(b.type == ValueType::INT && c.type == ValueType::INT) {
+            R(argA(i)) = Value::integer(wrapAdd(b.i , c.i));
+        } else if(b.type == ValueType::STRING && c.type == ValueType::STRING) {
+            R(argA(i)) = concat(b , c , frame , highWater);
+        } else {
+            R(argA(i)) = slowBinary(Op::ADD , b , c);
+        }
+        DISPATCH();
+    }
+    INT_OP(SUB , wrapSub(x , y))
+    INT_OP(MUL , wrapMul(x , y))
+    CASE(DIV) { R(argA(i)) = slowBinary(Op::DIV , R(argB(i)) , R(argC(i))); DISPATCH(); }
+    CASE(MOD) {
+        const Value& b = R(argB(i));
+        const Value& c = R(argC(i));
+        if(b.type == ValueType::INT && c.type == ValueType::INT && c.i > 0) {
+            R(argA(i)) = Value::integer(b.i % c.i);
+        } else {
+            R(argA(i)) = slowBinary(Op::MOD , b , c);
+        }
+        DISPATCH();
+    }
+    CASE(MODP2) {
+        const Value& b = R(argB(i));
+        int64_t m = (int64_t(1) << argC(i)) - 1;
+        if(b.type == ValueType::INT) {
+            int64_t r = b.i & m;
+            R(argA(i)) = Value::integer(b.i < 0 && r != 0 ? r - m - 1 : r); // truncating , like %
+        } else {
+            R(argA(i)) = slowBinary(Op::MOD , b , Value::integer(m + 1));
+        }
+        DISPATCH();
+    }
+    INT_OP(XOR , x ^ y)
+    INT_OP(EQ , x == y)
+    INT_OP(NE , x != y)
+    INT_OP(LT , x < y)
+    INT_OP(LE , x <= y)
+    INT_OP(GT , x > y)
+    INT_OP(GE , x >= y)
+    // The compiler proved both operands' types , so the tags are not looked at
+    CASE(IADD) { R(argA(i)) = Value::integer(wrapAdd(R(argB(i)).i , R(argC(i)).i)); DISPATCH(); }
+    CASE(ISUB) { R(argA(i)) = Value::integer(wrapSub(R(argB(i)).i , R(argC(i)).i)); DISPATCH(); }
+    CASE(IMUL) { R(argA(i)) = Value::integer(wrapMul(R(argB(i)).i , R(argC(i)).i)); DISPATCH(); }
+    CASE(ILT) { R(argA(i)) = Value::integer(R(argB(i)).i < R(argC(i)).i); DISPATCH(); }
+    CASE(ILE) { R(argA(i)) = Value::integer(R(argB(i)).i <= R(argC(i)).i); DISPATCH(); }
+    CASE(IGT) { R(argA(i)) = Value::integer(R(argB(i)).i > R(argC(i)).i); DISPATCH(); }
+    CASE(IGE) { R(argA(i)) = Value::integer(R(argB(i)).i >= R(argC(i)).i); DISPATCH(); }
+    CASE(FADD) { R(argA(i)) = Value::number(R(argB(i)).f + R(argC(i)).f); DISPATCH(); }
+    CASE(FSUB) { R(argA(i)) = Value::number(R(argB(i)).f - R(argC(i)).f); DISPATCH(); }
+    CASE(FMUL) { R(argA(i)) = Value::number(R(argB(i)).f * R(argC(i)).f); DISPATCH(); }
+    CASE(FDIV) { R(argA(i)) = Value::number(R(argB(i)).f / R(argC(i)).f); DISPATCH(); }
+    CASE(FLT) { R(argA(i)) = Value::integer(R(argB(i)).f < R(argC(i)).f); DISPATCH(); }
+    CASE(FLE) { R(argA(i)) = Value::integer(R(argB(i)).f <= R(argC(i)).f); DISPATCH(); }
+    CASE(FGT) { R(argA(i)) = Value::integer(R(argB(i)).f > R(argC(i)).f); DISPATCH(); }
+    CASE(FGE) { R(argA(i)) = Value::integer(R(argB(i)).f >= R(argC(i)).f); DISPATCH(); }
+    CASE(JMP) { pc += argSBx(i); DISPATCH(); }
+    CASE(JMPF) { if(!truthy(R(argA(i)))) pc += argSBx(i); DISPATCH(); }
+    CASE(JMPT) { if(truthy(R(argA(i)))) pc += argSBx(i); DISPATCH(); }
+    CASE(SWITCH) { pc = fn->code.data() + fn->switches[argBx(i)].target(R(argA(i))); DISPATCH(); }
+    CASE(CALL) {
+        uint32_t index = *pc++;
+        Value* calleeBase = base + argA(i);
+        if(native) {
+            Value result;
+            if(native->tryCall(index , calleeBase , argB(i) , result)) {
+                R(argA(i)) = result;
+                DISPATCH();
+            }
+        }
+        const BytecodeFunction* callee = &module.functions[index];
+        // highWater never passes stackEnd , so a window below it fits
+        Value* top = calleeBase + callee->frameSize;
+        if(top > highWater) {
+            if(top > stackEnd) runtimeError("stack overflow calling " + std::string(symbolText(callee->name)));
+            highWater = top;
+        }
+        if(frame + 1 == frameEnd) runtimeError("stack overflow calling " + std::string(symbolText(callee->name)));
+        *frame++ = Frame{fn , pc , base};
+        fn = callee;
+        pc = fn->code.data();
+        K = fn->constants.data();
+        base = calleeBase;
+        DISPATCH();
+    }
+    CASE(PRINT) {
+        for(uint8_t n = 0; n < argB(i); n++) {
+            if(n > 0) std::cout<<" ";
+            printValue(std::cout , R(argA(i) + n));
+        }
+        std::cout<<"\n";
+        R(argA(i)) = Value::nil();
+        DISPATCH();
+    }
+    CASE(RET) {
+        if(frame == frames.data()) {
+            if(COUNT) executed += count;
+            return R(argA(i));
+        }
+        // Into the caller's R[A] of the CALL , copied straight across when the
+        // callee allocated nothing
+        if(__builtin_expect(frame == regionOwner , 0)) base[0] = dropRegion(frame , base , R(argA(i)));
+        else base[0] = R(argA(i));
+        --frame;
+        fn = frame->fn;
+        pc = frame->pc;
+        K = fn->constants.data();
+        base = frame->base;
+        DISPATCH();
+    }
+
+#undef INT_OP
+#undef R
+#undef DISPATCH
+#undef CASE
+#if !STRYX_THREADED_DISPATCH
+    }
+    }
+#endif
+}
+
+template Value VM::execute<true>(const Module& , uint32_t , uint64_t&);
+template Value VM::execute<false>(const Module& , uint32_t , uint64_t&);
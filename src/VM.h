@@ -0,0 +1,85 @@
+#ifndef VM_H
+#define VM_H
+
+#include "Bytecode.h"
+#include "Heap.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Jit;
+
+// Register VM for compiled Stryx modules. Every frame is a window into one
+// value stack allocated up front : a call's arguments already sit in the
+// caller's registers and become the callee's R[0] .. , so calls copy nothing.
+// Dispatch is threaded through computed gotos on GCC and Clang , define
+// STRYX_SWITCH_DISPATCH to force the portable switch loop.
+//
+// Strings the program builds live in `heap` , each call owning the region
+// allocated while it runs. A call opens its region on its first allocation ,
+// so calls that build no string push nothing and return as before. The
+// collector's roots are the registers below `highWater` : calls raise it to
+// the top of the callee's window , and a return that drops a region nils the
+// callee's window and everything above it , so no register anywhere points
+// into a dropped region.
+class VM {
+    private :
+        struct Frame {
+            const BytecodeFunction* fn;
+            const Instr* pc;
+            Value* base;
+        };
+        // The heap region of a running call , `owner` is the `frame` cursor
+        // of execute() while the call runs
+        struct Region {
+            const Frame* owner;
+            uint64_t mark;
+        };
+
+        std::vector<Value> stack;
+        std::vector<Frame> frames;
+        Heap heap;
+        std::vector<Region> regions; // innermost last
+        const Frame* regionOwner;    // owner of the innermost region , nullptr without one
+        Value* highWater;            // registers at and above it hold no HEAP string
+        Jit* jit = nullptr;
+        std::string failure; // why the last run stopped , empty when it returned
+
+        void enter(const Module& module , uint32_t entry , const std::vector<Value>& args);
+        // run() , turning a runtime error into `failure`
+        template <bool COUNT>
+        Value guarded(const Module& module , uint32_t entry , const std::vector<Value>& args , uint64_t& executed);
+        // Only the counting instantiation pays for an increment per instruction
+        template <bool COUNT>
+        Value execute(const Module& module , uint32_t entry , uint64_t& executed);
+        // a + b for two strings , allocated in the region of the call `owner`.
+        // A collection it needs takes the registers below `top` as roots.
+        Value concat(const Value& a , const Value& b , const Frame* owner , Value* top);
+        void openRegion(const Frame* owner , uint64_t mark);
+        // Return from the call owning the innermost region , `result` moves
+        // down into the caller's
+        Value dropRegion(const Frame* callee , Value* calleeBase , Value result);
+
+    public :
+        // `stackSlots` values shared by all frames , at most `maxDepth` nested calls
+        explicit VM(size_t stackSlots = 1 << 18 , size_t maxDepth = 1 << 16 , size_t nurseryBytes = Heap::DEFAULT_NURSERY);
+        VM(const VM&) = delete;
+        VM& operator=(const VM&) = delete;
+
+        // Offer every call to `jit` first , which must be built for the module
+        // passed to run(). nullptr interprets everything.
+        void attach(Jit* native) { jit = native; }
+
+        // Call module.functions[entry] with `args` and return its result. A
+        // string result stays valid until the next run. A runtime error
+        // abandons every call in progress and returns nil , error() says why.
+        Value run(const Module& module , uint32_t entry , const std::vector<Value>& args = {});
+        // Same , also counting the instructions executed
+        Value run(const Module& module , uint32_t entry , const std::vector<Value>& args , uint64_t& executed);
+        // The last run's runtime error , empty when it returned normally
+        const std::string& error() const { return failure; }
+
+        const HeapStats& heapStats() const { return heap.stats(); }
+};
+
+#endif // VM_H
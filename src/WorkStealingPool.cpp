@@ -0,0 +1,94 @@
+#include "WorkStealingPool.h"
+
+namespace {
+
+// Identifies the pool and deque of the calling thread , null outside workers
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : queued(0) , nextQueue(0) , pending(0) , stopping(false) {
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    if(threads == 0) threads = 1;
+    queues.reserve(threads);
+    for(size_t i = 0; i < threads; i++) queues.push_back(std::make_unique<Queue>());
+    workers.reserve(threads);
+    for(size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this , i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for(auto& worker : workers) worker.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+    }
+    size_t target = currentPool == this
+        ? currentWorker
+        : nextQueue.fetch_add(1 , std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.fetch_add(1);
+    }
+    available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock , [this] { return pending == 0; });
+}
+
+bool WorkStealingPool::popLocal(size_t worker , Task& task) {
+    Queue& q = *queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if(q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t worker , Task& task) {
+    for(size_t k = 1; k < queues.size(); k++) {
+        Queue& q = *queues[(worker + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if(q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+    currentPool = this;
+    currentWorker = worker;
+    while(true) {
+        Task task;
+        if(popLocal(worker , task) || steal(worker , task)) {
+            queued.fetch_sub(1);
+            task(worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+            if(pending == 0) idle.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock , [this] { return stopping || queued.load() > 0; });
+        if(stopping && queued.load() <= 0) return; //STOPPING AND DRAINED
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool with one task deque per worker. A worker pops its own deque
+// from the back (newest first , so split work stays cache-warm) and , when
+// that runs dry , steals from the front of the others. Tasks submitted from
+// inside a task land on the submitting worker's deque , which is what makes
+// recursive splitting balance itself. Tasks receive the index of the worker
+// running them so callers can keep per-worker state without locking.
+class WorkStealingPool {
+    public :
+        using Task = std::function<void(size_t worker)>;
+
+    private :
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::mutex mutex;
+        std::condition_variable available;
+        std::condition_variable idle;
+        std::atomic<long> queued;       // tasks sitting in the deques
+        std::atomic<size_t> nextQueue;  // round-robin target for outside submits
+        size_t pending;                 // submitted but not finished , guarded by mutex
+        bool stopping;
+
+        bool popLocal(size_t worker , Task& task);
+        bool steal(size_t worker , Task& task);
+        void workerLoop(size_t worker);
+
+    public :
+        // 0 threads means one per hardware thread
+        explicit WorkStealingPool(size_t threads = 0);
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        void submit(Task task);
+        // Block until every submitted task , including ones spawned by tasks , has finished
+        void wait();
+        size_t size() const { return workers.size(); }
+};
+
+#endif // WORK_STEALING_POOL_H
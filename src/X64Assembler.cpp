@@ -0,0 +1,165 @@
+#include "X64Assembler.h"
+
+namespace x64 {
+
+void Assembler::u32(uint32_t v) {
+    for(int i = 0; i < 4; i++) byte(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void Assembler::u64(uint64_t v) {
+    for(int i = 0; i < 8; i++) byte(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void Assembler::patch32(size_t at , uint32_t v) {
+    for(int i = 0; i < 4; i++) code[at + i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+// REX is only emitted when it carries something : W , or a high register
+void Assembler::rex(bool w , int reg , int base) {
+    uint8_t r = static_cast<uint8_t>(0x40 | (w ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((base >> 3) & 1));
+    if(r != 0x40) byte(r);
+}
+
+// Always [base + disp32] , rsp and r12 as a base need a SIB byte
+void Assembler::modrmMem(int reg , Reg base , int32_t disp) {
+    byte(static_cast<uint8_t>(0x80 | (reg & 7) << 3 | (base & 7)));
+    if((base & 7) == RSP) byte(0x24);
+    u32(static_cast<uint32_t>(disp));
+}
+
+void Assembler::sse(uint8_t prefix , uint8_t op , int reg , int rm , bool w) {
+    byte(prefix);
+    rex(w , reg , rm);
+    byte(0x0F);
+    byte(op);
+    modrmReg(reg , rm);
+}
+
+void Assembler::sseMem(uint8_t prefix , uint8_t op , int reg , Reg base , int32_t disp) {
+    byte(prefix);
+    rex(false , reg , base);
+    byte(0x0F);
+    byte(op);
+    modrmMem(reg , base , disp);
+}
+
+// ---- integer ----
+
+void Assembler::mov(Reg dst , Reg src) {
+    rex(true , src , dst); byte(0x89); modrmReg(src , dst);
+}
+
+void Assembler::mov(Reg dst , int64_t imm) {
+    if(imm >= INT32_MIN && imm <= INT32_MAX) {
+        rex(true , 0 , dst); byte(0xC7); modrmReg(0 , dst); u32(static_cast<uint32_t>(imm));
+    } else {
+        rex(true , 0 , dst); byte(static_cast<uint8_t>(0xB8 + (dst & 7))); u64(static_cast<uint64_t>(imm));
+    }
+}
+
+void Assembler::load(Reg dst , Reg base , int32_t disp) {
+    rex(true , dst , base); byte(0x8B); modrmMem(dst , base , disp);
+}
+
+void Assembler::store(Reg base , int32_t disp , Reg src) {
+    rex(true , src , base); byte(0x89); modrmMem(src , base , disp);
+}
+
+void Assembler::lea(Reg dst , Reg base , int32_t disp) {
+    rex(true , dst , base); byte(0x8D); modrmMem(dst , base , disp);
+}
+
+void Assembler::add(Reg dst , Reg src) { rex(true , src , dst); byte(0x01); modrmReg(src , dst); }
+void Assembler::sub(Reg dst , Reg src) { rex(true , src , dst); byte(0x29); modrmReg(src , dst); }
+void Assembler::xor_(Reg dst , Reg src) { rex(true , src , dst); byte(0x31); modrmReg(src , dst); }
+void Assembler::cmp(Reg a , Reg b) { rex(true , b , a); byte(0x39); modrmReg(b , a); }
+void Assembler::test(Reg a , Reg b) { rex(true , b , a); byte(0x85); modrmReg(b , a); }
+
+void Assembler::imul(Reg dst , Reg src) {
+    rex(true , dst , src); byte(0x0F); byte(0xAF); modrmReg(dst , src);
+}
+
+void Assembler::cmp(Reg a , Reg base , int32_t disp) {
+    rex(true , a , base); byte(0x3B); modrmMem(a , base , disp);
+}
+
+void Assembler::cmp(Reg a , int8_t imm) {
+    rex(true , 0 , a); byte(0x83); modrmReg(7 , a); byte(static_cast<uint8_t>(imm));
+}
+
+void Assembler::neg(Reg r) { rex(true , 0 , r); byte(0xF7); modrmReg(3 , r); }
+void Assembler::cqo() { byte(0x48); byte(0x99); }
+void Assembler::idiv(Reg divisor) { rex(true , 0 , divisor); byte(0xF7); modrmReg(7 , divisor); }
+
+void Assembler::addImm(Reg r , int32_t imm) {
+    rex(true , 0 , r); byte(0x81); modrmReg(0 , r); u32(static_cast<uint32_t>(imm));
+}
+
+void Assembler::subImm(Reg r , int32_t imm) {
+    rex(true , 0 , r); byte(0x81); modrmReg(5 , r); u32(static_cast<uint32_t>(imm));
+}
+
+void Assembler::setcc(Cond c , Reg r8) {
+    byte(0x0F); byte(static_cast<uint8_t>(0x90 + c)); modrmReg(0 , r8);
+}
+
+void Assembler::andByte(Reg dst8 , Reg src8) { byte(0x20); modrmReg(src8 , dst8); }
+void Assembler::orByte(Reg dst8 , Reg src8) { byte(0x08); modrmReg(src8 , dst8); }
+
+void Assembler::movzxByte(Reg dst , Reg src8) {
+    rex(false , dst , src8); byte(0x0F); byte(0xB6); modrmReg(dst , src8);
+}
+
+void Assembler::push(Reg r) {
+    if(r >= R8) byte(0x41);
+    byte(static_cast<uint8_t>(0x50 + (r & 7)));
+}
+
+void Assembler::pop(Reg r) {
+    if(r >= R8) byte(0x41);
+    byte(static_cast<uint8_t>(0x58 + (r & 7)));
+}
+
+// ---- control flow ----
+
+size_t Assembler::jcc(Cond c) {
+    byte(0x0F); byte(static_cast<uint8_t>(0x80 + c)); u32(0);
+    return code.size() - 4;
+}
+
+size_t Assembler::jmp() {
+    byte(0xE9); u32(0);
+    return code.size() - 4;
+}
+
+void Assembler::jmp(size_t target) {
+    byte(0xE9);
+    u32(static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(code.size() + 4)));
+}
+
+void Assembler::bind(size_t rel32At) {
+    patch32(rel32At , static_cast<uint32_t>(static_cast<int64_t>(code.size()) - static_cast<int64_t>(rel32At + 4)));
+}
+
+void Assembler::call(Reg r) { rex(false , 0 , r); byte(0xFF); modrmReg(2 , r); }
+
+void Assembler::callMem(Reg base) {
+    rex(false , 0 , base); byte(0xFF); modrmMem(2 , base , 0);
+}
+
+// ---- scalar double ----
+
+void Assembler::movsd(Xmm dst , Xmm src) { sse(0xF2 , 0x10 , dst , src); }
+void Assembler::movsd(Xmm dst , Reg base , int32_t disp) { sseMem(0xF2 , 0x10 , dst , base , disp); }
+void Assembler::movsd(Reg base , int32_t disp , Xmm src) { sseMem(0xF2 , 0x11 , src , base , disp); }
+void Assembler::movq(Xmm dst , Reg src) { sse(0x66 , 0x6E , dst , src , true); }
+void Assembler::movq(Reg dst , Xmm src) { sse(0x66 , 0x7E , src , dst , true); }
+void Assembler::cvtsi2sd(Xmm dst , Reg src) { sse(0xF2 , 0x2A , dst , src , true); }
+void Assembler::addsd(Xmm dst , Xmm src) { sse(0xF2 , 0x58 , dst , src); }
+void Assembler::subsd(Xmm dst , Xmm src) { sse(0xF2 , 0x5C , dst , src); }
+void Assembler::mulsd(Xmm dst , Xmm src) { sse(0xF2 , 0x59 , dst , src); }
+void Assembler::divsd(Xmm dst , Xmm src) { sse(0xF2 , 0x5E , dst , src); }
+void Assembler::ucomisd(Xmm a , Xmm b) { sse(0x66 , 0x2E , a , b); }
+void Assembler::xorpd(Xmm dst , Xmm src) { sse(0x66 , 0x57 , dst , src); }
+
+} // namespace x64
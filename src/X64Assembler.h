@@ -0,0 +1,94 @@
+#ifndef X64_ASSEMBLER_H
+#define X64_ASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Just enough of the x86-64 encoding for the JIT : 64-bit integer ALU ops ,
+// scalar SSE2 doubles , [base + disp32] memory operands and rel32 branches.
+namespace x64 {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum Xmm : uint8_t { XMM0, XMM1 };
+
+// Condition codes as encoded in Jcc / SETcc
+enum Cond : uint8_t {
+    B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, BE = 0x6, A = 0x7,
+    P = 0xA, NP = 0xB, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF
+};
+
+inline Cond invert(Cond c) { return static_cast<Cond>(c ^ 1); }
+
+class Assembler {
+    private :
+        std::vector<uint8_t> code;
+
+        void rex(bool w , int reg , int base);
+        void modrmReg(int reg , int rm) { byte(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7))); }
+        void modrmMem(int reg , Reg base , int32_t disp);
+        void sse(uint8_t prefix , uint8_t op , int reg , int rm , bool w = false);
+        void sseMem(uint8_t prefix , uint8_t op , int reg , Reg base , int32_t disp);
+
+    public :
+        size_t size() const { return code.size(); }
+        const std::vector<uint8_t>& bytes() const { return code; }
+
+        void byte(uint8_t b) { code.push_back(b); }
+        void u32(uint32_t v);
+        void u64(uint64_t v);
+        void patch32(size_t at , uint32_t v);
+
+        // ---- integer ----
+        void mov(Reg dst , Reg src);
+        void mov(Reg dst , int64_t imm);
+        void load(Reg dst , Reg base , int32_t disp);   // dst = [base + disp]
+        void store(Reg base , int32_t disp , Reg src);  // [base + disp] = src
+        void lea(Reg dst , Reg base , int32_t disp);
+        void add(Reg dst , Reg src);
+        void sub(Reg dst , Reg src);
+        void imul(Reg dst , Reg src);
+        void xor_(Reg dst , Reg src);
+        void cmp(Reg a , Reg b);
+        void cmp(Reg a , Reg base , int32_t disp);      // a - [base + disp]
+        void cmp(Reg a , int8_t imm);
+        void test(Reg a , Reg b);
+        void neg(Reg r);
+        void cqo();
+        void idiv(Reg divisor);
+        void addImm(Reg r , int32_t imm);
+        void subImm(Reg r , int32_t imm);
+        void setcc(Cond c , Reg r8);                    // al , cl , dl or bl
+        void andByte(Reg dst8 , Reg src8);
+        void orByte(Reg dst8 , Reg src8);
+        void movzxByte(Reg dst , Reg src8);
+        void push(Reg r);
+        void pop(Reg r);
+
+        // ---- control flow : jumps return the offset of their rel32 for bind() ----
+        size_t jcc(Cond c);
+        size_t jmp();
+        void jmp(size_t target);
+        void bind(size_t rel32At);                      // point a forward jump here
+        void call(Reg r);
+        void callMem(Reg base);                         // call [base]
+        void ret() { byte(0xC3); }
+
+        // ---- scalar double ----
+        void movsd(Xmm dst , Xmm src);
+        void movsd(Xmm dst , Reg base , int32_t disp);
+        void movsd(Reg base , int32_t disp , Xmm src);
+        void movq(Xmm dst , Reg src);
+        void movq(Reg dst , Xmm src);
+        void cvtsi2sd(Xmm dst , Reg src);
+        void addsd(Xmm dst , Xmm src);
+        void subsd(Xmm dst , Xmm src);
+        void mulsd(Xmm dst , Xmm src);
+        void divsd(Xmm dst , Xmm src);
+        void ucomisd(Xmm a , Xmm b);
+        void xorpd(Xmm dst , Xmm src);
+};
+
+} // namespace x64
+
+#endif // X64_ASSEMBLER_H
@@ -1,36 +1,408 @@
 #include <iostream>
+#include <cstring>
 #include <fstream>
+#include <string>
 #include <vector>
+#include "AstCache.h"
+#include "AstSerializer.h"
+#include "CompileServer.h"
+#include "Compiler.h"
+#include "FlatAST.h"
+#include "Jit.h"
 #include "Lexer.h"
+#include "Optimizer.h"
+#include "ParallelLexer.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "SourceBuffer.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "WorkStealingPool.h"
 #include "Token.h"
+#include "VM.h"
 
-void runLexer(const std::string& source) {
+void runLexer(std::string_view source , size_t jobs) {
+    TokenStream tokens;
+    if(jobs > 1) {
+        ThreadPool pool(jobs);
+        tokens = tokenizeParallel(source , pool);
+    } else {
+        Lexer lexer(source);
+        tokens = lexer.tokenize();
+    }
+
+    for(size_t i = 0; i < tokens.size(); i++) {
+        std::cout<<tokens[i].toString()<<std::endl;
+    }
+}
+
+Program parseSource(std::string_view source , size_t jobs) {
+    if(jobs > 1) {
+        TokenStream tokens;
+        {
+            ThreadPool lexPool(jobs);
+            tokens = tokenizeParallel(source , lexPool);
+        }
+        WorkStealingPool pool(jobs);
+        return parseParallel(tokens , pool);
+    }
     Lexer lexer(source);
-    std::vector<Token> tokens = lexer.tokenize();
+    if(CompileStats::enabled) {
+        // Lexed up front so the report can tell lexing and parsing apart
+        Parser parser(lexer.tokenize());
+        return parser.parseProgram();
+    }
+    Parser parser(lexer); //STREAMING : TOKENS ARE LEXED AS THE PARSER ASKS FOR THEM
+    return parser.parseProgram();
+}
 
-    for(const Token& token : tokens) {
-        std::cout<<token.toString()<<std::endl;
+void printErrors(const std::string& name , const std::vector<ParseError>& errors) {
+    for(const ParseError& error : errors) {
+        std::cerr<<name<<" : "<<error.toString()<<"\n";
     }
 }
 
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if(!file) {
-        std::cerr<<"Error : Could not open file "<<filename<<std::endl;
+void printErrors(const std::string& name , const std::vector<CompileError>& errors) {
+    for(const CompileError& error : errors) {
+        std::cerr<<name<<" : "<<error.toString()<<"\n";
+    }
+}
+
+// Parse through the cache when there is one , reporting hits and misses.
+// Stops after listing every syntax error , nothing runs on a partial AST.
+Program loadProgram(const SourceBuffer& source , size_t jobs , AstCache* cache) {
+    Program program;
+    if(cache && cache->load(source.view() , program)) {
+        std::cerr<<"cache : hit "<<source.name()<<std::endl;
+        return program;
+    }
+    program = parseSource(source.view() , jobs);
+    if(!program.errors.empty()) {
+        printErrors(source.name() , program.errors);
         exit(1);
     }
-    std::string content((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
-    file.close();
-    return content;
+    if(!cache) return program;
+    std::string path = cache->pathFor(AstCache::hashSource(source.view()));
+    if(cache->store(source.view() , program)) std::cerr<<"cache : miss "<<source.name()<<" , stored "<<path<<std::endl;
+    else std::cerr<<"cache : miss "<<source.name()<<" , could not write "<<path<<std::endl;
+    return program;
 }
 
-int main(int argc , char* argv[]) {
-    if(argc < 2) {
-        std::cerr<<"Usage : ./stryx_lexer <filename.styx>"<<std::endl;
+// List every compile error the resolver finds , as loadProgram lists
+// syntax errors. The optimizer and the compiler resolve again , harmlessly.
+bool resolveNames(const SourceBuffer& source , Program& program) {
+    std::vector<CompileError> errors = resolveProgram(program);
+    printErrors(source.name() , errors);
+    return errors.empty();
+}
+
+void optimize(Program& program) {
+    OptimizerStats stats = optimizeProgram(program);
+    std::cerr<<"optimizer : "<<stats.eliminated()<<" of "<<stats.nodesBefore<<" nodes eliminated ("
+             <<stats.folded<<" folded , "<<stats.simplified<<" simplified , "<<stats.propagated<<" propagated , "
+             <<stats.branchesPruned<<" branches pruned)"<<std::endl;
+}
+
+// Parse and write each function as soon as it is parsed , then drop its
+// nodes : memory stays flat however large the source. With syntax errors
+// the functions that parsed are still written and the exit status is 1.
+int streamParser(const SourceBuffer& source , AstFormat format) {
+    Lexer lexer(source.view());
+    Parser parser(lexer);
+    AstSerializer out(std::cout , format);
+    out.beginProgram();
+    FunctionDecl* fn;
+    for(;;) {
+        AstArena arena; // its blocks go back to the block cache for the next function
+        if(!parser.parseNextFunction(arena , fn)) break;
+        if(fn) out.function(fn);
+    }
+    out.endProgram(parser.errors());
+    printErrors(source.name() , parser.errors());
+    return parser.errors().empty() ? 0 : 1;
+}
+
+int runParser(const SourceBuffer& source , size_t jobs , AstCache* cache , bool flat , bool opt , AstFormat format) {
+    // The parallel parser , the cache , the optimizer and --stats want the whole program
+    if(jobs == 1 && !cache && !opt && !flat && !CompileStats::enabled) return streamParser(source , format);
+
+    Program program = loadProgram(source , jobs , cache);
+    if(opt) {
+        if(!resolveNames(source , program)) return 1;
+        optimize(program);
+    }
+
+    if(flat) {
+        FlatAST ast = FlatAST::fromProgram(program);
+        for(NodeId fn : ast.functions()) {
+            ast.print(fn);
+            std::cout<<std::endl;
+        }
+        return 0;
+    }
+
+    AstSerializer(std::cout , format).program(program);
+    return 0;
+}
+
+// Compile to bytecode and call main() , printing what it returns
+int runProgram(const SourceBuffer& source , size_t jobs , AstCache* cache , bool disasm , bool opt , bool native) {
+    Program program = loadProgram(source , jobs , cache);
+    if(!resolveNames(source , program)) return 1;
+    if(opt) optimize(program);
+    std::vector<CompileError> errors;
+    Module module = compileProgram(program , errors);
+    if(!errors.empty()) {
+        printErrors(source.name() , errors);
         return 1;
     }
-    std::string source = readFile(argv[1]);
-    runLexer(source);
+    if(disasm) {
+        module.disassemble();
+        return 0;
+    }
+    long entry = module.find(symbols().intern("main"));
+    if(entry < 0) {
+        std::cerr<<"Error : no main() function"<<std::endl;
+        return 1;
+    }
+    VM vm;
+    Jit jit(program , module);
+    if(native) vm.attach(&jit);
+    Value result;
+    {
+        PhaseTimer timer(Phase::RUN);
+        result = vm.run(module , static_cast<uint32_t>(entry));
+    }
+    bool failed = !vm.error().empty();
+    if(failed) std::cerr<<"Runtime Error : "<<vm.error()<<"\n";
+    if(CompileStats::enabled) CompileStats::local().heap.add(vm.heapStats());
+    if(native) {
+        const Jit::Stats& stats = jit.stats();
+        std::cerr<<"jit : "<<stats.compiled<<" variants compiled ("<<stats.codeBytes<<" bytes) , "
+                 <<stats.rejected<<" rejected , "<<stats.nativeCalls<<" native calls , "
+                 <<stats.bailouts<<" bailouts"<<std::endl;
+    }
+    if(failed) return 1;
+    if(result.type != ValueType::NIL) {
+        printValue(std::cout , result);
+        std::cout<<std::endl;
+    }
+    return 0;
+}
 
+// Parse every file in this one process and list all of their syntax errors
+int checkFiles(const std::vector<std::string>& files , size_t jobs) {
+    size_t errors = 0;
+    size_t failed = 0;
+    for(const std::string& file : files) {
+        SourceBuffer source;
+        if(!source.open(file)) {
+            std::cerr<<"Error : Could not open file "<<file<<" : "<<std::strerror(errno)<<std::endl;
+            failed++;
+            continue;
+        }
+        Program program = parseSource(source.view() , jobs);
+        printErrors(file , program.errors);
+        errors += program.errors.size();
+        if(!program.errors.empty()) failed++;
+    }
+    std::cerr<<"checked "<<files.size()<<" files , "<<errors<<" errors"<<std::endl;
+    return failed ? 1 : 0;
+}
+
+// The same check through a running daemon , its output matches checkFiles()
+int checkOnServer(const std::string& socketPath , const std::vector<std::string>& files) {
+    std::string request;
+    for(const std::string& file : files) {
+        char* absolute = realpath(file.c_str() , nullptr); // the daemon resolves paths from its own directory
+        request += "check " + std::string(absolute ? absolute : file.c_str()) + "\n";
+        free(absolute);
+    }
+    request += "end\n";
+    std::string reply;
+    if(!requestServer(socketPath , request , reply)) {
+        std::cerr<<"Error : Could not reach stryxd at "<<socketPath<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+
+    // Replies come back in request order , so every line is shown under the name the user gave
+    size_t next = 0 , errors = 0 , failed = 0;
+    const std::string* file = nullptr;
+    size_t start = 0;
+    bool done = false;
+    while(start < reply.size()) {
+        size_t end = reply.find('\n' , start);
+        std::string line = reply.substr(start , end - start);
+        start = end + 1;
+        if(line.compare(0 , 5 , "file ") == 0 || line.compare(0 , 11 , "unreadable ") == 0) {
+            if(next == files.size()) break;
+            file = &files[next++];
+            if(line[0] == 'u') {
+                std::cerr<<"Error : Could not open file "<<*file<<" : "<<line.substr(11 , line.rfind(' ') - 11)<<std::endl;
+                failed++;
+            } else if(line.compare(0 , 7 , "file 0 ") != 0) {
+                failed++;
+            }
+        } else if(line.compare(0 , 6 , "lexer ") == 0) {
+            std::cerr<<line.substr(6)<<"\n"; // as the lexer itself prints it
+        } else if(line.compare(0 , 6 , "error ") == 0 && file) {
+            std::cerr<<*file<<" : "<<line.substr(6)<<"\n";
+            errors++;
+        } else if(line.compare(0 , 5 , "done ") == 0) {
+            done = true;
+        }
+    }
+    if(!done || next != files.size()) {
+        std::cerr<<"Error : incomplete reply from stryxd"<<std::endl;
+        return 1;
+    }
+    std::cerr<<"checked "<<files.size()<<" files , "<<errors<<" errors"<<std::endl;
+    return failed ? 1 : 0;
+}
+
+// Serve checks on a Unix socket until a `shutdown` request
+int runDaemon(const std::string& socketPath , size_t jobs , size_t memoryMb) {
+    CompileServer server(socketPath , jobs , memoryMb << 20);
+    if(!server.listen()) {
+        if(errno == EADDRINUSE) std::cerr<<"Error : daemon already running on "<<socketPath<<std::endl;
+        else if(errno == ENOTSOCK) std::cerr<<"Error : "<<socketPath<<" exists and is not a socket"<<std::endl;
+        else std::cerr<<"Error : Could not listen on "<<socketPath<<" : "<<std::strerror(errno)<<std::endl;
+        return 1;
+    }
+    std::cerr<<"stryxd : listening on "<<socketPath<<std::endl;
+    server.run();
+    CompileServer::Stats stats = server.stats();
+    std::cerr<<"stryxd : "<<stats.batches<<" batches , "<<stats.files<<" files , "<<stats.hits<<" hits , "
+             <<stats.misses<<" misses , "<<stats.evictions<<" evictions"<<std::endl;
+    if(stats.symbolBytes > (memoryMb << 20)) {
+        std::cerr<<"stryxd : interned symbols passed the "<<memoryMb<<" MB budget , restart to release them"<<std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+SourceBuffer readFile(const std::string& filename) {
+    SourceBuffer buffer;
+    if(!buffer.open(filename)) {
+        std::cerr<<"Error : Could not open file "<<filename<<" : "<<std::strerror(errno)<<std::endl;
+        exit(1);
+    }
+    return buffer;
+}
+
+// --stats prints a table , --stats=json one JSON object , both on stderr
+bool report(const std::string& stats , const std::string& tracePath) {
+    if(stats == "table") CompileStats::printTable(std::cerr);
+    else if(stats == "json") CompileStats::printJson(std::cerr);
+    if(tracePath.empty()) return true;
+    std::ofstream trace(tracePath);
+    if(trace) CompileStats::writeTrace(trace);
+    if(!trace) {
+        std::cerr<<"Error : Could not write "<<tracePath<<" : "<<std::strerror(errno)<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+void usage() {
+    std::cerr<<"Usage : ./stryx_lexer [--parse [--flat | --format text|json|sexpr]] [--optimize] [--jobs N] [--cache DIR] [--stats[=json]] [--trace FILE] <filename.styx>"<<std::endl;
+    std::cerr<<"        ./stryx_lexer run [--disasm] [--optimize] [--jit] [--jobs N] [--cache DIR] [--stats[=json]] [--trace FILE] <filename.styx>"<<std::endl;
+    std::cerr<<"        ./stryx_lexer check [--jobs N | --server SOCKET] <filename.styx>..."<<std::endl;
+    std::cerr<<"        ./stryx_lexer daemon [--jobs N] [--socket SOCKET] [--memory MB]   (also run as stryxd)"<<std::endl;
+}
+
+int main(int argc , char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    std::string self = argv[0];
+    bool run = mode == "run";
+    bool check = mode == "check";
+    bool daemon = mode == "daemon" || self.substr(self.rfind('/') + 1) == "stryxd";
+    bool parse = false;
+    bool flat = false;
+    AstFormat format = AstFormat::TEXT;
+    bool disasm = false;
+    bool opt = false;
+    bool native = false;
+    size_t jobs = 1;
+    std::string cacheDir;
+    std::string stats;
+    std::string tracePath;
+    std::string filename;
+    std::vector<std::string> files;
+    std::string socketPath;
+    size_t memoryMb = 256;
+    for(int i = run || check || mode == "daemon" ? 2 : 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--disasm" && run) {
+            disasm = true;
+        } else if(arg == "--jit" && run) {
+            native = true;
+        } else if(arg == "--optimize") {
+            opt = true;
+        } else if(arg == "--parse") {
+            parse = true;
+        } else if(arg == "--flat") {
+            parse = true;
+            flat = true;
+        } else if(arg == "--format" && i + 1 < argc) {
+            parse = true;
+            if(!parseAstFormat(argv[++i] , format)) {
+                std::cerr<<"Error : Unknown format "<<argv[i]<<" , expected text , json or sexpr"<<std::endl;
+                return 1;
+            }
+        } else if(arg == "--jobs" && i + 1 < argc) {
+            jobs = std::stoul(argv[++i]);
+        } else if(arg == "--cache" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if(arg == "--stats") {
+            stats = "table";
+        } else if(arg == "--stats=json") {
+            stats = "json";
+        } else if((arg == "--server" || arg == "--socket") && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if(arg == "--memory" && daemon && i + 1 < argc) {
+            memoryMb = std::stoul(argv[++i]);
+        } else if(arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else {
+            filename = arg;
+            files.push_back(arg);
+        }
+    }
+    if(flat && format != AstFormat::TEXT) {
+        std::cerr<<"Error : --flat prints text only"<<std::endl;
+        return 1;
+    }
+    if(!stats.empty() || !tracePath.empty()) CompileStats::enable();
+    if(daemon) {
+        // Without --jobs the daemon takes every hardware thread
+        int status = runDaemon(socketPath.empty() ? defaultSocketPath() : socketPath , jobs == 1 ? 0 : jobs , memoryMb);
+        if(CompileStats::enabled && !report(stats , tracePath)) return 1;
+        return status;
+    }
+    if(filename.empty()) {
+        usage();
+        return 1;
+    }
+    if(check) {
+        int status = socketPath.empty() ? checkFiles(files , jobs) : checkOnServer(socketPath , files);
+        if(CompileStats::enabled && !report(stats , tracePath)) return 1;
+        return status;
+    }
+
+    SourceBuffer source = readFile(filename);
+    AstCache cache(cacheDir);
+    AstCache* useCache = cacheDir.empty() ? nullptr : &cache;
+    int status = 0;
+    if(run) {
+        status = runProgram(source , jobs , useCache , disasm , opt , native);
+    } else if(parse) {
+        status = runParser(source , jobs , useCache , flat , opt , format);
+    } else {
+        runLexer(source.view() , jobs);
+    }
+
+    if(CompileStats::enabled && !report(stats , tracePath)) return 1;
+    return status;
+}
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AstCache.h"
+#include "AstSerializer.h"
+#include "Incremental.h"
+#include "Lexer.h"
+#include "ParallelParser.h"
+#include "ParallelLexer.h"
+#include "Parser.h"
+#include "SourceBuffer.h"
+#include "ThreadPool.h"
+#include "WorkStealingPool.h"
+
+// Checks that the parallel and incremental front ends , and the compacted
+// copy stryxd caches , agree with a plain sequential lex and parse : same
+// tokens , same AST , same errors , on the sources below and on every file
+// named on the command line. Exits 1 on the
+// first disagreement.
+// Build with the sources in src/ and include/ , like the driver.
+
+// Unbalanced input , where the boundary scanner has to end a function where
+// the recovering parser does , and lines the lexer has to count
+static const char* const SOURCES[] = {
+    "fn a() { let x = 1;\nfn b() { return 2; }\n}\nfn main() { return 1; }\n",
+    "fn a() { let x = 1;\nfn b() { return 2; }\nfn main() { return 1; }\n",
+    "fn a() { if (x) { while (y) { let z = 1;\nfn b() { return 2; }\nfn c() { return 3; }\n",
+    "fn a() { return 1; }\n}\nfn b() { return 2; }\nfn c() { { }\n",
+    "fn a( { return 1; }\nfn b() { match x { 1 => {\nfn c() { return 3; } fn d() { }\n",
+    "fn a() { return 1; } fn b() { return 2; } fn c() { return 3; } fn d() { return 4; }\n",
+    // String literals spanning lines , their tokens are on the line they open on
+    "fn a() { let s = \"x\ny\n\"; return s; }\nfn b() { return \"p\nq\" + 1; }\nfn c() { return 3; }\n",
+    // Keywords and literals where a let , var or assignment names a variable
+    "fn main() { let 5 = 1; let fn = 2; return 0; }\nfn b() { var \"s\" = 1; let _ = 2; let\nreturn 3; }\n",
+};
+
+// JSON of the AST and every error in full , the form the two parses are compared in
+static std::string dump(const Program& program) {
+    std::ostringstream out;
+    AstSerializer(out , AstFormat::JSON).program(program);
+    for(const ParseError& error : program.errors) out<<error.toString()<<"\n";
+    return out.str();
+}
+
+static std::string sequential(std::string_view source) {
+    TokenStream tokens = Lexer(source).tokenize();
+    return dump(Parser(tokens , 0 , tokens.size()).parseProgram());
+}
+
+static bool same(const std::string& name , const char* what , const std::string& expected , const std::string& got) {
+    if(expected == got) return true;
+    std::cerr<<name<<" : "<<what<<" differs from the sequential parse\n--- sequential\n"<<expected<<"--- "<<what<<"\n"<<got;
+    return false;
+}
+
+// Every field of every token , then what the lexer wrote to std::cerr
+static std::string lexDump(std::string_view source , ThreadPool* pool) {
+    std::ostringstream messages;
+    std::streambuf* saved = std::cerr.rdbuf(messages.rdbuf());
+    TokenStream tokens = pool ? tokenizeParallel(source , *pool , 1) : Lexer(source).tokenize();
+    std::cerr.rdbuf(saved);
+    std::ostringstream out;
+    for(size_t i = 0; i < tokens.size(); i++) {
+        out<<tokenSpelling(tokens.kind(i))<<" "<<tokens.offset(i)<<" "<<tokens.length(i)<<" "<<tokens.line(i)<<" ";
+        if(isNumberLiteral(tokens.kind(i)) && tokens.symbol(i) != TokenStream::NO_NUMBER) out<<tokens.number(i).i;
+        else out<<tokens.symbol(i);
+        out<<"\n";
+    }
+    return out.str() + messages.str();
+}
+
+// The source as is and with a NUL or a stray character dropped in at random ,
+// lexed in chunks as small as the pool allows
+static bool checkLexer(const std::string& name , const std::string& source , ThreadPool& pool) {
+    std::mt19937 rng(11);
+    for(int i = 0; i < 100; i++) {
+        std::string text = source;
+        if(i > 0) text.insert(rng() % (text.size() + 1) , 1 , i % 2 ? '\0' : '@');
+        std::string label = "tokenizeParallel , variant " + std::to_string(i);
+        if(!same(name , label.c_str() , lexDump(text , nullptr) , lexDump(text , &pool))) return false;
+    }
+    return true;
+}
+
+static bool check(const std::string& name , const std::string& source , WorkStealingPool& pool) {
+    std::string expected = sequential(source);
+    TokenStream tokens = Lexer(source).tokenize();
+    Program parallel = parseParallel(tokens , pool , 1);
+    if(!same(name , "parseParallel" , expected , dump(parallel))) return false;
+    if(!same(name , "compactProgram" , expected , dump(compactProgram(parallel)))) return false;
+    IncrementalDocument doc(source);
+    if(!same(name , "IncrementalDocument" , expected , dump(doc.ast()))) return false;
+
+    // Random edits that open and close blocks and functions , each compared with a parse from scratch
+    static const char* const PIECES[] = {"{" , "}" , "fn f() {" , "fn" , " " , "\n" , ";" , "return 1;" , ""};
+    std::mt19937 rng(7);
+    for(int i = 0; i < 200; i++) {
+        size_t size = doc.source().size();
+        size_t offset = size ? rng() % (size + 1) : 0;
+        size_t removed = offset < size ? rng() % std::min<size_t>(4 , size - offset + 1) : 0;
+        std::string inserted = PIECES[rng() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+        IncrementalDocument::EditStats stats;
+        if(!doc.apply(TextEdit{offset , removed , inserted} , stats)) {
+            std::cerr<<name<<" : IncrementalDocument rejected edit "<<i<<" at "<<offset<<" + "<<removed<<"\n";
+            return false;
+        }
+        std::string label = "IncrementalDocument after edit " + std::to_string(i);
+        if(!same(name , label.c_str() , sequential(doc.source()) , dump(doc.ast()))) return false;
+    }
+    // Edits past the end are refused and change nothing
+    std::string before = doc.source();
+    IncrementalDocument::EditStats stats;
+    if(doc.apply(TextEdit{before.size() + 1 , 0 , "x"} , stats) || doc.apply(TextEdit{0 , before.size() + 1 , ""} , stats)
+       || doc.source() != before) {
+        std::cerr<<name<<" : IncrementalDocument accepted an edit out of range\n";
+        return false;
+    }
+    return true;
+}
+
+// A name that is not an identifier or `_` is an error of its own , and the
+// statements after it still parse
+static bool checkBindingNames() {
+    std::string source = "fn main() { let 5 = 1; let fn = 2; return 0; }";
+    TokenStream tokens = Lexer(source).tokenize();
+    Program program = Parser(tokens , 0 , tokens.size()).parseProgram();
+    size_t named = 0;
+    for(const ParseError& error : program.errors) named += error.message == "expected variable name";
+    if(program.errors.size() == 2 && named == 2 && program.functions.size() == 1
+       && program.functions[0]->body.size() == 1) return true;
+    std::cerr<<"binding names : expected two 'expected variable name' errors and the return , got\n"<<dump(program);
+    return false;
+}
+
+// A source past 32-bit offsets is reported , not lexed , by both lexers.
+// Nothing past the first byte of the view below is ever read.
+static bool checkSourceTooLarge(ThreadPool& pool) {
+    static const char text[] = "fn";
+    std::string_view huge(text , size_t(UINT32_MAX) + 1);
+    std::vector<LexError> errors;
+    Lexer lexer(huge);
+    lexer.captureErrors(errors);
+    TokenStream tokens = lexer.tokenize();
+    std::ostringstream messages;
+    std::streambuf* saved = std::cerr.rdbuf(messages.rdbuf());
+    TokenStream chunked = tokenizeParallel(huge , pool , 1);
+    std::cerr.rdbuf(saved);
+    if(tokens.size() == 1 && chunked.size() == 1 && errors.size() == 1 && errors[0].kind == LexError::SOURCE_TOO_LARGE
+       && messages.str() == errors[0].toString() + "\n") return true;
+    std::cerr<<"source too large : expected one SOURCE_TOO_LARGE error and only END_OF_FILE , got\n"<<messages.str();
+    return false;
+}
+
+int main(int argc , char* argv[]) {
+    WorkStealingPool pool(4);
+    ThreadPool lexPool(4);
+    size_t checked = 0;
+    if(!checkBindingNames() || !checkSourceTooLarge(lexPool)) return 1;
+    for(const char* source : SOURCES) {
+        std::string name = "source " + std::to_string(checked);
+        if(!checkLexer(name , source , lexPool) || !check(name , source , pool)) return 1;
+        checked++;
+    }
+    for(int i = 1; i < argc; i++) {
+        SourceBuffer source;
+        if(!source.open(argv[i])) {
+            std::cerr<<"Error : Could not open file "<<argv[i]<<std::endl;
+            return 1;
+        }
+        std::string text(source.view());
+        if(!checkLexer(argv[i] , text , lexPool) || !check(argv[i] , text , pool)) return 1;
+        checked++;
+    }
+    std::cout<<"parallel_check : "<<checked<<" sources agree"<<std::endl;
+    return 0;
+}